@@ -13,6 +13,31 @@
 #include "../src/control_flow.hpp"
 #include "../src/variable_registry.hpp"
 #include "../src/pointers.hpp"
+#include "../src/instruction_set.hpp"
+#include "../src/module.hpp"
+#include "../src/validator.hpp"
+#include "../src/disassembler.hpp"
+#include "../src/assembler.hpp"
+#include "../src/graph_export.hpp"
+#include "../src/trace.hpp"
+#include "../src/node_cache.hpp"
+#include "../src/constant_folding.hpp"
+#include "../src/algebraic_simplification.hpp"
+#include "../src/dead_code_elimination.hpp"
+#include "../src/dead_store_elimination.hpp"
+#include "../src/loop_unrolling.hpp"
+#include "../src/select_lowering.hpp"
+#include "../src/local_promotion.hpp"
+#include "../src/strength_reduction.hpp"
+#include "../src/fma_contraction.hpp"
+#include "../src/load_elimination.hpp"
+#include "../src/store_forwarding.hpp"
+#include "../src/invariant_hoisting.hpp"
+#include "../src/code_sinking.hpp"
+#include "../src/slp_vectorization.hpp"
+#include "../src/pass_manager.hpp"
+#include "../src/functions.hpp"
+#include "../src/function_inlining.hpp"
 
 #include "../src/utils_impl.hpp"
 #include "../src/expressions_impl.hpp"
@@ -24,5 +49,10 @@
 #include "../src/event_registry_impl.hpp"
 #include "../src/variable_registry_impl.hpp"
 #include "../src/pointers_impl.hpp"
+#include "../src/node_cache_impl.hpp"
+#include "../src/constant_folding_impl.hpp"
+#include "../src/algebraic_simplification_impl.hpp"
+#include "../src/loop_unrolling_impl.hpp"
+#include "../src/functions_impl.hpp"
 
 #endif // ndef __SPURV_SPURV
@@ -0,0 +1,55 @@
+#include "algebraic_simplification.hpp"
+
+#include <algorithm>
+
+namespace spurv {
+
+  /*
+   * SAlgebraicSimplifier members
+   */
+
+  bool SAlgebraicSimplifier::enabled = true;
+  bool SAlgebraicSimplifier::fast_math = false;
+
+
+  /*
+   * SAlgebraicSimplifier member functions
+   */
+
+  bool SAlgebraicSimplifier::is_all(const std::vector<double>& values, double value) {
+    return std::all_of(values.begin(), values.end(), [value](double v) { return v == value; });
+  }
+
+  bool SAlgebraicSimplifier::is_identity(const std::vector<double>& values, int n) {
+    if(n < 2 || (int)values.size() != n * n) {
+      return false;
+    }
+
+    for(int i = 0; i < n; i++) {
+      for(int j = 0; j < n; j++) {
+	if(values[i * n + j] != (i == j ? 1.0 : 0.0)) {
+	  return false;
+	}
+      }
+    }
+
+    return true;
+  }
+
+  void SAlgebraicSimplifier::setEnabled(bool enabled) {
+    SAlgebraicSimplifier::enabled = enabled;
+  }
+
+  bool SAlgebraicSimplifier::isEnabled() {
+    return SAlgebraicSimplifier::enabled;
+  }
+
+  void SAlgebraicSimplifier::setFastMath(bool fast_math) {
+    SAlgebraicSimplifier::fast_math = fast_math;
+  }
+
+  bool SAlgebraicSimplifier::isFastMath() {
+    return SAlgebraicSimplifier::fast_math;
+  }
+
+};
@@ -0,0 +1,88 @@
+#ifndef __SPURV_ALGEBRAIC_SIMPLIFICATION
+#define __SPURV_ALGEBRAIC_SIMPLIFICATION
+
+#include "declarations.hpp"
+#include "types.hpp"
+
+#include <vector>
+
+namespace spurv {
+
+  /*
+   * SAlgebraicSimplifier - Rewrites expressions with an identity operand, or on the same
+   * value twice, into simpler ones while the shader is recorded. It runs in the expression
+   * factory after SConstantFolder, and before SNodeCache looks for an equal node, so that
+   * simplified expressions are shared like any other.
+   *
+   * Below, 0, 1 and -1 are constants with all components equal to that value, and I is an
+   * identity matrix (like one made from a falg::Matrix). Rules marked fast only apply to
+   * floats when fast math is on, as they are wrong for NaN, infinities or -0. The rest hold
+   * for every input:
+   *
+   *   x * 1, 1 * x, x / 1       ->  x
+   *   x * -1, -1 * x            ->  -x
+   *   x - 0                     ->  x      (not for x - (-0), which is x + 0)
+   *   x + 0, 0 + x              ->  x      fast, -0 + 0 is 0
+   *   0 - x                     ->  -x     fast, 0 - 0 is 0
+   *   x * 0, 0 * x              ->  0      fast, NaN * 0 is NaN
+   *   x - x                     ->  0      fast, inf - inf is NaN
+   *   -(-x)                     ->  x
+   *   I * x, x * I              ->  x      fast, the products by zero in the sums
+   *   cast<A>(x)                ->  x      for x of type A
+   *   cast<A>(cast<B>(x))       ->  x      for x of type A, and B at least as wide and of the same kind
+   *   x < x, x > x, x != x      ->  false  (comparisons of floats are ordered)
+   *   x == x, x <= x, x >= x    ->  true   fast, false for NaN
+   *
+   * Negations are only made for signed integers and floats, and zeros and booleans only
+   * for scalars. Values are the same only if they are the same node, which SNodeCache
+   * makes equal expressions. Each rule, and whether it needs fast math, is checked by the
+   * table in tests/algebraic_simplification_test.cpp, which is to be kept in step with this one
+   */
+
+  class SAlgebraicSimplifier {
+    static bool enabled;
+    static bool fast_math;
+
+    SAlgebraicSimplifier() = delete;
+
+    // Sets values to the components of v in row-major order and returns true, if v is a
+    // scalar constant or a constant vector or matrix
+    template<typename tt>
+    static bool get_constant(SValue<tt>& v, std::vector<double>& values);
+
+    static bool is_all(const std::vector<double>& values, double value);
+
+    // Whether the constant is the identity matrix
+    static bool is_identity(const std::vector<double>& values, int n);
+
+    // A constant of scalar type tt, null for other types
+    template<typename tt>
+    static SValue<tt>* make_constant(double value);
+
+    // -v, null for types without negation
+    template<typename tt>
+    static SValue<tt>* negate(SValue<tt>& v);
+
+    // Whether casting a value of type ta to type tb and back gives the value itself
+    template<typename ta, typename tb>
+    static constexpr bool is_round_trip_exact();
+
+  public:
+
+    // Simplification is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Allows the rules for floats that do not hold for NaN, infinities or signed zeros. Off
+    // by default. Applies to expressions recorded after it is set
+    static void setFastMath(bool fast_math);
+    static bool isFastMath();
+
+    // Used by the expression factory. Returns nullptr if the expression is not simplified
+    template<typename tt, SExprOp op, typename tt2, typename tt3>
+    static SValue<tt>* simplifyExpression(SValue<tt2>& v1, SValue<tt3>* v2);
+  };
+
+};
+
+#endif // __SPURV_ALGEBRAIC_SIMPLIFICATION
@@ -0,0 +1,230 @@
+#ifndef __SPURV_ALGEBRAIC_SIMPLIFICATION_IMPL
+#define __SPURV_ALGEBRAIC_SIMPLIFICATION_IMPL
+
+#include "algebraic_simplification.hpp"
+#include "constant_folding_impl.hpp"
+#include "values.hpp"
+
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+
+namespace spurv {
+
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  SValue<tt>& construct_expression(SValue<tt2>& v1, SValue<tt3>* v2);
+
+  // The type of each component of values of type tt
+  template<typename tt>
+  struct simplified_component {
+    using type = tt;
+  };
+
+  template<int n, int m, typename inner>
+  struct simplified_component<SMat<n, m, inner> > {
+    using type = inner;
+  };
+
+
+  /*
+   * SAlgebraicSimplifier member functions
+   */
+
+  template<typename tt>
+  bool SAlgebraicSimplifier::get_constant(SValue<tt>& v, std::vector<double>& values) {
+    if constexpr(is_spurv_mat_type<tt>::value) {
+      constexpr int n = tt::nn;
+      constexpr int m = tt::mm;
+      using inner = typename tt::inner_type;
+
+      ConstructMatrix<n, m, inner>* c = dynamic_cast<ConstructMatrix<n, m, inner>*>(&v);
+      if(!c || !c->is_constant) {
+	return false;
+      }
+
+      values.resize(n * m);
+      std::vector<double> constituent;
+      for(unsigned int i = 0; i < c->components.size(); i++) {
+	if(c->using_columns()) {
+	  if(!SAlgebraicSimplifier::get_constant(*(SValue<SMat<n, 1, inner> >*)c->components[i], constituent)) {
+	    return false;
+	  }
+
+	  for(int row = 0; row < n; row++) {
+	    values[row * m + i] = constituent[row];
+	  }
+	} else {
+	  if(!SAlgebraicSimplifier::get_constant(*(SValue<inner>*)c->components[i], constituent)) {
+	    return false;
+	  }
+
+	  values[i] = constituent[0];
+	}
+      }
+
+      return true;
+    } else if constexpr(std::is_void<typename InvMapSType<tt>::type>::value) {
+      return false;
+    } else {
+      typename InvMapSType<tt>::type value;
+      if(!SConstantFolder::getConstant(v, value)) {
+	return false;
+      }
+
+      values.assign(1, (double)value);
+      return true;
+    }
+  }
+
+  template<typename tt>
+  SValue<tt>* SAlgebraicSimplifier::make_constant(double value) {
+    if constexpr(is_spurv_mat_type<tt>::value || std::is_void<typename InvMapSType<tt>::type>::value) {
+      return nullptr;
+    } else {
+      using ctype = typename InvMapSType<tt>::type;
+      return SUtils::allocate<Constant<ctype> >((ctype)value);
+    }
+  }
+
+  template<typename tt>
+  SValue<tt>* SAlgebraicSimplifier::negate(SValue<tt>& v) {
+    using ct = typename simplified_component<tt>::type;
+    if constexpr(is_spurv_float_type<ct>::value || is_spurv_signed_int_type<ct>::value) {
+      return &construct_expression<tt, EXPR_NEGATIVE, tt, void_s>(v, nullptr);
+    } else {
+      return nullptr;
+    }
+  }
+
+  template<typename ta, typename tb>
+  constexpr bool SAlgebraicSimplifier::is_round_trip_exact() {
+    using ca = typename simplified_component<ta>::type;
+    using cb = typename simplified_component<tb>::type;
+
+    // Integer conversions keep the low bits, and widened floats hold every narrower value
+    if constexpr(is_spurv_int_type<ca>::value && is_spurv_int_type<cb>::value) {
+      return cb::getArg0() >= ca::getArg0();
+    } else if constexpr(is_spurv_float_type<ca>::value && is_spurv_float_type<cb>::value) {
+      return cb::getArg0() >= ca::getArg0();
+    } else {
+      return false;
+    }
+  }
+
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  SValue<tt>* SAlgebraicSimplifier::simplifyExpression(SValue<tt2>& v1, SValue<tt3>* v2) {
+    if(!SAlgebraicSimplifier::enabled) {
+      return nullptr;
+    }
+
+    constexpr bool same_types = std::is_same<tt, tt2>::value && std::is_same<tt, tt3>::value;
+
+    // Rules that do not hold for all floats hold for integers
+    const bool fast = !is_spurv_float_type<typename simplified_component<tt2>::type>::value ||
+      SAlgebraicSimplifier::fast_math;
+
+    std::vector<double> c1, c2;
+    bool k1 = false, k2 = false;
+    if constexpr(op == EXPR_ADDITION || op == EXPR_SUBTRACTION || op == EXPR_MULTIPLICATION ||
+		 op == EXPR_DIVISION || op == EXPR_DOT) {
+      k1 = SAlgebraicSimplifier::get_constant(v1, c1);
+      k2 = SAlgebraicSimplifier::get_constant(*v2, c2);
+    }
+
+    if constexpr(op == EXPR_ADDITION && same_types) {
+      if(fast && k2 && SAlgebraicSimplifier::is_all(c2, 0.0)) {
+	return &v1;
+      }
+      if(fast && k1 && SAlgebraicSimplifier::is_all(c1, 0.0)) {
+	return v2;
+      }
+    } else if constexpr(op == EXPR_SUBTRACTION && same_types) {
+      // x - (+0) is x also for x = -0
+      if(k2 && SAlgebraicSimplifier::is_all(c2, 0.0) &&
+	 std::none_of(c2.begin(), c2.end(), [](double v) { return std::signbit(v); })) {
+	return &v1;
+      }
+      if(fast && &v1 == v2) {
+	return SAlgebraicSimplifier::make_constant<tt>(0.0);
+      }
+      if(fast && k1 && SAlgebraicSimplifier::is_all(c1, 0.0)) {
+	return SAlgebraicSimplifier::negate(*v2);
+      }
+    } else if constexpr(op == EXPR_MULTIPLICATION) {
+      if constexpr(std::is_same<tt, tt2>::value) {
+	if(k2 && SAlgebraicSimplifier::is_all(c2, 1.0)) {
+	  return &v1;
+	}
+	if(k2 && SAlgebraicSimplifier::is_all(c2, -1.0)) {
+	  return SAlgebraicSimplifier::negate(v1);
+	}
+	if(fast && k2 && SAlgebraicSimplifier::is_all(c2, 0.0)) {
+	  return SAlgebraicSimplifier::make_constant<tt>(0.0);
+	}
+      }
+
+      if constexpr(std::is_same<tt, tt3>::value) {
+	if(k1 && SAlgebraicSimplifier::is_all(c1, 1.0)) {
+	  return v2;
+	}
+	if(k1 && SAlgebraicSimplifier::is_all(c1, -1.0)) {
+	  return SAlgebraicSimplifier::negate(*v2);
+	}
+	if(fast && k1 && SAlgebraicSimplifier::is_all(c1, 0.0)) {
+	  return SAlgebraicSimplifier::make_constant<tt>(0.0);
+	}
+      }
+    } else if constexpr(op == EXPR_DIVISION && same_types) {
+      if(k2 && SAlgebraicSimplifier::is_all(c2, 1.0)) {
+	return &v1;
+      }
+    } else if constexpr(op == EXPR_DOT) {
+      // Matrix products, dot products have vector operands
+      if constexpr(std::is_same<tt, tt3>::value && is_spurv_mat_type<tt2>::value &&
+		   tt2::nn == tt2::mm) {
+	if(fast && k1 && SAlgebraicSimplifier::is_identity(c1, tt2::nn)) {
+	  return v2;
+	}
+      }
+
+      if constexpr(std::is_same<tt, tt2>::value && is_spurv_mat_type<tt3>::value &&
+		   tt3::nn == tt3::mm) {
+	if(fast && k2 && SAlgebraicSimplifier::is_identity(c2, tt3::nn)) {
+	  return &v1;
+	}
+      }
+    } else if constexpr(op == EXPR_NEGATIVE && std::is_same<tt, tt2>::value) {
+      SExpr<tt, EXPR_NEGATIVE, tt, void_s>* negation = dynamic_cast<SExpr<tt, EXPR_NEGATIVE, tt, void_s>*>(&v1);
+      if(negation) {
+	return negation->v1;
+      }
+    } else if constexpr(op == EXPR_CAST) {
+      if constexpr(std::is_same<tt, tt2>::value) {
+	return &v1;
+      } else if constexpr(SAlgebraicSimplifier::is_round_trip_exact<tt, tt2>()) {
+	SExpr<tt2, EXPR_CAST, tt, void_s>* cast = dynamic_cast<SExpr<tt2, EXPR_CAST, tt, void_s>*>(&v1);
+	if(cast) {
+	  return cast->v1;
+	}
+      }
+    } else if constexpr((op == EXPR_EQUAL || op == EXPR_NOTEQUAL ||
+			 op == EXPR_LESSTHAN || op == EXPR_GREATERTHAN ||
+			 op == EXPR_LESSOREQUAL || op == EXPR_GREATEROREQUAL) &&
+			std::is_same<tt2, tt3>::value) {
+      if(&v1 == v2) {
+	if constexpr(op == EXPR_NOTEQUAL || op == EXPR_LESSTHAN || op == EXPR_GREATERTHAN) {
+	  return SAlgebraicSimplifier::make_constant<tt>(0.0);
+	} else {
+	  if(fast) {
+	    return SAlgebraicSimplifier::make_constant<tt>(1.0);
+	  }
+	}
+      }
+    }
+
+    return nullptr;
+  }
+
+};
+
+#endif // __SPURV_ALGEBRAIC_SIMPLIFICATION_IMPL
@@ -0,0 +1,693 @@
+#include "assembler.hpp"
+#include "instruction_set.hpp"
+
+#include <unordered_map>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+
+namespace spurv {
+
+  namespace {
+    const uint32_t spirv_magic_number = 0x07230203;
+
+    enum TokenType {
+      TOKEN_WORD, // Opcodes, enumerants, numbers and raw words
+      TOKEN_ID, // %12 or %name
+      TOKEN_STRING, // "...", quotes included
+      TOKEN_EQUALS
+    };
+
+    struct Token {
+      TokenType type;
+      const char* start;
+      size_t length;
+      int line;
+    };
+
+    struct NumberType {
+      bool is_float;
+      bool is_signed;
+      uint32_t width;
+    };
+
+    bool is_word_char(char c) {
+      return c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != ';' && c != '=' && c != '"';
+    }
+
+    bool is_instruction_start(const std::vector<Token>& tokens, size_t i) {
+      const Token& token = tokens[i];
+      if(token.type == TOKEN_ID) {
+	return i + 1 < tokens.size() && tokens[i + 1].type == TOKEN_EQUALS;
+      }
+      return token.type == TOKEN_WORD && token.length > 2 && token.start[0] == 'O' && token.start[1] == 'p';
+    }
+
+
+    /*
+     * AssemblyContext - State for one call to SAssembler::assemble
+     */
+
+    class AssemblyContext {
+      const char* text;
+      size_t length;
+      std::vector<uint32_t>& res;
+      std::string& error_message;
+
+      uint32_t version;
+      uint32_t generator;
+      uint32_t bound;
+      uint32_t schema;
+
+      std::vector<Token> tokens;
+      std::unordered_map<std::string, uint32_t> named_ids;
+      std::unordered_map<uint32_t, NumberType> number_types;
+      uint32_t next_named_id;
+      uint32_t max_id;
+
+      // The operand tokens of the instruction being assembled
+      size_t current;
+      size_t end;
+      std::vector<uint32_t> words;
+
+      bool error(const Token& token, const std::string& message);
+      void read_header_comment(const char* start, const char* stop);
+      bool tokenize();
+
+      bool at_end() const;
+      bool parse_id(const Token& token, uint32_t* id);
+      bool parse_number(const Token& token, uint32_t* word);
+      bool parse_string(const Token& token);
+      bool parse_enum(const Token& token, SOperandKind kind, uint32_t* value);
+      bool parse_any(const Token& token);
+      bool parse_typed_literals(uint32_t type_id);
+      bool parse_rest();
+      bool parse_operands(const SInstructionInfo* info, const Token& opcode_token);
+
+    public:
+      AssemblyContext(const char* text, size_t length, std::vector<uint32_t>& res, std::string& error);
+
+      bool run();
+    };
+
+    AssemblyContext::AssemblyContext(const char* text, size_t length, std::vector<uint32_t>& res,
+				     std::string& error)
+      : text(text), length(length), res(res), error_message(error),
+	version(0x00010000), generator(0), bound(0), schema(0),
+	next_named_id(0), max_id(0), current(0), end(0) { }
+
+    bool AssemblyContext::error(const Token& token, const std::string& message) {
+      this->error_message = "line " + std::to_string(token.line) + ": " + message +
+	" (at \"" + std::string(token.start, token.length) + "\")";
+      return false;
+    }
+
+    // "; Version: 1.0", "; Generator: 0x124", "; Bound: 52" and "; Schema: 0"
+    void AssemblyContext::read_header_comment(const char* start, const char* stop) {
+      std::string comment(start, stop);
+      size_t colon = comment.find(':');
+      if(colon == std::string::npos) {
+	return;
+      }
+
+      size_t key_start = comment.find_first_not_of("; \t");
+      if(key_start == std::string::npos || key_start > colon) {
+	return;
+      }
+      std::string key = comment.substr(key_start, colon - key_start);
+      const char* value = comment.c_str() + colon + 1;
+
+      if(key == "Version") {
+	char* dot;
+	unsigned long major = strtoul(value, &dot, 10);
+	unsigned long minor = *dot == '.' ? strtoul(dot + 1, nullptr, 10) : 0;
+	this->version = (uint32_t)((major << 16) | (minor << 8));
+      } else if(key == "Generator") {
+	this->generator = (uint32_t)strtoul(value, nullptr, 0);
+      } else if(key == "Bound") {
+	this->bound = (uint32_t)strtoul(value, nullptr, 0);
+      } else if(key == "Schema") {
+	this->schema = (uint32_t)strtoul(value, nullptr, 0);
+      }
+    }
+
+    bool AssemblyContext::tokenize() {
+      const char* p = this->text;
+      const char* stop = this->text + this->length;
+      int line = 1;
+
+      while(p < stop) {
+	char c = *p;
+
+	if(c == '\n') {
+	  line++;
+	  p++;
+	} else if(c == ' ' || c == '\t' || c == '\r') {
+	  p++;
+	} else if(c == ';') {
+	  const char* comment_start = p;
+	  while(p < stop && *p != '\n') {
+	    p++;
+	  }
+	  if(this->tokens.size() == 0) {
+	    this->read_header_comment(comment_start, p);
+	  }
+	} else if(c == '=') {
+	  this->tokens.push_back({TOKEN_EQUALS, p, 1, line});
+	  p++;
+	} else if(c == '"') {
+	  const char* start = p;
+	  int start_line = line;
+	  p++;
+	  while(p < stop && *p != '"') {
+	    if(*p == '\\' && p + 1 < stop) {
+	      p++;
+	    }
+	    if(*p == '\n') {
+	      line++;
+	    }
+	    p++;
+	  }
+	  if(p >= stop) {
+	    return this->error({TOKEN_STRING, start, 1, start_line}, "Unterminated string");
+	  }
+	  p++;
+	  this->tokens.push_back({TOKEN_STRING, start, (size_t)(p - start), start_line});
+	} else {
+	  const char* start = p;
+	  while(p < stop && is_word_char(*p)) {
+	    p++;
+	  }
+	  Token token = {c == '%' ? TOKEN_ID : TOKEN_WORD, start, (size_t)(p - start), line};
+	  if(token.type == TOKEN_ID && token.length < 2) {
+	    return this->error(token, "Empty id");
+	  }
+	  this->tokens.push_back(token);
+	}
+      }
+
+      return true;
+    }
+
+    bool AssemblyContext::at_end() const {
+      return this->current >= this->end;
+    }
+
+    bool AssemblyContext::parse_id(const Token& token, uint32_t* id) {
+      if(token.type != TOKEN_ID) {
+	return this->error(token, "Expected an id");
+      }
+
+      const char* name = token.start + 1;
+      size_t name_length = token.length - 1;
+
+      bool numeric = true;
+      for(size_t i = 0; i < name_length; i++) {
+	numeric = numeric && name[i] >= '0' && name[i] <= '9';
+      }
+
+      if(numeric) {
+	errno = 0;
+	unsigned long long value = strtoull(name, nullptr, 10);
+	if(errno || value == 0 || value > 0xffffffffull) {
+	  return this->error(token, "Id out of range");
+	}
+	*id = (uint32_t)value;
+      } else {
+	std::string key(name, name_length);
+	auto it = this->named_ids.find(key);
+	if(it == this->named_ids.end()) {
+	  it = this->named_ids.insert({key, this->next_named_id++}).first;
+	}
+	*id = it->second;
+      }
+
+      this->max_id = std::max(this->max_id, *id);
+      return true;
+    }
+
+    bool AssemblyContext::parse_number(const Token& token, uint32_t* word) {
+      if(token.type != TOKEN_WORD || token.length == 0) {
+	return this->error(token, "Expected a number");
+      }
+
+      std::string str(token.start, token.length);
+      const char* s = str.c_str();
+      bool raw = s[0] == '!';
+      if(raw) {
+	s++;
+      }
+
+      char* parse_end;
+      errno = 0;
+      if(s[0] == '-') {
+	long long value = strtoll(s, &parse_end, 0);
+	if(errno || *parse_end || value < INT32_MIN) {
+	  return this->error(token, "Invalid number");
+	}
+	*word = (uint32_t)(int32_t)value;
+      } else {
+	unsigned long long value = strtoull(s, &parse_end, 0);
+	if(errno || *parse_end || parse_end == s || value > 0xffffffffull) {
+	  return this->error(token, "Invalid number");
+	}
+	*word = (uint32_t)value;
+      }
+      return true;
+    }
+
+    bool AssemblyContext::parse_string(const Token& token) {
+      if(token.type != TOKEN_STRING) {
+	return this->error(token, "Expected a string");
+      }
+
+      uint32_t word = 0;
+      int byte = 0;
+      for(size_t i = 1; i + 1 < token.length; i++) {
+	char c = token.start[i];
+	if(c == '\\') {
+	  i++;
+	  c = token.start[i];
+	}
+	word |= (uint32_t)(uint8_t)c << (8 * byte);
+	if(++byte == 4) {
+	  this->words.push_back(word);
+	  word = 0;
+	  byte = 0;
+	}
+      }
+      // The terminating nul, padded to a full word
+      this->words.push_back(word);
+      return true;
+    }
+
+    bool AssemblyContext::parse_enum(const Token& token, SOperandKind kind, uint32_t* value) {
+      if(token.type != TOKEN_WORD) {
+	return this->error(token, "Expected an enumerant");
+      }
+
+      // Names are tried first, since some start with a digit (Dim 1D, 2D and 3D)
+      if(!SInstructionSet::isMaskKind(kind)) {
+	if(SInstructionSet::getEnumValue(kind, token.start, token.length, value)) {
+	  return true;
+	}
+	if(!(token.start[0] >= '0' && token.start[0] <= '9') && token.start[0] != '!') {
+	  return this->error(token, "Unknown enumerant");
+	}
+	return this->parse_number(token, value);
+      }
+
+      // Masks are written as names or numbers separated by '|'
+      *value = 0;
+      const char* p = token.start;
+      const char* stop = token.start + token.length;
+      while(p < stop) {
+	const char* bar = p;
+	while(bar < stop && *bar != '|') {
+	  bar++;
+	}
+
+	uint32_t bits;
+	Token part = {TOKEN_WORD, p, (size_t)(bar - p), token.line};
+	if(part.length > 0 && part.start[0] >= '0' && part.start[0] <= '9') {
+	  if(!this->parse_number(part, &bits)) {
+	    return false;
+	  }
+	} else if(!SInstructionSet::getEnumValue(kind, part.start, part.length, &bits)) {
+	  return this->error(part, "Unknown mask bit");
+	}
+
+	*value |= bits;
+	p = bar + 1;
+      }
+      return true;
+    }
+
+    // Operands whose meaning doesn't matter for the encoding are told apart by how they look
+    bool AssemblyContext::parse_any(const Token& token) {
+      uint32_t word;
+      switch(token.type) {
+      case TOKEN_ID:
+	if(!this->parse_id(token, &word)) {
+	  return false;
+	}
+	this->words.push_back(word);
+	return true;
+      case TOKEN_STRING:
+	return this->parse_string(token);
+      default:
+	if(!this->parse_number(token, &word)) {
+	  return false;
+	}
+	this->words.push_back(word);
+	return true;
+      }
+    }
+
+    bool AssemblyContext::parse_rest() {
+      while(!this->at_end()) {
+	if(!this->parse_any(this->tokens[this->current++])) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    // OpConstant and OpSpecConstant literals are read according to their type
+    bool AssemblyContext::parse_typed_literals(uint32_t type_id) {
+      auto it = this->number_types.find(type_id);
+
+      while(!this->at_end()) {
+	const Token& token = this->tokens[this->current++];
+	if(it == this->number_types.end() || token.type != TOKEN_WORD ||
+	   token.length == 0 || token.start[0] == '!') {
+	  if(!this->parse_any(token)) {
+	    return false;
+	  }
+	  continue;
+	}
+
+	NumberType type = it->second;
+	std::string str(token.start, token.length);
+	char* parse_end;
+	errno = 0;
+
+	uint64_t bits;
+	if(type.is_float && type.width == 32) {
+	  float f = strtof(str.c_str(), &parse_end);
+	  uint32_t b;
+	  memcpy(&b, &f, sizeof(b));
+	  bits = b;
+	} else if(type.is_float && type.width == 64) {
+	  double d = strtod(str.c_str(), &parse_end);
+	  memcpy(&bits, &d, sizeof(bits));
+	} else if(type.is_float) {
+	  return this->error(token, "Only 32 and 64 bit float constants can be written as numbers");
+	} else if(str[0] == '-') {
+	  int64_t value = strtoll(str.c_str(), &parse_end, 0);
+	  bits = (uint64_t)value;
+	  if(type.width < 64) {
+	    int64_t min = -((int64_t)1 << (type.width - 1));
+	    if(value < min) {
+	      return this->error(token, "Constant out of range");
+	    }
+	    bits &= type.width == 32 ? 0xffffffffull : ((1ull << type.width) - 1);
+	    // Narrower signed types are sign extended to the full word
+	    if(type.is_signed && type.width < 32) {
+	      bits = (uint32_t)(int32_t)value;
+	    }
+	  }
+	} else {
+	  bits = strtoull(str.c_str(), &parse_end, 0);
+	  if(type.width < 64 && bits >> type.width) {
+	    return this->error(token, "Constant out of range");
+	  }
+	}
+
+	if(errno || *parse_end || parse_end == str.c_str()) {
+	  return this->error(token, "Invalid number");
+	}
+
+	this->words.push_back((uint32_t)bits);
+	if(type.width > 32) {
+	  this->words.push_back((uint32_t)(bits >> 32));
+	}
+      }
+      return true;
+    }
+
+    bool AssemblyContext::parse_operands(const SInstructionInfo* info, const Token& opcode_token) {
+      size_t first_operand = this->current;
+
+      for(SOperandKind kind : info->operands) {
+	if(this->at_end()) {
+	  switch(kind) {
+	  case OPERAND_OPTIONAL_ID:
+	  case OPERAND_OPTIONAL_LITERAL:
+	  case OPERAND_OPTIONAL_STRING:
+	  case OPERAND_OPTIONAL_ACCESS_QUALIFIER:
+	  case OPERAND_OPTIONAL_MEMORY_ACCESS:
+	  case OPERAND_OPTIONAL_IMAGE_OPERANDS:
+	  case OPERAND_VARIABLE_IDS:
+	  case OPERAND_VARIABLE_LITERALS:
+	  case OPERAND_VARIABLE_STRINGS:
+	  case OPERAND_VARIABLE_LITERAL_ID:
+	  case OPERAND_VARIABLE_ID_LITERAL:
+	    continue;
+	  default:
+	    return this->error(opcode_token, "Missing operand");
+	  }
+	}
+
+	const Token& token = this->tokens[this->current];
+	uint32_t word;
+
+	switch(kind) {
+	case OPERAND_ID:
+	case OPERAND_OPTIONAL_ID:
+	  if(!this->parse_id(token, &word)) {
+	    return false;
+	  }
+	  this->words.push_back(word);
+	  this->current++;
+	  break;
+	case OPERAND_LITERAL:
+	case OPERAND_OPTIONAL_LITERAL:
+	  // OpExtInst <result_type> <result_id> <set> <instruction> <operands>...
+	  if(info->opcode == 12 && this->current == first_operand + 1 && token.type == TOKEN_WORD &&
+	     SInstructionSet::getGLSLInstructionNumber(token.start, token.length, &word)) {
+	    this->words.push_back(word);
+	    this->current++;
+	    break;
+	  }
+	  if(!this->parse_number(token, &word)) {
+	    return false;
+	  }
+	  this->words.push_back(word);
+	  this->current++;
+	  break;
+	case OPERAND_STRING:
+	case OPERAND_OPTIONAL_STRING:
+	  if(!this->parse_string(token)) {
+	    return false;
+	  }
+	  this->current++;
+	  break;
+	case OPERAND_VARIABLE_LITERALS:
+	  if(info->opcode == 43 || info->opcode == 50) { // OpConstant, OpSpecConstant
+	    if(!this->parse_typed_literals(this->words[0])) {
+	      return false;
+	    }
+	    break;
+	  }
+	  if(!this->parse_rest()) {
+	    return false;
+	  }
+	  break;
+	case OPERAND_VARIABLE_IDS:
+	case OPERAND_VARIABLE_STRINGS:
+	case OPERAND_VARIABLE_LITERAL_ID:
+	case OPERAND_VARIABLE_ID_LITERAL:
+	  if(!this->parse_rest()) {
+	    return false;
+	  }
+	  break;
+	case OPERAND_EXECUTION_MODE:
+	  if(!this->parse_enum(token, kind, &word)) {
+	    return false;
+	  }
+	  this->words.push_back(word);
+	  this->current++;
+	  if(!this->parse_rest()) {
+	    return false;
+	  }
+	  break;
+	case OPERAND_DECORATION:
+	  if(!this->parse_enum(token, kind, &word)) {
+	    return false;
+	  }
+	  this->words.push_back(word);
+	  this->current++;
+
+	  if(word == 11 && !this->at_end()) { // BuiltIn <builtin>
+	    uint32_t builtin;
+	    if(!this->parse_enum(this->tokens[this->current], OPERAND_BUILTIN, &builtin)) {
+	      return false;
+	    }
+	    this->words.push_back(builtin);
+	    this->current++;
+	  }
+	  if(!this->parse_rest()) {
+	    return false;
+	  }
+	  break;
+	default:
+	  if(!this->parse_enum(token, kind, &word)) {
+	    return false;
+	  }
+	  this->words.push_back(word);
+	  this->current++;
+
+	  // Parameters come in the order of the bits that pulled them in
+	  if(SInstructionSet::isMaskKind(kind)) {
+	    for(int b = 0; b < 32; b++) {
+	      uint32_t bit = 1u << b;
+	      if(!(word & bit)) {
+		continue;
+	      }
+
+	      bool are_ids;
+	      int count = SInstructionSet::getMaskParameterCount(kind, bit, &are_ids);
+	      for(int j = 0; j < count; j++) {
+		if(this->at_end()) {
+		  return this->error(opcode_token, "Missing mask parameter");
+		}
+		if(!this->parse_any(this->tokens[this->current++])) {
+		  return false;
+		}
+	      }
+	    }
+	  }
+	  break;
+	}
+      }
+
+      if(!this->at_end()) {
+	return this->error(this->tokens[this->current], "Too many operands");
+      }
+      return true;
+    }
+
+    bool AssemblyContext::run() {
+      if(!this->tokenize()) {
+	return false;
+      }
+
+      // Named ids are numbered after all the numeric ones
+      for(const Token& token : this->tokens) {
+	if(token.type != TOKEN_ID) {
+	  continue;
+	}
+	uint32_t value = 0;
+	bool numeric = true;
+	for(size_t i = 1; i < token.length && numeric; i++) {
+	  char c = token.start[i];
+	  numeric = c >= '0' && c <= '9' && value < 0x19999999;
+	  value = value * 10 + (c - '0');
+	}
+	if(numeric) {
+	  this->max_id = std::max(this->max_id, value);
+	}
+      }
+      this->next_named_id = this->max_id + 1;
+
+      size_t header_position = this->res.size();
+      this->res.insert(this->res.end(), {spirv_magic_number, this->version, this->generator, 0,
+					 this->schema});
+
+      size_t i = 0;
+      while(i < this->tokens.size()) {
+	const Token* result_token = nullptr;
+	if(this->tokens[i].type == TOKEN_ID) {
+	  if(!is_instruction_start(this->tokens, i)) {
+	    return this->error(this->tokens[i], "Expected an instruction");
+	  }
+	  result_token = &this->tokens[i];
+	  i += 2;
+	  if(i >= this->tokens.size()) {
+	    return this->error(*result_token, "Missing opcode");
+	  }
+	}
+
+	const Token& opcode_token = this->tokens[i];
+	uint32_t opcode;
+	if(opcode_token.type != TOKEN_WORD ||
+	   !SInstructionSet::getOpcode(opcode_token.start, opcode_token.length, &opcode)) {
+	  return this->error(opcode_token, "Unknown opcode");
+	}
+	const SInstructionInfo* info = SInstructionSet::getInfo(opcode);
+
+	if(info->has_result != (result_token != nullptr)) {
+	  return this->error(opcode_token, info->has_result ? "Missing result id" :
+			     "Instruction has no result id");
+	}
+
+	// The operand tokens run up to the next instruction
+	this->current = i + 1;
+	this->end = this->current;
+	while(this->end < this->tokens.size() && !is_instruction_start(this->tokens, this->end)) {
+	  this->end++;
+	}
+	i = this->end;
+
+	this->words.clear();
+	uint32_t result_id = 0;
+
+	if(info->has_type) {
+	  if(this->at_end()) {
+	    return this->error(opcode_token, "Missing result type");
+	  }
+	  uint32_t type_id;
+	  if(!this->parse_id(this->tokens[this->current++], &type_id)) {
+	    return false;
+	  }
+	  this->words.push_back(type_id);
+	}
+	if(info->has_result) {
+	  if(!this->parse_id(*result_token, &result_id)) {
+	    return false;
+	  }
+	  this->words.push_back(result_id);
+	}
+
+	// Operands written as raw words (as for instructions not matching
+	// the grammar) are taken as they are
+	bool all_raw = !this->at_end();
+	for(size_t t = this->current; t < this->end && all_raw; t++) {
+	  all_raw = this->tokens[t].type == TOKEN_WORD && this->tokens[t].start[0] == '!';
+	}
+
+	if(all_raw) {
+	  if(!this->parse_rest()) {
+	    return false;
+	  }
+	} else if(!this->parse_operands(info, opcode_token)) {
+	  return false;
+	}
+
+	if(this->words.size() + 1 > 0xffff) {
+	  return this->error(opcode_token, "Instruction too long");
+	}
+
+	this->res.push_back(((uint32_t)(this->words.size() + 1) << 16) | opcode);
+	this->res.insert(this->res.end(), this->words.begin(), this->words.end());
+
+	if(opcode == 21 && this->words.size() >= 3) { // OpTypeInt <result> <width> <signedness>
+	  this->number_types[result_id] = {false, this->words[2] != 0, this->words[1]};
+	} else if(opcode == 22 && this->words.size() >= 2) { // OpTypeFloat <result> <width>
+	  this->number_types[result_id] = {true, true, this->words[1]};
+	}
+      }
+
+      this->res[header_position + 3] = std::max(this->bound, this->max_id + 1);
+      return true;
+    }
+  };
+
+
+  /*
+   * SAssembler member functions
+   */
+
+  bool SAssembler::assemble(const char* text, size_t length, std::vector<uint32_t>& res,
+			    std::string& error) {
+    AssemblyContext context(text, length, res, error);
+    return context.run();
+  }
+
+  bool SAssembler::assemble(const std::string& text, std::vector<uint32_t>& res, std::string& error) {
+    return SAssembler::assemble(text.data(), text.size(), res, error);
+  }
+
+};
@@ -0,0 +1,33 @@
+#ifndef __SPURV_ASSEMBLER
+#define __SPURV_ASSEMBLER
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace spurv {
+
+  /*
+   * SAssembler - Turns text in the format written by SDisassembler (and the Khronos tools)
+   * back into a SPIR-V binary. Ids may be numeric (%12), which are kept as they are, or
+   * names (%float), which are numbered after the highest numeric id. A "!<number>" literal
+   * is put into the binary as a single raw word. Version, generator, bound and schema are
+   * taken from the header comments when present, so that disassembling and assembling
+   * again reproduces the original binary
+   */
+
+  class SAssembler {
+  public:
+    SAssembler() = delete;
+
+    // The binary is appended to res. Returns false and fills in error
+    // (with the line number) if the text could not be assembled
+    static bool assemble(const char* text, size_t length, std::vector<uint32_t>& res,
+			 std::string& error);
+    static bool assemble(const std::string& text, std::vector<uint32_t>& res, std::string& error);
+  };
+
+};
+
+#endif // __SPURV_ASSEMBLER
@@ -0,0 +1,273 @@
+#include "code_sinking.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "dead_code_elimination.hpp"
+#include "invariant_hoisting.hpp"
+
+#include <algorithm>
+
+namespace spurv {
+
+  /*
+   * SCodeSinker members
+   */
+
+  bool SCodeSinker::enabled = true;
+
+  std::unordered_map<int, std::vector<int> > SCodeSinker::sunk;
+  std::unordered_set<int> SCodeSinker::sunk_events;
+
+  int SCodeSinker::num_sunk = 0;
+
+
+  /*
+   * SCodeSinker member functions
+   */
+
+  bool SCodeSinker::is_sinkable(const SNodeInfo& info) {
+    switch(info.kind) {
+    case NODE_EXPRESSION:
+      if(info.operation == EXPR_LOOKUP) {
+	SNodeInfo looked_up;
+	info.operands[0]->getNodeInfo(looked_up);
+	return looked_up.type.kind == STypeKind::KIND_MAT ||
+	  looked_up.type.kind == STypeKind::KIND_TEXTURE;
+      }
+
+      return info.operation != EXPR_DPDX && info.operation != EXPR_DPDY;
+    case NODE_GLSL_FUNCTION:
+    case NODE_CONSTRUCT_MATRIX:
+    case NODE_SELECT:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void SCodeSinker::analyze() {
+    SCodeSinker::clear();
+    SCodeSinker::num_sunk = 0;
+
+    if(!SCodeSinker::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // Blocks are numbered by the event opening them: 3n for the then-block of an if-statement,
+    // 3n + 1 for its else-block and 3n + 2 for a loop body. The branches of the selection
+    // declared in event n are -(2n + 1) and -(2n + 2)
+    std::vector<std::vector<int> > paths(events.size()); // The blocks each event is in
+    std::unordered_map<int, int> openers; // Event the values sunk into no further than outside a block are written before
+
+    // The events using each value, and whether they use it in the true (1) or false (2) branch of a selection
+    std::unordered_map<const SValueBase*, std::vector<std::pair<int, int> > > uses;
+
+    std::vector<int> blocks;
+    std::vector<int> ifs;
+
+    SEventInfo ev;
+    SPointerInfo pointer;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+      paths[i] = blocks;
+
+      std::vector<const SValueBase*> used;
+      const SPointerBase* indexed = nullptr;
+
+      switch(ev.kind) {
+      case EVENT_DECLARATION:
+	{
+	  SNodeInfo info;
+	  ev.values[0]->getNodeInfo(info);
+
+	  if(info.kind == NODE_SELECT) {
+	    uses[info.operands[0]].push_back(std::make_pair(i, 0));
+	    for(int k = 1; k <= 2; k++) {
+	      bool is_branch = info.operands[k] != info.operands[3 - k] && info.operands[k] != info.operands[0];
+	      uses[info.operands[k]].push_back(std::make_pair(i, is_branch ? k : 0));
+	    }
+	  } else {
+	    used = info.operands;
+	    indexed = info.pointer;
+	  }
+	}
+	break;
+      case EVENT_LOAD:
+	{
+	  SNodeInfo info;
+	  ev.values[0]->getNodeInfo(info);
+	  indexed = info.pointer;
+	}
+	break;
+      case EVENT_STORE:
+      case EVENT_IMAGE_STORE:
+      case EVENT_RETURN:
+	used = ev.values;
+	indexed = ev.pointer;
+	break;
+      case EVENT_IF:
+	used = ev.values;
+	blocks.push_back(3 * i);
+	ifs.push_back(i);
+	openers[3 * i] = i;
+	openers[3 * i + 1] = i;
+	break;
+      case EVENT_ELSE:
+	blocks.back() = 3 * ifs.back() + 1;
+	break;
+      case EVENT_END_IF:
+	blocks.pop_back();
+	ifs.pop_back();
+	break;
+      case EVENT_FOR_BEGIN:
+	blocks.push_back(3 * i + 2);
+	openers[3 * i + 2] = i;
+	break;
+      case EVENT_FOR_END:
+	blocks.pop_back();
+	break;
+      default:
+	break;
+      }
+
+      // Indices into access chains are used where the chain is
+      while(indexed != nullptr) {
+	indexed->getPointerInfo(pointer);
+	if(pointer.parent != nullptr) {
+	  used.push_back(pointer.index);
+	}
+	indexed = pointer.parent;
+      }
+
+      for(const SValueBase* value : used) {
+	uses[value].push_back(std::make_pair(i, 0));
+      }
+    }
+
+    // Users are recorded after the values they use, so going backwards, the positions of all
+    // users are known when a value is sunk
+    std::vector<SPosition> positions(events.size());
+    for(int i = (int)events.size() - 1; i >= 0; i--) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      positions[i] = {paths[i], i};
+
+      events[i]->getEventInfo(ev);
+      if(ev.kind != EVENT_DECLARATION) {
+	continue;
+      }
+
+      SNodeInfo info;
+      ev.values[0]->getNodeInfo(info);
+
+      std::unordered_map<const SValueBase*, std::vector<std::pair<int, int> > >::iterator it = uses.find(ev.values[0]);
+      if(SCodeSinker::is_sinkable(info) && !SInvariantHoister::isHoisted(i) && it != uses.end()) {
+	std::vector<SPosition> used_at;
+	bool is_fixed = false;
+	for(const std::pair<int, int>& use : it->second) {
+	  // Hoisted values are written before their loop
+	  if(SInvariantHoister::isHoisted(use.first)) {
+	    is_fixed = true;
+	    break;
+	  }
+
+	  SPosition position = positions[use.first];
+	  if(use.second) {
+	    position.path.push_back(-(2 * use.first + use.second));
+	    position.anchor = -1;
+	  }
+	  used_at.push_back(position);
+	}
+
+	// The innermost block containing all uses, within the block of the value and outside loops
+	std::vector<int> target = used_at.size() ? used_at[0].path : std::vector<int>();
+	for(const SPosition& position : used_at) {
+	  std::vector<int>::iterator end = std::mismatch(target.begin(), target.end(),
+							 position.path.begin(), position.path.end()).first;
+	  target.erase(end, target.end());
+	}
+
+	const std::vector<int>& own = paths[i];
+	if(is_fixed || target.size() <= own.size() ||
+	   !std::equal(own.begin(), own.end(), target.begin())) {
+	  target = own;
+	}
+
+	for(unsigned int k = own.size(); k < target.size(); k++) {
+	  if(target[k] >= 0 && target[k] % 3 == 2) {
+	    target.resize(k);
+	    break;
+	  }
+	}
+
+	if(target.size() > own.size()) {
+	  // In a selection branch, the value is defined by its user. Otherwise before the first
+	  // use in the block, or the first block within it containing a use
+	  int anchor = -1;
+	  if(target.back() >= 0) {
+	    anchor = events.size();
+	    for(const SPosition& position : used_at) {
+	      anchor = std::min(anchor, position.path.size() == target.size() ? position.anchor :
+				openers[position.path[target.size()]]);
+	    }
+	  }
+
+	  positions[i] = {target, anchor};
+	  SCodeSinker::sunk_events.insert(i);
+	  if(anchor >= 0) {
+	    SCodeSinker::sunk[anchor].push_back(i);
+	  }
+	  SCodeSinker::num_sunk++;
+	}
+      }
+
+      if(info.kind == NODE_SELECT) {
+	openers[-(2 * i + 1)] = positions[i].anchor;
+	openers[-(2 * i + 2)] = positions[i].anchor;
+      }
+    }
+
+    // In the order they were recorded, so that operands come first
+    for(std::pair<const int, std::vector<int> >& values : SCodeSinker::sunk) {
+      std::reverse(values.second.begin(), values.second.end());
+    }
+  }
+
+  void SCodeSinker::write_sunk(std::vector<uint32_t>& bin, int event_num) {
+    std::unordered_map<int, std::vector<int> >::iterator it = SCodeSinker::sunk.find(event_num);
+    if(it == SCodeSinker::sunk.end()) {
+      return;
+    }
+
+    for(int sunk_event : it->second) {
+      SEventRegistry::events[sunk_event]->ensure_written(bin);
+    }
+  }
+
+  bool SCodeSinker::isSunk(int event_num) {
+    return SCodeSinker::sunk_events.count(event_num);
+  }
+
+  void SCodeSinker::clear() {
+    SCodeSinker::sunk.clear();
+    SCodeSinker::sunk_events.clear();
+  }
+
+  void SCodeSinker::setEnabled(bool enabled) {
+    SCodeSinker::enabled = enabled;
+  }
+
+  bool SCodeSinker::isEnabled() {
+    return SCodeSinker::enabled;
+  }
+
+  int SCodeSinker::getNumSunk() {
+    return SCodeSinker::num_sunk;
+  }
+
+};
@@ -0,0 +1,80 @@
+#ifndef __SPURV_CODE_SINKING
+#define __SPURV_CODE_SINKING
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SValueBase;
+  struct SNodeInfo;
+
+  /*
+   * SCodeSinker - Computes values in the innermost block that dominates all their uses,
+   * instead of where they were declared, so that a value only used in one branch of an
+   * if-statement is not computed when the other branch is taken.
+   *
+   * Expressions, GLSL functions, constructions and selections are sunk into if-statements
+   * (then or else block) and into the branches of selections written as such (see
+   * SSelectLowering), where they are defined together with the branch value using them.
+   * Values are never sunk into loops, where they would be computed in every iteration, and
+   * values hoisted out of loops, or used by hoisted values, are left where they are (see
+   * SInvariantHoister). Derivatives are never moved, as they are undefined in non-uniform
+   * control flow, nor are lookups into arrays and storage images, as they read memory
+   */
+
+  class SCodeSinker {
+    static bool enabled;
+
+    // Event numbers of the values sunk, by the event they are written before. Values sunk into
+    // the branch of a selection are not written by themselves
+    static std::unordered_map<int, std::vector<int> > sunk;
+    static std::unordered_set<int> sunk_events;
+
+    static int num_sunk;
+
+    // Where a value is used, as the blocks it is in and the event it is to be written before
+    struct SPosition {
+      std::vector<int> path;
+      int anchor; // -1 when defined by its user
+    };
+
+    SCodeSinker() = delete;
+
+    static bool is_sinkable(const SNodeInfo& info);
+
+    // Finds the values to sink among the live events in SEventRegistry. Expects
+    // SDeadCodeEliminator and SInvariantHoister to have analyzed them
+    static void analyze();
+
+    // Writes the values sunk to right before the given event
+    static void write_sunk(std::vector<uint32_t>& bin, int event_num);
+
+    static bool isSunk(int event_num);
+
+    static void clear();
+
+    friend class SEventRegistry;
+    friend class SGraphExporter;
+    friend class SPassManager;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Sinking is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of values sunk into conditional blocks in the last compiled shader
+    static int getNumSunk();
+  };
+
+};
+
+#endif // __SPURV_CODE_SINKING
@@ -0,0 +1,415 @@
+#include "constant_folding.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace spurv {
+
+  namespace {
+
+    // Vulkan does not require inf, NaN, signed zero or denormals to be preserved
+    // (without SignedZeroInfNanPreserve / DenormPreserve), so only values where every
+    // implementation agrees are folded
+    bool is_exact(float f) {
+      return f == 0.0f || std::isnormal(f);
+    }
+
+    bool are_exact(const std::vector<float>& fs) {
+      for(float f : fs) {
+	if(!is_exact(f)) {
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    // Two's complement arithmetic, without the undefined behaviour of signed overflow
+    int32_t wrap(uint32_t u) {
+      return (int32_t)u;
+    }
+  };
+
+
+  /*
+   * SConstantFolder members
+   */
+
+  bool SConstantFolder::enabled = true;
+
+
+  /*
+   * SConstantFolder member functions
+   */
+
+  void SConstantFolder::setEnabled(bool enabled) {
+    SConstantFolder::enabled = enabled;
+  }
+
+  bool SConstantFolder::isEnabled() {
+    return SConstantFolder::enabled;
+  }
+
+  bool SConstantFolder::foldUnary(SExprOp op, float a, float& res) {
+    if(!is_exact(a)) {
+      return false;
+    }
+
+    float r;
+    switch(op) {
+    case EXPR_NEGATIVE:
+      r = -a;
+      break;
+    case EXPR_DPDX:
+    case EXPR_DPDY:
+      // The difference between neighbouring invocations
+      r = 0.0f;
+      break;
+    default:
+      return false;
+    }
+
+    res = r;
+    return true;
+  }
+
+  bool SConstantFolder::foldUnary(SExprOp op, int32_t a, int32_t& res) {
+    if(op != EXPR_NEGATIVE) {
+      return false;
+    }
+
+    // OpSNegate
+    res = wrap(0u - (uint32_t)a);
+    return true;
+  }
+
+  bool SConstantFolder::foldUnary(SExprOp op, uint32_t a, uint32_t& res) {
+    // Negation is not defined for unsigned values
+    return false;
+  }
+
+  bool SConstantFolder::foldBinary(SExprOp op, float a, float b, float& res) {
+    if(!is_exact(a) || !is_exact(b)) {
+      return false;
+    }
+
+    float r;
+    switch(op) {
+    case EXPR_ADDITION:
+      r = a + b;
+      break;
+    case EXPR_SUBTRACTION:
+      r = a - b;
+      break;
+    case EXPR_MULTIPLICATION:
+      r = a * b;
+      break;
+    case EXPR_DIVISION:
+      // OpFDiv is only required to be accurate for divisors in [2^-126, 2^126]
+      if(b == 0.0f || std::fabs(b) > 0x1p126f) {
+	return false;
+      }
+      r = a / b;
+      break;
+    case EXPR_REM:
+      // OpFRem, sign of a
+      if(b == 0.0f) {
+	return false;
+      }
+      r = std::fmod(a, b);
+      break;
+    case EXPR_MOD:
+      // OpFMod, sign of b
+      if(b == 0.0f) {
+	return false;
+      }
+      r = std::fmod(a, b);
+      if(r != 0.0f && std::signbit(r) != std::signbit(b)) {
+	r += b;
+      }
+      break;
+    default:
+      return false;
+    }
+
+    if(!is_exact(r)) {
+      return false;
+    }
+
+    res = r;
+    return true;
+  }
+
+  bool SConstantFolder::foldBinary(SExprOp op, int32_t a, int32_t b, int32_t& res) {
+    int32_t r;
+    switch(op) {
+    case EXPR_ADDITION:
+      r = wrap((uint32_t)a + (uint32_t)b);
+      break;
+    case EXPR_SUBTRACTION:
+      r = wrap((uint32_t)a - (uint32_t)b);
+      break;
+    case EXPR_MULTIPLICATION:
+      r = wrap((uint32_t)a * (uint32_t)b);
+      break;
+    case EXPR_DIVISION:
+    case EXPR_REM:
+    case EXPR_MOD:
+      // Undefined in SPIR-V
+      if(b == 0 || (a == std::numeric_limits<int32_t>::min() && b == -1)) {
+	return false;
+      }
+
+      if(op == EXPR_DIVISION) {
+	r = a / b; // OpSDiv, rounds towards zero
+      } else {
+	r = a % b; // OpSRem, sign of a
+	if(op == EXPR_MOD && r != 0 && ((r < 0) != (b < 0))) {
+	  r += b; // OpSMod, sign of b
+	}
+      }
+      break;
+    default:
+      return false;
+    }
+
+    res = r;
+    return true;
+  }
+
+  bool SConstantFolder::foldBinary(SExprOp op, uint32_t a, uint32_t b, uint32_t& res) {
+    uint32_t r;
+    switch(op) {
+    case EXPR_ADDITION:
+      r = a + b;
+      break;
+    case EXPR_SUBTRACTION:
+      r = a - b;
+      break;
+    case EXPR_MULTIPLICATION:
+      r = a * b;
+      break;
+    case EXPR_DIVISION:
+    case EXPR_REM:
+    case EXPR_MOD:
+      if(b == 0) {
+	return false;
+      }
+      r = op == EXPR_DIVISION ? a / b : a % b; // OpUDiv / OpUMod
+      break;
+    default:
+      return false;
+    }
+
+    res = r;
+    return true;
+  }
+
+  bool SConstantFolder::foldComparison(SExprOp op, float a, float b, bool& res) {
+    // Also keeps NaN out, whose ordered comparisons would all be false
+    if(!is_exact(a) || !is_exact(b)) {
+      return false;
+    }
+
+    switch(op) {
+    case EXPR_EQUAL:
+      res = a == b;
+      break;
+    case EXPR_NOTEQUAL:
+      res = a != b;
+      break;
+    case EXPR_LESSTHAN:
+      res = a < b;
+      break;
+    case EXPR_GREATERTHAN:
+      res = a > b;
+      break;
+    case EXPR_LESSOREQUAL:
+      res = a <= b;
+      break;
+    case EXPR_GREATEROREQUAL:
+      res = a >= b;
+      break;
+    default:
+      return false;
+    }
+
+    return true;
+  }
+
+  template<typename tt>
+  static bool fold_integer_comparison(SExprOp op, tt a, tt b, bool& res) {
+    switch(op) {
+    case EXPR_EQUAL:
+      res = a == b;
+      break;
+    case EXPR_NOTEQUAL:
+      res = a != b;
+      break;
+    case EXPR_LESSTHAN:
+      res = a < b;
+      break;
+    case EXPR_GREATERTHAN:
+      res = a > b;
+      break;
+    case EXPR_LESSOREQUAL:
+      res = a <= b;
+      break;
+    case EXPR_GREATEROREQUAL:
+      res = a >= b;
+      break;
+    default:
+      return false;
+    }
+
+    return true;
+  }
+
+  bool SConstantFolder::foldComparison(SExprOp op, int32_t a, int32_t b, bool& res) {
+    return fold_integer_comparison(op, a, b, res);
+  }
+
+  bool SConstantFolder::foldComparison(SExprOp op, uint32_t a, uint32_t b, bool& res) {
+    return fold_integer_comparison(op, a, b, res);
+  }
+
+  bool SConstantFolder::foldCast(float a, int32_t& res) {
+    // OpConvertFToS, undefined if the truncated value does not fit
+    if(!is_exact(a) || !(a >= -0x1p31f && a < 0x1p31f)) {
+      return false;
+    }
+
+    res = (int32_t)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldCast(float a, uint32_t& res) {
+    // OpConvertFToU
+    if(!is_exact(a) || !(a > -1.0f && a < 0x1p32f)) {
+      return false;
+    }
+
+    res = (uint32_t)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldCast(int32_t a, float& res) {
+    // OpConvertSToF, correctly rounded
+    res = (float)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldCast(uint32_t a, float& res) {
+    // OpConvertUToF
+    res = (float)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldCast(int32_t a, uint32_t& res) {
+    // OpBitcast
+    res = (uint32_t)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldCast(uint32_t a, int32_t& res) {
+    // OpBitcast
+    res = (int32_t)a;
+    return true;
+  }
+
+  bool SConstantFolder::foldGLSL(GLSLFunction function, const std::vector<float>& args, float& res) {
+    if(!are_exact(args)) {
+      return false;
+    }
+
+    // Only the exact functions, the precision of the others is up to the implementation
+    float r;
+    switch(function) {
+    case GLSL_ROUND:
+      // The direction of halfway cases is up to the implementation
+      if(std::fabs(args[0] - std::trunc(args[0])) == 0.5f) {
+	return false;
+      }
+      r = std::round(args[0]);
+      break;
+    case GLSL_ROUND_EVEN:
+      r = std::nearbyint(args[0]);
+      break;
+    case GLSL_TRUNC:
+      r = std::trunc(args[0]);
+      break;
+    case GLSL_FABS:
+      r = std::fabs(args[0]);
+      break;
+    case GLSL_FSIGN:
+      r = args[0] > 0.0f ? 1.0f : (args[0] < 0.0f ? -1.0f : 0.0f);
+      break;
+    case GLSL_FLOOR:
+      r = std::floor(args[0]);
+      break;
+    case GLSL_CEIL:
+      r = std::ceil(args[0]);
+      break;
+    case GLSL_FRACT:
+      r = args[0] - std::floor(args[0]);
+      break;
+    case GLSL_FMIN:
+    case GLSL_FMAX:
+      // Which zero is returned for 0.0 and -0.0 is up to the implementation
+      if(args[0] == args[1] && std::signbit(args[0]) != std::signbit(args[1])) {
+	return false;
+      }
+      if(function == GLSL_FMIN) {
+	r = args[1] < args[0] ? args[1] : args[0];
+      } else {
+	r = args[0] < args[1] ? args[1] : args[0];
+      }
+      break;
+    default:
+      return false;
+    }
+
+    if(!is_exact(r)) {
+      return false;
+    }
+
+    res = r;
+    return true;
+  }
+
+  bool SConstantFolder::foldGLSL(GLSLFunction function, const std::vector<int32_t>& args, int32_t& res) {
+    switch(function) {
+    case GLSL_SABS:
+      res = args[0] < 0 ? wrap(0u - (uint32_t)args[0]) : args[0];
+      break;
+    case GLSL_SSIGN:
+      res = args[0] > 0 ? 1 : (args[0] < 0 ? -1 : 0);
+      break;
+    case GLSL_SMIN:
+      res = args[1] < args[0] ? args[1] : args[0];
+      break;
+    case GLSL_SMAX:
+      res = args[0] < args[1] ? args[1] : args[0];
+      break;
+    default:
+      return false;
+    }
+
+    return true;
+  }
+
+  bool SConstantFolder::foldGLSL(GLSLFunction function, const std::vector<uint32_t>& args, uint32_t& res) {
+    switch(function) {
+    case GLSL_UMIN:
+      res = args[1] < args[0] ? args[1] : args[0];
+      break;
+    case GLSL_UMAX:
+      res = args[0] < args[1] ? args[1] : args[0];
+      break;
+    default:
+      return false;
+    }
+
+    return true;
+  }
+
+};
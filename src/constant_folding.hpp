@@ -0,0 +1,97 @@
+#ifndef __SPURV_CONSTANT_FOLDING
+#define __SPURV_CONSTANT_FOLDING
+
+#include "declarations.hpp"
+#include "types.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace spurv {
+
+  /*
+   * SConstantFolder - Evaluates expressions, GLSL function calls and selects whose
+   * operands are all scalar constants while the shader is recorded, so that the
+   * factories can return a new constant instead of emitting the operation. Component-wise
+   * expressions on constant vectors and matrices are folded one component at a time, and
+   * lookups with a constant index into a constant vector give the component.
+   *
+   * Results follow the SPIR-V semantics of the instruction that would otherwise have been
+   * emitted: integer arithmetic wraps, floating point arithmetic is IEEE 754 with round to
+   * nearest even, and ordered comparisons are false on NaN. Operations whose result is
+   * undefined in SPIR-V (integer division by zero, out-of-range float to int conversion,
+   * sqrt of a negative number and so on) are left for the GPU, and so are functions
+   * with implementation-defined precision where the host can not match it exactly
+   */
+
+  class SConstantFolder {
+    static bool enabled;
+
+    SConstantFolder() = delete;
+
+    // Sets values to the components of v in row-major order, and returns true if v is a
+    // scalar constant or a constant composite
+    template<typename tt, typename ctype>
+    static bool getComponents(SValue<tt>& v, std::vector<ctype>& values);
+
+    // The constant of type tt with the given components, in row-major order
+    template<typename tt, typename ctype>
+    static SValue<tt>* makeConstant(const std::vector<ctype>& values);
+
+    // Folds op on one component of each operand. b is not used if op is unary
+    template<SExprOp op, bool unary, typename rtype, typename atype, typename btype>
+    static bool foldComponent(atype a, btype b, rtype& res);
+
+    template<typename tt, typename tt2, typename tt3>
+    static SValue<tt>* foldLookup(SValue<tt2>& v, SValue<tt3>& index);
+
+  public:
+
+    // Folding is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Each of these returns false, leaving res untouched, if the operation is not folded
+
+    static bool foldUnary(SExprOp op, float a, float& res);
+    static bool foldUnary(SExprOp op, int32_t a, int32_t& res);
+    static bool foldUnary(SExprOp op, uint32_t a, uint32_t& res);
+
+    static bool foldBinary(SExprOp op, float a, float b, float& res);
+    static bool foldBinary(SExprOp op, int32_t a, int32_t b, int32_t& res);
+    static bool foldBinary(SExprOp op, uint32_t a, uint32_t b, uint32_t& res);
+
+    static bool foldComparison(SExprOp op, float a, float b, bool& res);
+    static bool foldComparison(SExprOp op, int32_t a, int32_t b, bool& res);
+    static bool foldComparison(SExprOp op, uint32_t a, uint32_t b, bool& res);
+
+    static bool foldCast(float a, int32_t& res);
+    static bool foldCast(float a, uint32_t& res);
+    static bool foldCast(int32_t a, float& res);
+    static bool foldCast(uint32_t a, float& res);
+    static bool foldCast(int32_t a, uint32_t& res);
+    static bool foldCast(uint32_t a, int32_t& res);
+
+    static bool foldGLSL(GLSLFunction function, const std::vector<float>& args, float& res);
+    static bool foldGLSL(GLSLFunction function, const std::vector<int32_t>& args, int32_t& res);
+    static bool foldGLSL(GLSLFunction function, const std::vector<uint32_t>& args, uint32_t& res);
+
+    // Used by the node factories. Return nullptr if the node can not be folded
+
+    template<typename tt, SExprOp op, typename tt2, typename tt3>
+    static SValue<tt>* foldExpression(SValue<tt2>& v1, SValue<tt3>* v2);
+
+    template<typename tt>
+    static SValue<tt>* foldGLSLFunction(GLSLFunction function, const std::vector<SValue<tt>*>& args);
+
+    template<typename tt>
+    static SValue<tt>* foldSelect(SValue<SBool>& cond, SValue<tt>& val_true, SValue<tt>& val_false);
+
+    // Sets value and returns true if v is a scalar constant
+    template<typename tt>
+    static bool getConstant(SValue<tt>& v, typename InvMapSType<tt>::type& value);
+  };
+
+};
+
+#endif // __SPURV_CONSTANT_FOLDING
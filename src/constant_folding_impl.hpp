@@ -0,0 +1,282 @@
+#ifndef __SPURV_CONSTANT_FOLDING_IMPL
+#define __SPURV_CONSTANT_FOLDING_IMPL
+
+#include "constant_folding.hpp"
+#include "values.hpp"
+
+#include <type_traits>
+#include <utility>
+
+namespace spurv {
+
+  // The types constants exist for
+  template<typename tt>
+  struct is_foldable_scalar {
+    static constexpr bool value =
+      std::is_same<tt, float_s>::value ||
+      std::is_same<tt, int_s>::value ||
+      std::is_same<tt, uint_s>::value ||
+      std::is_same<tt, SBool>::value;
+  };
+
+  // Scalars are folded as composites with one component
+  template<typename tt>
+  struct fold_shape {
+    using component_type = tt;
+    static constexpr bool is_composite = false;
+    static constexpr int n = 1;
+    static constexpr int m = 1;
+  };
+
+  template<int n_, int m_, typename inner>
+  struct fold_shape<SMat<n_, m_, inner> > {
+    using component_type = inner;
+    static constexpr bool is_composite = true;
+    static constexpr int n = n_;
+    static constexpr int m = m_;
+  };
+
+  // Whether the expression is folded one component at a time. Besides scalars, that is
+  // expressions on vectors of the same size and vectors or matrices multiplied with a
+  // scalar, as expressions on matrices are either not component-wise (see EXPR_DOT) or
+  // not written by SExpr
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  struct is_foldable_expression {
+    static constexpr bool unary = std::is_same<tt3, void_s>::value;
+
+    using s1 = fold_shape<tt>;
+    using s2 = fold_shape<tt2>;
+    using s3 = fold_shape<tt3>;
+
+    static constexpr bool scalars = is_foldable_scalar<typename s1::component_type>::value &&
+      is_foldable_scalar<typename s2::component_type>::value &&
+      !std::is_same<typename s2::component_type, SBool>::value &&
+      (unary || is_foldable_scalar<typename s3::component_type>::value);
+
+    static constexpr bool same_vectors = s1::m == 1 && s2::m == 1 && s1::n == s2::n &&
+      (unary || (s3::m == 1 && s3::n == s1::n));
+
+    static constexpr bool scaled = op == EXPR_MULTIPLICATION && !unary &&
+      ((s2::is_composite && !s3::is_composite && std::is_same<tt, tt2>::value) ||
+       (!s2::is_composite && s3::is_composite && std::is_same<tt, tt3>::value));
+
+    static constexpr bool value = scalars && (same_vectors || scaled);
+  };
+
+
+  /*
+   * SConstantFolder member functions
+   */
+
+  template<typename tt>
+  bool SConstantFolder::getConstant(SValue<tt>& v, typename InvMapSType<tt>::type& value) {
+    using ctype = typename InvMapSType<tt>::type;
+
+    Constant<ctype>* c = dynamic_cast<Constant<ctype>*>(&v);
+    if(!c) {
+      return false;
+    }
+
+    value = c->value;
+    return true;
+  }
+
+  template<typename tt, typename ctype>
+  bool SConstantFolder::getComponents(SValue<tt>& v, std::vector<ctype>& values) {
+    using shape = fold_shape<tt>;
+
+    if constexpr(!shape::is_composite) {
+      values.resize(1);
+      return SConstantFolder::getConstant(v, values[0]);
+    } else {
+      using inner = typename shape::component_type;
+      constexpr int n = shape::n;
+      constexpr int m = shape::m;
+
+      ConstructMatrix<n, m, inner>* composite = dynamic_cast<ConstructMatrix<n, m, inner>*>(&v);
+      if(!composite || !composite->is_constant) {
+	return false;
+      }
+
+      values.resize(n * m);
+      for(int i = 0; i < n; i++) {
+	for(int j = 0; j < m; j++) {
+	  SValue<inner>* component;
+	  if constexpr(n > 1 && m > 1) {
+	    // Constant matrices are made of constant columns, see ConstructMatrix::detect_constant
+	    ConstructMatrix<n, 1, inner>* column =
+	      static_cast<ConstructMatrix<n, 1, inner>*>((SValue<SMat<n, 1, inner> >*)composite->components[j]);
+	    component = (SValue<inner>*)column->components[i];
+	  } else {
+	    component = (SValue<inner>*)composite->components[i * m + j];
+	  }
+
+	  if(!SConstantFolder::getConstant(*component, values[i * m + j])) {
+	    return false;
+	  }
+	}
+      }
+
+      return true;
+    }
+  }
+
+  template<int n, int m, typename inner, std::size_t... is>
+  SValue<SMat<n, m, inner> >* make_constant_composite(const std::vector<SValue<inner>*>& components,
+						      std::index_sequence<is...>) {
+    // Turned into an OpConstantComposite as all components are constants
+    return SUtils::allocate<ConstructMatrix<n, m, inner> >(*components[is]...);
+  }
+
+  template<typename tt, typename ctype>
+  SValue<tt>* SConstantFolder::makeConstant(const std::vector<ctype>& values) {
+    using shape = fold_shape<tt>;
+
+    if constexpr(!shape::is_composite) {
+      return SUtils::allocate<Constant<ctype> >(values[0]);
+    } else {
+      using inner = typename shape::component_type;
+
+      std::vector<SValue<inner>*> components(values.size());
+      for(unsigned int i = 0; i < values.size(); i++) {
+	components[i] = SUtils::allocate<Constant<ctype> >(values[i]);
+      }
+
+      return make_constant_composite<shape::n, shape::m, inner>(components,
+								 std::make_index_sequence<shape::n * shape::m>());
+    }
+  }
+
+  template<SExprOp op, bool unary, typename rtype, typename atype, typename btype>
+  bool SConstantFolder::foldComponent(atype a, btype b, rtype& res) {
+    if constexpr(op == EXPR_CAST) {
+      if constexpr(std::is_same<rtype, atype>::value) {
+	return false;
+      } else {
+	return SConstantFolder::foldCast(a, res);
+      }
+    } else if constexpr(unary) {
+      return SConstantFolder::foldUnary(op, a, res);
+    } else if constexpr(std::is_same<rtype, bool>::value) {
+      return SConstantFolder::foldComparison(op, a, b, res);
+    } else {
+      return SConstantFolder::foldBinary(op, a, b, res);
+    }
+  }
+
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  SValue<tt>* SConstantFolder::foldExpression(SValue<tt2>& v1, SValue<tt3>* v2) {
+    constexpr bool unary = std::is_same<tt3, void_s>::value;
+
+    if constexpr(op == EXPR_LOOKUP) {
+      return SConstantFolder::foldLookup<tt>(v1, *v2);
+    } else if constexpr(!is_foldable_expression<tt, op, tt2, tt3>::value) {
+      return nullptr;
+    } else {
+      using rtype = typename InvMapSType<typename fold_shape<tt>::component_type>::type;
+      using atype = typename InvMapSType<typename fold_shape<tt2>::component_type>::type;
+      using btype = typename std::conditional<unary, atype,
+					      typename InvMapSType<typename fold_shape<tt3>::component_type>::type>::type;
+
+      std::vector<atype> as;
+      if(!SConstantFolder::enabled || !SConstantFolder::getComponents(v1, as)) {
+	return nullptr;
+      }
+
+      std::vector<btype> bs(1);
+      if constexpr(!unary) {
+	if(!SConstantFolder::getComponents(*v2, bs)) {
+	  return nullptr;
+	}
+      }
+
+      std::vector<rtype> rs(fold_shape<tt>::n * fold_shape<tt>::m);
+      for(unsigned int i = 0; i < rs.size(); i++) {
+	// A scalar operand goes with every component of the other
+	rtype r;
+	if(!SConstantFolder::foldComponent<op, unary>(as[as.size() == 1 ? 0 : i],
+						      bs[bs.size() == 1 ? 0 : i], r)) {
+	  return nullptr;
+	}
+
+	rs[i] = r;
+      }
+
+      return SConstantFolder::makeConstant<tt>(rs);
+    }
+  }
+
+  template<typename tt, typename tt2, typename tt3>
+  SValue<tt>* SConstantFolder::foldLookup(SValue<tt2>& v, SValue<tt3>& index) {
+    if constexpr(!fold_shape<tt2>::is_composite || fold_shape<tt2>::m != 1 ||
+		 !is_foldable_scalar<tt>::value) {
+      return nullptr;
+    } else {
+      constexpr int n = fold_shape<tt2>::n;
+
+      typename InvMapSType<tt3>::type i;
+      if(!SConstantFolder::enabled || !SConstantFolder::getConstant(index, i) ||
+	 (int64_t)i < 0 || (int64_t)i >= n) {
+	return nullptr;
+      }
+
+      ConstructMatrix<n, 1, tt>* composite = dynamic_cast<ConstructMatrix<n, 1, tt>*>(&v);
+      if(!composite || !composite->is_constant) {
+	return nullptr;
+      }
+
+      // The constant the composite was made from
+      return (SValue<tt>*)composite->components[i];
+    }
+  }
+
+  template<typename tt>
+  SValue<tt>* SConstantFolder::foldGLSLFunction(GLSLFunction function,
+						const std::vector<SValue<tt>*>& args) {
+    if constexpr(!is_foldable_scalar<tt>::value || std::is_same<tt, SBool>::value) {
+      return nullptr;
+    } else {
+      using ctype = typename InvMapSType<tt>::type;
+
+      if(!SConstantFolder::enabled) {
+	return nullptr;
+      }
+
+      std::vector<ctype> values(args.size());
+      for(unsigned int i = 0; i < args.size(); i++) {
+	if(!SConstantFolder::getConstant(*args[i], values[i])) {
+	  return nullptr;
+	}
+      }
+
+      ctype r;
+      if(!SConstantFolder::foldGLSL(function, values, r)) {
+	return nullptr;
+      }
+
+      return SUtils::allocate<Constant<ctype> >(r);
+    }
+  }
+
+  template<typename tt>
+  SValue<tt>* SConstantFolder::foldSelect(SValue<SBool>& cond, SValue<tt>& val_true, SValue<tt>& val_false) {
+    if(!SConstantFolder::enabled) {
+      return nullptr;
+    }
+
+    // Same node, or equal constants
+    if(val_true.getID() == val_false.getID()) {
+      return &val_true;
+    }
+
+    bool c;
+    if(SConstantFolder::getConstant(cond, c)) {
+      return c ? &val_true : &val_false;
+    }
+
+    return nullptr;
+  }
+
+};
+
+#endif // __SPURV_CONSTANT_FOLDING_IMPL
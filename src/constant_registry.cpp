@@ -4,11 +4,20 @@
 #include <map>
 #include <algorithm> // pair
 #include <tuple>
+#include <cstring>
 
 namespace spurv {
 
   std::map<std::tuple<int, int, int>, SDeclarationState> SConstantRegistry::integer_registry;
-  std::map<std::pair<int, float>, SDeclarationState > SConstantRegistry::float_registry;
+  std::map<std::pair<int, uint32_t>, SDeclarationState > SConstantRegistry::float_registry;
+  std::map<bool, SDeclarationState> SConstantRegistry::bool_registry;
+  std::map<std::tuple<int, int, std::vector<int> >, SDeclarationState> SConstantRegistry::composite_registry;
+
+  std::pair<int, uint32_t> SConstantRegistry::float_key(int n, float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return std::make_pair(n, bits);
+  }
 
   
   bool SConstantRegistry::isDefinedInt(int n, int s, int m) {
@@ -20,8 +29,16 @@ namespace spurv {
   }
 
   bool SConstantRegistry::isDefinedFloat(int n, float f) {
-    if(float_registry.find(std::make_pair(n, f)) != float_registry.end()) {
-      return float_registry[std::make_pair(n, f)].is_defined;
+    if(float_registry.find(float_key(n, f)) != float_registry.end()) {
+      return float_registry[float_key(n, f)].is_defined;
+    }
+
+    return false;
+  }
+
+  bool SConstantRegistry::isDefinedBool(bool b) {
+    if(bool_registry.find(b) != bool_registry.end()) {
+      return bool_registry[b].is_defined;
     }
 
     return false;
@@ -32,7 +49,11 @@ namespace spurv {
   }
 
   bool SConstantRegistry::isRegisteredFloat(int n, float f) {
-    return float_registry.find(std::make_pair(n, f)) != float_registry.end();
+    return float_registry.find(float_key(n, f)) != float_registry.end();
+  }
+
+  bool SConstantRegistry::isRegisteredBool(bool b) {
+    return bool_registry.find(b) != bool_registry.end();
   }
 
   void SConstantRegistry::registerInt(int n, int s, int m, int id) {
@@ -53,7 +74,33 @@ namespace spurv {
     } else {
       SDeclarationState state;
       state.id = id;
-      float_registry[std::make_pair(n, f)] = state;
+      float_registry[float_key(n, f)] = state;
+    }
+  }
+
+  void SConstantRegistry::registerBool(bool b, int id) {
+    if(isRegisteredBool(b)) {
+      printf("Tried to reregister bool\n");
+      exit(-1);
+    } else {
+      SDeclarationState state;
+      state.id = id;
+      bool_registry[b] = state;
+    }
+  }
+
+  bool SConstantRegistry::isRegisteredComposite(int n, int m, const std::vector<int>& constituents) {
+    return composite_registry.find(std::make_tuple(n, m, constituents)) != composite_registry.end();
+  }
+
+  void SConstantRegistry::registerComposite(int n, int m, const std::vector<int>& constituents, int id) {
+    if(isRegisteredComposite(n, m, constituents)) {
+      printf("Tried to reregister composite\n");
+      exit(-1);
+    } else {
+      SDeclarationState state;
+      state.id = id;
+      composite_registry[std::make_tuple(n, m, constituents)] = state;
     }
   }
 
@@ -82,7 +129,21 @@ namespace spurv {
       exit(-1);
     }
 
-    float_registry[std::make_pair(n, s)].is_defined = true;
+    float_registry[float_key(n, s)].is_defined = true;
+  }
+
+  void SConstantRegistry::declareDefinedBool(bool b) {
+    if(!isRegisteredBool(b)) {
+      printf("Tried to define unregistered bool!\n");
+      exit(-1);
+    }
+
+    if(isDefinedBool(b)) {
+      printf("Tried to redeclare defined of already defined bool!\n");
+      exit(-1);
+    }
+
+    bool_registry[b].is_defined = true;
   }
 
   int SConstantRegistry::getIDInteger(int n, int s, int m) {
@@ -100,12 +161,67 @@ namespace spurv {
       exit(-1);
     }
     
-    return float_registry[std::make_pair(n, f)].id;
+    return float_registry[float_key(n, f)].id;
+  }
+
+  int SConstantRegistry::getIDBool(bool b) {
+    if(!isRegisteredBool(b)) {
+      printf("Tried to get id of unregistered bool\n");
+      exit(-1);
+    }
+    
+    return bool_registry[b].id;
+  }
+
+  int SConstantRegistry::getIDComposite(int n, int m, const std::vector<int>& constituents) {
+    if(!isRegisteredComposite(n, m, constituents)) {
+      printf("Tried to get id of unregistered composite\n");
+      exit(-1);
+    }
+
+    return composite_registry[std::make_tuple(n, m, constituents)].id;
+  }
+
+  void SConstantRegistry::ensureDefinedComposite(int n, int m, const std::vector<int>& constituents,
+						 bool is_null, int type_id, std::vector<uint32_t>& res) {
+    if(!isRegisteredComposite(n, m, constituents)) {
+      printf("Tried to define unregistered composite!\n");
+      exit(-1);
+    }
+
+    SDeclarationState& state = composite_registry[std::make_tuple(n, m, constituents)];
+    if(state.is_defined) {
+      return;
+    }
+
+    if(type_id < 0) {
+      printf("Tried to define constant before its type was defined!\n");
+      exit(-1);
+    }
+
+    if(is_null) {
+      // OpConstantNull
+      SUtils::add(res, (3 << 16) | 46);
+      SUtils::add(res, type_id);
+      SUtils::add(res, state.id);
+    } else {
+      // OpConstantComposite
+      SUtils::add(res, ((3 + constituents.size()) << 16) | 44);
+      SUtils::add(res, type_id);
+      SUtils::add(res, state.id);
+      for(int id : constituents) {
+	SUtils::add(res, id);
+      }
+    }
+
+    state.is_defined = true;
   }
 
   void SConstantRegistry::resetRegistry() {
     integer_registry.clear();
     float_registry.clear();
+    bool_registry.clear();
+    composite_registry.clear();
   }
   
 };
@@ -12,31 +12,52 @@ namespace spurv {
   
   class SConstantRegistry {
     // Tuples for ints contain <data type size, signedness, constant> maps to id
-    // Pairs for floats contain <data type size, constant>, maps to id
+    // Pairs for floats contain <data type size, bit pattern of constant>, maps to id
+    // (bit patterns, so that 0.0 and -0.0 are kept apart and NaNs can be registered)
+    // Bools map to id
+    // Tuples for composites contain <rows, columns, ids of the constituents> maps to id
+    // (the constituents are scalars for vectors and column vectors for matrices)
     static std::map<std::tuple<int, int, int>, SDeclarationState> integer_registry;
-    static std::map<std::pair<int, float>, SDeclarationState > float_registry;
+    static std::map<std::pair<int, uint32_t>, SDeclarationState > float_registry;
+    static std::map<bool, SDeclarationState> bool_registry;
+    static std::map<std::tuple<int, int, std::vector<int> >, SDeclarationState> composite_registry;
+
+    static std::pair<int, uint32_t> float_key(int n, float f);
 
   public:
     
     static void registerInt(int n, int s, int m, int id);
     static void registerFloat(int n, float f, int id);
+    static void registerBool(bool b, int id);
+    static void registerComposite(int n, int m, const std::vector<int>& constituents, int id);
     
     static void declareDefinedInt(int n, int s, int m);
     static void declareDefinedFloat(int n, float s);
+    static void declareDefinedBool(bool b);
     
     static bool isDefinedInt(int n, int s, int m);
     static bool isDefinedFloat(int n, float f);
+    static bool isDefinedBool(bool b);
 
     static bool isRegisteredInt(int n, int s, int m);
     static bool isRegisteredFloat(int n, float f);
+    static bool isRegisteredBool(bool b);
+    static bool isRegisteredComposite(int n, int m, const std::vector<int>& constituents);
 
     static int getIDInteger(int n, int s, int m);
     static int getIDFloat(int n, float f);
+    static int getIDBool(bool b);
+    static int getIDComposite(int n, int m, const std::vector<int>& constituents);
 
     // Returns the registered id if different from supplied id
     template<typename nt> 
     static int ensureDefinedConstant(const nt& val, int id,
 				     std::vector<uint32_t>& res);
+
+    // Writes OpConstantComposite, or OpConstantNull if is_null, the first time it is called
+    // for a registered composite. The constituents must already be defined
+    static void ensureDefinedComposite(int n, int m, const std::vector<int>& constituents,
+				       bool is_null, int type_id, std::vector<uint32_t>& res);
     
     static void resetRegistry();
   };
@@ -16,15 +16,42 @@ namespace spurv {
 					       std::vector<uint32_t>& res) {
     using st = typename MapSType<tt>::type;
 
-    static_assert(st::getKind() == STypeKind::KIND_INT || st::getKind() == STypeKind::KIND_FLOAT,
-		  "Constant definitions only allowed for ints and floats for now");
+    static_assert(st::getKind() == STypeKind::KIND_INT || st::getKind() == STypeKind::KIND_FLOAT ||
+		  st::getKind() == STypeKind::KIND_BOOL,
+		  "Constant definitions only allowed for ints, floats and bools for now");
 
-    static_assert(st::getArg0() == 32,
+    static_assert(st::getKind() == STypeKind::KIND_BOOL || st::getArg0() == 32,
 		  "Constant definitions of float or integer type must have bit depth 32, for now");
 
     int n_id;
     
-    if constexpr(st::getKind() == STypeKind::KIND_INT) {
+    if constexpr(st::getKind() == STypeKind::KIND_BOOL) {
+	if(isDefinedBool(val)) {
+	  return getIDBool(val);
+	}
+
+	if(isRegisteredBool(val)) {
+	  n_id = getIDBool(val);
+	} else {
+	  registerBool(val, id);
+	  n_id = id;
+	}
+
+	declareDefinedBool(val);
+
+	if(st::getID() < 0) {
+	  printf("Tried to define constant before its type was defined!\n");
+	  exit(-1);
+	}
+
+	// OpConstantTrue / OpConstantFalse
+	SUtils::add(res, (3 << 16) | (val ? 41 : 42));
+	SUtils::add(res, st::getID());
+	SUtils::add(res, n_id);
+
+	return n_id;
+	
+    } else if constexpr(st::getKind() == STypeKind::KIND_INT) {
 
 	if(isDefinedInt(st::getArg0(), st::getArg1(), val)) {
 	  return getIDInteger(st::getArg0(), st::getArg1(), val);;
@@ -2,6 +2,7 @@
 #include "control_flow.hpp"
 #include "values.hpp"
 #include "pointers.hpp"
+#include "local_promotion.hpp"
 
 #include "variable_registry_impl.hpp"
 #include "values_impl.hpp"
@@ -14,9 +15,10 @@ namespace spurv {
    * SIfThen member functions
    */
 
-  SIfThen::SIfThen(SValue<bool_s>* cond) {
+  SIfThen::SIfThen(SValue<bool_s>* cond, SSelectionControl control) {
     this->cond = cond;
     this->hasElse = false;
+    this->control = control;
 
     this->ifthen_label = SUtils::getNewID();
     this->else_label = SUtils::getNewID();
@@ -32,10 +34,13 @@ namespace spurv {
   void SIfThen::write_begin(std::vector<uint32_t>& bin) {
     this->cond->ensure_defined(bin);
 
-    // OpSelectionMerge <merge_point> None
+    SLocalPromoter::branch(bin, this->ifthen_label);
+    SLocalPromoter::branch(bin, this->hasElse ? this->else_label : this->merge_label);
+
+    // OpSelectionMerge <merge_point> <selection_control>
     SUtils::add(bin, (3 << 16) | 247);
     SUtils::add(bin, this->merge_label);
-    SUtils::add(bin, 0);
+    SUtils::add(bin, this->control);
 
     // OpBranchConditional <cond> <ifthen> <else/end>
     SUtils::add(bin, (4 << 16) | 250);
@@ -48,9 +53,13 @@ namespace spurv {
     // OpLabel <ifthen>
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->ifthen_label);
+
+    SLocalPromoter::label(bin, this->ifthen_label);
   }
   
   void SIfThen::write_else(std::vector<uint32_t>& bin) {
+    SLocalPromoter::branch(bin, this->merge_label);
+
     // OpBranch <end>
     SUtils::add(bin, (2 << 16) | 249);
     SUtils::add(bin, this->merge_label);
@@ -58,9 +67,13 @@ namespace spurv {
     // OpLabel <else>
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->else_label);
+
+    SLocalPromoter::label(bin, this->else_label);
   }
   
   void SIfThen::write_end(std::vector<uint32_t>& bin) {
+    SLocalPromoter::branch(bin, this->merge_label);
+
     // OpBranch <end>
     SUtils::add(bin, (2 << 16) | 249);
     SUtils::add(bin, this->merge_label);
@@ -68,6 +81,8 @@ namespace spurv {
     // OpLabel <merge>
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->merge_label);
+
+    SLocalPromoter::label(bin, this->merge_label);
   }
 
   bool SIfThen::has_else() {
@@ -83,6 +98,53 @@ namespace spurv {
   }
   
   
+  /*
+   * SLoopControl member functions
+   */
+
+  uint32_t SLoopControl::getMask() const {
+    return (this->unroll ? 0x1 : 0) |
+      (this->dont_unroll ? 0x2 : 0) |
+      (this->dependency_infinite ? 0x4 : 0) |
+      (this->dependency_length ? 0x8 : 0) |
+      (this->min_iterations ? 0x10 : 0) |
+      (this->max_iterations ? 0x20 : 0);
+  }
+
+  int SLoopControl::getWordCount() const {
+    return 1 + (this->dependency_length ? 1 : 0) +
+      (this->min_iterations ? 1 : 0) +
+      (this->max_iterations ? 1 : 0);
+  }
+
+  uint32_t SLoopControl::getRequiredVersion() const {
+    if(this->min_iterations || this->max_iterations) {
+      return 0x00010400;
+    }
+
+    if(this->dependency_infinite || this->dependency_length) {
+      return 0x00010100;
+    }
+
+    return 0x00010000;
+  }
+
+  void SLoopControl::write(std::vector<uint32_t>& bin) const {
+    SUtils::add(bin, this->getMask());
+
+    // Parameters in the order of their bits
+    if(this->dependency_length) {
+      SUtils::add(bin, this->dependency_length);
+    }
+    if(this->min_iterations) {
+      SUtils::add(bin, this->min_iterations);
+    }
+    if(this->max_iterations) {
+      SUtils::add(bin, this->max_iterations);
+    }
+  }
+
+
   /*
    * SForLoop member functions
    */
@@ -99,13 +161,23 @@ namespace spurv {
       this->end = start;
     } else if(end < start) {
       printf("End value must be higher than start value in spurv for loops\n");
+
+      // Runs no iterations
+      this->start = start;
+      this->end = start;
     } else {
       this->start = start;
       this->end = end;
     }
 
+    this->step = 1;
+    this->unroll = SUnroll::UNROLL_AUTO;
+    this->unroll_factor = 0;
+    this->control = SLoopControl();
+
     this->iterator_pointer = SUtils::allocate<SLocal<int_s> >();
     this->iterator_val = SUtils::allocate<SCustomVal<int_s> >();
+    this->incremented_id = -1;
     this->start_constant = SUtils::allocate<Constant<int> >(this->start);
     this->end_constant = SUtils::allocate<Constant<int> >(this->end);
     this->increment_constant = SUtils::allocate<Constant<int> >(1);
@@ -122,13 +194,23 @@ namespace spurv {
   }
 
   void SForLoop::write_start(std::vector<uint32_t>& bin) {
-    this->iterator_pointer->ensure_defined(bin);
+    // A promoted iterator is a phi of the start value and the incremented value
+    bool promoted = SLocalPromoter::isPromoted(this->iterator_pointer->getID());
+    int preheader_label = SLocalPromoter::block(bin);
+
+    if(promoted) {
+      this->incremented_id = SUtils::getNewID();
+    } else {
+      this->iterator_pointer->ensure_defined(bin);
 
-    // Store start value in pointer
-    // OpStore <pointer_id> <val_id>
-    SUtils::add(bin, (3 << 16) | 62);
-    SUtils::add(bin, this->iterator_pointer->getID());
-    SUtils::add(bin, this->start_constant->getID());
+      // Store start value in pointer
+      // OpStore <pointer_id> <val_id>
+      SUtils::add(bin, (3 << 16) | 62);
+      SUtils::add(bin, this->iterator_pointer->getID());
+      SUtils::add(bin, this->start_constant->getID());
+    }
+
+    SLocalPromoter::branch(bin, this->label_merge);
   
     // OpBranch <check_block>
     SUtils::add(bin, (2 << 16) | 249);
@@ -138,11 +220,27 @@ namespace spurv {
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->label_merge);
 
-    // OpLoopMerge <merge_point (end)> <continue_point (increment)> <loop_control (None)>
-    SUtils::add(bin, (4 << 16) | 246);
+    if(promoted) {
+      // OpPhi <result_type> <result_id> <start> <preheader> <incremented> <increment>
+      SUtils::add(bin, (7 << 16) | 245);
+      SUtils::add(bin, SInt<32, 1>::getID());
+      SUtils::add(bin, this->iterator_val->getID());
+      SUtils::add(bin, this->start_constant->getID());
+      SUtils::add(bin, preheader_label);
+      SUtils::add(bin, this->incremented_id);
+      SUtils::add(bin, this->label_increment);
+    }
+
+    SLocalPromoter::loop_header(bin, this->label_merge, this->label_increment,
+				this->iterator_pointer->getID());
+
+    // OpLoopMerge <merge_point (end)> <continue_point (increment)> <loop_control> <parameters...>
+    SUtils::add(bin, ((3 + this->control.getWordCount()) << 16) | 246);
     SUtils::add(bin, this->label_post);
     SUtils::add(bin, this->label_increment);
-    SUtils::add(bin, 0); // None
+    this->control.write(bin);
+
+    SLocalPromoter::branch(bin, this->label_check);
 
     // OpBranch <check>
     SUtils::add(bin, (2 << 16) | 249);
@@ -152,13 +250,17 @@ namespace spurv {
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->label_check);
 
+    SLocalPromoter::label(bin, this->label_check);
+
     // Load iterator variable and check if it has met its end goal yet
-  
-    // OpLoad <result_type (int)> <result id> <pointer>
-    SUtils::add(bin, (4 << 16) | 61);
-    SUtils::add(bin, SInt<32, 1>::getID());
-    SUtils::add(bin, this->iterator_val->getID());
-    SUtils::add(bin, this->iterator_pointer->getID());
+
+    if(!promoted) {
+      // OpLoad <result_type (int)> <result id> <pointer>
+      SUtils::add(bin, (4 << 16) | 61);
+      SUtils::add(bin, SInt<32, 1>::getID());
+      SUtils::add(bin, this->iterator_val->getID());
+      SUtils::add(bin, this->iterator_pointer->getID());
+    }
 
     int is_within_range_id = SUtils::getNewID();
   
@@ -169,6 +271,9 @@ namespace spurv {
     SUtils::add(bin, this->iterator_val->getID());
     SUtils::add(bin, this->end_constant->getID());
 
+    SLocalPromoter::branch(bin, this->label_body);
+    SLocalPromoter::branch(bin, this->label_post);
+
     // OpBranchConditional <condition_id> <true_branch> <false_branch>
     SUtils::add(bin, (4 << 16) | 250);
     SUtils::add(bin, is_within_range_id);
@@ -178,10 +283,14 @@ namespace spurv {
     // OpLabel <body_id>
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->label_body);
+
+    SLocalPromoter::label(bin, this->label_body);
   }
 
 
   void SForLoop::write_end(std::vector<uint32_t>& bin) {
+    SLocalPromoter::branch(bin, this->label_increment);
+
     // OpBranch <increment>
     SUtils::add(bin, (2 << 16) | 249);
     SUtils::add(bin, this->label_increment);
@@ -190,27 +299,40 @@ namespace spurv {
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->label_increment);
 
-    int new_load_id = SUtils::getNewID();
+    SLocalPromoter::label(bin, this->label_increment);
+
+    if(SLocalPromoter::isPromoted(this->iterator_pointer->getID())) {
+      // OpIAdd <int_id> <result_id> <it_val_id> <const_1>
+      SUtils::add(bin, (5 << 16) | 128);
+      SUtils::add(bin, SInt<32, 1>::getID());
+      SUtils::add(bin, this->incremented_id);
+      SUtils::add(bin, this->iterator_val->getID());
+      SUtils::add(bin, this->increment_constant->getID());
+    } else {
+      int new_load_id = SUtils::getNewID();
     
-    // OpLoad <result_type (int> <result_id> <pointer>
-    SUtils::add(bin, (4 << 16) | 61);
-    SUtils::add(bin, SInt<32, 1>::getID());
-    SUtils::add(bin, new_load_id);
-    SUtils::add(bin, this->iterator_pointer->getID());
+      // OpLoad <result_type (int> <result_id> <pointer>
+      SUtils::add(bin, (4 << 16) | 61);
+      SUtils::add(bin, SInt<32, 1>::getID());
+      SUtils::add(bin, new_load_id);
+      SUtils::add(bin, this->iterator_pointer->getID());
     
-    int incremented_id = SUtils::getNewID();
+      int incremented_id = SUtils::getNewID();
     
-    // OpIAdd <int_id> <result_id> <it_val_id> <const_1>
-    SUtils::add(bin, (5 << 16) | 128);
-    SUtils::add(bin, SInt<32, 1>::getID());
-    SUtils::add(bin, incremented_id);
-    SUtils::add(bin, new_load_id);
-    SUtils::add(bin, this->increment_constant->getID());
-
-    // OpStore <iterator_pointer> <incremented_id>
-    SUtils::add(bin, (3 << 16) | 62);
-    SUtils::add(bin, this->iterator_pointer->getID());
-    SUtils::add(bin, incremented_id);
+      // OpIAdd <int_id> <result_id> <it_val_id> <const_1>
+      SUtils::add(bin, (5 << 16) | 128);
+      SUtils::add(bin, SInt<32, 1>::getID());
+      SUtils::add(bin, incremented_id);
+      SUtils::add(bin, new_load_id);
+      SUtils::add(bin, this->increment_constant->getID());
+
+      // OpStore <iterator_pointer> <incremented_id>
+      SUtils::add(bin, (3 << 16) | 62);
+      SUtils::add(bin, this->iterator_pointer->getID());
+      SUtils::add(bin, incremented_id);
+    }
+
+    SLocalPromoter::branch(bin, this->label_merge);
 
     // OpBranch <check>
     SUtils::add(bin, (2 << 16) | 249);
@@ -219,9 +341,13 @@ namespace spurv {
     // OpLabel <post>
     SUtils::add(bin, (2 << 16) | 248);
     SUtils::add(bin, this->label_post);
+
+    SLocalPromoter::label(bin, this->label_post);
   }
 
   void SForLoop::write_break(std::vector<uint32_t>& bin) {
+    SLocalPromoter::branch(bin, this->label_post);
+
     // OpBranch <post_label>
     SUtils::add(bin, (2 << 16) | 249);
     SUtils::add(bin, this->label_post);
@@ -237,6 +363,8 @@ namespace spurv {
   }
 
   void SForLoop::write_continue(std::vector<uint32_t>& bin) {
+    SLocalPromoter::branch(bin, this->label_increment);
+
     // OpBranch <increment>
     SUtils::add(bin, (2 << 16) | 249);
     SUtils::add(bin, this->label_increment);
@@ -248,6 +376,13 @@ namespace spurv {
     SUtils::add(bin, new_label);
   }
 
+  void SForLoop::set_step(int step) {
+    if(step != this->step) {
+      this->step = step;
+      this->increment_constant = SUtils::allocate<Constant<int> >(step);
+    }
+  }
+
   SControlType SForLoop::getControlType() {
     return CONTROL_FOR;
   }
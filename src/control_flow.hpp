@@ -25,10 +25,11 @@ namespace spurv {
 
     SValue<bool_s>* cond;
     bool hasElse;
+    SSelectionControl control;
 
     int ifthen_label, else_label, merge_label;
     
-    SIfThen(SValue<bool_s>* cond);
+    SIfThen(SValue<bool_s>* cond, SSelectionControl control);
     
     void write_type_definitions(std::vector<uint32_t>& bin,
 				std::vector<SDeclarationState*>& declaration_states);
@@ -52,6 +53,27 @@ namespace spurv {
   };
   
   
+  /*
+   * SLoopControl - Hints for the driver on how to compile a loop, given as the loop control
+   * of its OpLoopMerge. Lengths and iteration counts of 0 are left out
+   */
+
+  struct SLoopControl {
+    bool unroll;
+    bool dont_unroll;
+    bool dependency_infinite; // No dependencies between iterations
+    int dependency_length; // Iterations between dependent accesses, at least
+    int min_iterations;
+    int max_iterations;
+
+    uint32_t getMask() const;
+    int getWordCount() const; // Of the mask and its parameters
+    uint32_t getRequiredVersion() const; // As in the SPIR-V header
+
+    void write(std::vector<uint32_t>& bin) const;
+  };
+
+  
   /*
    * SForLoop - class representing a loop construct
    */
@@ -60,10 +82,16 @@ namespace spurv {
     SForLoop(int start, int end);
     
     int label_merge, label_check, label_body, label_increment, label_post;
-    int start, end;
+    int start, end, step;
+
+    SUnroll unroll;
+    int unroll_factor; // For UNROLL_PARTIAL, 0 for the default
+
+    SLoopControl control;
 
     SLocal<int_s>* iterator_pointer;
     SValue<int_s>* iterator_val;
+    int incremented_id; // Of the iterator at the end of the body, when promoted (see SLocalPromoter)
 
     Constant<int>* start_constant;
     Constant<int>* end_constant;
@@ -77,6 +105,9 @@ namespace spurv {
     void write_break(std::vector<uint32_t>& bin);
     void write_continue(std::vector<uint32_t>& bin);
 
+    // The amount the iterator is incremented by, (end - start) must be divisible by it
+    void set_step(int step);
+
     virtual SControlType getControlType();
     
     template<SShaderType type, typename... InputTypes>
@@ -88,6 +119,8 @@ namespace spurv {
     friend class SBreakEvent;
     friend class SContinueEvent;
 
+    friend class SLoopUnroller;
+
     friend class SUtils;
     
   };
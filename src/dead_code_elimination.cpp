@@ -0,0 +1,149 @@
+#include "dead_code_elimination.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "dead_store_elimination.hpp"
+
+namespace spurv {
+
+  /*
+   * SDeadCodeEliminator members
+   */
+
+  bool SDeadCodeEliminator::enabled = true;
+  bool SDeadCodeEliminator::analyzed = false;
+
+  std::vector<bool> SDeadCodeEliminator::live_events;
+  std::unordered_set<const SValueBase*> SDeadCodeEliminator::live_values;
+  std::unordered_set<int> SDeadCodeEliminator::live_pointers;
+
+  int SDeadCodeEliminator::num_eliminated = 0;
+
+
+  /*
+   * SDeadCodeEliminator member functions
+   */
+
+  void SDeadCodeEliminator::mark_value(const SValueBase* value,
+				       std::vector<const SValueBase*>& worklist) {
+    if(value != nullptr && SDeadCodeEliminator::live_values.insert(value).second) {
+      worklist.push_back(value);
+    }
+  }
+
+  void SDeadCodeEliminator::mark_pointer(const SPointerBase* pointer,
+					 std::vector<const SValueBase*>& worklist) {
+    // Walk up the access chain, the indices are used to compute the address
+    SPointerInfo info;
+    while(pointer != nullptr) {
+      pointer->getPointerInfo(info);
+      if(!SDeadCodeEliminator::live_pointers.insert(info.id).second) {
+	break;
+      }
+
+      SDeadCodeEliminator::mark_value(info.index, worklist);
+      pointer = info.parent;
+    }
+  }
+
+  void SDeadCodeEliminator::analyze() {
+    SDeadCodeEliminator::clear();
+    SDeadCodeEliminator::num_eliminated = 0;
+
+    if(!SDeadCodeEliminator::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+    std::vector<const SValueBase*> worklist;
+
+    // Mark the roots
+    SEventInfo ev;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_STORE:
+	// Nothing observes the stored value, see SDeadStoreEliminator
+	if(SDeadStoreEliminator::isDead(i)) {
+	  break;
+	}
+	[[fallthrough]];
+      case EVENT_IMAGE_STORE:
+      case EVENT_IF:
+      case EVENT_RETURN:
+	for(const SValueBase* value : ev.values) {
+	  SDeadCodeEliminator::mark_value(value, worklist);
+	}
+	SDeadCodeEliminator::mark_pointer(ev.pointer, worklist);
+	break;
+      case EVENT_FOR_BEGIN:
+	// The iterator is written by the loop itself, whether it is used or not
+	SDeadCodeEliminator::mark_pointer(ev.pointer, worklist);
+	break;
+      default:
+	break;
+      }
+    }
+
+    // Propagate to operands and loaded pointers
+    SNodeInfo info;
+    while(worklist.size()) {
+      const SValueBase* value = worklist.back();
+      worklist.pop_back();
+
+      value->getNodeInfo(info);
+      for(const SValueBase* operand : info.operands) {
+	SDeadCodeEliminator::mark_value(operand, worklist);
+      }
+      SDeadCodeEliminator::mark_pointer(info.pointer, worklist);
+    }
+
+    // Only declarations, loads and dead stores can be left out, the other events have side effects
+    SDeadCodeEliminator::live_events.assign(events.size(), true);
+    for(unsigned int i = 0; i < events.size(); i++) {
+      events[i]->getEventInfo(ev);
+
+      if((ev.kind == EVENT_DECLARATION || ev.kind == EVENT_LOAD) &&
+	 !SDeadCodeEliminator::live_values.count(ev.values[0])) {
+	SDeadCodeEliminator::live_events[i] = false;
+
+	if(ev.kind == EVENT_DECLARATION) {
+	  SDeadCodeEliminator::num_eliminated++;
+	}
+      } else if(ev.kind == EVENT_STORE && SDeadStoreEliminator::isDead(i)) {
+	SDeadCodeEliminator::live_events[i] = false;
+      }
+    }
+
+    SDeadCodeEliminator::analyzed = true;
+  }
+
+  bool SDeadCodeEliminator::isEventLive(int event_num) {
+    return !SDeadCodeEliminator::analyzed || SDeadCodeEliminator::live_events[event_num];
+  }
+
+  bool SDeadCodeEliminator::isPointerLive(int pointer_id) {
+    return !SDeadCodeEliminator::analyzed || SDeadCodeEliminator::live_pointers.count(pointer_id);
+  }
+
+  void SDeadCodeEliminator::clear() {
+    SDeadCodeEliminator::analyzed = false;
+
+    SDeadCodeEliminator::live_events.clear();
+    SDeadCodeEliminator::live_values.clear();
+    SDeadCodeEliminator::live_pointers.clear();
+  }
+
+  void SDeadCodeEliminator::setEnabled(bool enabled) {
+    SDeadCodeEliminator::enabled = enabled;
+  }
+
+  bool SDeadCodeEliminator::isEnabled() {
+    return SDeadCodeEliminator::enabled;
+  }
+
+  int SDeadCodeEliminator::getNumEliminated() {
+    return SDeadCodeEliminator::num_eliminated;
+  }
+
+};
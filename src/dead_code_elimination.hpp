@@ -0,0 +1,76 @@
+#ifndef __SPURV_DEAD_CODE_ELIMINATION
+#define __SPURV_DEAD_CODE_ELIMINATION
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SValueBase;
+
+  /*
+   * SDeadCodeEliminator - Finds the values and pointers that contribute to the result
+   * of the shader, so that the rest is left out of the binary.
+   *
+   * The roots are the stores (which includes the outputs given to compile and the
+   * builtins set with setBuiltin) that SDeadStoreEliminator has not found dead, the image
+   * stores and the conditions of if-statements. Dead stores are left out as well.
+   * Everything reachable from these through operands, loaded pointers and access chain
+   * indices is live. Declarations and loads of the other values are not written, and
+   * since types and constants are defined on demand by the values using them, neither
+   * are the types and constants only those values needed
+   */
+
+  class SDeadCodeEliminator {
+    static bool enabled;
+    static bool analyzed;
+
+    static std::vector<bool> live_events;
+    static std::unordered_set<const SValueBase*> live_values;
+    static std::unordered_set<int> live_pointers; // By id, as pointers are often copied by value
+
+    static int num_eliminated;
+
+    SDeadCodeEliminator() = delete;
+
+    static void mark_value(const SValueBase* value, std::vector<const SValueBase*>& worklist);
+    static void mark_pointer(const SPointerBase* pointer, std::vector<const SValueBase*>& worklist);
+
+    // Computes liveness for the events currently in SEventRegistry
+    static void analyze();
+
+    // Everything is live if no analysis has been done
+    static bool isEventLive(int event_num);
+    static bool isPointerLive(int pointer_id);
+
+    static void clear();
+
+    friend class SEventRegistry;
+    friend class SVariableRegistry;
+    friend class SLocalPromoter;
+    friend class SFmaContractor;
+    friend class SLoadEliminator;
+    friend class SStoreForwarder;
+    friend class SInvariantHoister;
+    friend class SCodeSinker;
+    friend class SGraphExporter;
+    friend class SPassManager;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Elimination is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of values left out of the last compiled shader
+    static int getNumEliminated();
+  };
+
+};
+
+#endif // __SPURV_DEAD_CODE_ELIMINATION
@@ -0,0 +1,202 @@
+#include "dead_store_elimination.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+
+#include <algorithm>
+
+namespace spurv {
+
+  /*
+   * SDeadStoreEliminator members
+   */
+
+  bool SDeadStoreEliminator::enabled = true;
+
+  std::unordered_set<int> SDeadStoreEliminator::dead_stores;
+
+  int SDeadStoreEliminator::num_eliminated = 0;
+
+
+  /*
+   * SDeadStoreEliminator member functions
+   */
+
+  bool SDeadStoreEliminator::get_access(const SPointerBase* pointer, SAccess& access) {
+    access.path.clear();
+    access.constant.clear();
+
+    SPointerInfo info;
+    SNodeInfo index_info;
+    while(true) {
+      pointer->getPointerInfo(info);
+      if(info.parent == nullptr) {
+	break;
+      }
+
+      info.index->getNodeInfo(index_info);
+      access.path.push_back(index_info.id);
+      access.constant.push_back(index_info.kind == NODE_CONSTANT);
+      pointer = info.parent;
+    }
+
+    if(info.storage != SStorageClass::STORAGE_FUNCTION && info.storage != SStorageClass::STORAGE_OUTPUT) {
+      return false;
+    }
+
+    access.path.push_back(info.id);
+    access.constant.push_back(true);
+    access.is_local = info.storage == SStorageClass::STORAGE_FUNCTION;
+    std::reverse(access.path.begin(), access.path.end());
+    std::reverse(access.constant.begin(), access.constant.end());
+    return true;
+  }
+
+  bool SDeadStoreEliminator::may_alias(const SAccess& a, const SAccess& b) {
+    if(a.path[0] != b.path[0]) {
+      return false;
+    }
+
+    // Equal constants share ids, so constant indices with different ids are different members
+    unsigned int length = std::min(a.path.size(), b.path.size());
+    for(unsigned int i = 1; i < length; i++) {
+      if(a.path[i] != b.path[i] && a.constant[i] && b.constant[i]) {
+	return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool SDeadStoreEliminator::covers(const SAccess& a, const SAccess& b) {
+    // Indices with the same id have the same value within a block
+    return a.path.size() <= b.path.size() &&
+      std::equal(a.path.begin(), a.path.end(), b.path.begin());
+  }
+
+  void SDeadStoreEliminator::analyze() {
+    SDeadStoreEliminator::clear();
+    SDeadStoreEliminator::num_eliminated = 0;
+
+    if(!SDeadStoreEliminator::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // The stores made so far in the current block that nothing may have loaded, by event number
+    std::vector<std::pair<SAccess, int> > pending;
+
+    // The stores to and loads from locals. Stores are kept with the event after which
+    // loads may read them
+    std::vector<std::pair<SAccess, int> > local_stores;
+    std::vector<int> local_store_events;
+    std::vector<std::pair<SAccess, int> > local_loads;
+
+    std::unordered_set<int> iterators; // Written by the loops themselves
+    int loop_depth = 0;
+    int loop_begin = -1; // Of the outermost loop we are in
+
+    SEventInfo ev;
+    SNodeInfo node;
+    SAccess access;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_DECLARATION:
+      case EVENT_IMAGE_STORE:
+	break;
+      case EVENT_STORE:
+	if(SDeadStoreEliminator::get_access(ev.pointer, access) && !iterators.count(access.path[0])) {
+	  for(const std::pair<SAccess, int>& store : pending) {
+	    if(SDeadStoreEliminator::covers(access, store.first)) {
+	      SDeadStoreEliminator::dead_stores.insert(store.second);
+	    }
+	  }
+
+	  pending.erase(std::remove_if(pending.begin(), pending.end(),
+				       [&](const std::pair<SAccess, int>& store) {
+					 return SDeadStoreEliminator::covers(access, store.first);
+				       }), pending.end());
+	  pending.push_back(std::make_pair(access, i));
+
+	  if(access.is_local) {
+	    local_stores.push_back(std::make_pair(access, loop_depth ? loop_begin : i));
+	    local_store_events.push_back(i);
+	  }
+	}
+	break;
+      case EVENT_LOAD:
+	ev.values[0]->getNodeInfo(node);
+	if(SDeadStoreEliminator::get_access(node.pointer, access)) {
+	  pending.erase(std::remove_if(pending.begin(), pending.end(),
+				       [&](const std::pair<SAccess, int>& store) {
+					 return SDeadStoreEliminator::may_alias(access, store.first);
+				       }), pending.end());
+
+	  if(access.is_local) {
+	    local_loads.push_back(std::make_pair(access, i));
+	  }
+	}
+	break;
+      case EVENT_FOR_BEGIN:
+	if(SDeadStoreEliminator::get_access(ev.pointer, access)) {
+	  iterators.insert(access.path[0]);
+	}
+	if(loop_depth == 0) {
+	  loop_begin = i;
+	}
+	loop_depth++;
+	pending.clear();
+	break;
+      case EVENT_FOR_END:
+	loop_depth--;
+	pending.clear();
+	break;
+      default:
+	// Control flow, the next block may be reached from elsewhere
+	pending.clear();
+	break;
+      }
+    }
+
+    // Locals are not observed after the shader
+    for(unsigned int k = 0; k < local_stores.size(); k++) {
+      bool is_loaded = false;
+      for(const std::pair<SAccess, int>& load : local_loads) {
+	if(load.second > local_stores[k].second &&
+	   SDeadStoreEliminator::may_alias(load.first, local_stores[k].first)) {
+	  is_loaded = true;
+	  break;
+	}
+      }
+
+      if(!is_loaded) {
+	SDeadStoreEliminator::dead_stores.insert(local_store_events[k]);
+      }
+    }
+
+    SDeadStoreEliminator::num_eliminated = SDeadStoreEliminator::dead_stores.size();
+  }
+
+  bool SDeadStoreEliminator::isDead(int event_num) {
+    return SDeadStoreEliminator::dead_stores.count(event_num);
+  }
+
+  void SDeadStoreEliminator::clear() {
+    SDeadStoreEliminator::dead_stores.clear();
+  }
+
+  void SDeadStoreEliminator::setEnabled(bool enabled) {
+    SDeadStoreEliminator::enabled = enabled;
+  }
+
+  bool SDeadStoreEliminator::isEnabled() {
+    return SDeadStoreEliminator::enabled;
+  }
+
+  int SDeadStoreEliminator::getNumEliminated() {
+    return SDeadStoreEliminator::num_eliminated;
+  }
+
+};
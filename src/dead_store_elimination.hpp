@@ -0,0 +1,76 @@
+#ifndef __SPURV_DEAD_STORE_ELIMINATION
+#define __SPURV_DEAD_STORE_ELIMINATION
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SPointerBase;
+
+  /*
+   * SDeadStoreEliminator - Finds the stores to locals and outputs whose values can never
+   * be observed, so that they are left out together with the values only they use.
+   *
+   * Within a block, a store is dead if a later store writes all of what it wrote (the same
+   * member, or the whole variable or a member containing it) before any load that may alias
+   * it. This covers outputs given new values and builtins set several times with
+   * setBuiltin, where only the last store is seen after the shader. A store to a local is
+   * also dead if no load that may alias it is recorded after it, as locals end with the
+   * shader. Inside loops, this only holds if there is no such load after the beginning of
+   * the outermost loop, as the next iteration would read it
+   */
+
+  class SDeadStoreEliminator {
+    static bool enabled;
+
+    static std::unordered_set<int> dead_stores; // By event number
+
+    static int num_eliminated;
+
+    // A store to or load from a local or output, as the ids of the variable and the indices
+    struct SAccess {
+      std::vector<int> path;
+      std::vector<bool> constant; // Whether each index is constant
+      bool is_local;
+    };
+
+    SDeadStoreEliminator() = delete;
+
+    // Returns false if the pointer is not into a local or output
+    static bool get_access(const SPointerBase* pointer, SAccess& access);
+
+    static bool may_alias(const SAccess& a, const SAccess& b);
+
+    // Whether a store to a writes all of b
+    static bool covers(const SAccess& a, const SAccess& b);
+
+    // Finds the dead stores among the events in SEventRegistry. To be called before
+    // SDeadCodeEliminator, which does not count them as roots
+    static void analyze();
+
+    static bool isDead(int event_num);
+
+    static void clear();
+
+    friend class SDeadCodeEliminator;
+    friend class SPassManager;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Dead store elimination is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of stores left out of the last compiled shader
+    static int getNumEliminated();
+  };
+
+};
+
+#endif // __SPURV_DEAD_STORE_ELIMINATION
@@ -84,6 +84,49 @@ namespace spurv {
     CONTROL_FOR
   };
 
+  // Hints for the driver on whether to branch or execute both sides, as in SPIR-V
+  enum SSelectionControl {
+    SELECTION_CONTROL_NONE = 0,
+    SELECTION_CONTROL_FLATTEN = 1,
+    SELECTION_CONTROL_DONT_FLATTEN = 2
+  };
+
+  // How a for-loop is unrolled, see SLoopUnroller
+  enum class SUnroll {
+    UNROLL_AUTO,
+    UNROLL_NONE,
+    UNROLL_FULL,
+    UNROLL_PARTIAL
+  };
+
+  // Hints for the driver on whether to inline a function, as in SPIR-V
+  enum SFunctionControl {
+    FUNCTION_CONTROL_NONE = 0,
+    FUNCTION_CONTROL_INLINE = 1,
+    FUNCTION_CONTROL_DONT_INLINE = 2
+  };
+
+  // Whether the calls to a function are recorded inline, see SFunctionInliner
+  enum class SInline {
+    INLINE_AUTO,
+    INLINE_ALWAYS,
+    INLINE_NEVER
+  };
+
+  // How freely floating point arithmetic may be rewritten, set per shader
+  enum class SPrecision {
+    PRECISION_STRICT,  // As written
+    PRECISION_CONTRACT // a * b + c may be fused into one operation, see SFmaContractor
+  };
+
+  // Presets of the optimization passes to run, see SPassManager
+  enum class SOptimizationLevel {
+    OPTIMIZATION_LEVEL_0,   // -O0: none, the shader is written as recorded
+    OPTIMIZATION_LEVEL_1,   // -O1: the passes that only remove work, and are cheap to run
+    OPTIMIZATION_LEVEL_2,   // -O2: all of them, the default
+    OPTIMIZATION_LEVEL_SIZE // -Os: as -O2, but without the passes that may grow the binary
+  };
+
   enum SExtension {
     EXTENSION_STORAGE_BUFFER = 0,
     EXTENSION_END
@@ -132,6 +175,7 @@ namespace spurv {
     GLSL_FMAX,
     GLSL_UMAX,
     GLSL_SMAX,
+    GLSL_FMA = 50,
     GLSL_CROSS = 68,
     GLSL_NORMALIZE,
     GLSL_REFLECT = 71,
@@ -230,6 +274,8 @@ namespace spurv {
 
   class SForLoop;
 
+  class SCloneMap;
+
   class SVariableRegistry;
 
   class SVariableEntryBase;
@@ -251,6 +297,11 @@ namespace spurv {
   template<typename tt, SStorageClass stind>
   class SLoadedVal;
 
+  class SFunctionBase;
+
+  template<typename Signature>
+  class SFunction;
+
 
   class SUtils;
 
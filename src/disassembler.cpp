@@ -0,0 +1,708 @@
+#include "disassembler.hpp"
+#include "instruction_set.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+
+namespace spurv {
+
+  namespace {
+    const uint32_t spirv_magic_number = 0x07230203;
+    const int header_size = 5;
+
+    // Text is handed to sinks whenever this much has been gathered
+    const size_t flush_size = 1 << 15;
+
+    // Ids above this don't get type information or names (only matters for absurd bounds)
+    const uint32_t max_tracked_ids = 1 << 22;
+
+    // The opcodes start in this column when indenting, like in the Khronos tools
+    const int opcode_column = 15;
+
+    enum NumberKind : uint8_t {
+      NUMBER_NONE,
+      NUMBER_UINT,
+      NUMBER_SINT,
+      NUMBER_FLOAT
+    };
+
+    struct IdInfo {
+      uint8_t number_kind; // Set for OpTypeInt and OpTypeFloat results
+      uint8_t width;
+      bool is_glsl_set; // Set for OpExtInstImport "GLSL.std.450"
+    };
+
+
+    /*
+     * Text formatting helpers, all appending to a string
+     */
+
+    void put(std::string& out, const char* str) {
+      out.append(str, strlen(str));
+    }
+
+    void put_uint(std::string& out, uint64_t value) {
+      char buffer[24];
+      char* end = buffer + sizeof(buffer);
+      char* p = end;
+      do {
+	*--p = '0' + (char)(value % 10);
+	value /= 10;
+      } while(value);
+      out.append(p, end - p);
+    }
+
+    void put_int(std::string& out, int64_t value) {
+      if(value < 0) {
+	out.push_back('-');
+	put_uint(out, (uint64_t)0 - (uint64_t)value);
+      } else {
+	put_uint(out, (uint64_t)value);
+      }
+    }
+
+    void put_hex(std::string& out, uint32_t value) {
+      static const char digits[] = "0123456789abcdef";
+      char buffer[10];
+      char* end = buffer + sizeof(buffer);
+      char* p = end;
+      do {
+	*--p = digits[value & 0xf];
+	value >>= 4;
+      } while(value);
+      *--p = 'x';
+      *--p = '0';
+      out.append(p, end - p);
+    }
+
+    // A literal word whose value can't be written in a nicer form, e.g. a NaN
+    void put_raw_word(std::string& out, uint32_t value) {
+      out.push_back('!');
+      put_hex(out, value);
+    }
+
+    void put_float(std::string& out, float value, uint32_t bits) {
+      if(!std::isfinite(value)) {
+	put_raw_word(out, bits);
+	return;
+      }
+
+      // Shortest of the two forms that reads back to the same value
+      char buffer[32];
+      int len = snprintf(buffer, sizeof(buffer), "%.7g", value);
+      if(strtof(buffer, nullptr) != value) {
+	len = snprintf(buffer, sizeof(buffer), "%.9g", value);
+      }
+      out.append(buffer, len);
+    }
+
+    void put_double(std::string& out, double value, uint32_t low, uint32_t high) {
+      if(!std::isfinite(value)) {
+	put_raw_word(out, low);
+	out.push_back(' ');
+	put_raw_word(out, high);
+	return;
+      }
+
+      char buffer[40];
+      int len = snprintf(buffer, sizeof(buffer), "%.15g", value);
+      if(strtod(buffer, nullptr) != value) {
+	len = snprintf(buffer, sizeof(buffer), "%.17g", value);
+      }
+      out.append(buffer, len);
+    }
+
+    void put_string(std::string& out, const uint32_t* words, int num_words) {
+      out.push_back('"');
+      for(int i = 0; i < num_words; i++) {
+	uint32_t w = words[i];
+	for(int b = 0; b < 4; b++) {
+	  char c = (char)((w >> (8 * b)) & 0xff);
+	  if(c == '\0') {
+	    out.push_back('"');
+	    return;
+	  }
+	  if(c == '"' || c == '\\') {
+	    out.push_back('\\');
+	  }
+	  out.push_back(c);
+	}
+      }
+      out.push_back('"');
+    }
+
+    void put_enum(std::string& out, SOperandKind kind, uint32_t value) {
+      const char* name = SInstructionSet::getEnumName(kind, value);
+      if(name) {
+	put(out, name);
+      } else {
+	put_uint(out, value);
+      }
+    }
+
+    void put_mask(std::string& out, SOperandKind kind, uint32_t mask) {
+      if(mask == 0) {
+	put(out, "None");
+	return;
+      }
+
+      bool first = true;
+      uint32_t unknown_bits = 0;
+      for(int b = 0; b < 32; b++) {
+	uint32_t bit = 1u << b;
+	if(!(mask & bit)) {
+	  continue;
+	}
+
+	const char* name = SInstructionSet::getEnumName(kind, bit);
+	if(!name) {
+	  unknown_bits |= bit;
+	  continue;
+	}
+
+	if(!first) {
+	  out.push_back('|');
+	}
+	put(out, name);
+	first = false;
+      }
+
+      if(unknown_bits) {
+	if(!first) {
+	  out.push_back('|');
+	}
+	put_hex(out, unknown_bits);
+      }
+    }
+
+    bool is_enum_kind(SOperandKind kind) {
+      return kind >= OPERAND_SOURCE_LANGUAGE && kind <= OPERAND_GROUP_OPERATION;
+    }
+
+    // Reads a literal string into a std::string, for the friendly names
+    std::string read_string(const uint32_t* words, int num_words) {
+      std::string res;
+      for(int i = 0; i < num_words; i++) {
+	for(int b = 0; b < 4; b++) {
+	  char c = (char)((words[i] >> (8 * b)) & 0xff);
+	  if(c == '\0') {
+	    return res;
+	  }
+	  res.push_back(c);
+	}
+      }
+      return res;
+    }
+
+
+    /*
+     * DisassemblyContext - State for one call to SDisassembler::disassemble
+     */
+
+    class DisassemblyContext {
+      const uint32_t* words;
+      size_t num_words;
+      int flags;
+
+      std::string& out;
+      SDisassemblerSink sink;
+      void* user_data;
+
+      std::vector<IdInfo> id_infos;
+      std::vector<std::string> names; // Only filled in with DISASSEMBLE_FRIENDLY_NAMES
+      std::vector<SDecodedOperand> decoded;
+
+      void flush_if_full();
+      void put_id(uint32_t id);
+      void put_constant(uint32_t type_id, const uint32_t* operands, int num_operands);
+      void error(size_t position, const char* message);
+
+      void assign_friendly_names();
+      void assign_name(uint32_t id, const std::string& name);
+      std::string type_name(uint32_t id) const;
+
+    public:
+      DisassemblyContext(const uint32_t* words, size_t num_words, int flags, std::string& out,
+			 SDisassemblerSink sink, void* user_data);
+
+      bool run();
+      void flush();
+    };
+
+    DisassemblyContext::DisassemblyContext(const uint32_t* words, size_t num_words, int flags,
+					   std::string& out, SDisassemblerSink sink, void* user_data)
+      : words(words), num_words(num_words), flags(flags), out(out), sink(sink), user_data(user_data) { }
+
+    void DisassemblyContext::flush() {
+      if(this->sink && this->out.size() > 0) {
+	this->sink(this->out.data(), this->out.size(), this->user_data);
+	this->out.clear();
+      }
+    }
+
+    void DisassemblyContext::flush_if_full() {
+      if(this->sink && this->out.size() >= flush_size) {
+	this->flush();
+      }
+    }
+
+    void DisassemblyContext::put_id(uint32_t id) {
+      this->out.push_back('%');
+      if(id < this->names.size() && this->names[id].size() > 0) {
+	this->out.append(this->names[id]);
+      } else {
+	put_uint(this->out, id);
+      }
+    }
+
+    void DisassemblyContext::error(size_t position, const char* message) {
+      put(this->out, "; Error at word ");
+      put_uint(this->out, position);
+      put(this->out, ": ");
+      put(this->out, message);
+      this->out.push_back('\n');
+    }
+
+    // OpConstant and OpSpecConstant literals are written according to their type
+    void DisassemblyContext::put_constant(uint32_t type_id, const uint32_t* operands, int num_operands) {
+      IdInfo info = {NUMBER_NONE, 0, false};
+      if(type_id < this->id_infos.size()) {
+	info = this->id_infos[type_id];
+      }
+
+      int expected_words = info.width > 32 ? 2 : 1;
+      if(info.number_kind == NUMBER_NONE || num_operands != expected_words) {
+	for(int i = 0; i < num_operands; i++) {
+	  this->out.push_back(' ');
+	  put_uint(this->out, operands[i]);
+	}
+	return;
+      }
+
+      this->out.push_back(' ');
+      uint32_t low = operands[0];
+
+      if(info.number_kind == NUMBER_FLOAT) {
+	if(info.width == 32) {
+	  float f;
+	  memcpy(&f, &low, sizeof(f));
+	  put_float(this->out, f, low);
+	} else if(info.width == 64) {
+	  uint64_t bits = ((uint64_t)operands[1] << 32) | low;
+	  double d;
+	  memcpy(&d, &bits, sizeof(d));
+	  put_double(this->out, d, low, operands[1]);
+	} else {
+	  // Half floats are rare enough that they are written as their bits
+	  put_raw_word(this->out, low);
+	}
+	return;
+      }
+
+      if(info.width == 64) {
+	uint64_t bits = ((uint64_t)operands[1] << 32) | low;
+	if(info.number_kind == NUMBER_SINT) {
+	  put_int(this->out, (int64_t)bits);
+	} else {
+	  put_uint(this->out, bits);
+	}
+	return;
+      }
+
+      if(info.number_kind == NUMBER_SINT) {
+	// Narrower signed types are sign extended to the full word
+	int shift = 32 - info.width;
+	put_int(this->out, (int32_t)(low << shift) >> shift);
+      } else {
+	put_uint(this->out, low);
+      }
+    }
+
+    void DisassemblyContext::assign_name(uint32_t id, const std::string& name) {
+      if(id >= this->names.size() || name.size() == 0 || this->names[id].size() > 0) {
+	return;
+      }
+
+      std::string sanitized;
+      sanitized.reserve(name.size() + 1);
+      // Names must not be mistaken for plain numeric ids
+      if(name[0] >= '0' && name[0] <= '9') {
+	sanitized.push_back('_');
+      }
+      for(char c : name) {
+	bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	sanitized.push_back(ok ? c : '_');
+      }
+
+      this->names[id] = sanitized;
+    }
+
+    std::string DisassemblyContext::type_name(uint32_t id) const {
+      if(id < this->names.size() && this->names[id].size() > 0) {
+	return this->names[id];
+      }
+      return std::to_string(id);
+    }
+
+    // Names types after their structure and scalar constants after their value,
+    // OpName'd ids after their name. Clashing names get a numbered suffix
+    void DisassemblyContext::assign_friendly_names() {
+      this->names.resize(this->id_infos.size());
+
+      std::vector<std::pair<uint32_t, std::string>> debug_names;
+
+      size_t position = header_size;
+      while(position < this->num_words) {
+	uint32_t first = this->words[position];
+	uint32_t opcode = first & 0xffff;
+	uint32_t count = first >> 16;
+	if(count == 0 || position + count > this->num_words || opcode == 54) { // Stop at OpFunction
+	  break;
+	}
+
+	const uint32_t* w = this->words + position;
+	position += count;
+
+	if(count < 2) {
+	  continue;
+	}
+
+	uint32_t id = w[1];
+	std::string name;
+
+	switch(opcode) {
+	case 5: // OpName <target> <name>
+	  if(count >= 3) {
+	    debug_names.push_back({id, read_string(w + 2, count - 2)});
+	  }
+	  continue;
+	case 19: // OpTypeVoid
+	  name = "void";
+	  break;
+	case 20: // OpTypeBool
+	  name = "bool";
+	  break;
+	case 21: // OpTypeInt <result> <width> <signedness>
+	  if(count >= 4) {
+	    name = w[3] ? "int" : "uint";
+	    if(w[2] != 32) {
+	      name += std::to_string(w[2]);
+	    }
+	  }
+	  break;
+	case 22: // OpTypeFloat <result> <width>
+	  if(count >= 3) {
+	    name = w[2] == 16 ? "half" : w[2] == 64 ? "double" : "float";
+	  }
+	  break;
+	case 23: // OpTypeVector <result> <component_type> <count>
+	  if(count >= 4) {
+	    name = "v" + std::to_string(w[3]) + this->type_name(w[2]);
+	  }
+	  break;
+	case 24: // OpTypeMatrix <result> <column_type> <count>
+	  if(count >= 4) {
+	    name = "mat" + std::to_string(w[3]) + this->type_name(w[2]);
+	  }
+	  break;
+	case 26: // OpTypeSampler
+	  name = "sampler";
+	  break;
+	case 27: // OpTypeSampledImage <result> <image_type>
+	  if(count >= 3) {
+	    name = "sampled_" + this->type_name(w[2]);
+	  }
+	  break;
+	case 25: // OpTypeImage
+	  name = "image";
+	  break;
+	case 28: // OpTypeArray <result> <element_type> <length>
+	  if(count >= 4) {
+	    name = "_arr_" + this->type_name(w[2]) + "_" + this->type_name(w[3]);
+	  }
+	  break;
+	case 29: // OpTypeRuntimeArray <result> <element_type>
+	  if(count >= 3) {
+	    name = "_runtimearr_" + this->type_name(w[2]);
+	  }
+	  break;
+	case 30: // OpTypeStruct
+	  name = "_struct_" + std::to_string(id);
+	  break;
+	case 32: // OpTypePointer <result> <storage_class> <type>
+	  if(count >= 4) {
+	    const char* storage = SInstructionSet::getEnumName(OPERAND_STORAGE_CLASS, w[2]);
+	    name = std::string("_ptr_") + (storage ? storage : std::to_string(w[2]).c_str()) +
+	      "_" + this->type_name(w[3]);
+	  }
+	  break;
+	case 41: // OpConstantTrue <result_type> <result>
+	  id = count >= 3 ? w[2] : 0;
+	  name = "true";
+	  break;
+	case 42: // OpConstantFalse <result_type> <result>
+	  id = count >= 3 ? w[2] : 0;
+	  name = "false";
+	  break;
+	case 43: // OpConstant <result_type> <result> <value>
+	  if(count >= 4 && w[1] < this->id_infos.size() &&
+	     this->id_infos[w[1]].number_kind != NUMBER_NONE) {
+	    std::string value;
+	    this->out.swap(value);
+	    this->put_constant(w[1], w + 3, count - 3);
+	    this->out.swap(value);
+
+	    // " -0.5" becomes "n0_5"
+	    name = this->type_name(w[1]) + "_";
+	    for(size_t i = 1; i < value.size(); i++) {
+	      char c = value[i];
+	      name.push_back(c == '-' ? 'n' : (c == '.' || c == '+' || c == '!') ? '_' : c);
+	    }
+	    id = w[2];
+	  }
+	  break;
+	default:
+	  break;
+	}
+
+	// Types are named right away, since later type names are built from them
+	if(name.size() > 0 && id < this->names.size()) {
+	  this->names[id] = name;
+	}
+
+	// Record the scalar types for put_constant
+	if(opcode == 21 && count >= 4 && id < this->id_infos.size()) {
+	  this->id_infos[id] = {(uint8_t)(w[3] ? NUMBER_SINT : NUMBER_UINT), (uint8_t)w[2], false};
+	} else if(opcode == 22 && count >= 3 && id < this->id_infos.size()) {
+	  this->id_infos[id] = {NUMBER_FLOAT, (uint8_t)w[2], false};
+	}
+      }
+
+      // OpName takes precedence over derived names
+      for(std::pair<uint32_t, std::string>& debug_name : debug_names) {
+	if(debug_name.first < this->names.size()) {
+	  this->names[debug_name.first].clear();
+	  this->assign_name(debug_name.first, debug_name.second);
+	}
+      }
+
+      // Make the names unique
+      std::vector<std::pair<std::string, uint32_t>> sorted;
+      for(uint32_t i = 0; i < this->names.size(); i++) {
+	if(this->names[i].size() > 0) {
+	  sorted.push_back({this->names[i], i});
+	}
+      }
+      std::sort(sorted.begin(), sorted.end());
+
+      std::vector<std::string> taken;
+      for(std::pair<std::string, uint32_t>& p : sorted) {
+	taken.push_back(p.first);
+      }
+
+      for(size_t i = 1; i < sorted.size(); i++) {
+	if(sorted[i].first != sorted[i - 1].first) {
+	  continue;
+	}
+
+	for(int suffix = 0; ; suffix++) {
+	  std::string candidate = sorted[i].first + "_" + std::to_string(suffix);
+	  if(!std::binary_search(taken.begin(), taken.end(), candidate)) {
+	    this->names[sorted[i].second] = candidate;
+	    taken.insert(std::lower_bound(taken.begin(), taken.end(), candidate), candidate);
+	    break;
+	  }
+	}
+      }
+    }
+
+    bool DisassemblyContext::run() {
+      if(this->num_words < header_size || this->words[0] != spirv_magic_number) {
+	this->error(0, "Binary does not start with a valid SPIR-V header");
+	return false;
+      }
+
+      uint32_t version = this->words[1];
+      uint32_t bound = this->words[3];
+
+      this->id_infos.assign(std::min(bound, max_tracked_ids), {NUMBER_NONE, 0, false});
+
+      if(!(this->flags & DISASSEMBLE_NO_HEADER)) {
+	put(this->out, "; SPIR-V\n; Version: ");
+	put_uint(this->out, (version >> 16) & 0xff);
+	this->out.push_back('.');
+	put_uint(this->out, (version >> 8) & 0xff);
+	put(this->out, "\n; Generator: ");
+	put_hex(this->out, this->words[2]);
+	put(this->out, "\n; Bound: ");
+	put_uint(this->out, bound);
+	put(this->out, "\n; Schema: ");
+	put_uint(this->out, this->words[4]);
+	this->out.push_back('\n');
+      }
+
+      if(this->flags & DISASSEMBLE_FRIENDLY_NAMES) {
+	this->assign_friendly_names();
+      }
+
+      bool indent = !(this->flags & DISASSEMBLE_NO_INDENT);
+
+      size_t position = header_size;
+      while(position < this->num_words) {
+	uint32_t first = this->words[position];
+	uint32_t opcode = first & 0xffff;
+	uint32_t count = first >> 16;
+
+	if(count == 0 || position + count > this->num_words) {
+	  this->error(position, "Invalid word count");
+	  return false;
+	}
+
+	const uint32_t* w = this->words + position;
+	const SInstructionInfo* info = SInstructionSet::getInfo(opcode);
+	int fixed_words = info ? 1 + info->has_type + info->has_result : 1;
+
+	if(!info || (int)count < fixed_words) {
+	  put(this->out, "; Unknown instruction:");
+	  for(uint32_t i = 0; i < count; i++) {
+	    this->out.push_back(' ');
+	    put_uint(this->out, w[i]);
+	  }
+	  this->out.push_back('\n');
+	  position += count;
+	  continue;
+	}
+
+	uint32_t type_id = info->has_type ? w[1] : 0;
+	uint32_t result_id = info->has_result ? w[fixed_words - 1] : 0;
+	const uint32_t* operands = w + fixed_words;
+	int num_operands = count - fixed_words;
+
+	// "%12 = " is aligned so that all opcodes start in the same column
+	if(info->has_result) {
+	  size_t start = this->out.size();
+	  this->put_id(result_id);
+	  int length = (int)(this->out.size() - start);
+	  if(indent && length + 3 < opcode_column) {
+	    this->out.insert(start, opcode_column - 3 - length, ' ');
+	  }
+	  put(this->out, " = ");
+	} else if(indent) {
+	  this->out.append(opcode_column, ' ');
+	}
+
+	put(this->out, info->name);
+
+	if(info->has_type) {
+	  this->out.push_back(' ');
+	  this->put_id(type_id);
+	}
+
+	this->decoded.clear();
+	if(!SInstructionSet::decodeOperands(opcode, operands, num_operands, this->decoded)) {
+	  // Keep the words so that the text still assembles to the same binary
+	  for(int i = 0; i < num_operands; i++) {
+	    this->out.push_back(' ');
+	    put_raw_word(this->out, operands[i]);
+	  }
+	  put(this->out, " ; Operands don't match the grammar\n");
+	  position += count;
+	  continue;
+	}
+
+	if(opcode == 43 || opcode == 50) { // OpConstant, OpSpecConstant
+	  this->put_constant(type_id, operands, num_operands);
+	} else {
+	  for(const SDecodedOperand& operand : this->decoded) {
+	    this->out.push_back(' ');
+	    uint32_t value = operands[operand.offset];
+
+	    switch(operand.kind) {
+	    case OPERAND_ID:
+	      this->put_id(value);
+	      break;
+	    case OPERAND_STRING:
+	      put_string(this->out, operands + operand.offset, operand.num_words);
+	      break;
+	    case OPERAND_LITERAL:
+	      // OpExtInst <result_type> <result_id> <set> <instruction> <operands>...
+	      if(opcode == 12 && operand.offset == 1 && operands[0] < this->id_infos.size() &&
+		 this->id_infos[operands[0]].is_glsl_set &&
+		 SInstructionSet::getGLSLInstructionName(value)) {
+		put(this->out, SInstructionSet::getGLSLInstructionName(value));
+	      } else {
+		put_uint(this->out, value);
+	      }
+	      break;
+	    default:
+	      if(SInstructionSet::isMaskKind(operand.kind)) {
+		put_mask(this->out, operand.kind, value);
+	      } else if(is_enum_kind(operand.kind)) {
+		put_enum(this->out, operand.kind, value);
+	      } else {
+		put_uint(this->out, value);
+	      }
+	    }
+	  }
+	}
+	this->out.push_back('\n');
+
+	// Keep track of what later instructions need to be printed nicely
+	if(result_id < this->id_infos.size()) {
+	  if(opcode == 21 && num_operands >= 2) { // OpTypeInt
+	    this->id_infos[result_id] = {(uint8_t)(operands[1] ? NUMBER_SINT : NUMBER_UINT),
+					 (uint8_t)operands[0], false};
+	  } else if(opcode == 22 && num_operands >= 1) { // OpTypeFloat
+	    this->id_infos[result_id] = {NUMBER_FLOAT, (uint8_t)operands[0], false};
+	  } else if(opcode == 11 && num_operands >= 1) { // OpExtInstImport
+	    this->id_infos[result_id].is_glsl_set =
+	      read_string(operands, num_operands) == "GLSL.std.450";
+	  }
+	}
+
+	position += count;
+	this->flush_if_full();
+      }
+
+      return true;
+    }
+  };
+
+
+  /*
+   * SDisassembler member functions
+   */
+
+  bool SDisassembler::disassemble(const uint32_t* words, size_t num_words, std::string& out, int flags) {
+    // Roughly what the text ends up as, to avoid most reallocations
+    out.reserve(out.size() + num_words * 7);
+
+    DisassemblyContext context(words, num_words, flags, out, nullptr, nullptr);
+    return context.run();
+  }
+
+  bool SDisassembler::disassemble(const std::vector<uint32_t>& binary, std::string& out, int flags) {
+    return SDisassembler::disassemble(binary.data(), binary.size(), out, flags);
+  }
+
+  bool SDisassembler::disassemble(const uint32_t* words, size_t num_words, FILE* out, int flags) {
+    SDisassemblerSink sink = [](const char* data, size_t size, void* user_data) {
+      fwrite(data, 1, size, (FILE*)user_data);
+    };
+    return SDisassembler::disassemble(words, num_words, sink, out, flags);
+  }
+
+  bool SDisassembler::disassemble(const uint32_t* words, size_t num_words, SDisassemblerSink sink,
+				  void* user_data, int flags) {
+    std::string buffer;
+    buffer.reserve(flush_size + 4096);
+
+    DisassemblyContext context(words, num_words, flags, buffer, sink, user_data);
+    bool res = context.run();
+    context.flush();
+    return res;
+  }
+
+};
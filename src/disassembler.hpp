@@ -0,0 +1,62 @@
+#ifndef __SPURV_DISASSEMBLER
+#define __SPURV_DISASSEMBLER
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+
+namespace spurv {
+
+  /*
+   * SDisassemblerFlags - Options for SDisassembler, may be or'ed together
+   */
+
+  enum SDisassemblerFlags {
+    DISASSEMBLE_DEFAULT = 0,
+    DISASSEMBLE_FRIENDLY_NAMES = 1, // %float, %v4float, %_ptr_Input_float, %float_0_5 and OpName'd names instead of %12
+    DISASSEMBLE_NO_HEADER = 2, // Skip the "; Version: ..." comment lines
+    DISASSEMBLE_NO_INDENT = 4 // Don't align the opcodes in one column
+  };
+
+
+  /*
+   * SDisassemblerSink - Receives the text as it is produced, in chunks of a few tens of kilobytes
+   */
+
+  typedef void (*SDisassemblerSink)(const char* data, size_t size, void* user_data);
+
+
+  /*
+   * SDisassembler - Turns SPIR-V binaries into text in the format used by the Khronos tools
+   * (opcode and enumerant names, %id operands, quoted strings and typed constants).
+   * Runs in a single pass over the binary (two with friendly names), so it is cheap
+   * enough to dump every failing shader. SAssembler reads the same format back
+   */
+
+  class SDisassembler {
+  public:
+    SDisassembler() = delete;
+
+    // These all return false if the binary is malformed. Everything up to the
+    // problem is still written, followed by a comment describing it
+
+    // Appends the text to out
+    static bool disassemble(const uint32_t* words, size_t num_words, std::string& out,
+			    int flags = DISASSEMBLE_DEFAULT);
+    static bool disassemble(const std::vector<uint32_t>& binary, std::string& out,
+			    int flags = DISASSEMBLE_DEFAULT);
+
+    // Writes the text to a file, e.g. stdout or a log
+    static bool disassemble(const uint32_t* words, size_t num_words, FILE* out,
+			    int flags = DISASSEMBLE_DEFAULT);
+
+    // Hands the text to a user supplied sink
+    static bool disassemble(const uint32_t* words, size_t num_words, SDisassemblerSink sink,
+			    void* user_data, int flags = DISASSEMBLE_DEFAULT);
+  };
+
+};
+
+#endif // __SPURV_DISASSEMBLER
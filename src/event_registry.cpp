@@ -1,7 +1,11 @@
 #include "event_registry.hpp"
+#include "pointers.hpp"
+#include "loop_unrolling_impl.hpp"
 
 #include "utils_impl.hpp"
 
+#include <algorithm>
+
 namespace spurv {
 
   /*
@@ -53,6 +57,20 @@ namespace spurv {
     this->ifthen->write_begin(bin);
   }
 
+  void SIfEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_IF;
+    info.values.assign(1, this->ifthen->cond);
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SIfEvent::replay(SCloneMap& map) {
+    SIfThen* ifthen = SUtils::allocate<SIfThen>(map.value(this->ifthen->cond), this->ifthen->control);
+    map.setBlock(this->ifthen, ifthen);
+
+    SEventRegistry::addIf(ifthen);
+  }
+
 
   /*
    * SElseEvent member functions
@@ -69,6 +87,20 @@ namespace spurv {
     this->ifthen->write_else(bin);
   }
 
+  void SElseEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_ELSE;
+    info.values.clear();
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SElseEvent::replay(SCloneMap& map) {
+    SIfThen* ifthen = map.block(this->ifthen);
+    ifthen->add_else();
+
+    SEventRegistry::addElse(ifthen);
+  }
+
   
   /*
    * SEndIfEvent member functions
@@ -84,6 +116,17 @@ namespace spurv {
   void SEndIfEvent::write_binary(std::vector<uint32_t>& bin) {
     this->ifthen->write_end(bin);
   }
+
+  void SEndIfEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_END_IF;
+    info.values.clear();
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SEndIfEvent::replay(SCloneMap& map) {
+    SEventRegistry::addEndIf(map.block(this->ifthen));
+  }
   
   
   /*
@@ -95,6 +138,9 @@ namespace spurv {
   }
 
   void SForBeginEvent::write_binary(std::vector<uint32_t>& bin) {
+    // Loop-invariant values are computed before the loop, see SInvariantHoister
+    SInvariantHoister::write_hoisted(bin, this->event_num);
+
     loop->write_start(bin);
   }
 
@@ -103,6 +149,24 @@ namespace spurv {
     this->loop->write_type_definitions(bin, declaration_states);
   }
 
+  void SForBeginEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_FOR_BEGIN;
+    info.values.assign(1, this->loop->iterator_val);
+    info.pointer = this->loop->iterator_pointer;
+    info.iterations = (this->loop->end - this->loop->start) / this->loop->step;
+  }
+
+  void SForBeginEvent::replay(SCloneMap& map) {
+    // Nested loops have already been unrolled, if they were to be
+    SForLoop* loop = SUtils::allocate<SForLoop>(this->loop->start, this->loop->end);
+    loop->set_step(this->loop->step);
+    loop->control = this->loop->control;
+    map.setValue(this->loop->iterator_val, loop->iterator_val);
+    map.setBlock(this->loop, loop);
+
+    SEventRegistry::addForBegin(loop);
+  }
+
 
   /*
    * SForEndEvent member functions
@@ -116,6 +180,17 @@ namespace spurv {
     loop->write_end(bin);
   }
 
+  void SForEndEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_FOR_END;
+    info.values.clear();
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SForEndEvent::replay(SCloneMap& map) {
+    SEventRegistry::addForEnd(map.block(this->loop));
+  }
+
 
   /*
    * SBreakFor member functions
@@ -129,6 +204,17 @@ namespace spurv {
     loop->write_break(bin);
   }
 
+  void SBreakEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_BREAK;
+    info.values.clear();
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SBreakEvent::replay(SCloneMap& map) {
+    SEventRegistry::addBreak(map.block(this->loop));
+  }
+
 
   /*
    * SContinueFor member functions
@@ -142,6 +228,17 @@ namespace spurv {
     loop->write_continue(bin);
   }
 
+  void SContinueEvent::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_CONTINUE;
+    info.values.clear();
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  void SContinueEvent::replay(SCloneMap& map) {
+    SEventRegistry::addContinue(map.block(this->loop));
+  }
+
   
   /*
    * SEventRegistry member functions
@@ -150,26 +247,37 @@ namespace spurv {
   void SEventRegistry::addIf(SIfThen* ifthen) {
     SIfEvent* ie = new SIfEvent(SEventRegistry::events.size(), ifthen);
     SEventRegistry::events.push_back(ie);
+
+    SNodeCache::enterScope();
   }
 
   void SEventRegistry::addElse(SIfThen* ifthen) {
     SElseEvent* ee = new SElseEvent(SEventRegistry::events.size(), ifthen);
     SEventRegistry::events.push_back(ee);
+
+    SNodeCache::exitScope();
+    SNodeCache::enterScope();
   }
 
   void SEventRegistry::addEndIf(SIfThen* ifthen) {
     SEndIfEvent* ee = new SEndIfEvent(SEventRegistry::events.size(), ifthen);
     SEventRegistry::events.push_back(ee);
+
+    SNodeCache::exitScope();
   }
   
   void SEventRegistry::addForBegin(SForLoop* loop) {
     SForBeginEvent* fb = new SForBeginEvent(SEventRegistry::events.size(), loop);
     SEventRegistry::events.push_back(fb);
+
+    SNodeCache::enterScope();
   }
 
   void SEventRegistry::addForEnd(SForLoop* loop) {
     SForEndEvent* fb = new SForEndEvent(SEventRegistry::events.size(), loop);
     SEventRegistry::events.push_back(fb);
+
+    SNodeCache::exitScope();
   }
 
   void SEventRegistry::addBreak(SForLoop* loop) {
@@ -185,20 +293,47 @@ namespace spurv {
 
   void SEventRegistry::write_type_definitions(std::vector<uint32_t>& bin,
 					      std::vector<SDeclarationState*>& declaration_states) {
-    for(STimeEventBase *eb : SEventRegistry::events) {
-      eb->ensure_type_defined(bin, declaration_states);
+    for(unsigned int i = 0; i < SEventRegistry::events.size(); i++) {
+      if(SDeadCodeEliminator::isEventLive(i)) {
+	SEventRegistry::events[i]->ensure_type_defined(bin, declaration_states);
+      }
     }
   }
   
   void SEventRegistry::write_events(std::vector<uint32_t>& bin) {
 
     // This function traverses the event list and outputs them (together
-    // with their dependencies) in order
+    // with their dependencies) in order, leaving out dead values. Values
+    // sunk into conditional blocks are written before the event they are
+    // sunk to instead (see SCodeSinker)
+
+    for(unsigned int i = 0; i < SEventRegistry::events.size(); i++) {
+      if(SDeadCodeEliminator::isEventLive(i)) {
+	SCodeSinker::write_sunk(bin, i);
+
+	if(!SCodeSinker::isSunk(i)) {
+	  SEventRegistry::events[i]->ensure_written(bin);
+	}
+      }
+    }
+
+  }
 
-    for(STimeEventBase *eb : SEventRegistry::events) {
-      eb->ensure_written(bin);
+  void SEventRegistry::defer_declaration(const SValueBase* value) {
+    SEventInfo info;
+    for(int i = SEventRegistry::events.size() - 1; i >= 0; i--) {
+      SEventRegistry::events[i]->getEventInfo(info);
+      if(info.kind != EVENT_DECLARATION || info.values[0] != value) {
+	continue;
+      }
+
+      std::rotate(SEventRegistry::events.begin() + i, SEventRegistry::events.begin() + i + 1,
+		  SEventRegistry::events.end());
+      for(unsigned int j = i; j < SEventRegistry::events.size(); j++) {
+	SEventRegistry::events[j]->event_num = j;
+      }
+      return;
     }
-    
   }
 
   void SEventRegistry::clear() {
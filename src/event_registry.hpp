@@ -4,15 +4,61 @@
 #include "declarations.hpp"
 #include "values.hpp"
 #include "control_flow.hpp"
+#include "node_cache.hpp"
+#include "dead_code_elimination.hpp"
+#include "loop_unrolling.hpp"
+#include "local_promotion.hpp"
+#include "store_forwarding.hpp"
+#include "invariant_hoisting.hpp"
+#include "code_sinking.hpp"
 
 namespace spurv {
 
 
+  /*
+   * SEventKind - The different kinds of events, as reported by STimeEventBase::getEventInfo
+   */
+
+  enum SEventKind {
+    EVENT_DECLARATION,
+    EVENT_LOAD,
+    EVENT_STORE,
+    EVENT_IMAGE_STORE,
+    EVENT_IF,
+    EVENT_ELSE,
+    EVENT_END_IF,
+    EVENT_FOR_BEGIN,
+    EVENT_FOR_END,
+    EVENT_BREAK,
+    EVENT_CONTINUE,
+    EVENT_RETURN
+  };
+
+  
+  /*
+   * SEventInfo - Type-independent description of an event
+   */
+
+  struct SEventInfo {
+    SEventKind kind;
+
+    // The declared, loaded, stored or returned value, the condition of an if-statement,
+    // or the image, coordinate and value of an image store
+    std::vector<const SValueBase*> values;
+    
+    const SPointerBase* pointer; // Pointer stored to, for stores and the iterator of loops
+    int iterations; // Number of iterations, for loops
+  };
+
+  
   /*
    * STimeEventBase - Base class for events like loads and stores
    */
   
   class STimeEventBase {
+  public:
+    virtual void getEventInfo(SEventInfo& info) const = 0;
+    
   protected:
     
     int event_num;
@@ -24,9 +70,15 @@ namespace spurv {
     virtual void write_binary(std::vector<uint32_t>& bin) = 0;
     virtual bool stores_to_pointer(int n);
 
+    // Records this event again, on the copies in map, see SLoopUnroller
+    virtual void replay(SCloneMap& map) = 0;
+
     STimeEventBase(int event_num);
 
     friend class SEventRegistry;
+    friend class SLoopUnroller;
+    friend class SInvariantHoister;
+    friend class SCodeSinker;
 
     template<typename tt>
     friend class SLocal;
@@ -46,6 +98,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SEventRegistry;
   };
@@ -63,6 +117,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     SLoadEvent(int event_num, int pointer_id);
 
@@ -90,6 +146,8 @@ namespace spurv {
 				     std::vector<SDeclarationState*>& declaration_states);
 
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
     virtual bool stores_to_pointer(int n);
     
     SStoreEvent(int event_num, SPointerTypeBase<tt>* pointer);
@@ -118,6 +176,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     SImageStoreEvent(int event_num, SValue<im_type>& image,
 		     SValue<typename lookup_index<im_type>::type>& coord,
@@ -127,6 +187,26 @@ namespace spurv {
   };
   
 
+  /*
+   * SReturnEvent - Represents the return of a value from a function body, see SFunction
+   */
+
+  template<typename tt>
+  class SReturnEvent : public STimeEventBase {
+    SValue<tt>* value;
+
+    SReturnEvent(int event_num, SValue<tt>* value);
+
+    virtual void ensure_type_defined(std::vector<uint32_t>& bin,
+				     std::vector<SDeclarationState*>& declaration_states);
+    virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
+
+    friend class SEventRegistry;
+  };
+
+
   /*
    * SIfEvent - represents the beginning of an if-statement
    */
@@ -139,6 +219,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SEventRegistry;
     
@@ -159,6 +241,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SEventRegistry;
     
@@ -178,6 +262,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SEventRegistry;
 
@@ -198,6 +284,8 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& bin,
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SUtils;
 
@@ -215,6 +303,8 @@ namespace spurv {
     SForEndEvent(int evnum, SForLoop* loop);
 
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SUtils;
 
@@ -232,6 +322,8 @@ namespace spurv {
     SBreakEvent(int evnum, SForLoop* loop);
 
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SUtils;
     friend class SEventRegistry;
@@ -247,6 +339,8 @@ namespace spurv {
     SContinueEvent(int evnum, SForLoop* loop);
 
     virtual void write_binary(std::vector<uint32_t>& bin);
+    virtual void getEventInfo(SEventInfo& info) const;
+    virtual void replay(SCloneMap& map);
 
     friend class SUtils;
     friend class SEventRegistry;
@@ -275,6 +369,13 @@ namespace spurv {
 
     template<typename tt>
     static void addDeclaration(SValue<tt>* pointer);
+
+    template<typename tt>
+    static void addReturn(SValue<tt>* value);
+
+    // Moves the declaration of value after the events recorded since, for values whose
+    // operands are created while they are constructed
+    static void defer_declaration(const SValueBase* value);
     
     static void addIf(SIfThen* ifthen);
     static void addElse(SIfThen* ifthen);
@@ -311,6 +412,39 @@ namespace spurv {
 
     template<typename tt>
     friend class SValue;
+
+    template<int n, int m, typename inner>
+    friend class ConstructMatrix;
+
+    friend class SGraphExporter;
+    friend class SDeadCodeEliminator;
+    friend class SDeadStoreEliminator;
+    friend class SPassManager;
+    friend class SLoopUnroller;
+    friend class SLocalPromoter;
+    friend class SFmaContractor;
+    friend class SStoreForwarder;
+    friend class SInvariantHoister;
+    friend class SCodeSinker;
+    friend class SFunctionBase;
+
+    template<typename Signature>
+    friend class SFunction;
+
+    // For replaying
+    template<typename tt>
+    friend class SDeclarationEvent;
+
+    template<typename tt>
+    friend class SReturnEvent;
+
+    friend class SIfEvent;
+    friend class SElseEvent;
+    friend class SEndIfEvent;
+    friend class SForBeginEvent;
+    friend class SForEndEvent;
+    friend class SBreakEvent;
+    friend class SContinueEvent;
   };
 
 };
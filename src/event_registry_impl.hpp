@@ -2,6 +2,7 @@
 #define __SPURV_EVENT_REGISTRY_IMPL
 
 #include "event_registry.hpp"
+#include "loop_unrolling_impl.hpp"
 
 namespace spurv {
 
@@ -26,6 +27,29 @@ namespace spurv {
     this->value->ensure_defined(bin);
   }
 
+  template<typename tt>
+  void SDeclarationEvent<tt>::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_DECLARATION;
+    info.values.assign(1, this->value);
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  template<typename tt>
+  void SDeclarationEvent<tt>::replay(SCloneMap& map) {
+    // Loaded values are copied by their load event
+    if(map.hasValue(this->value)) {
+      return;
+    }
+
+    SValue<tt>* copy = this->value->clone(map);
+    if(copy == this->value && map.redeclare(copy)) {
+      SEventRegistry::addDeclaration(copy);
+    }
+
+    map.setValue(this->value, copy);
+  }
+
   
   /*
    * SLoadEvent member functions
@@ -47,6 +71,19 @@ namespace spurv {
     val_p->ensure_defined(bin);
   }
 
+  template<typename tt>
+  void SLoadEvent<tt>::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_LOAD;
+    info.values.assign(1, this->val_p);
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  template<typename tt>
+  void SLoadEvent<tt>::replay(SCloneMap& map) {
+    map.setValue(this->val_p, this->val_p->clone(map));
+  }
+
   
   /*
    * SStoreEvent member functions
@@ -68,6 +105,17 @@ namespace spurv {
 
   template<typename tt>
   void SStoreEvent<tt>::write_binary(std::vector<uint32_t>& bin) {
+    if(SLocalPromoter::isPromoted(this->pointer->getID())) {
+      this->val_p->ensure_defined(bin);
+      SLocalPromoter::store(this->pointer->getID(), this->val_p->getID());
+      return;
+    }
+
+    // Nothing loads the stored value, see SStoreForwarder
+    if(SStoreForwarder::isDropped(this->event_num)) {
+      return;
+    }
+
     this->pointer->ensure_defined(bin);
     this->val_p->ensure_defined(bin);
     
@@ -77,6 +125,19 @@ namespace spurv {
     SUtils::add(bin, this->val_p->getID());
   }
 
+  template<typename tt>
+  void SStoreEvent<tt>::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_STORE;
+    info.values.assign(1, this->val_p);
+    info.pointer = this->pointer;
+    info.iterations = 0;
+  }
+
+  template<typename tt>
+  void SStoreEvent<tt>::replay(SCloneMap& map) {
+    map.pointer(this->pointer)->store(*map.value(this->val_p));
+  }
+
   template<typename tt>
   bool SStoreEvent<tt>::stores_to_pointer(int id) {
     return this->pointer->getID() == id;
@@ -118,6 +179,57 @@ namespace spurv {
     SUtils::add(bin, this->value->getID());
   }
 
+  template<typename im_type>
+  void SImageStoreEvent<im_type>::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_IMAGE_STORE;
+    info.values = {this->image, this->coord, this->value};
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  template<typename im_type>
+  void SImageStoreEvent<im_type>::replay(SCloneMap& map) {
+    map.value(this->image)->store(*map.value(this->coord), *map.value(this->value));
+  }
+
+
+  /*
+   * SReturnEvent member functions
+   */
+
+  template<typename tt>
+  SReturnEvent<tt>::SReturnEvent(int event_num, SValue<tt>* value) : STimeEventBase(event_num) {
+    this->value = value;
+  }
+
+  template<typename tt>
+  void SReturnEvent<tt>::ensure_type_defined(std::vector<uint32_t>& bin,
+					     std::vector<SDeclarationState*>& declaration_states) {
+    this->value->ensure_type_defined(bin, declaration_states);
+  }
+
+  template<typename tt>
+  void SReturnEvent<tt>::write_binary(std::vector<uint32_t>& bin) {
+    this->value->ensure_defined(bin);
+
+    // OpReturnValue
+    SUtils::add(bin, (2 << 16) | 254);
+    SUtils::add(bin, this->value->getID());
+  }
+
+  template<typename tt>
+  void SReturnEvent<tt>::getEventInfo(SEventInfo& info) const {
+    info.kind = EVENT_RETURN;
+    info.values.assign(1, this->value);
+    info.pointer = nullptr;
+    info.iterations = 0;
+  }
+
+  template<typename tt>
+  void SReturnEvent<tt>::replay(SCloneMap& map) {
+    SEventRegistry::addReturn(map.value(this->value));
+  }
+
   
   /*
    * SEventRegistry member functions
@@ -139,6 +251,8 @@ namespace spurv {
 
     SEventRegistry::events.push_back(sl);
 
+    SNodeCache::noteMemoryWrite();
+
     return sl;
   }
 
@@ -149,6 +263,8 @@ namespace spurv {
     SImageStoreEvent<im_type>* sise = new SImageStoreEvent<im_type>(SEventRegistry::events.size(), image, ind, val);
 
     SEventRegistry::events.push_back(sise);
+
+    SNodeCache::noteMemoryWrite();
     return sise;
   }
 
@@ -157,6 +273,12 @@ namespace spurv {
     SDeclarationEvent<tt>* de = new SDeclarationEvent(SEventRegistry::events.size(), pointer);
     SEventRegistry::events.push_back(de);
   }
+
+  template<typename tt>
+  void SEventRegistry::addReturn(SValue<tt>* value) {
+    SReturnEvent<tt>* re = new SReturnEvent<tt>(SEventRegistry::events.size(), value);
+    SEventRegistry::events.push_back(re);
+  }
   
   template<typename tt>
   void SEventRegistry::ensure_predecessor_written(SLoadEvent<tt>* load,
@@ -3,6 +3,12 @@
 
 #include "declarations.hpp"
 #include "types.hpp"
+#include "node_cache_impl.hpp"
+#include "constant_folding_impl.hpp"
+#include "algebraic_simplification_impl.hpp"
+#include "loop_unrolling_impl.hpp"
+#include "strength_reduction.hpp"
+#include "fma_contraction.hpp"
 
 namespace spurv {
 
@@ -41,6 +47,50 @@ namespace spurv {
     str << this->getID() << std::endl;
   }
 
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  void SExpr<tt, op, tt2, tt3>::getNodeInfo(SNodeInfo& info) const {
+    SValue<tt>::getNodeInfo(info);
+    info.kind = NODE_EXPRESSION;
+    info.operation = op;
+    
+    if(this->v1) {
+      info.operands.push_back(this->v1);
+    }
+
+    if(this->v2) {
+      info.operands.push_back(this->v2);
+    }
+  }
+
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  SValue<tt>* SExpr<tt, op, tt2, tt3>::clone(SCloneMap& map) {
+    return &construct_expression<tt, op, tt2, tt3>(*map.value(this->v1), map.value(this->v2));
+  }
+
+  // Whether the expression is component-wise addition or multiplication of floats or float
+  // vectors, which SFmaContractor may fuse
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  constexpr bool is_fusable() {
+    if constexpr((op == EXPR_ADDITION || op == EXPR_MULTIPLICATION) &&
+		 std::is_same<tt, tt2>::value && std::is_same<tt, tt3>::value) {
+      if constexpr(tt::getKind() == STypeKind::KIND_MAT) {
+	return tt::getArg1() == 1 && is_spurv_float_type<typename tt::inner_type>::value;
+      } else {
+	return is_spurv_float_type<tt>::value;
+      }
+    }
+
+    return false;
+  }
+
+  // Whether the expression divides a 32-bit integer, which SStrengthReducer may reduce
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  constexpr bool is_integer_division() {
+    return (op == EXPR_DIVISION || op == EXPR_REM || op == EXPR_MOD) &&
+      (std::is_same<tt, int_s>::value || std::is_same<tt, uint_s>::value) &&
+      std::is_same<tt, tt2>::value && std::is_same<tt, tt3>::value;
+  }
+
 
   template<typename tt, SExprOp op, typename tt2, typename tt3>
   void SExpr<tt, op, tt2, tt3>::ensure_type_defined(std::vector<uint32_t>& res,
@@ -54,6 +104,14 @@ namespace spurv {
     }
 
     tt::ensure_defined(res, declaration_states);
+
+    if constexpr(is_integer_division<tt, op, tt2, tt3>()) {
+      typename InvMapSType<tt>::type divisor;
+      if(SConstantFolder::getConstant(*this->v2, divisor)) {
+	SStrengthReducer::defineConstants(op, tt::getArg1() == 1, (uint32_t)divisor,
+					  res, declaration_states);
+      }
+    }
   }
 
   template<typename tt, SExprOp op, typename tt2, typename tt3>
@@ -101,8 +159,49 @@ namespace spurv {
    * Output the expression to the binary
    */
 
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  void SExpr<tt, op, tt2, tt3>::define_fma(std::vector<uint32_t>& res, int fused_operand) {
+    SValue<tt>* product_value = fused_operand == 0 ? this->v1 : this->v2;
+    SValue<tt>* addend = fused_operand == 0 ? this->v2 : this->v1;
+
+    SExpr<tt, EXPR_MULTIPLICATION, tt, tt>* product =
+      dynamic_cast<SExpr<tt, EXPR_MULTIPLICATION, tt, tt>*>(product_value);
+    if(!product) {
+      printf("[spurv::SExpr::define_fma] Operand to fuse was not a product\n");
+      exit(-1);
+    }
+
+    product->v1->ensure_defined(res);
+    product->v2->ensure_defined(res);
+    addend->ensure_defined(res);
+
+    // OpExtInst <result_type> <result_id> <glsl_inst> Fma <a> <b> <c>
+    SUtils::add(res, (8 << 16) | 12);
+    SUtils::add(res, tt::getID());
+    SUtils::add(res, this->getID());
+    SUtils::add(res, SUtils::getGLSLID());
+    SUtils::add(res, GLSL_FMA);
+    SUtils::add(res, product->v1->getID());
+    SUtils::add(res, product->v2->getID());
+    SUtils::add(res, addend->getID());
+  }
+
   template<typename tt, SExprOp op, typename tt2, typename tt3>
   void SExpr<tt, op, tt2, tt3>::define(std::vector<uint32_t>& res) {
+    if constexpr(is_fusable<tt, op, tt2, tt3>()) {
+      if constexpr(op == EXPR_MULTIPLICATION) {
+	if(SFmaContractor::isFused(this)) {
+	  return; // Written by the addition using it
+	}
+      } else {
+	int fused_operand = SFmaContractor::getFusedOperand(this);
+	if(fused_operand >= 0) {
+	  this->define_fma(res, fused_operand);
+	  return;
+	}
+      }
+    }
+
     if(this->v1) {
       this->v1->ensure_defined(res);
     }
@@ -216,6 +315,15 @@ namespace spurv {
     } else if(d1 == d2 && d2 == d3 &&
 	      !(tt2::getKind() == STypeKind::KIND_MAT && // Make sure not a matrix
 		tt2::getArg1() > 1 && tt2::getArg0() > 1)) {
+      if constexpr(is_integer_division<tt, op, tt2, tt3>()) {
+	typename InvMapSType<tt>::type divisor;
+	if(SConstantFolder::getConstant(*this->v2, divisor) &&
+	   SStrengthReducer::write(op, tt::getArg1() == 1, (uint32_t)divisor,
+				   this->getID(), this->v1->getID(), res)) {
+	  return;
+	}
+      }
+
       if (d1_comp.kind == STypeKind::KIND_INT) {
 	if constexpr(op == EXPR_ADDITION) {
 	    opcode = 128;
@@ -328,8 +436,11 @@ namespace spurv {
 	      SUtils::add(res, 2); // LoD
 	      SUtils::add(res, SConstantRegistry::getIDFloat(32, 0.0f));
 	    } else if constexpr (tt2::getKind() == STypeKind::KIND_MAT) {
+	      // Constant indices are given as literals
+	      typename InvMapSType<tt3>::type index;
+	      bool constant_index = SConstantFolder::getConstant(*this->v2, index);
 
-	      if (d2.a1 == 1) {
+	      if (d2.a1 == 1 && !constant_index) {
 		// OpVectorExtractDynamic <result_type> <result_id> <vector> <index>
 		SUtils::add(res, (5 << 16) | 77);
 		SUtils::add(res, tt2::inner_type::getID());
@@ -337,13 +448,26 @@ namespace spurv {
 		SUtils::add(res, this->v1->getID());
 		SUtils::add(res, this->v2->getID());
 
+	      } else if (d2.a1 == 1) {
+		// OpCompositeExtract <result_type> <result_id> <vector> <index>
+		SUtils::add(res, (5 << 16) | 81);
+		SUtils::add(res, tt2::inner_type::getID());
+		SUtils::add(res, this->getID());
+		SUtils::add(res, this->v1->getID());
+		SUtils::add(res, (uint32_t)index);
+
 	      } else {
+		if(!constant_index) {
+		  printf("[spurv] Columns of matrices can only be looked up with constant indices\n");
+		  exit(-1);
+		}
+
 		// OpCompositeExtract <result_type> <result_id> <matrix> <index>
 		SUtils::add(res, (5 << 16) | 81);
 		SUtils::add(res, SMat<tt2::getArg0(), 1, typename tt2::firstInnerType>::getID());
 		SUtils::add(res, this->getID());
 		SUtils::add(res, this->v1->getID());
-		SUtils::add(res, this->v2->getID());
+		SUtils::add(res, (uint32_t)index);
 
 	      }
 	    } else if constexpr (tt2::getKind() == STypeKind::KIND_ARR ||
@@ -470,75 +594,97 @@ namespace spurv {
    * Operator functions
    */
 
-  template<typename tt>
-  SExpr<tt, EXPR_NEGATIVE, tt, void_s>& operator-(SValue<tt>& v1) {
-    SExpr<tt, EXPR_NEGATIVE, tt, void_s>* ex = SUtils::allocate<SExpr<tt, EXPR_NEGATIVE, tt, void_s> >();
+  // Returns an expression on the given operands. The expression is folded to a constant if
+  // all operands are constants (see SConstantFolder), rewritten if it can be simplified (see
+  // SAlgebraicSimplifier), and an identical one recorded earlier is reused if it is available
+  // here (see SNodeCache). v2 is null for unary expressions
+  template<typename tt, SExprOp op, typename tt2, typename tt3>
+  SValue<tt>& construct_expression(SValue<tt2>& v1, SValue<tt3>* v2) {
+    using expr_type = SExpr<tt, op, tt2, tt3>;
+
+    SValue<tt>* folded = SConstantFolder::foldExpression<tt, op, tt2, tt3>(v1, v2);
+    if(folded) {
+      return *folded;
+    }
+
+    SValue<tt>* simplified = SAlgebraicSimplifier::simplifyExpression<tt, op, tt2, tt3>(v1, v2);
+    if(simplified) {
+      return *simplified;
+    }
+
+    // Lookups into arrays and images read memory that may be stored to
+    constexpr bool reads_memory = op == EXPR_LOOKUP &&
+      (tt2::getKind() == STypeKind::KIND_ARR ||
+       tt2::getKind() == STypeKind::KIND_RUN_ARR ||
+       tt2::getKind() == STypeKind::KIND_IMAGE);
+
+    SNodeKey key = SNodeCache::makeKey<expr_type>(op, {v1.getID(), v2 ? v2->getID() : -1});
+    expr_type* ex = SNodeCache::find<expr_type>(key, reads_memory);
+    if(ex) {
+      return *ex;
+    }
+
+    ex = SUtils::allocate<expr_type>();
     ex->register_left_node(v1);
+    if(v2) {
+      ex->register_right_node(*v2);
+    }
+
+    SNodeCache::insert(key, ex, reads_memory);
     return *ex;
   }
 
   template<typename tt>
-  SExpr<tt, EXPR_DPDX, tt, void_s>& dfdx(SValue<tt>& v1) {
-    SExpr<tt, EXPR_DPDX, tt, void_s>* ex = SUtils::allocate<SExpr<tt, EXPR_DPDX, tt, void_s> >();
-    ex->register_left_node(v1);
-    return *ex;
+  SValue<tt>& operator-(SValue<tt>& v1) {
+    return construct_expression<tt, EXPR_NEGATIVE, tt, void_s>(v1, nullptr);
   }
 
   template<typename tt>
-  SExpr<tt, EXPR_DPDY, tt, void_s>& dfdy(SValue<tt>& v1) {
-    SExpr<tt, EXPR_DPDY, tt, void_s>* ex = SUtils::allocate<SExpr<tt, EXPR_DPDY, tt, void_s> >();
-    ex->register_left_node(v1);
-    return *ex;
+  SValue<tt>& dfdx(SValue<tt>& v1) {
+    return construct_expression<tt, EXPR_DPDX, tt, void_s>(v1, nullptr);
+  }
+
+  template<typename tt>
+  SValue<tt>& dfdy(SValue<tt>& v1) {
+    return construct_expression<tt, EXPR_DPDY, tt, void_s>(v1, nullptr);
   }
 
   // Additions
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_ADDITION,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>&
+  SValue<typename uwr<in1_t, in2_t>::type>&
   operator+(in1_t&& in1, in2_t&& in2) {
 
     using tt = typename uwr<in1_t, in2_t>::type;
 
-    SExpr<tt, EXPR_ADDITION, tt, tt>* ex = SUtils::allocate<SExpr<tt, EXPR_ADDITION, tt, tt> >();
-    ex->register_left_node(SValueWrapper::unwrap_to<in1_t, tt>(in1));
-    ex->register_right_node(SValueWrapper::unwrap_to<in2_t, tt>(in2));
-    return *ex;
+    SValue<tt>& v1 = SValueWrapper::unwrap_to<in1_t, tt>(in1);
+    SValue<tt>& v2 = SValueWrapper::unwrap_to<in2_t, tt>(in2);
+    return construct_expression<tt, EXPR_ADDITION, tt, tt>(v1, &v2);
   }
 
 
   // Subtractions
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_SUBTRACTION,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>&
+  SValue<typename uwr<in1_t, in2_t>::type>&
   operator-(in1_t&& in1, in2_t&& in2) {
 
     using tt = typename uwr<in1_t, in2_t>::type;
 
 
-    SExpr<tt, EXPR_SUBTRACTION, tt, tt>* ex = SUtils::allocate<SExpr<tt, EXPR_SUBTRACTION, tt, tt> >();
-    ex->register_left_node(SValueWrapper::unwrap_to<in1_t, tt>(in1));
-    ex->register_right_node(SValueWrapper::unwrap_to<in2_t, tt>(in2));
-    return *ex;
+    SValue<tt>& v1 = SValueWrapper::unwrap_to<in1_t, tt>(in1);
+    SValue<tt>& v2 = SValueWrapper::unwrap_to<in2_t, tt>(in2);
+    return construct_expression<tt, EXPR_SUBTRACTION, tt, tt>(v1, &v2);
   }
 
 
   // Division
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_DIVISION,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>&
+  SValue<typename uwr<in1_t, in2_t>::type>&
   operator/(in1_t&& in1, in2_t&& in2) {
     using tt = typename uwr<in1_t, in2_t>::type;
 
-    SExpr<tt, EXPR_DIVISION, tt, tt>* ex = SUtils::allocate<SExpr<tt, EXPR_DIVISION, tt, tt> >();
-    ex->register_left_node(SValueWrapper::unwrap_to<in1_t, tt>(in1));
-    ex->register_right_node(SValueWrapper::unwrap_to<in2_t, tt>(in2));
-    return *ex;
+    SValue<tt>& v1 = SValueWrapper::unwrap_to<in1_t, tt>(in1);
+    SValue<tt>& v2 = SValueWrapper::unwrap_to<in2_t, tt>(in2);
+    return construct_expression<tt, EXPR_DIVISION, tt, tt>(v1, &v2);
   }
 
 
@@ -567,21 +713,16 @@ namespace spurv {
   template<typename tt1, typename tt2>
   requires MultiplicableSpurvMatrices<typename std::remove_reference<tt1>::type,
 				      typename std::remove_reference<tt2>::type>
-  SExpr<typename matrix_multiplication_res_type<typename SValueWrapper::unwrapped_type<tt1>::type,
-						typename SValueWrapper::unwrapped_type<tt2>::type>::type,
-	EXPR_DOT,
-	typename SValueWrapper::unwrapped_type<tt1>::type,
-	typename SValueWrapper::unwrapped_type<tt2>::type>& operator*(tt1&& ml, tt2&& mr) {
+  SValue<typename matrix_multiplication_res_type<typename SValueWrapper::unwrapped_type<tt1>::type,
+						typename SValueWrapper::unwrapped_type<tt2>::type>::type>& operator*(tt1&& ml, tt2&& mr) {
     using matl = typename SValueWrapper::ToType<tt1>::type;
     using matr = typename SValueWrapper::ToType<tt2>::type;
     using matres = typename matrix_multiplication_res_type<typename SValueWrapper::ToType<tt1>::type,
 							   typename SValueWrapper::ToType<tt2>::type>::type;
 
-    SExpr<matres, EXPR_DOT, matl, matr>* ex = SUtils::allocate<SExpr<matres, EXPR_DOT, matl, matr> >();
-
-    ex->register_left_node(SValueWrapper::unwrap_to<tt1, matl>(ml));
-    ex->register_right_node(SValueWrapper::unwrap_to<tt2, matr>(mr));
-    return *ex;
+    SValue<matl>& v1 = SValueWrapper::unwrap_to<tt1, matl>(ml);
+    SValue<matr>& v2 = SValueWrapper::unwrap_to<tt2, matr>(mr);
+    return construct_expression<matres, EXPR_DOT, matl, matr>(v1, &v2);
   }
 
   template<typename mtt, typename stt>
@@ -621,29 +762,20 @@ namespace spurv {
 	    typename std::remove_reference<tt2>::type> ||
 	    MatrixScalable<typename std::remove_reference<tt2>::type,
 	    typename std::remove_reference<tt1>::type>)
-    SExpr<typename matrix_type<tt1, tt2>::type,
-	  EXPR_MULTIPLICATION,
-	  typename matrix_type<tt1, tt2>::type,
-	  typename matrix_type<tt1, tt2>::type::inner_type>& operator*(tt1&& ml, tt2&& mr) {
+    SValue<typename matrix_type<tt1, tt2>::type>& operator*(tt1&& ml, tt2&& mr) {
     using comp_type = typename matrix_type<tt1, tt2>::type::inner_type;
     using mat_type = typename matrix_type<tt1, tt2>::type;
 
 
-    SExpr<mat_type, EXPR_MULTIPLICATION, mat_type, comp_type>* ex =
-      SUtils::allocate<SExpr<mat_type, EXPR_MULTIPLICATION, mat_type, comp_type> >();
-
-    ex->register_left_node(SValueWrapper::unwrap_to<tt1, mat_type>(ml));
-    ex->register_right_node(SValueWrapper::unwrap_to<tt2, comp_type>(mr));
-    return *ex;
+    SValue<mat_type>& v1 = SValueWrapper::unwrap_to<tt1, mat_type>(ml);
+    SValue<comp_type>& v2 = SValueWrapper::unwrap_to<tt2, comp_type>(mr);
+    return construct_expression<mat_type, EXPR_MULTIPLICATION, mat_type, comp_type>(v1, &v2);
     }
 
   template<typename tt1, typename tt2>
   requires (MatrixScalable<typename std::remove_reference<tt2>::type,
 	    typename std::remove_reference<tt1>::type>)
-    SExpr<typename matrix_type<tt1, tt2>::type,
-	  EXPR_MULTIPLICATION,
-	  typename matrix_type<tt1, tt2>::type,
-	  typename matrix_type<tt1, tt2>::type::inner_type>& operator*(tt1&& ml, tt2&& mr) {
+    SValue<typename matrix_type<tt1, tt2>::type>& operator*(tt1&& ml, tt2&& mr) {
     return mr * ml;
   }
 
@@ -668,20 +800,13 @@ namespace spurv {
   requires (HasSameType<typename std::remove_reference<tt1>::type,
 		       typename std::remove_reference<tt2>::type> &&
 	    NotWideMatrix<typename get_common_type<tt1, tt2>::type>)
-  SExpr<typename get_common_type<tt1, tt2>::type,
-	EXPR_MULTIPLICATION,
-	typename get_common_type<tt1, tt2>::type,
-	typename get_common_type<tt1, tt2>::type>& operator*(tt1&& el, tt2&& er) {
+  SValue<typename get_common_type<tt1, tt2>::type>& operator*(tt1&& el, tt2&& er) {
 
     using sptype = typename get_common_type<tt1, tt2>::type;
 
-    SExpr<sptype, EXPR_MULTIPLICATION, sptype, sptype>* ex =
-      SUtils::allocate<SExpr<sptype, EXPR_MULTIPLICATION, sptype, sptype> >();
-
-    ex->register_left_node(SValueWrapper::unwrap_to<tt1, sptype>(el));
-    ex->register_right_node(SValueWrapper::unwrap_to<tt2, sptype>(er));
-
-    return *ex;
+    SValue<sptype>& v1 = SValueWrapper::unwrap_to<tt1, sptype>(el);
+    SValue<sptype>& v2 = SValueWrapper::unwrap_to<tt2, sptype>(er);
+    return construct_expression<sptype, EXPR_MULTIPLICATION, sptype, sptype>(v1, &v2);
   }
 
 
@@ -696,55 +821,37 @@ namespace spurv {
 
   template<typename tt1, typename tt2>
   requires AreDottable<tt1, tt2>
-  SExpr<typename get_common_type<tt1, tt2>::type::inner_type,
-	EXPR_DOT,
-	typename get_common_type<tt1, tt2>::type,
-	typename get_common_type<tt1, tt2>::type>& dot(tt1&& el, tt2&& er) {
+  SValue<typename get_common_type<tt1, tt2>::type::inner_type>& dot(tt1&& el, tt2&& er) {
     using sptype = typename get_common_type<tt1, tt2>::type;
 
-    SExpr<typename sptype::inner_type, EXPR_DOT, sptype, sptype>* ex =
-      SUtils::allocate<SExpr<typename sptype::inner_type, EXPR_DOT, sptype, sptype> >();
-
-    ex->register_left_node(SValueWrapper::unwrap_to<tt1, sptype>(el));
-    ex->register_right_node(SValueWrapper::unwrap_to<tt2, sptype>(er));
-
-    return *ex;
+    SValue<sptype>& v1 = SValueWrapper::unwrap_to<tt1, sptype>(el);
+    SValue<sptype>& v2 = SValueWrapper::unwrap_to<tt2, sptype>(er);
+    return construct_expression<typename sptype::inner_type, EXPR_DOT, sptype, sptype>(v1, &v2);
   }
 
 
   // Mod and Rem
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_MOD,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>& mod(in1_t&& in1, in2_t&& in2) {
+  SValue<typename uwr<in1_t, in2_t>::type>& mod(in1_t&& in1, in2_t&& in2) {
     using tt = typename uwr<in1_t, in2_t>::type;
 
-    SExpr<tt, EXPR_MOD, tt, tt>* ex = SUtils::allocate<SExpr<tt, EXPR_MOD, tt, tt> >();
-    ex->register_left_node(SValueWrapper::unwrap_to<in1_t, tt>(in1));
-    ex->register_right_node(SValueWrapper::unwrap_to<in2_t, tt>(in2));
-    return *ex;
+    SValue<tt>& v1 = SValueWrapper::unwrap_to<in1_t, tt>(in1);
+    SValue<tt>& v2 = SValueWrapper::unwrap_to<in2_t, tt>(in2);
+    return construct_expression<tt, EXPR_MOD, tt, tt>(v1, &v2);
   }
 
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_REM,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>& rem(in1_t&& in1, in2_t&& in2) {
+  SValue<typename uwr<in1_t, in2_t>::type>& rem(in1_t&& in1, in2_t&& in2) {
 
     using tt = typename uwr<in1_t, in2_t>::type;
 
-    SExpr<tt, EXPR_REM, tt, tt>* ex = SUtils::allocate<SExpr<tt, EXPR_REM, tt, tt> >();
-    ex->register_left_node(SValueWrapper::unwrap_to<in1_t, tt>(in1));
-    ex->register_right_node(SValueWrapper::unwrap_to<in2_t, tt>(in2));
-    return *ex;
+    SValue<tt>& v1 = SValueWrapper::unwrap_to<in1_t, tt>(in1);
+    SValue<tt>& v2 = SValueWrapper::unwrap_to<in2_t, tt>(in2);
+    return construct_expression<tt, EXPR_REM, tt, tt>(v1, &v2);
   }
 
   template<typename in1_t, typename in2_t>
-  SExpr<typename uwr<in1_t, in2_t>::type,
-	EXPR_MOD,
-	typename uwr<in1_t, in2_t>::type,
-	typename uwr<in1_t, in2_t>::type>& operator%(in1_t&& in1, in2_t&& in2) {
+  SValue<typename uwr<in1_t, in2_t>::type>& operator%(in1_t&& in1, in2_t&& in2) {
     return mod(in1, in2);
   }
 
@@ -759,13 +866,21 @@ namespace spurv {
   SValue<tt>::operator[](SValue<ti>& index) {
 
     static_assert(is_lookup_index<tt, ti>::value, "Value cannnot be used as index into this datatype");
-    SExpr<typename lookup_result<tt>::type, EXPR_LOOKUP,
-	  tt, ti>* ex  =
-      SUtils::allocate<SExpr<typename lookup_result<tt>::type, EXPR_LOOKUP,
-			     tt, ti> >();
-    ex->register_left_node(*this);
-    ex->register_right_node(index);
-    return *ex;
+    return construct_expression<typename lookup_result<tt>::type, EXPR_LOOKUP, tt, ti>(*this, &index);
+  }
+
+  template<typename tt>
+  template<int... is>
+  SValue<typename swizzle_result<tt, sizeof...(is)>::type>& SValue<tt>::swizzle() requires IsSwizzle<tt, is...> {
+    // Recognized as a shuffle by ConstructMatrix
+    return swizzle_result<tt, sizeof...(is)>::type::cons((*this)[is]...);
+  }
+
+  // The vector of the given components of v, as v.zyx in GLSL
+  template<int... is, typename tt>
+  requires IsSwizzle<tt, is...>
+  SValue<typename swizzle_result<tt, sizeof...(is)>::type>& swizzle(SValue<tt>& v) {
+    return v.template swizzle<is...>();
   }
 
   template<typename tt>
@@ -773,14 +888,8 @@ namespace spurv {
 
     static_assert(is_lookup_index<tt, SInt<32, 1> >::value, "Integer value cannot be used as index into this datatype");
     Constant<int>* c = SUtils::allocate<Constant<int> >(index);
-    SExpr<typename lookup_result<tt>::type, EXPR_LOOKUP,
-	  tt, SInt<32, 1> >* ex  =
-      SUtils::allocate<SExpr<typename lookup_result<tt>::type, EXPR_LOOKUP,
-			     tt, SInt<32, 1> > >();
-    ex->register_left_node(*this);
-    ex->register_right_node(*c);
-
-    return *ex;
+    return construct_expression<typename lookup_result<tt>::type, EXPR_LOOKUP,
+				tt, SInt<32, 1> >(*this, c);
   }
 
 
@@ -789,14 +898,11 @@ namespace spurv {
    */
 
   template<typename t1, typename t2>
-  SExpr<t1, EXPR_CAST, t2>& cast(SValue<t2>& val) {
+  SValue<t1>& cast(SValue<t2>& val) {
     static_assert(is_spurv_castable<t2, t1>::value,
 		  "[spurv::cast] The supplied type is not castable to desired type");
 
-    SExpr<t1, EXPR_CAST, t2>* ex = SUtils::allocate<SExpr<t1, EXPR_CAST, t2> >();
-
-    ex->register_left_node(val);
-    return *ex;
+    return construct_expression<t1, EXPR_CAST, t2, void_s>(val, nullptr);
   }
 
 
@@ -805,60 +911,50 @@ namespace spurv {
    */
 
   template<typename t1, typename t2, SExprOp op>
-  static SExpr<SBool, op,
-	       typename uwr<t1, t2>::type,
-	       typename uwr<t1, t2>::type>& construct_comparison_val(t1 v1, t2 v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  static SValue<SBool>& construct_comparison_val(t1 v1, t2 v2) {
     using tt = typename uwr<t1, t2>::type;
     static_assert(is_spurv_int_type<tt>::value || is_spurv_float_type<tt>::value,
 		  "Comparison not yet defined for non-scalar types");
 
-    SExpr<SBool, op, tt, tt>* ex =
-      SUtils::allocate<SExpr<SBool, op, tt, tt> >();
-
-    ex->register_left_node(SValueWrapper::unwrap_to<t1, tt>(v1));
-    ex->register_right_node(SValueWrapper::unwrap_to<t2, tt>(v2));
-    return *ex;
+    SValue<tt>& uv1 = SValueWrapper::unwrap_to<t1, tt>(v1);
+    SValue<tt>& uv2 = SValueWrapper::unwrap_to<t2, tt>(v2);
+    return construct_expression<SBool, op, tt, tt>(uv1, &uv2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_EQUAL,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator==(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator==(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_EQUAL>(v1, v2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_NOTEQUAL,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator!=(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator!=(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_NOTEQUAL>(v1, v2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_LESSTHAN,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator<(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator<(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_LESSTHAN>(v1, v2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_GREATERTHAN,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator>(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator>(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_GREATERTHAN>(v1, v2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_LESSOREQUAL,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator<=(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator<=(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_LESSOREQUAL>(v1, v2);
   }
 
   template<typename t1, typename t2>
-  SExpr<SBool, EXPR_GREATEROREQUAL,
-	typename uwr<t1, t2>::type,
-	typename uwr<t1, t2>::type>& operator>=(t1&& v1, t2&& v2) {
+  requires RequireOneSpurvValue<t1, t2>
+  SValue<SBool>& operator>=(t1&& v1, t2&& v2) {
     return construct_comparison_val<t1, t2, EXPR_GREATEROREQUAL>(v1, v2);
   }
 
@@ -0,0 +1,195 @@
+#include "fma_contraction.hpp"
+#include "event_registry.hpp"
+#include "dead_code_elimination.hpp"
+#include "utils.hpp"
+
+namespace spurv {
+
+  /*
+   * SFmaContractor members
+   */
+
+  bool SFmaContractor::enabled = true;
+
+  std::unordered_set<const SValueBase*> SFmaContractor::precise_values;
+
+  std::unordered_set<const SValueBase*> SFmaContractor::no_contraction;
+  std::unordered_map<const SValueBase*, int> SFmaContractor::contracted;
+  std::unordered_set<const SValueBase*> SFmaContractor::fused;
+
+  int SFmaContractor::num_contracted = 0;
+
+
+  /*
+   * SFmaContractor member functions
+   */
+
+  bool SFmaContractor::is_float_arithmetic(const SNodeInfo& info, int operation) {
+    if(info.kind != NODE_EXPRESSION || info.operation != operation) {
+      return false;
+    }
+
+    // Scalars and vectors only, multiplications of matrices are not component-wise
+    const DSType& type = info.type;
+    if(type.kind == STypeKind::KIND_MAT) {
+      if(type.a0 > 1 && type.a1 > 1) {
+	return false;
+      }
+
+      return type.inner_types[0].kind == STypeKind::KIND_FLOAT;
+    }
+
+    return type.kind == STypeKind::KIND_FLOAT;
+  }
+
+  void SFmaContractor::analyze(SPrecision precision) {
+    SFmaContractor::no_contraction.clear();
+    SFmaContractor::contracted.clear();
+    SFmaContractor::fused.clear();
+    SFmaContractor::num_contracted = 0;
+
+    // Precise values and everything they are computed from
+    std::vector<const SValueBase*> worklist(SFmaContractor::precise_values.begin(),
+					    SFmaContractor::precise_values.end());
+    SNodeInfo info;
+    while(worklist.size()) {
+      const SValueBase* value = worklist.back();
+      worklist.pop_back();
+
+      if(!SFmaContractor::no_contraction.insert(value).second) {
+	continue;
+      }
+
+      value->getNodeInfo(info);
+      worklist.insert(worklist.end(), info.operands.begin(), info.operands.end());
+    }
+
+    if(!SFmaContractor::enabled || precision == SPrecision::PRECISION_STRICT) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // Count the uses of each value among what will be written
+    std::unordered_map<const SValueBase*, int> uses;
+    std::vector<const SValueBase*> written;
+    SEventInfo ev;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      if(ev.kind == EVENT_DECLARATION) {
+	ev.values[0]->getNodeInfo(info);
+	for(const SValueBase* operand : info.operands) {
+	  uses[operand]++;
+	}
+	written.push_back(ev.values[0]);
+      } else if(ev.kind != EVENT_LOAD) {
+	for(const SValueBase* value : ev.values) {
+	  uses[value]++;
+	}
+      }
+    }
+
+    // Node infos are not reused here, as getDSType leaves the inner types of scalars as they were
+    for(const SValueBase* value : written) {
+      SNodeInfo info;
+      value->getNodeInfo(info);
+      if(!SFmaContractor::is_float_arithmetic(info, EXPR_ADDITION) ||
+	 SFmaContractor::no_contraction.count(value)) {
+	continue;
+      }
+
+      for(unsigned int i = 0; i < info.operands.size(); i++) {
+	const SValueBase* operand = info.operands[i];
+	SNodeInfo operand_info;
+	operand->getNodeInfo(operand_info);
+
+	if(SFmaContractor::is_float_arithmetic(operand_info, EXPR_MULTIPLICATION) &&
+	   operand_info.type == info.type && uses[operand] == 1 &&
+	   !SFmaContractor::no_contraction.count(operand) && !SFmaContractor::fused.count(operand)) {
+	  // Scaling a vector by a scalar is not component-wise
+	  bool same_types = true;
+	  for(const SValueBase* factor : operand_info.operands) {
+	    SNodeInfo factor_info;
+	    factor->getNodeInfo(factor_info);
+	    same_types = same_types && factor_info.type == info.type;
+	  }
+
+	  if(!same_types) {
+	    continue;
+	  }
+
+	  SFmaContractor::contracted[value] = i;
+	  SFmaContractor::fused.insert(operand);
+	  SFmaContractor::num_contracted++;
+	  break;
+	}
+      }
+    }
+  }
+
+  void SFmaContractor::write_decorations(std::vector<uint32_t>& bin) {
+    if(SFmaContractor::no_contraction.empty()) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    SEventInfo ev;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      if(ev.kind != EVENT_DECLARATION || !SFmaContractor::no_contraction.count(ev.values[0])) {
+	continue;
+      }
+
+      SNodeInfo info;
+      ev.values[0]->getNodeInfo(info);
+      if(SFmaContractor::is_float_arithmetic(info, EXPR_ADDITION) ||
+	 SFmaContractor::is_float_arithmetic(info, EXPR_SUBTRACTION) ||
+	 SFmaContractor::is_float_arithmetic(info, EXPR_MULTIPLICATION) ||
+	 SFmaContractor::is_float_arithmetic(info, EXPR_DIVISION)) {
+	// OpDecorate <target> NoContraction
+	SUtils::add(bin, (3 << 16) | 71);
+	SUtils::add(bin, info.id);
+	SUtils::add(bin, 42);
+      }
+    }
+  }
+
+  int SFmaContractor::getFusedOperand(const SValueBase* addition) {
+    std::unordered_map<const SValueBase*, int>::iterator it = SFmaContractor::contracted.find(addition);
+    return it == SFmaContractor::contracted.end() ? -1 : it->second;
+  }
+
+  bool SFmaContractor::isFused(const SValueBase* product) {
+    return SFmaContractor::fused.count(product);
+  }
+
+  void SFmaContractor::clear() {
+    SFmaContractor::precise_values.clear();
+
+    SFmaContractor::no_contraction.clear();
+    SFmaContractor::contracted.clear();
+    SFmaContractor::fused.clear();
+  }
+
+  void SFmaContractor::setEnabled(bool enabled) {
+    SFmaContractor::enabled = enabled;
+  }
+
+  bool SFmaContractor::isEnabled() {
+    return SFmaContractor::enabled;
+  }
+
+  int SFmaContractor::getNumContracted() {
+    return SFmaContractor::num_contracted;
+  }
+
+};
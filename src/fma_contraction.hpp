@@ -0,0 +1,82 @@
+#ifndef __SPURV_FMA_CONTRACTION
+#define __SPURV_FMA_CONTRACTION
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SValueBase;
+  struct SNodeInfo;
+
+  /*
+   * SFmaContractor - Writes a * b + c on floats and float vectors as a single GLSL.std.450
+   * Fma, in shaders whose precision mode allows it (see SPrecision). The result is rounded
+   * once instead of twice, so it may differ slightly from the separate operations.
+   *
+   * An addition is contracted with an operand that is a component-wise multiplication used
+   * nowhere else, since the product would otherwise have to be written anyway. Values marked
+   * with precise(), and everything they are computed from, are never contracted, and their
+   * arithmetic is decorated with NoContraction so that the driver leaves it alone as well
+   */
+
+  class SFmaContractor {
+    static bool enabled;
+
+    static std::unordered_set<const SValueBase*> precise_values; // As marked by the user
+
+    // Analysis
+    static std::unordered_set<const SValueBase*> no_contraction; // Precise values and their operands
+    static std::unordered_map<const SValueBase*, int> contracted; // Operand index of the product, by addition
+    static std::unordered_set<const SValueBase*> fused; // Products written as part of an Fma
+
+    static int num_contracted;
+
+    SFmaContractor() = delete;
+
+    // Whether the node is component-wise arithmetic on floats or float vectors
+    static bool is_float_arithmetic(const SNodeInfo& info, int operation);
+
+    // Finds the additions to contract among the live values in SEventRegistry.
+    // Expects SDeadCodeEliminator to have analyzed them
+    static void analyze(SPrecision precision);
+
+    // Writes NoContraction on the live arithmetic of precise values. To be called
+    // within the annotations of the module
+    static void write_decorations(std::vector<uint32_t>& bin);
+
+    // Index of the operand to fuse into an Fma with the addition, -1 if none
+    static int getFusedOperand(const SValueBase* addition);
+
+    static bool isFused(const SValueBase* product);
+
+    static void clear();
+
+    template<typename tt, SExprOp op, typename tt2, typename tt3>
+    friend class SExpr;
+
+    template<typename tt>
+    friend SValue<tt>& precise(SValue<tt>& value);
+
+    friend class SPassManager;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Contraction is on by default, but only done in shaders with a precision mode allowing it
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of additions contracted in the last compiled shader
+    static int getNumContracted();
+  };
+
+};
+
+#endif // __SPURV_FMA_CONTRACTION
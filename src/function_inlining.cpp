@@ -0,0 +1,65 @@
+#include "function_inlining.hpp"
+#include "functions.hpp"
+#include "loop_unrolling.hpp"
+
+namespace spurv {
+
+  /*
+   * SFunctionInliner members
+   */
+
+  int SFunctionInliner::max_inlined_size = SFunctionInliner::default_max_inlined_size;
+
+  int SFunctionInliner::inlined = 0;
+  int SFunctionInliner::num_inlined = 0;
+
+
+  /*
+   * SFunctionInliner member functions
+   */
+
+  long long SFunctionInliner::body_size(const std::vector<STimeEventBase*>& body) {
+    return SLoopUnroller::body_size(body);
+  }
+
+  bool SFunctionInliner::inlines(const SFunctionBase* function) {
+    bool is_inlined = false;
+
+    switch(function->inlining) {
+    case SInline::INLINE_AUTO:
+      // Asking the driver not to inline the function keeps the call
+      is_inlined = function->control != FUNCTION_CONTROL_DONT_INLINE &&
+	SFunctionInliner::max_inlined_size > 0 && function->size <= SFunctionInliner::max_inlined_size;
+      break;
+    case SInline::INLINE_ALWAYS:
+      is_inlined = true;
+      break;
+    case SInline::INLINE_NEVER:
+      break;
+    }
+
+    if(is_inlined) {
+      SFunctionInliner::inlined++;
+    }
+
+    return is_inlined;
+  }
+
+  void SFunctionInliner::clear() {
+    SFunctionInliner::num_inlined = SFunctionInliner::inlined;
+    SFunctionInliner::inlined = 0;
+  }
+
+  void SFunctionInliner::setMaxInlinedSize(int size) {
+    SFunctionInliner::max_inlined_size = size;
+  }
+
+  int SFunctionInliner::getMaxInlinedSize() {
+    return SFunctionInliner::max_inlined_size;
+  }
+
+  int SFunctionInliner::getNumInlined() {
+    return SFunctionInliner::num_inlined;
+  }
+
+};
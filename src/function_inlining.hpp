@@ -0,0 +1,66 @@
+#ifndef __SPURV_FUNCTION_INLINING
+#define __SPURV_FUNCTION_INLINING
+
+#include "declarations.hpp"
+
+#include <vector>
+
+namespace spurv {
+
+  class STimeEventBase;
+
+  /*
+   * SFunctionInliner - Decides whether a call to a function defined with SShader::function
+   * is written as an OpFunctionCall, or recorded inline by running the body again on the
+   * arguments. Inlined bodies are folded with the arguments (see SConstantFolder) and share
+   * values with the caller (see SNodeCache), while a called body is written once.
+   *
+   * INLINE_AUTO inlines functions whose body is within the maximum inlined size, where a
+   * call would cost about as much as the body, unless the driver is asked not to inline
+   * them. Bodies are recorded once when the function is defined, also to be measured, except
+   * for INLINE_ALWAYS functions, which are only ever recorded inline
+   */
+
+  class SFunctionInliner {
+    static int max_inlined_size;
+
+    // Counted while recording, and kept for the statistics when the shader is compiled
+    static int inlined;
+    static int num_inlined;
+
+    SFunctionInliner() = delete;
+
+    // Number of instructions in a recorded body, see SLoopUnroller
+    static long long body_size(const std::vector<STimeEventBase*>& body);
+
+    // Whether the next call to function is recorded inline, counted if so
+    static bool inlines(const SFunctionBase* function);
+
+    // Also keeps the statistics of the shader just compiled
+    static void clear();
+
+    friend class SFunctionBase;
+
+    template<typename Signature>
+    friend class SFunction;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+    friend class SPassManager;
+
+  public:
+
+    static const int default_max_inlined_size = 8;
+
+    // The size up to which INLINE_AUTO inlines, 0 to inline no INLINE_AUTO function
+    static void setMaxInlinedSize(int size);
+    static int getMaxInlinedSize();
+
+    // Number of calls recorded inline in the last compiled shader
+    static int getNumInlined();
+  };
+
+};
+
+#endif // __SPURV_FUNCTION_INLINING
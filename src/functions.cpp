@@ -0,0 +1,272 @@
+#include "functions.hpp"
+#include "event_registry.hpp"
+#include "variable_registry.hpp"
+#include "pointers.hpp"
+#include "load_elimination.hpp"
+#include "local_promotion.hpp"
+#include "pass_manager.hpp"
+#include "function_inlining.hpp"
+#include "trace.hpp"
+
+#include <map>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+
+namespace spurv {
+
+  /*
+   * SFunctionBase members
+   */
+
+  std::vector<SFunctionBase*> SFunctionBase::functions;
+
+
+  /*
+   * SFunctionBase member functions
+   */
+
+  SFunctionBase::SFunctionBase(SInline inlining, SFunctionControl control) {
+    this->id = SUtils::getNewID();
+    this->index = -1;
+    this->inlining = inlining;
+    this->control = control;
+    this->is_recording = false;
+    this->is_called = false;
+    this->reads_memory = false;
+    this->reads_global = false;
+    this->size = 0;
+
+    this->cache_open_scopes = {true};
+    this->cache_scope_stack = {0};
+    this->cache_memory_epoch = 0;
+  }
+
+  void SFunctionBase::swap_registries() {
+    std::swap(this->events, SEventRegistry::events);
+    std::swap(this->variables, SVariableRegistry::variables);
+
+    std::swap(this->cache_entries, SNodeCache::entries);
+    std::swap(this->cache_open_scopes, SNodeCache::open_scopes);
+    std::swap(this->cache_scope_stack, SNodeCache::scope_stack);
+    std::swap(this->cache_memory_epoch, SNodeCache::memory_epoch);
+
+    std::swap(this->chains, SLoadEliminator::chains);
+    std::swap(this->hoisted_chains, SLoadEliminator::hoisted_chains);
+    std::swap(this->chain_order, SLoadEliminator::chain_order);
+  }
+
+  void SFunctionBase::begin_body() {
+    this->is_recording = true;
+    this->swap_registries();
+  }
+
+  void SFunctionBase::end_body() {
+    this->analyze_body();
+    this->size = SFunctionInliner::body_size(SEventRegistry::events);
+
+    this->swap_registries();
+    this->is_recording = false;
+
+    // Functions called from the body have been defined before
+    this->index = SFunctionBase::functions.size();
+    SFunctionBase::functions.push_back(this);
+  }
+
+  void SFunctionBase::analyze_body() {
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    std::unordered_set<int> locals;
+    for(SVariableEntryBase* variable : SVariableRegistry::variables) {
+      locals.insert(variable->getPointerID());
+    }
+
+    std::unordered_set<const SValueBase*> recorded;
+    SEventInfo ev;
+    for(const STimeEventBase* event : events) {
+      event->getEventInfo(ev);
+      if(ev.kind == EVENT_DECLARATION || ev.kind == EVENT_LOAD) {
+	recorded.insert(ev.values[0]);
+      }
+    }
+
+    SNodeInfo info;
+    SPointerInfo pointer;
+    for(const STimeEventBase* event : events) {
+      event->getEventInfo(ev);
+
+      std::vector<const SValueBase*> used;
+      const SPointerBase* accessed = nullptr;
+      bool is_store = false;
+
+      switch(ev.kind) {
+      case EVENT_DECLARATION:
+	ev.values[0]->getNodeInfo(info);
+	used = info.operands;
+
+	if(info.kind == NODE_EXPRESSION && info.operation == EXPR_LOOKUP) {
+	  SNodeInfo looked_up;
+	  info.operands[0]->getNodeInfo(looked_up);
+	  if(looked_up.type.kind != STypeKind::KIND_MAT) {
+	    this->reads_global = true;
+	    this->reads_memory = this->reads_memory || looked_up.type.kind != STypeKind::KIND_TEXTURE;
+	  }
+	} else if(info.kind == NODE_FUNCTION_CALL) {
+	  const SFunctionBase* callee = SFunctionBase::functions[info.operation];
+	  this->reads_global = this->reads_global || callee->reads_global;
+	  this->reads_memory = this->reads_memory || callee->reads_memory;
+	}
+	break;
+      case EVENT_LOAD:
+	ev.values[0]->getNodeInfo(info);
+	accessed = info.pointer;
+	break;
+      case EVENT_STORE:
+	used = ev.values;
+	accessed = ev.pointer;
+	is_store = true;
+	break;
+      case EVENT_IMAGE_STORE:
+	printf("[spurv] Functions can not store to images\n");
+	exit(-1);
+      default:
+	used = ev.values;
+	break;
+      }
+
+      while(accessed != nullptr) {
+	accessed->getPointerInfo(pointer);
+	if(pointer.parent != nullptr) {
+	  used.push_back(pointer.index);
+	}
+	accessed = pointer.parent;
+      }
+
+      if(ev.kind == EVENT_LOAD || ev.kind == EVENT_STORE) {
+	if(pointer.storage == SStorageClass::STORAGE_FUNCTION) {
+	  if(!locals.count(pointer.id)) {
+	    printf("[spurv] Functions can only access their own locals, pass other values as arguments\n");
+	    exit(-1);
+	  }
+	} else if(is_store) {
+	  printf("[spurv] Functions can only store to their own locals\n");
+	  exit(-1);
+	} else if(pointer.storage == SStorageClass::STORAGE_OUTPUT) {
+	  printf("[spurv] Functions can not load from outputs\n");
+	  exit(-1);
+	} else {
+	  this->reads_global = true;
+	  this->reads_memory = this->reads_memory || pointer.storage == SStorageClass::STORAGE_STORAGE_BUFFER;
+	}
+      }
+
+      for(const SValueBase* value : used) {
+	if(recorded.count(value)) {
+	  continue;
+	}
+
+	value->getNodeInfo(info);
+	if(info.kind != NODE_CONSTANT) {
+	  printf("[spurv] Functions can only use their parameters, constants and what they compute from "
+		 "them, pass other values as arguments\n");
+	  exit(-1);
+	}
+      }
+    }
+  }
+
+  void SFunctionBase::compile_functions(std::vector<uint32_t>& bin, std::vector<uint32_t>& definitions,
+					std::vector<uint32_t>& bodies, SPrecision precision,
+					const std::string& shader,
+					std::vector<SDeclarationState*>& declaration_states) {
+    // Types of functions with the same signature are defined once
+    std::map<std::vector<uint32_t>, int> function_types;
+
+    // Callers come after their callees, and mark them as called when they are written
+    for(int i = (int)SFunctionBase::functions.size() - 1; i >= 0; i--) {
+      SFunctionBase* function = SFunctionBase::functions[i];
+      if(!function->is_called) {
+	continue;
+      }
+
+      std::string name = "function " + std::to_string(function->index);
+      STraceSpan span("function", "compile", shader);
+
+      function->swap_registries();
+
+      std::vector<const SValueBase*> outputs = { function->getResult() };
+      SPassManager::run(bin, precision, shader, name, outputs);
+
+      SEventRegistry::write_type_definitions(definitions, declaration_states);
+      function->define_types(definitions, declaration_states);
+
+      std::vector<uint32_t> signature;
+      function->get_signature(signature);
+
+      std::map<std::vector<uint32_t>, int>::iterator it = function_types.find(signature);
+      if(it == function_types.end()) {
+	int function_type = SUtils::getNewID();
+
+	// OpTypeFunction <result_id> <return type> <parameter types...>
+	SUtils::add(definitions, ((2 + signature.size()) << 16) | 33);
+	SUtils::add(definitions, function_type);
+	for(uint32_t type_id : signature) {
+	  SUtils::add(definitions, type_id);
+	}
+
+	it = function_types.insert(std::make_pair(signature, function_type)).first;
+      }
+
+      unsigned int function_start = bodies.size();
+
+      // Nothing but the function's own locals is written to, and nothing at all is read
+      // from memory if it loads from no variable (see analyze_body)
+      int function_control = function->control | (function->reads_global ? 0x4 : 0x8);
+
+      // OpFunction <result type> <result_id> <function_control> <function_type>
+      SUtils::add(bodies, (5 << 16) | 54);
+      SUtils::add(bodies, signature[0]);
+      SUtils::add(bodies, function->id);
+      SUtils::add(bodies, function_control);
+      SUtils::add(bodies, it->second);
+
+      for(unsigned int k = 0; k < function->parameter_ids.size(); k++) {
+	// OpFunctionParameter <result type> <result_id>
+	SUtils::add(bodies, (3 << 16) | 55);
+	SUtils::add(bodies, signature[k + 1]);
+	SUtils::add(bodies, function->parameter_ids[k]);
+      }
+
+      // OpLabel <result_id>
+      SUtils::add(bodies, (2 << 16) | 248);
+      SUtils::add(bodies, SUtils::getNewID());
+
+      SVariableRegistry::write_variable_definitions(bodies);
+      SLocalPromoter::write_initial_values(bodies, function_start);
+      SLoadEliminator::write_chains(bodies);
+
+      SEventRegistry::write_events(bodies);
+
+      // OpFunctionEnd
+      SUtils::add(bodies, (1 << 16) | 56);
+
+      function->swap_registries();
+    }
+  }
+
+  void SFunctionBase::clear() {
+    for(SFunctionBase* function : SFunctionBase::functions) {
+      function->swap_registries();
+      SEventRegistry::clear();
+      SVariableRegistry::clear();
+      function->swap_registries();
+    }
+
+    SFunctionBase::functions.clear();
+  }
+
+  int SFunctionBase::getID() const {
+    return this->id;
+  }
+
+};
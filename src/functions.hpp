@@ -0,0 +1,192 @@
+#ifndef __SPURV_FUNCTIONS
+#define __SPURV_FUNCTIONS
+
+#include "declarations.hpp"
+#include "values.hpp"
+#include "node_cache.hpp"
+
+#include <vector>
+#include <string>
+#include <tuple>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class STimeEventBase;
+
+  template<typename tt>
+  class SFunctionParameter;
+
+  /*
+   * SFunctionBase - Type-independent part of functions defined with SShader::function.
+   *
+   * The body of a function is recorded once, into events, locals and caches of its own,
+   * which are swapped with the ones in SEventRegistry, SVariableRegistry, SNodeCache and
+   * SLoadEliminator while the body is recorded and while it is compiled. Bodies may only
+   * use their parameters, constants and what they compute from them, and may only store
+   * to their own locals, so that calls can be shared and moved like other pure nodes
+   */
+
+  class SFunctionBase {
+  protected:
+    int id;
+    int index; // In the order the functions were defined, -1 until the body is recorded
+
+    SInline inlining;
+    SFunctionControl control;
+
+    bool is_recording; // Also while the body is recorded inline, to catch recursion
+    bool is_called; // Set when a call to the function is written
+
+    bool reads_memory; // Loads from storage buffers, so calls are only reused as such loads are
+    bool reads_global; // Loads from any variable but its own locals
+
+    long long size; // Number of instructions in the body, see SLoopUnroller
+
+    std::vector<int> parameter_ids;
+
+    // The registries of the body, while they are not swapped in
+    std::vector<STimeEventBase*> events;
+    std::vector<SVariableEntryBase*> variables;
+    std::unordered_map<SNodeKey, SNodeCache::Entry, SNodeKeyHash> cache_entries;
+    std::vector<bool> cache_open_scopes;
+    std::vector<int> cache_scope_stack;
+    int cache_memory_epoch;
+    std::unordered_map<SNodeKey, SPointerBase*, SNodeKeyHash> chains;
+    std::unordered_set<const SPointerBase*> hoisted_chains;
+    std::vector<SPointerBase*> chain_order;
+
+    static std::vector<SFunctionBase*> functions; // Recorded ones, in the order their bodies ended
+
+    SFunctionBase(SInline inlining, SFunctionControl control);
+
+    void swap_registries();
+
+    // Swaps in the registries of the body, before it is recorded
+    void begin_body();
+
+    // Checks what the recorded body uses, measures it and registers the function
+    void end_body();
+
+    // Finds what the body reads, and stops at what it may not use
+    void analyze_body();
+
+    // The value returned by the body
+    virtual const SValueBase* getResult() const = 0;
+
+    // Of the return value and the parameters
+    virtual void define_types(std::vector<uint32_t>& bin,
+			      std::vector<SDeclarationState*>& declaration_states) = 0;
+
+    // The type ids of the return value and the parameters, to be called after define_types
+    virtual void get_signature(std::vector<uint32_t>& type_ids) const = 0;
+
+    // Runs the passes on and writes the functions called from what has been written, types and
+    // constants to definitions and the functions themselves to bodies. Decorations go to bin
+    static void compile_functions(std::vector<uint32_t>& bin, std::vector<uint32_t>& definitions,
+				  std::vector<uint32_t>& bodies, SPrecision precision,
+				  const std::string& shader,
+				  std::vector<SDeclarationState*>& declaration_states);
+
+    static void clear();
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+    friend class SFunctionInliner;
+
+    template<typename Ret, typename... Args>
+    friend class SFunctionCall;
+
+  public:
+
+    int getID() const;
+  };
+
+
+  /*
+   * SFunction - A function of the shader, called like a C++ function on spurv values (or
+   * C++ values converting to them). Calls are written as OpFunctionCall or recorded inline,
+   * see SFunctionInliner
+   */
+
+  template<typename Signature>
+  class SFunction;
+
+  template<typename Ret, typename... Args>
+  class SFunction<Ret(Args...)> : public SFunctionBase {
+    static_assert(is_spurv_type<Ret>::value && !std::is_same<Ret, void_s>::value,
+		  "[spurv] Functions must return a spurv value");
+
+    std::function<SValue<Ret>&(SValue<Args>&...)> body;
+
+    std::tuple<SFunctionParameter<Args>*...> parameters;
+    SValue<Ret>* result;
+
+    SFunction(const std::function<SValue<Ret>&(SValue<Args>&...)>& body,
+	      SInline inlining, SFunctionControl control);
+
+    void record();
+
+    virtual const SValueBase* getResult() const;
+    virtual void define_types(std::vector<uint32_t>& bin,
+			      std::vector<SDeclarationState*>& declaration_states);
+    virtual void get_signature(std::vector<uint32_t>& type_ids) const;
+
+    friend class SUtils;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+    template<typename R, typename... A>
+    friend class SFunctionCall;
+
+  public:
+
+    SValue<Ret>& call(SValue<Args>&... args);
+
+    template<typename... Ts>
+    SValue<Ret>& operator()(Ts&&... args);
+  };
+
+
+  /*
+   * SFunctionParameter - A parameter of a function, written with the function
+   */
+
+  template<typename tt>
+  class SFunctionParameter : public SValue<tt> {
+    SFunctionParameter();
+
+  public:
+    virtual void define(std::vector<uint32_t>& res);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+
+    friend class SUtils;
+  };
+
+
+  /*
+   * SFunctionCall - The value returned by a call to a function
+   */
+
+  template<typename Ret, typename... Args>
+  class SFunctionCall : public SValue<Ret> {
+    SFunction<Ret(Args...)>* function;
+    std::tuple<SValue<Args>*...> args;
+
+    SFunctionCall(SFunction<Ret(Args...)>* function, SValue<Args>*... args);
+
+  public:
+    virtual void define(std::vector<uint32_t>& res);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<Ret>* clone(SCloneMap& map);
+
+    friend class SUtils;
+  };
+
+};
+
+#endif // __SPURV_FUNCTIONS
@@ -0,0 +1,164 @@
+#ifndef __SPURV_FUNCTIONS_IMPL
+#define __SPURV_FUNCTIONS_IMPL
+
+#include "functions.hpp"
+#include "function_inlining.hpp"
+#include "event_registry.hpp"
+#include "node_cache_impl.hpp"
+#include "value_wrapper.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace spurv {
+
+  /*
+   * SFunction member functions
+   */
+
+  template<typename Ret, typename... Args>
+  SFunction<Ret(Args...)>::SFunction(const std::function<SValue<Ret>&(SValue<Args>&...)>& body,
+				     SInline inlining, SFunctionControl control) :
+    SFunctionBase(inlining, control), body(body), result(nullptr) {
+  }
+
+  template<typename Ret, typename... Args>
+  void SFunction<Ret(Args...)>::record() {
+    this->begin_body();
+
+    // Braces keep the parameters in order
+    this->parameters = std::tuple<SFunctionParameter<Args>*...>{ SUtils::allocate<SFunctionParameter<Args> >()... };
+    std::apply([this](SFunctionParameter<Args>*... parameters) {
+      this->parameter_ids = { parameters->getID()... };
+    }, this->parameters);
+
+    this->result = &std::apply([this](SFunctionParameter<Args>*... parameters) -> SValue<Ret>& {
+      return this->body(*parameters...);
+    }, this->parameters);
+    SEventRegistry::addReturn(this->result);
+
+    this->end_body();
+  }
+
+  template<typename Ret, typename... Args>
+  const SValueBase* SFunction<Ret(Args...)>::getResult() const {
+    return this->result;
+  }
+
+  template<typename Ret, typename... Args>
+  void SFunction<Ret(Args...)>::define_types(std::vector<uint32_t>& bin,
+					     std::vector<SDeclarationState*>& declaration_states) {
+    Ret::ensure_defined(bin, declaration_states);
+    (Args::ensure_defined(bin, declaration_states), ...);
+  }
+
+  template<typename Ret, typename... Args>
+  void SFunction<Ret(Args...)>::get_signature(std::vector<uint32_t>& type_ids) const {
+    type_ids = { (uint32_t)Ret::getID(), (uint32_t)Args::getID()... };
+  }
+
+  template<typename Ret, typename... Args>
+  SValue<Ret>& SFunction<Ret(Args...)>::call(SValue<Args>&... args) {
+    if(this->is_recording) {
+      printf("[spurv] Functions can not call themselves\n");
+      exit(-1);
+    }
+
+    if(SFunctionInliner::inlines(this)) {
+      this->is_recording = true;
+      SValue<Ret>& result = this->body(args...);
+      this->is_recording = false;
+
+      return result;
+    }
+
+    // Calls with the same arguments give the same value, as the body has no side effects
+    SNodeKey key = SNodeCache::makeKey<SFunctionCall<Ret, Args...> >(this->index, { args.getID()... });
+    SFunctionCall<Ret, Args...>* call = SNodeCache::find<SFunctionCall<Ret, Args...> >(key, this->reads_memory);
+    if(call) {
+      return *call;
+    }
+
+    call = SUtils::allocate<SFunctionCall<Ret, Args...> >(this, &args...);
+    SNodeCache::insert(key, call, this->reads_memory);
+    return *call;
+  }
+
+  template<typename Ret, typename... Args>
+  template<typename... Ts>
+  SValue<Ret>& SFunction<Ret(Args...)>::operator()(Ts&&... args) {
+    static_assert(sizeof...(Ts) == sizeof...(Args), "[spurv] Wrong number of arguments to function");
+
+    return this->call(SValueWrapper::unwrap_to<Ts, Args>(args)...);
+  }
+
+
+  /*
+   * SFunctionParameter member functions
+   */
+
+  template<typename tt>
+  SFunctionParameter<tt>::SFunctionParameter() {
+  }
+
+  template<typename tt>
+  void SFunctionParameter<tt>::define(std::vector<uint32_t>& res) {
+    // Written with the function
+  }
+
+  template<typename tt>
+  void SFunctionParameter<tt>::getNodeInfo(SNodeInfo& info) const {
+    SValue<tt>::getNodeInfo(info);
+    info.kind = NODE_PARAMETER;
+  }
+
+
+  /*
+   * SFunctionCall member functions
+   */
+
+  template<typename Ret, typename... Args>
+  SFunctionCall<Ret, Args...>::SFunctionCall(SFunction<Ret(Args...)>* function, SValue<Args>*... args) {
+    this->function = function;
+    this->args = std::make_tuple(args...);
+  }
+
+  template<typename Ret, typename... Args>
+  void SFunctionCall<Ret, Args...>::define(std::vector<uint32_t>& res) {
+    std::apply([&res](SValue<Args>*... args) {
+      (args->ensure_defined(res), ...);
+    }, this->args);
+
+    // OpFunctionCall <result type> <result_id> <function> <arguments...>
+    SUtils::add(res, ((4 + sizeof...(Args)) << 16) | 57);
+    SUtils::add(res, Ret::getID());
+    SUtils::add(res, this->getID());
+    SUtils::add(res, this->function->getID());
+
+    std::apply([&res](SValue<Args>*... args) {
+      (SUtils::add(res, args->getID()), ...);
+    }, this->args);
+
+    this->function->is_called = true;
+  }
+
+  template<typename Ret, typename... Args>
+  void SFunctionCall<Ret, Args...>::getNodeInfo(SNodeInfo& info) const {
+    SValue<Ret>::getNodeInfo(info);
+    info.kind = NODE_FUNCTION_CALL;
+    info.operation = this->function->index;
+    std::apply([&info](SValue<Args>*... args) {
+      info.operands = { args... };
+    }, this->args);
+  }
+
+  template<typename Ret, typename... Args>
+  SValue<Ret>* SFunctionCall<Ret, Args...>::clone(SCloneMap& map) {
+    return std::apply([&map, this](SValue<Args>*... args) -> SValue<Ret>* {
+      return &this->function->call(*map.value(args)...);
+    }, this->args);
+  }
+
+};
+
+#endif // __SPURV_FUNCTIONS_IMPL
@@ -0,0 +1,872 @@
+#include "graph_export.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "instruction_set.hpp"
+#include "dead_code_elimination.hpp"
+#include "invariant_hoisting.hpp"
+#include "code_sinking.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+
+namespace spurv {
+
+  namespace {
+
+    enum RegionKind {
+      REGION_MAIN,
+      REGION_LOOP,
+      REGION_THEN,
+      REGION_ELSE
+    };
+
+    struct GraphRegion {
+      RegionKind kind;
+      int parent;
+      int condition; // Node of the if-condition or the loop iterator, -1 if none
+      int iterations; // For loops
+      bool has_break, has_continue;
+
+      bool in_loop, in_branch;
+      long long executions; // Product of the iteration counts of the enclosing loops
+
+      std::vector<int> nodes;
+      std::vector<int> children;
+    };
+
+    struct GraphNode {
+      const SValueBase* value;
+      SNodeInfo info;
+      int region;
+
+      std::vector<int> operands;
+      int pointer; // For loads
+
+      int fan_out;
+      int cost;
+
+      const char* moved; // "hoisted" or "sunk" if a pass has moved it
+    };
+
+    struct GraphPointer {
+      SPointerInfo info;
+      int parent; // For access chains
+      int index;
+    };
+
+    struct GraphStore {
+      int pointer;
+      int value;
+      int region;
+    };
+
+    struct GraphImageStore {
+      int image, coord, value;
+      int region;
+    };
+
+
+    /*
+     * Graph - The recorded shader, with values and pointers numbered in the
+     * order they were declared
+     */
+
+    struct Graph {
+      std::vector<GraphNode> nodes;
+      std::vector<GraphPointer> pointers;
+      std::vector<GraphRegion> regions;
+      std::vector<GraphStore> stores;
+      std::vector<GraphImageStore> image_stores;
+      std::vector<int> outputs;
+
+      std::unordered_map<const SValueBase*, int> node_indices;
+      std::unordered_map<const SPointerBase*, int> pointer_indices;
+
+      long long total_cost;
+
+      int add_region(RegionKind kind, int parent, int condition, int iterations);
+      int get_node(const SValueBase* value, int region);
+      int get_pointer(const SPointerBase* pointer, int region);
+      // live and moved hold the state of each event left by the passes run so far
+      void build(const std::vector<STimeEventBase*>& events,
+		 const std::vector<bool>& live, const std::vector<const char*>& moved,
+		 const std::vector<const SValueBase*>& outputs);
+    };
+
+    int Graph::add_region(RegionKind kind, int parent, int condition, int iterations) {
+      GraphRegion region;
+      region.kind = kind;
+      region.parent = parent;
+      region.condition = condition;
+      region.iterations = iterations;
+      region.has_break = false;
+      region.has_continue = false;
+
+      if(parent >= 0) {
+	const GraphRegion& pr = this->regions[parent];
+	region.in_loop = pr.in_loop || kind == REGION_LOOP;
+	region.in_branch = pr.in_branch || kind == REGION_THEN || kind == REGION_ELSE;
+	region.executions = pr.executions * (kind == REGION_LOOP ? iterations : 1);
+	this->regions[parent].children.push_back(this->regions.size());
+      } else {
+	region.in_loop = false;
+	region.in_branch = false;
+	region.executions = 1;
+      }
+
+      this->regions.push_back(region);
+      return this->regions.size() - 1;
+    }
+
+    // Values are normally added by their declaration event. Those that are
+    // not (should not happen) are added to the region they are first used in
+    int Graph::get_node(const SValueBase* value, int region) {
+      std::unordered_map<const SValueBase*, int>::iterator it = this->node_indices.find(value);
+      if(it != this->node_indices.end()) {
+	return it->second;
+      }
+
+      int index = this->nodes.size();
+      this->node_indices[value] = index;
+
+      this->nodes.push_back(GraphNode());
+      GraphNode& node = this->nodes.back();
+      node.value = value;
+      node.region = region;
+      node.pointer = -1;
+      node.fan_out = 0;
+      node.cost = 0;
+      node.moved = nullptr;
+      value->getNodeInfo(node.info);
+
+      this->regions[region].nodes.push_back(index);
+      return index;
+    }
+
+    int Graph::get_pointer(const SPointerBase* pointer, int region) {
+      std::unordered_map<const SPointerBase*, int>::iterator it = this->pointer_indices.find(pointer);
+      if(it != this->pointer_indices.end()) {
+	return it->second;
+      }
+
+      GraphPointer gp;
+      pointer->getPointerInfo(gp.info);
+      gp.parent = gp.info.parent ? this->get_pointer(gp.info.parent, region) : -1;
+      gp.index = gp.info.index ? this->get_node(gp.info.index, region) : -1;
+
+      int index = this->pointers.size();
+      this->pointer_indices[pointer] = index;
+      this->pointers.push_back(gp);
+      return index;
+    }
+
+    void Graph::build(const std::vector<STimeEventBase*>& events,
+		      const std::vector<bool>& live, const std::vector<const char*>& moved,
+		      const std::vector<const SValueBase*>& output_values) {
+      std::vector<int> stack;
+      stack.push_back(this->add_region(REGION_MAIN, -1, -1, 0));
+
+      SEventInfo ev;
+      for(unsigned int i = 0; i < events.size(); i++) {
+	if(!live[i]) {
+	  continue;
+	}
+	events[i]->getEventInfo(ev);
+	int current = stack.back();
+
+	switch(ev.kind) {
+	case EVENT_DECLARATION:
+	  {
+	    int node = this->get_node(ev.values[0], current);
+	    this->nodes[node].moved = moved[i];
+	  }
+	  break;
+	case EVENT_LOAD:
+	  // The loaded value has its own declaration event
+	  break;
+	case EVENT_RETURN:
+	  // The returned value is the output of the graph of a function
+	  break;
+	case EVENT_STORE:
+	  {
+	    GraphStore store;
+	    store.value = this->get_node(ev.values[0], current);
+	    store.pointer = this->get_pointer(ev.pointer, current);
+	    store.region = current;
+	    this->stores.push_back(store);
+	  }
+	  break;
+	case EVENT_IMAGE_STORE:
+	  {
+	    GraphImageStore store;
+	    store.image = this->get_node(ev.values[0], current);
+	    store.coord = this->get_node(ev.values[1], current);
+	    store.value = this->get_node(ev.values[2], current);
+	    store.region = current;
+	    this->image_stores.push_back(store);
+	  }
+	  break;
+	case EVENT_IF:
+	  stack.push_back(this->add_region(REGION_THEN, current,
+					   this->get_node(ev.values[0], current), 0));
+	  break;
+	case EVENT_ELSE:
+	  {
+	    int condition = this->regions[current].condition;
+	    stack.pop_back();
+	    stack.push_back(this->add_region(REGION_ELSE, stack.back(), condition, 0));
+	  }
+	  break;
+	case EVENT_FOR_BEGIN:
+	  stack.push_back(this->add_region(REGION_LOOP, current,
+					   this->get_node(ev.values[0], current),
+					   ev.iterations));
+	  break;
+	case EVENT_END_IF:
+	case EVENT_FOR_END:
+	  if(stack.size() > 1) {
+	    stack.pop_back();
+	  }
+	  break;
+	case EVENT_BREAK:
+	case EVENT_CONTINUE:
+	  // Mark the innermost loop
+	  for(int i = stack.size() - 1; i >= 0; i--) {
+	    if(this->regions[stack[i]].kind == REGION_LOOP) {
+	      if(ev.kind == EVENT_BREAK) {
+		this->regions[stack[i]].has_break = true;
+	      } else {
+		this->regions[stack[i]].has_continue = true;
+	      }
+	      break;
+	    }
+	  }
+	  break;
+	}
+      }
+
+      for(const SValueBase* val : output_values) {
+	this->outputs.push_back(this->get_node(val, 0));
+      }
+
+      // Resolve operands. Nodes may be appended while doing so
+      for(unsigned int i = 0; i < this->nodes.size(); i++) {
+	// Copied, since get_node may reallocate the nodes
+	std::vector<const SValueBase*> operand_values = this->nodes[i].info.operands;
+	const SPointerBase* load_pointer = this->nodes[i].info.pointer;
+	int region = this->nodes[i].region;
+
+	std::vector<int> operands;
+	for(const SValueBase* op : operand_values) {
+	  operands.push_back(this->get_node(op, region));
+	}
+
+	int pointer = load_pointer ? this->get_pointer(load_pointer, region) : -1;
+
+	this->nodes[i].operands = operands;
+	this->nodes[i].pointer = pointer;
+      }
+
+      // Fan-out counts every use, including stores, conditions and outputs
+      for(const GraphNode& node : this->nodes) {
+	for(int op : node.operands) {
+	  this->nodes[op].fan_out++;
+	}
+      }
+      for(const GraphPointer& gp : this->pointers) {
+	if(gp.index >= 0) {
+	  this->nodes[gp.index].fan_out++;
+	}
+      }
+      for(const GraphStore& store : this->stores) {
+	this->nodes[store.value].fan_out++;
+      }
+      for(const GraphImageStore& store : this->image_stores) {
+	this->nodes[store.image].fan_out++;
+	this->nodes[store.coord].fan_out++;
+	this->nodes[store.value].fan_out++;
+      }
+      for(const GraphRegion& region : this->regions) {
+	if(region.condition >= 0 && region.kind == REGION_THEN) {
+	  this->nodes[region.condition].fan_out++;
+	}
+      }
+      for(int out : this->outputs) {
+	this->nodes[out].fan_out++;
+      }
+
+      this->total_cost = 0;
+      std::vector<const SNodeInfo*> operand_infos;
+      for(GraphNode& node : this->nodes) {
+	operand_infos.clear();
+	for(int op : node.operands) {
+	  operand_infos.push_back(&this->nodes[op].info);
+	}
+
+	node.cost = SGraphExporter::estimateCost(node.info, operand_infos);
+	this->total_cost += node.cost * this->regions[node.region].executions;
+      }
+    }
+
+
+    /*
+     * Naming utilities
+     */
+
+    const char* expression_names[] = {
+      "negative",
+      "dpdx",
+      "dpdy",
+      "addition",
+      "subtraction",
+      "multiplication",
+      "division",
+      "dot",
+      "cross",
+      "exp",
+      "sqrt",
+      "pow",
+      "mod",
+      "rem",
+      "lookup",
+      "cast",
+      "equal",
+      "not_equal",
+      "less_than",
+      "greater_than",
+      "less_or_equal",
+      "greater_or_equal"
+    };
+
+    const char* node_kind_name(SNodeKind kind) {
+      switch(kind) {
+      case NODE_CONSTANT: return "constant";
+      case NODE_EXPRESSION: return "expression";
+      case NODE_GLSL_FUNCTION: return "glsl_function";
+      case NODE_CONSTRUCT_MATRIX: return "construct_matrix";
+      case NODE_SELECT: return "select";
+      case NODE_LOAD: return "load";
+      case NODE_CUSTOM: return "custom";
+      case NODE_PARAMETER: return "parameter";
+      case NODE_FUNCTION_CALL: return "function_call";
+      }
+      return "unknown";
+    }
+
+    const char* region_kind_name(RegionKind kind) {
+      switch(kind) {
+      case REGION_MAIN: return "main";
+      case REGION_LOOP: return "loop";
+      case REGION_THEN: return "then";
+      case REGION_ELSE: return "else";
+      }
+      return "unknown";
+    }
+
+    std::string operation_name(const SNodeInfo& info) {
+      if(info.kind == NODE_EXPRESSION &&
+	 info.operation >= 0 &&
+	 info.operation < (int)(sizeof(expression_names) / sizeof(expression_names[0]))) {
+	return expression_names[info.operation];
+      } else if(info.kind == NODE_GLSL_FUNCTION) {
+	const char* name = SInstructionSet::getGLSLInstructionName(info.operation);
+	if(name) {
+	  return name;
+	}
+	return "GLSL " + std::to_string(info.operation);
+      } else if(info.kind == NODE_FUNCTION_CALL) {
+	return "call function " + std::to_string(info.operation);
+      }
+
+      return node_kind_name(info.kind);
+    }
+
+    std::string storage_name(SStorageClass storage) {
+      const char* name = SInstructionSet::getEnumName(OPERAND_STORAGE_CLASS, storage);
+      return name ? name : std::to_string((int)storage);
+    }
+
+    // GLSL-like names (float, ivec3, mat4x3, float[4]) for types
+    std::string type_name(const DSType& type) {
+      switch(type.kind) {
+      case STypeKind::KIND_BOOL:
+	return "bool";
+      case STypeKind::KIND_VOID:
+	return "void";
+      case STypeKind::KIND_INT:
+	if(type.a0 == 32) {
+	  return type.a1 ? "int" : "uint";
+	}
+	return (type.a1 ? "int" : "uint") + std::to_string(type.a0);
+      case STypeKind::KIND_FLOAT:
+	if(type.a0 == 32) {
+	  return "float";
+	} else if(type.a0 == 64) {
+	  return "double";
+	}
+	return "float" + std::to_string(type.a0);
+      case STypeKind::KIND_MAT:
+	{
+	  std::string prefix;
+	  if(type.inner_types.size()) {
+	    const DSType& inner = type.inner_types[0];
+	    if(inner.kind == STypeKind::KIND_INT) {
+	      prefix = inner.a1 ? "i" : "u";
+	    } else if(inner.kind == STypeKind::KIND_BOOL) {
+	      prefix = "b";
+	    } else if(inner.kind == STypeKind::KIND_FLOAT && inner.a0 == 64) {
+	      prefix = "d";
+	    }
+	  }
+
+	  // SMat<n, m> has n rows and m columns
+	  if(type.a1 == 1) {
+	    return prefix + "vec" + std::to_string(type.a0);
+	  } else if(type.a0 == type.a1) {
+	    return prefix + "mat" + std::to_string(type.a0);
+	  }
+	  return prefix + "mat" + std::to_string(type.a1) + "x" + std::to_string(type.a0);
+	}
+      case STypeKind::KIND_ARR:
+	return (type.inner_types.size() ? type_name(type.inner_types[0]) : "?") +
+	  "[" + std::to_string(type.a1) + "]";
+      case STypeKind::KIND_RUN_ARR:
+	return (type.inner_types.size() ? type_name(type.inner_types[0]) : "?") + "[]";
+      case STypeKind::KIND_POINTER:
+	return "ptr<" + storage_name((SStorageClass)type.a0) + ", " +
+	  (type.inner_types.size() ? type_name(type.inner_types[0]) : "?") + ">";
+      case STypeKind::KIND_STRUCT:
+	{
+	  std::string res = "struct{";
+	  for(unsigned int i = 0; i < type.inner_types.size(); i++) {
+	    if(i) {
+	      res += ", ";
+	    }
+	    res += type_name(type.inner_types[i]);
+	  }
+	  return res + "}";
+	}
+      case STypeKind::KIND_IMAGE:
+	return "image" + std::to_string(type.a0 + 1) + "D";
+      case STypeKind::KIND_TEXTURE:
+	return "texture" + std::to_string(type.a0) + "D";
+      case STypeKind::KIND_INVALID:
+	break;
+      }
+      return "invalid";
+    }
+
+    int num_components(const DSType& type) {
+      if(type.kind == STypeKind::KIND_MAT) {
+	return type.a0 * type.a1;
+      }
+      return 1;
+    }
+
+    bool is_integer(const DSType& type) {
+      if(type.kind == STypeKind::KIND_MAT && type.inner_types.size()) {
+	return is_integer(type.inner_types[0]);
+      }
+      return type.kind == STypeKind::KIND_INT;
+    }
+
+
+    /*
+     * Output utilities
+     */
+
+    void append_escaped(std::string& out, const std::string& str) {
+      for(char c : str) {
+	if(c == '"' || c == '\\') {
+	  out += '\\';
+	  out += c;
+	} else if(c == '\n') {
+	  out += "\\n";
+	} else if((unsigned char)c < 0x20) {
+	  char buf[8];
+	  snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+	  out += buf;
+	} else {
+	  out += c;
+	}
+      }
+    }
+
+    void append_index_or_null(std::string& out, int index) {
+      out += index >= 0 ? std::to_string(index) : "null";
+    }
+
+    // Background color going from white for free nodes to red for the most expensive one
+    std::string heat_color(long long cost, long long max_cost) {
+      double saturation = max_cost > 0 ? (double)cost / max_cost : 0.0;
+      char buf[32];
+      snprintf(buf, sizeof(buf), "0.000 %.3f 1.000", saturation);
+      return buf;
+    }
+
+
+    /*
+     * DOT output
+     */
+
+    void write_dot_region(const Graph& graph, int r, long long max_cost, int indent, std::string& out) {
+      const GraphRegion& region = graph.regions[r];
+      std::string pad(indent, ' ');
+
+      for(int i : region.nodes) {
+	const GraphNode& node = graph.nodes[i];
+	long long weighted = node.cost * region.executions;
+
+	std::string label = "%" + std::to_string(node.info.id) + " " + operation_name(node.info);
+	if(node.info.value.size()) {
+	  label += " " + node.info.value;
+	}
+	label += "\n" + type_name(node.info.type) + ", fan-out " + std::to_string(node.fan_out);
+	label += "\ncost " + std::to_string(node.cost);
+	if(region.executions != 1) {
+	  label += " x " + std::to_string(region.executions);
+	}
+	if(node.moved) {
+	  label += std::string(", ") + node.moved;
+	}
+
+	out += pad + "n" + std::to_string(i) + " [label=\"";
+	append_escaped(out, label);
+	out += "\"";
+	if(node.info.kind == NODE_CONSTANT) {
+	  out += ", shape=ellipse";
+	}
+	out += ", fillcolor=\"" + heat_color(weighted, max_cost) + "\"];\n";
+      }
+
+      for(int c : region.children) {
+	const GraphRegion& child = graph.regions[c];
+	out += pad + "subgraph cluster_r" + std::to_string(c) + " {\n";
+
+	std::string label = region_kind_name(child.kind);
+	if(child.kind == REGION_LOOP) {
+	  label += " (" + std::to_string(child.iterations) + " iterations";
+	  if(child.has_break) {
+	    label += ", break";
+	  }
+	  if(child.has_continue) {
+	    label += ", continue";
+	  }
+	  label += ")";
+	}
+	out += pad + "  label=\"" + label + "\";\n";
+	out += pad + "  style=dashed;\n";
+
+	// Anchor for the condition / iterator edge
+	out += pad + "  r" + std::to_string(c) + " [label=\"" + label +
+	  "\", shape=diamond, fillcolor=white];\n";
+
+	write_dot_region(graph, c, max_cost, indent + 2, out);
+	out += pad + "}\n";
+      }
+    }
+
+    void write_dot(const Graph& graph, std::string& out) {
+      long long max_cost = 0;
+      for(const GraphNode& node : graph.nodes) {
+	max_cost = std::max(max_cost, node.cost * graph.regions[node.region].executions);
+      }
+
+      out += "digraph spurv {\n";
+      out += "  label=\"estimated cost " + std::to_string(graph.total_cost) + "\";\n";
+      out += "  node [shape=box, style=filled, fontname=\"monospace\"];\n";
+
+      write_dot_region(graph, 0, max_cost, 2, out);
+
+      for(unsigned int i = 0; i < graph.pointers.size(); i++) {
+	const GraphPointer& gp = graph.pointers[i];
+	out += "  p" + std::to_string(i) + " [label=\"%" + std::to_string(gp.info.id) + " " +
+	  storage_name(gp.info.storage) + "\\n";
+	append_escaped(out, type_name(gp.info.type));
+	out += "\", shape=cylinder, fillcolor=lightblue];\n";
+      }
+
+      for(unsigned int i = 0; i < graph.outputs.size(); i++) {
+	out += "  o" + std::to_string(i) + " [label=\"output " + std::to_string(i) +
+	  "\", shape=invhouse, fillcolor=lightgreen];\n";
+      }
+
+      // Edges point from values to their users
+      for(unsigned int i = 0; i < graph.nodes.size(); i++) {
+	const GraphNode& node = graph.nodes[i];
+	for(int op : node.operands) {
+	  out += "  n" + std::to_string(op) + " -> n" + std::to_string(i) + ";\n";
+	}
+	if(node.pointer >= 0) {
+	  out += "  p" + std::to_string(node.pointer) + " -> n" + std::to_string(i) +
+	    " [style=dashed, label=\"load\"];\n";
+	}
+      }
+
+      for(unsigned int i = 0; i < graph.pointers.size(); i++) {
+	const GraphPointer& gp = graph.pointers[i];
+	if(gp.parent >= 0) {
+	  out += "  p" + std::to_string(gp.parent) + " -> p" + std::to_string(i) + " [style=dashed];\n";
+	}
+	if(gp.index >= 0) {
+	  out += "  n" + std::to_string(gp.index) + " -> p" + std::to_string(i) + " [label=\"index\"];\n";
+	}
+      }
+
+      for(const GraphStore& store : graph.stores) {
+	out += "  n" + std::to_string(store.value) + " -> p" + std::to_string(store.pointer) +
+	  " [color=blue, label=\"store\"];\n";
+      }
+
+      for(const GraphImageStore& store : graph.image_stores) {
+	out += "  n" + std::to_string(store.coord) + " -> n" + std::to_string(store.image) +
+	  " [color=blue, label=\"store coordinate\"];\n";
+	out += "  n" + std::to_string(store.value) + " -> n" + std::to_string(store.image) +
+	  " [color=blue, label=\"store\"];\n";
+      }
+
+      for(unsigned int i = 0; i < graph.regions.size(); i++) {
+	const GraphRegion& region = graph.regions[i];
+	if(region.condition >= 0) {
+	  out += "  n" + std::to_string(region.condition) + " -> r" + std::to_string(i) +
+	    (region.kind == REGION_LOOP ? " [style=dotted, dir=back];\n" : " [style=dotted];\n");
+	}
+      }
+
+      for(unsigned int i = 0; i < graph.outputs.size(); i++) {
+	out += "  n" + std::to_string(graph.outputs[i]) + " -> o" + std::to_string(i) + ";\n";
+      }
+
+      out += "}\n";
+    }
+
+
+    /*
+     * JSON output
+     */
+
+    void write_json(const Graph& graph, std::string& out) {
+      out += "{\n  \"nodes\": [";
+      for(unsigned int i = 0; i < graph.nodes.size(); i++) {
+	const GraphNode& node = graph.nodes[i];
+	const GraphRegion& region = graph.regions[node.region];
+
+	out += i ? ",\n    {" : "\n    {";
+	out += "\"node\": " + std::to_string(i);
+	out += ", \"id\": " + std::to_string(node.info.id);
+	out += ", \"kind\": \"" + std::string(node_kind_name(node.info.kind)) + "\"";
+	out += ", \"operation\": \"" + operation_name(node.info) + "\"";
+	out += ", \"type\": \"";
+	append_escaped(out, type_name(node.info.type));
+	out += "\"";
+
+	if(node.info.kind == NODE_CONSTANT) {
+	  out += ", \"value\": \"";
+	  append_escaped(out, node.info.value);
+	  out += "\"";
+	}
+
+	out += ", \"operands\": [";
+	for(unsigned int j = 0; j < node.operands.size(); j++) {
+	  out += (j ? ", " : "") + std::to_string(node.operands[j]);
+	}
+	out += "]";
+
+	if(node.pointer >= 0) {
+	  out += ", \"pointer\": " + std::to_string(node.pointer);
+	}
+
+	out += ", \"fan_out\": " + std::to_string(node.fan_out);
+	out += ", \"region\": " + std::to_string(node.region);
+	out += std::string(", \"in_loop\": ") + (region.in_loop ? "true" : "false");
+	out += std::string(", \"in_branch\": ") + (region.in_branch ? "true" : "false");
+	out += ", \"executions\": " + std::to_string(region.executions);
+	out += ", \"cost\": " + std::to_string(node.cost);
+	if(node.moved) {
+	  out += std::string(", \"moved\": \"") + node.moved + "\"";
+	}
+	out += "}";
+      }
+      out += "\n  ],\n";
+
+      out += "  \"pointers\": [";
+      for(unsigned int i = 0; i < graph.pointers.size(); i++) {
+	const GraphPointer& gp = graph.pointers[i];
+	out += i ? ",\n    {" : "\n    {";
+	out += "\"pointer\": " + std::to_string(i);
+	out += ", \"id\": " + std::to_string(gp.info.id);
+	out += ", \"storage\": \"" + storage_name(gp.info.storage) + "\"";
+	out += ", \"type\": \"";
+	append_escaped(out, type_name(gp.info.type));
+	out += "\", \"parent\": ";
+	append_index_or_null(out, gp.parent);
+	out += ", \"index\": ";
+	append_index_or_null(out, gp.index);
+	out += "}";
+      }
+      out += "\n  ],\n";
+
+      out += "  \"stores\": [";
+      for(unsigned int i = 0; i < graph.stores.size(); i++) {
+	const GraphStore& store = graph.stores[i];
+	out += i ? ",\n    {" : "\n    {";
+	out += "\"pointer\": " + std::to_string(store.pointer);
+	out += ", \"value\": " + std::to_string(store.value);
+	out += ", \"region\": " + std::to_string(store.region) + "}";
+      }
+      out += "\n  ],\n";
+
+      out += "  \"image_stores\": [";
+      for(unsigned int i = 0; i < graph.image_stores.size(); i++) {
+	const GraphImageStore& store = graph.image_stores[i];
+	out += i ? ",\n    {" : "\n    {";
+	out += "\"image\": " + std::to_string(store.image);
+	out += ", \"coordinate\": " + std::to_string(store.coord);
+	out += ", \"value\": " + std::to_string(store.value);
+	out += ", \"region\": " + std::to_string(store.region) + "}";
+      }
+      out += "\n  ],\n";
+
+      out += "  \"regions\": [";
+      for(unsigned int i = 0; i < graph.regions.size(); i++) {
+	const GraphRegion& region = graph.regions[i];
+	out += i ? ",\n    {" : "\n    {";
+	out += "\"region\": " + std::to_string(i);
+	out += ", \"kind\": \"" + std::string(region_kind_name(region.kind)) + "\"";
+	out += ", \"parent\": ";
+	append_index_or_null(out, region.parent);
+	out += ", \"condition\": ";
+	append_index_or_null(out, region.condition);
+	if(region.kind == REGION_LOOP) {
+	  out += ", \"iterations\": " + std::to_string(region.iterations);
+	  out += std::string(", \"has_break\": ") + (region.has_break ? "true" : "false");
+	  out += std::string(", \"has_continue\": ") + (region.has_continue ? "true" : "false");
+	}
+	out += ", \"executions\": " + std::to_string(region.executions) + "}";
+      }
+      out += "\n  ],\n";
+
+      out += "  \"outputs\": [";
+      for(unsigned int i = 0; i < graph.outputs.size(); i++) {
+	out += (i ? ", " : "") + std::to_string(graph.outputs[i]);
+      }
+      out += "],\n";
+
+      out += "  \"total_cost\": " + std::to_string(graph.total_cost) + "\n}\n";
+    }
+  };
+
+
+  /*
+   * SGraphExporter member functions
+   */
+
+  void SGraphExporter::exportGraph(const std::vector<const SValueBase*>& outputs, SGraphFormat format,
+				   std::string& out) {
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // Between passes (see SPassManager), what has been found dead is left out
+    std::vector<bool> live(events.size());
+    std::vector<const char*> moved(events.size(), nullptr);
+    for(unsigned int i = 0; i < events.size(); i++) {
+      live[i] = SDeadCodeEliminator::isEventLive(i);
+      if(SInvariantHoister::isHoisted(i)) {
+	moved[i] = "hoisted";
+      } else if(SCodeSinker::isSunk(i)) {
+	moved[i] = "sunk";
+      }
+    }
+
+    Graph graph;
+    graph.build(events, live, moved, outputs);
+
+    if(format == GRAPH_FORMAT_DOT) {
+      write_dot(graph, out);
+    } else {
+      write_json(graph, out);
+    }
+  }
+
+  // The numbers are meant for comparing parts of a shader, not for predicting
+  // timings. Component-wise arithmetic costs one per component, division and
+  // transcendentals run on slower units, texture lookups are dominated by memory
+  int SGraphExporter::estimateCost(const SNodeInfo& info, const std::vector<const SNodeInfo*>& operands) {
+    int c = num_components(info.type);
+
+    switch(info.kind) {
+    case NODE_CONSTANT:
+    case NODE_CUSTOM:
+    case NODE_PARAMETER:
+      return 0;
+    case NODE_FUNCTION_CALL:
+      return 1; // The body is counted in the graph of the function
+    case NODE_LOAD:
+      return 1;
+    case NODE_CONSTRUCT_MATRIX:
+      return 1;
+    case NODE_SELECT:
+      return 3; // Branch, merge and phi
+    case NODE_EXPRESSION:
+      switch((SExprOp)info.operation) {
+      case EXPR_MULTIPLICATION:
+	// Matrix products need a dot product per result component
+	if(operands.size() == 2 &&
+	   operands[0]->type.kind == STypeKind::KIND_MAT && operands[0]->type.a1 > 1 &&
+	   operands[1]->type.kind == STypeKind::KIND_MAT) {
+	  return c * operands[0]->type.a1;
+	}
+	return c;
+      case EXPR_DIVISION:
+      case EXPR_MOD:
+      case EXPR_REM:
+	return (is_integer(info.type) ? 8 : 2) * c;
+      case EXPR_DOT:
+	return operands.size() ? num_components(operands[0]->type) : 1;
+      case EXPR_CROSS:
+	return 6;
+      case EXPR_EXP:
+      case EXPR_SQRT:
+	return 4 * c;
+      case EXPR_POW:
+	return 8 * c;
+      case EXPR_LOOKUP:
+	if(operands.size()) {
+	  STypeKind kind = operands[0]->type.kind;
+	  if(kind == STypeKind::KIND_TEXTURE || kind == STypeKind::KIND_IMAGE) {
+	    return 16;
+	  } else if(kind == STypeKind::KIND_ARR || kind == STypeKind::KIND_RUN_ARR) {
+	    return 2; // Access chain and load
+	  }
+	}
+	return 1;
+      default:
+	return c;
+      }
+    case NODE_GLSL_FUNCTION:
+      switch((GLSLFunction)info.operation) {
+      case GLSL_SIN: case GLSL_COS: case GLSL_TAN:
+      case GLSL_ASIN: case GLSL_ACOS: case GLSL_ATAN:
+      case GLSL_SINH: case GLSL_COSH: case GLSL_TANH:
+      case GLSL_ASINH: case GLSL_ACOSH: case GLSL_ATANH:
+      case GLSL_EXP: case GLSL_LOG: case GLSL_EXP2: case GLSL_LOG2:
+      case GLSL_SQRT: case GLSL_INVSQRT:
+	return 4 * c;
+      case GLSL_POW:
+      case GLSL_ATAN2:
+	return 8 * c;
+      case GLSL_CROSS:
+	return 6;
+      case GLSL_NORMALIZE:
+	return 3 * c + 4; // Dot product, inverse square root and scaling
+      case GLSL_REFLECT:
+	return 3 * c;
+      default:
+	return c;
+      }
+    }
+
+    return 1;
+  }
+
+};
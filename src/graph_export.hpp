@@ -0,0 +1,50 @@
+#ifndef __SPURV_GRAPH_EXPORT
+#define __SPURV_GRAPH_EXPORT
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <string>
+
+namespace spurv {
+
+  class SValueBase;
+  struct SNodeInfo;
+
+  /*
+   * SGraphFormat - Output formats of SGraphExporter
+   */
+
+  enum SGraphFormat {
+    GRAPH_FORMAT_DOT, // Graphviz, with loops and branches drawn as clusters
+    GRAPH_FORMAT_JSON
+  };
+
+
+  /*
+   * SGraphExporter - Writes the graph recorded for the shader currently being built
+   * (values, expressions, loads, stores and the loops and branches they live in).
+   * Every node is annotated with its kind, type, fan-out, whether it lies inside a
+   * loop or branch, and a rough estimate of the instructions it costs, so that
+   * expensive parts of a shader can be found before compiling it. When exported between
+   * passes (see SPassManager), values found dead are left out, and values hoisted out of
+   * loops or sunk into branches are marked as such
+   */
+
+  class SGraphExporter {
+  public:
+    SGraphExporter() = delete;
+
+    // Appends the graph to out. outputs are the values that are to be written
+    // to the output variables, as given to SShader::compile
+    static void exportGraph(const std::vector<const SValueBase*>& outputs, SGraphFormat format,
+			    std::string& out);
+
+    // Estimated cost of a node, in scalar ALU instructions, for one execution.
+    // operands holds the info of each of the node's operands
+    static int estimateCost(const SNodeInfo& info, const std::vector<const SNodeInfo*>& operands);
+  };
+
+};
+
+#endif // __SPURV_GRAPH_EXPORT
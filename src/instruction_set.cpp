@@ -0,0 +1,813 @@
+#include "instruction_set.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace spurv {
+
+  namespace {
+    // Shorthands to keep the table below readable
+    const SOperandKind ID = OPERAND_ID;
+    const SOperandKind LIT = OPERAND_LITERAL;
+    const SOperandKind STR = OPERAND_STRING;
+    const SOperandKind OPT_ID = OPERAND_OPTIONAL_ID;
+    const SOperandKind OPT_STR = OPERAND_OPTIONAL_STRING;
+    const SOperandKind IDS = OPERAND_VARIABLE_IDS;
+    const SOperandKind LITS = OPERAND_VARIABLE_LITERALS;
+    const SOperandKind STRS = OPERAND_VARIABLE_STRINGS;
+
+    const SModuleSection S_CAP = SECTION_CAPABILITY;
+    const SModuleSection S_EXT = SECTION_EXTENSION;
+    const SModuleSection S_IMP = SECTION_EXT_INST_IMPORT;
+    const SModuleSection S_MEM = SECTION_MEMORY_MODEL;
+    const SModuleSection S_ENT = SECTION_ENTRY_POINT;
+    const SModuleSection S_EXM = SECTION_EXECUTION_MODE;
+    const SModuleSection S_STR = SECTION_DEBUG_STRING;
+    const SModuleSection S_NAM = SECTION_DEBUG_NAME;
+    const SModuleSection S_MOD = SECTION_DEBUG_MODULE_PROCESSED;
+    const SModuleSection S_ANN = SECTION_ANNOTATION;
+    const SModuleSection S_DEC = SECTION_DECLARATION;
+    const SModuleSection S_FUN = SECTION_FUNCTION;
+    const SModuleSection S_ANY = SECTION_ANY;
+
+    const uint32_t direct_lookup_size = 512;
+  };
+
+  std::vector<SInstructionInfo> SInstructionSet::infos;
+  std::vector<const SInstructionInfo*> SInstructionSet::lookup_table;
+
+  void SInstructionSet::initialize() {
+    infos = {
+      // Miscellaneous and debug
+      {0, "OpNop", false, false, S_ANY, {}},
+      {1, "OpUndef", true, true, S_ANY, {}},
+      {2, "OpSourceContinued", false, false, S_STR, {STR}},
+      {3, "OpSource", false, false, S_STR, {OPERAND_SOURCE_LANGUAGE, LIT, OPT_ID, OPT_STR}},
+      {4, "OpSourceExtension", false, false, S_STR, {STR}},
+      {5, "OpName", false, false, S_NAM, {ID, STR}},
+      {6, "OpMemberName", false, false, S_NAM, {ID, LIT, STR}},
+      {7, "OpString", false, true, S_STR, {STR}},
+      {8, "OpLine", false, false, S_ANY, {ID, LIT, LIT}},
+      {317, "OpNoLine", false, false, S_ANY, {}},
+      {330, "OpModuleProcessed", false, false, S_MOD, {STR}},
+
+      // Mode setting and extensions
+      {10, "OpExtension", false, false, S_EXT, {STR}},
+      {11, "OpExtInstImport", false, true, S_IMP, {STR}},
+      {12, "OpExtInst", true, true, S_ANY, {ID, LIT, IDS}}, // Non-semantic ones also among declarations
+      {14, "OpMemoryModel", false, false, S_MEM, {OPERAND_ADDRESSING_MODEL, OPERAND_MEMORY_MODEL}},
+      {15, "OpEntryPoint", false, false, S_ENT, {OPERAND_EXECUTION_MODEL, ID, STR, IDS}},
+      {16, "OpExecutionMode", false, false, S_EXM, {ID, OPERAND_EXECUTION_MODE}},
+      {17, "OpCapability", false, false, S_CAP, {OPERAND_CAPABILITY}},
+      {331, "OpExecutionModeId", false, false, S_EXM, {ID, OPERAND_EXECUTION_MODE}},
+
+      // Types
+      {19, "OpTypeVoid", false, true, S_DEC, {}},
+      {20, "OpTypeBool", false, true, S_DEC, {}},
+      {21, "OpTypeInt", false, true, S_DEC, {LIT, LIT}},
+      {22, "OpTypeFloat", false, true, S_DEC, {LIT}},
+      {23, "OpTypeVector", false, true, S_DEC, {ID, LIT}},
+      {24, "OpTypeMatrix", false, true, S_DEC, {ID, LIT}},
+      {25, "OpTypeImage", false, true, S_DEC, {ID, OPERAND_DIM, LIT, LIT, LIT, LIT,
+					       OPERAND_IMAGE_FORMAT, OPERAND_OPTIONAL_ACCESS_QUALIFIER}},
+      {26, "OpTypeSampler", false, true, S_DEC, {}},
+      {27, "OpTypeSampledImage", false, true, S_DEC, {ID}},
+      {28, "OpTypeArray", false, true, S_DEC, {ID, ID}},
+      {29, "OpTypeRuntimeArray", false, true, S_DEC, {ID}},
+      {30, "OpTypeStruct", false, true, S_DEC, {IDS}},
+      {31, "OpTypeOpaque", false, true, S_DEC, {STR}},
+      {32, "OpTypePointer", false, true, S_DEC, {OPERAND_STORAGE_CLASS, ID}},
+      {33, "OpTypeFunction", false, true, S_DEC, {ID, IDS}},
+
+      // Constants
+      {41, "OpConstantTrue", true, true, S_DEC, {}},
+      {42, "OpConstantFalse", true, true, S_DEC, {}},
+      {43, "OpConstant", true, true, S_DEC, {LITS}},
+      {44, "OpConstantComposite", true, true, S_DEC, {IDS}},
+      {46, "OpConstantNull", true, true, S_DEC, {}},
+      {48, "OpSpecConstantTrue", true, true, S_DEC, {}},
+      {49, "OpSpecConstantFalse", true, true, S_DEC, {}},
+      {50, "OpSpecConstant", true, true, S_DEC, {LITS}},
+      {51, "OpSpecConstantComposite", true, true, S_DEC, {IDS}},
+      {52, "OpSpecConstantOp", true, true, S_DEC, {LIT, IDS}},
+
+      // Functions
+      {54, "OpFunction", true, true, S_FUN, {OPERAND_FUNCTION_CONTROL, ID}},
+      {55, "OpFunctionParameter", true, true, S_FUN, {}},
+      {56, "OpFunctionEnd", false, false, S_FUN, {}},
+      {57, "OpFunctionCall", true, true, S_FUN, {ID, IDS}},
+
+      // Memory
+      {59, "OpVariable", true, true, S_ANY, {OPERAND_STORAGE_CLASS, OPT_ID}},
+      {60, "OpImageTexelPointer", true, true, S_FUN, {ID, ID, ID}},
+      {61, "OpLoad", true, true, S_FUN, {ID, OPERAND_OPTIONAL_MEMORY_ACCESS}},
+      {62, "OpStore", false, false, S_FUN, {ID, ID, OPERAND_OPTIONAL_MEMORY_ACCESS}},
+      {63, "OpCopyMemory", false, false, S_FUN, {ID, ID, OPERAND_OPTIONAL_MEMORY_ACCESS,
+						 OPERAND_OPTIONAL_MEMORY_ACCESS}},
+      {65, "OpAccessChain", true, true, S_FUN, {ID, IDS}},
+      {66, "OpInBoundsAccessChain", true, true, S_FUN, {ID, IDS}},
+      {67, "OpPtrAccessChain", true, true, S_FUN, {ID, ID, IDS}},
+      {68, "OpArrayLength", true, true, S_FUN, {ID, LIT}},
+
+      // Annotations
+      {71, "OpDecorate", false, false, S_ANN, {ID, OPERAND_DECORATION}},
+      {72, "OpMemberDecorate", false, false, S_ANN, {ID, LIT, OPERAND_DECORATION}},
+      {73, "OpDecorationGroup", false, true, S_ANN, {}},
+      {74, "OpGroupDecorate", false, false, S_ANN, {ID, IDS}},
+      {75, "OpGroupMemberDecorate", false, false, S_ANN, {ID, OPERAND_VARIABLE_ID_LITERAL}},
+      {332, "OpDecorateId", false, false, S_ANN, {ID, OPERAND_DECORATION}},
+      {5632, "OpDecorateString", false, false, S_ANN, {ID, OPERAND_DECORATION}},
+      {5633, "OpMemberDecorateString", false, false, S_ANN, {ID, LIT, OPERAND_DECORATION}},
+
+      // Composites
+      {77, "OpVectorExtractDynamic", true, true, S_FUN, {ID, ID}},
+      {78, "OpVectorInsertDynamic", true, true, S_FUN, {ID, ID, ID}},
+      {79, "OpVectorShuffle", true, true, S_FUN, {ID, ID, LITS}},
+      {80, "OpCompositeConstruct", true, true, S_FUN, {IDS}},
+      {81, "OpCompositeExtract", true, true, S_FUN, {ID, LITS}},
+      {82, "OpCompositeInsert", true, true, S_FUN, {ID, ID, LITS}},
+      {83, "OpCopyObject", true, true, S_FUN, {ID}},
+      {84, "OpTranspose", true, true, S_FUN, {ID}},
+
+      // Images
+      {86, "OpSampledImage", true, true, S_FUN, {ID, ID}},
+      {87, "OpImageSampleImplicitLod", true, true, S_FUN, {ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {88, "OpImageSampleExplicitLod", true, true, S_FUN, {ID, ID, OPERAND_IMAGE_OPERANDS}},
+      {89, "OpImageSampleDrefImplicitLod", true, true, S_FUN, {ID, ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {90, "OpImageSampleDrefExplicitLod", true, true, S_FUN, {ID, ID, ID, OPERAND_IMAGE_OPERANDS}},
+      {91, "OpImageSampleProjImplicitLod", true, true, S_FUN, {ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {92, "OpImageSampleProjExplicitLod", true, true, S_FUN, {ID, ID, OPERAND_IMAGE_OPERANDS}},
+      {95, "OpImageFetch", true, true, S_FUN, {ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {96, "OpImageGather", true, true, S_FUN, {ID, ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {97, "OpImageDrefGather", true, true, S_FUN, {ID, ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {98, "OpImageRead", true, true, S_FUN, {ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {99, "OpImageWrite", false, false, S_FUN, {ID, ID, ID, OPERAND_OPTIONAL_IMAGE_OPERANDS}},
+      {100, "OpImage", true, true, S_FUN, {ID}},
+      {103, "OpImageQuerySizeLod", true, true, S_FUN, {ID, ID}},
+      {104, "OpImageQuerySize", true, true, S_FUN, {ID}},
+      {105, "OpImageQueryLod", true, true, S_FUN, {ID, ID}},
+      {106, "OpImageQueryLevels", true, true, S_FUN, {ID}},
+      {107, "OpImageQuerySamples", true, true, S_FUN, {ID}},
+
+      // Conversions
+      {109, "OpConvertFToU", true, true, S_FUN, {ID}},
+      {110, "OpConvertFToS", true, true, S_FUN, {ID}},
+      {111, "OpConvertSToF", true, true, S_FUN, {ID}},
+      {112, "OpConvertUToF", true, true, S_FUN, {ID}},
+      {113, "OpUConvert", true, true, S_FUN, {ID}},
+      {114, "OpSConvert", true, true, S_FUN, {ID}},
+      {115, "OpFConvert", true, true, S_FUN, {ID}},
+      {116, "OpQuantizeToF16", true, true, S_FUN, {ID}},
+      {124, "OpBitcast", true, true, S_FUN, {ID}},
+
+      // Arithmetic
+      {126, "OpSNegate", true, true, S_FUN, {ID}},
+      {127, "OpFNegate", true, true, S_FUN, {ID}},
+      {128, "OpIAdd", true, true, S_FUN, {ID, ID}},
+      {129, "OpFAdd", true, true, S_FUN, {ID, ID}},
+      {130, "OpISub", true, true, S_FUN, {ID, ID}},
+      {131, "OpFSub", true, true, S_FUN, {ID, ID}},
+      {132, "OpIMul", true, true, S_FUN, {ID, ID}},
+      {133, "OpFMul", true, true, S_FUN, {ID, ID}},
+      {134, "OpUDiv", true, true, S_FUN, {ID, ID}},
+      {135, "OpSDiv", true, true, S_FUN, {ID, ID}},
+      {136, "OpFDiv", true, true, S_FUN, {ID, ID}},
+      {137, "OpUMod", true, true, S_FUN, {ID, ID}},
+      {138, "OpSRem", true, true, S_FUN, {ID, ID}},
+      {139, "OpSMod", true, true, S_FUN, {ID, ID}},
+      {140, "OpFRem", true, true, S_FUN, {ID, ID}},
+      {141, "OpFMod", true, true, S_FUN, {ID, ID}},
+      {142, "OpVectorTimesScalar", true, true, S_FUN, {ID, ID}},
+      {143, "OpMatrixTimesScalar", true, true, S_FUN, {ID, ID}},
+      {144, "OpVectorTimesMatrix", true, true, S_FUN, {ID, ID}},
+      {145, "OpMatrixTimesVector", true, true, S_FUN, {ID, ID}},
+      {146, "OpMatrixTimesMatrix", true, true, S_FUN, {ID, ID}},
+      {147, "OpOuterProduct", true, true, S_FUN, {ID, ID}},
+      {148, "OpDot", true, true, S_FUN, {ID, ID}},
+      {149, "OpIAddCarry", true, true, S_FUN, {ID, ID}},
+      {150, "OpISubBorrow", true, true, S_FUN, {ID, ID}},
+      {151, "OpUMulExtended", true, true, S_FUN, {ID, ID}},
+      {152, "OpSMulExtended", true, true, S_FUN, {ID, ID}},
+
+      // Relational and logical
+      {154, "OpAny", true, true, S_FUN, {ID}},
+      {155, "OpAll", true, true, S_FUN, {ID}},
+      {156, "OpIsNan", true, true, S_FUN, {ID}},
+      {157, "OpIsInf", true, true, S_FUN, {ID}},
+      {164, "OpLogicalEqual", true, true, S_FUN, {ID, ID}},
+      {165, "OpLogicalNotEqual", true, true, S_FUN, {ID, ID}},
+      {166, "OpLogicalOr", true, true, S_FUN, {ID, ID}},
+      {167, "OpLogicalAnd", true, true, S_FUN, {ID, ID}},
+      {168, "OpLogicalNot", true, true, S_FUN, {ID}},
+      {169, "OpSelect", true, true, S_FUN, {ID, ID, ID}},
+      {170, "OpIEqual", true, true, S_FUN, {ID, ID}},
+      {171, "OpINotEqual", true, true, S_FUN, {ID, ID}},
+      {172, "OpUGreaterThan", true, true, S_FUN, {ID, ID}},
+      {173, "OpSGreaterThan", true, true, S_FUN, {ID, ID}},
+      {174, "OpUGreaterThanEqual", true, true, S_FUN, {ID, ID}},
+      {175, "OpSGreaterThanEqual", true, true, S_FUN, {ID, ID}},
+      {176, "OpULessThan", true, true, S_FUN, {ID, ID}},
+      {177, "OpSLessThan", true, true, S_FUN, {ID, ID}},
+      {178, "OpULessThanEqual", true, true, S_FUN, {ID, ID}},
+      {179, "OpSLessThanEqual", true, true, S_FUN, {ID, ID}},
+      {180, "OpFOrdEqual", true, true, S_FUN, {ID, ID}},
+      {181, "OpFUnordEqual", true, true, S_FUN, {ID, ID}},
+      {182, "OpFOrdNotEqual", true, true, S_FUN, {ID, ID}},
+      {183, "OpFUnordNotEqual", true, true, S_FUN, {ID, ID}},
+      {184, "OpFOrdLessThan", true, true, S_FUN, {ID, ID}},
+      {185, "OpFUnordLessThan", true, true, S_FUN, {ID, ID}},
+      {186, "OpFOrdGreaterThan", true, true, S_FUN, {ID, ID}},
+      {187, "OpFUnordGreaterThan", true, true, S_FUN, {ID, ID}},
+      {188, "OpFOrdLessThanEqual", true, true, S_FUN, {ID, ID}},
+      {189, "OpFUnordLessThanEqual", true, true, S_FUN, {ID, ID}},
+      {190, "OpFOrdGreaterThanEqual", true, true, S_FUN, {ID, ID}},
+      {191, "OpFUnordGreaterThanEqual", true, true, S_FUN, {ID, ID}},
+
+      // Bit instructions
+      {194, "OpShiftRightLogical", true, true, S_FUN, {ID, ID}},
+      {195, "OpShiftRightArithmetic", true, true, S_FUN, {ID, ID}},
+      {196, "OpShiftLeftLogical", true, true, S_FUN, {ID, ID}},
+      {197, "OpBitwiseOr", true, true, S_FUN, {ID, ID}},
+      {198, "OpBitwiseXor", true, true, S_FUN, {ID, ID}},
+      {199, "OpBitwiseAnd", true, true, S_FUN, {ID, ID}},
+      {200, "OpNot", true, true, S_FUN, {ID}},
+      {201, "OpBitFieldInsert", true, true, S_FUN, {ID, ID, ID, ID}},
+      {202, "OpBitFieldSExtract", true, true, S_FUN, {ID, ID, ID}},
+      {203, "OpBitFieldUExtract", true, true, S_FUN, {ID, ID, ID}},
+      {204, "OpBitReverse", true, true, S_FUN, {ID}},
+      {205, "OpBitCount", true, true, S_FUN, {ID}},
+
+      // Derivatives
+      {207, "OpDPdx", true, true, S_FUN, {ID}},
+      {208, "OpDPdy", true, true, S_FUN, {ID}},
+      {209, "OpFwidth", true, true, S_FUN, {ID}},
+      {210, "OpDPdxFine", true, true, S_FUN, {ID}},
+      {211, "OpDPdyFine", true, true, S_FUN, {ID}},
+      {212, "OpFwidthFine", true, true, S_FUN, {ID}},
+      {213, "OpDPdxCoarse", true, true, S_FUN, {ID}},
+      {214, "OpDPdyCoarse", true, true, S_FUN, {ID}},
+      {215, "OpFwidthCoarse", true, true, S_FUN, {ID}},
+
+      // Barriers and atomics
+      {224, "OpControlBarrier", false, false, S_FUN, {ID, ID, ID}},
+      {225, "OpMemoryBarrier", false, false, S_FUN, {ID, ID}},
+      {227, "OpAtomicLoad", true, true, S_FUN, {ID, ID, ID}},
+      {228, "OpAtomicStore", false, false, S_FUN, {ID, ID, ID, ID}},
+      {229, "OpAtomicExchange", true, true, S_FUN, {ID, ID, ID, ID}},
+      {230, "OpAtomicCompareExchange", true, true, S_FUN, {ID, ID, ID, ID, ID, ID}},
+      {232, "OpAtomicIIncrement", true, true, S_FUN, {ID, ID, ID}},
+      {233, "OpAtomicIDecrement", true, true, S_FUN, {ID, ID, ID}},
+      {234, "OpAtomicIAdd", true, true, S_FUN, {ID, ID, ID, ID}},
+      {235, "OpAtomicISub", true, true, S_FUN, {ID, ID, ID, ID}},
+      {236, "OpAtomicSMin", true, true, S_FUN, {ID, ID, ID, ID}},
+      {237, "OpAtomicUMin", true, true, S_FUN, {ID, ID, ID, ID}},
+      {238, "OpAtomicSMax", true, true, S_FUN, {ID, ID, ID, ID}},
+      {239, "OpAtomicUMax", true, true, S_FUN, {ID, ID, ID, ID}},
+      {240, "OpAtomicAnd", true, true, S_FUN, {ID, ID, ID, ID}},
+      {241, "OpAtomicOr", true, true, S_FUN, {ID, ID, ID, ID}},
+      {242, "OpAtomicXor", true, true, S_FUN, {ID, ID, ID, ID}},
+
+      // Control flow
+      {245, "OpPhi", true, true, S_FUN, {IDS}},
+      {246, "OpLoopMerge", false, false, S_FUN, {ID, ID, OPERAND_LOOP_CONTROL}},
+      {247, "OpSelectionMerge", false, false, S_FUN, {ID, OPERAND_SELECTION_CONTROL}},
+      {248, "OpLabel", false, true, S_FUN, {}},
+      {249, "OpBranch", false, false, S_FUN, {ID}},
+      {250, "OpBranchConditional", false, false, S_FUN, {ID, ID, ID, LITS}},
+      {251, "OpSwitch", false, false, S_FUN, {ID, ID, OPERAND_VARIABLE_LITERAL_ID}},
+      {252, "OpKill", false, false, S_FUN, {}},
+      {253, "OpReturn", false, false, S_FUN, {}},
+      {254, "OpReturnValue", false, false, S_FUN, {ID}},
+      {255, "OpUnreachable", false, false, S_FUN, {}},
+      {4416, "OpTerminateInvocation", false, false, S_FUN, {}},
+    };
+
+    lookup_table.assign(direct_lookup_size, nullptr);
+    for(const SInstructionInfo& info : infos) {
+      if(info.opcode < direct_lookup_size) {
+	lookup_table[info.opcode] = &info;
+      }
+    }
+  }
+
+  const SInstructionInfo* SInstructionSet::getInfo(uint32_t opcode) {
+    if(lookup_table.size() == 0) {
+      initialize();
+    }
+
+    if(opcode < direct_lookup_size) {
+      return lookup_table[opcode];
+    }
+
+    // The few extension opcodes we know of are far outside the direct table
+    for(const SInstructionInfo& info : infos) {
+      if(info.opcode == opcode) {
+	return &info;
+      }
+    }
+    return nullptr;
+  }
+
+  int SInstructionSet::stringWordLength(const uint32_t* words, int max_words) {
+    for(int i = 0; i < max_words; i++) {
+      uint32_t w = words[i];
+      if(!(w & 0xff) || !(w & 0xff00) || !(w & 0xff0000) || !(w & 0xff000000)) {
+	return i + 1;
+      }
+    }
+    return -1;
+  }
+
+  int SInstructionSet::getMaskParameterCount(SOperandKind kind, uint32_t bit, bool* are_ids) {
+    *are_ids = false;
+    switch(kind) {
+    case OPERAND_LOOP_CONTROL:
+      // DependencyLength, MinIterations, MaxIterations, IterationMultiple, PeelCount, PartialCount
+      return (bit >= 0x8 && bit <= 0x100) ? 1 : 0;
+    case OPERAND_OPTIONAL_MEMORY_ACCESS:
+      if(bit == 0x2) { // Aligned
+	return 1;
+      }
+      if(bit == 0x8 || bit == 0x10) { // MakePointerAvailable, MakePointerVisible
+	*are_ids = true;
+	return 1;
+      }
+      return 0;
+    case OPERAND_IMAGE_OPERANDS:
+    case OPERAND_OPTIONAL_IMAGE_OPERANDS:
+      *are_ids = true;
+      if(bit == 0x4) { // Grad
+	return 2;
+      }
+      return bit <= 0x200 ? 1 : 0;
+    default:
+      return 0;
+    }
+  }
+
+  // Number of literal or id parameters following a decoration, or -1 if they fill the rest of the instruction
+  static int decoration_parameter_count(uint32_t decoration, bool* are_ids) {
+    *are_ids = false;
+    switch(decoration) {
+    case 1: case 6: case 7: case 29: case 30: case 31: case 32: case 33: case 34: case 35:
+    case 36: case 37: case 38: case 39: case 40: case 43: case 44: case 45:
+      // SpecId, ArrayStride, MatrixStride, Stream, Location, Component, Index, Binding,
+      // DescriptorSet, Offset, XfbBuffer, XfbStride, FuncParamAttr, FPRoundingMode,
+      // FPFastMathMode, InputAttachmentIndex, Alignment, MaxByteOffset
+      return 1;
+    case 27: case 46: case 47: case 5634:
+      // UniformId, AlignmentId, MaxByteOffsetId, CounterBuffer
+      *are_ids = true;
+      return 1;
+    case 11: // BuiltIn
+      return 1;
+    case 41: // LinkageAttributes
+      return -1;
+    default:
+      return 0;
+    }
+  }
+
+  bool SInstructionSet::decodeOperands(uint32_t opcode, const uint32_t* operands, int num_operands,
+				       std::vector<SDecodedOperand>& res) {
+    const SInstructionInfo* info = SInstructionSet::getInfo(opcode);
+    if(!info) {
+      return false;
+    }
+
+    int i = 0;
+    for(SOperandKind kind : info->operands) {
+      int left = num_operands - i;
+
+      switch(kind) {
+      case OPERAND_OPTIONAL_ID:
+      case OPERAND_OPTIONAL_LITERAL:
+      case OPERAND_OPTIONAL_STRING:
+      case OPERAND_OPTIONAL_ACCESS_QUALIFIER:
+      case OPERAND_OPTIONAL_MEMORY_ACCESS:
+      case OPERAND_OPTIONAL_IMAGE_OPERANDS:
+	if(left == 0) {
+	  continue;
+	}
+	break;
+      case OPERAND_VARIABLE_IDS:
+      case OPERAND_VARIABLE_LITERALS:
+      case OPERAND_VARIABLE_STRINGS:
+      case OPERAND_VARIABLE_LITERAL_ID:
+      case OPERAND_VARIABLE_ID_LITERAL:
+	break;
+      default:
+	if(left == 0) {
+	  return false;
+	}
+      }
+
+      switch(kind) {
+      case OPERAND_OPTIONAL_ID:
+	res.push_back({OPERAND_ID, i, 1});
+	i++;
+	break;
+      case OPERAND_OPTIONAL_LITERAL:
+	res.push_back({OPERAND_LITERAL, i, 1});
+	i++;
+	break;
+      case OPERAND_STRING:
+      case OPERAND_OPTIONAL_STRING:
+	{
+	  int len = SInstructionSet::stringWordLength(operands + i, left);
+	  if(len < 0) {
+	    return false;
+	  }
+	  res.push_back({OPERAND_STRING, i, len});
+	  i += len;
+	}
+	break;
+      case OPERAND_VARIABLE_IDS:
+	for(; i < num_operands; i++) {
+	  res.push_back({OPERAND_ID, i, 1});
+	}
+	break;
+      case OPERAND_VARIABLE_LITERALS:
+	for(; i < num_operands; i++) {
+	  res.push_back({OPERAND_LITERAL, i, 1});
+	}
+	break;
+      case OPERAND_VARIABLE_STRINGS:
+	while(i < num_operands) {
+	  int len = SInstructionSet::stringWordLength(operands + i, num_operands - i);
+	  if(len < 0) {
+	    return false;
+	  }
+	  res.push_back({OPERAND_STRING, i, len});
+	  i += len;
+	}
+	break;
+      case OPERAND_VARIABLE_LITERAL_ID:
+      case OPERAND_VARIABLE_ID_LITERAL:
+	if((num_operands - i) % 2) {
+	  return false;
+	}
+	for(; i < num_operands; i += 2) {
+	  bool first_is_id = kind == OPERAND_VARIABLE_ID_LITERAL;
+	  res.push_back({first_is_id ? OPERAND_ID : OPERAND_LITERAL, i, 1});
+	  res.push_back({first_is_id ? OPERAND_LITERAL : OPERAND_ID, i + 1, 1});
+	}
+	break;
+      case OPERAND_EXECUTION_MODE:
+	res.push_back({kind, i, 1});
+	i++;
+	// Execution mode parameters are ids for OpExecutionModeId, literals otherwise
+	for(; i < num_operands; i++) {
+	  res.push_back({opcode == 331 ? OPERAND_ID : OPERAND_LITERAL, i, 1});
+	}
+	break;
+      case OPERAND_DECORATION:
+	{
+	  uint32_t decoration = operands[i];
+	  res.push_back({kind, i, 1});
+	  i++;
+
+	  if(opcode == 5632 || opcode == 5633) { // OpDecorateString, OpMemberDecorateString
+	    while(i < num_operands) {
+	      int len = SInstructionSet::stringWordLength(operands + i, num_operands - i);
+	      if(len < 0) {
+		return false;
+	      }
+	      res.push_back({OPERAND_STRING, i, len});
+	      i += len;
+	    }
+	    break;
+	  }
+
+	  bool are_ids;
+	  int count = decoration_parameter_count(decoration, &are_ids);
+	  are_ids = are_ids || opcode == 332; // OpDecorateId
+
+	  if(decoration == 11 && i < num_operands) {
+	    res.push_back({OPERAND_BUILTIN, i, 1});
+	    i++;
+	  } else if(decoration == 41) {
+	    int len = SInstructionSet::stringWordLength(operands + i, num_operands - i);
+	    if(len < 0 || i + len >= num_operands) {
+	      return false;
+	    }
+	    res.push_back({OPERAND_STRING, i, len});
+	    i += len;
+	    res.push_back({OPERAND_LITERAL, i, 1});
+	    i++;
+	  } else {
+	    for(int j = 0; j < count && i < num_operands; j++, i++) {
+	      res.push_back({are_ids ? OPERAND_ID : OPERAND_LITERAL, i, 1});
+	    }
+	  }
+	}
+	break;
+      case OPERAND_FUNCTION_CONTROL:
+      case OPERAND_SELECTION_CONTROL:
+      case OPERAND_LOOP_CONTROL:
+      case OPERAND_OPTIONAL_MEMORY_ACCESS:
+      case OPERAND_IMAGE_OPERANDS:
+      case OPERAND_OPTIONAL_IMAGE_OPERANDS:
+	{
+	  uint32_t mask = operands[i];
+	  res.push_back({kind, i, 1});
+	  i++;
+
+	  // Parameters come in the order of the bits that pulled them in
+	  for(int b = 0; b < 32; b++) {
+	    uint32_t bit = 1u << b;
+	    if(!(mask & bit)) {
+	      continue;
+	    }
+
+	    bool are_ids;
+	    int count = SInstructionSet::getMaskParameterCount(kind, bit, &are_ids);
+	    for(int j = 0; j < count; j++, i++) {
+	      if(i >= num_operands) {
+		return false;
+	      }
+	      res.push_back({are_ids ? OPERAND_ID : OPERAND_LITERAL, i, 1});
+	    }
+	  }
+	}
+	break;
+      case OPERAND_OPTIONAL_ACCESS_QUALIFIER:
+	res.push_back({OPERAND_ACCESS_QUALIFIER, i, 1});
+	i++;
+	break;
+      default:
+	// Plain ids, literals and single-word enumerants
+	res.push_back({kind, i, 1});
+	i++;
+	break;
+      }
+    }
+
+    return i == num_operands;
+  }
+
+  /*
+   * Enumerant tables
+   */
+
+  namespace {
+    const std::vector<SEnumerant> source_languages = {
+      {"Unknown", 0}, {"ESSL", 1}, {"GLSL", 2}, {"OpenCL_C", 3}, {"OpenCL_CPP", 4}, {"HLSL", 5}
+    };
+
+    const std::vector<SEnumerant> execution_models = {
+      {"Vertex", 0}, {"TessellationControl", 1}, {"TessellationEvaluation", 2}, {"Geometry", 3},
+      {"Fragment", 4}, {"GLCompute", 5}, {"Kernel", 6}
+    };
+
+    const std::vector<SEnumerant> addressing_models = {
+      {"Logical", 0}, {"Physical32", 1}, {"Physical64", 2}, {"PhysicalStorageBuffer64", 5348}
+    };
+
+    const std::vector<SEnumerant> memory_models = {
+      {"Simple", 0}, {"GLSL450", 1}, {"OpenCL", 2}, {"Vulkan", 3}
+    };
+
+    const std::vector<SEnumerant> execution_modes = {
+      {"Invocations", 0}, {"SpacingEqual", 1}, {"SpacingFractionalEven", 2},
+      {"SpacingFractionalOdd", 3}, {"VertexOrderCw", 4}, {"VertexOrderCcw", 5},
+      {"PixelCenterInteger", 6}, {"OriginUpperLeft", 7}, {"OriginLowerLeft", 8},
+      {"EarlyFragmentTests", 9}, {"PointMode", 10}, {"Xfb", 11}, {"DepthReplacing", 12},
+      {"DepthGreater", 14}, {"DepthLess", 15}, {"DepthUnchanged", 16}, {"LocalSize", 17},
+      {"LocalSizeHint", 18}, {"InputPoints", 19}, {"InputLines", 20}, {"InputLinesAdjacency", 21},
+      {"Triangles", 22}, {"InputTrianglesAdjacency", 23}, {"Quads", 24}, {"Isolines", 25},
+      {"OutputVertices", 26}, {"OutputPoints", 27}, {"OutputLineStrip", 28},
+      {"OutputTriangleStrip", 29}, {"VecTypeHint", 30}, {"ContractionOff", 31},
+      {"Initializer", 33}, {"Finalizer", 34}, {"SubgroupSize", 35}, {"SubgroupsPerWorkgroup", 36},
+      {"SubgroupsPerWorkgroupId", 37}, {"LocalSizeId", 38}, {"LocalSizeHintId", 39}
+    };
+
+    const std::vector<SEnumerant> storage_classes = {
+      {"UniformConstant", 0}, {"Input", 1}, {"Uniform", 2}, {"Output", 3}, {"Workgroup", 4},
+      {"CrossWorkgroup", 5}, {"Private", 6}, {"Function", 7}, {"Generic", 8}, {"PushConstant", 9},
+      {"AtomicCounter", 10}, {"Image", 11}, {"StorageBuffer", 12}, {"PhysicalStorageBuffer", 5349}
+    };
+
+    const std::vector<SEnumerant> dims = {
+      {"1D", 0}, {"2D", 1}, {"3D", 2}, {"Cube", 3}, {"Rect", 4}, {"Buffer", 5}, {"SubpassData", 6}
+    };
+
+    const std::vector<SEnumerant> sampler_addressing_modes = {
+      {"None", 0}, {"ClampToEdge", 1}, {"Clamp", 2}, {"Repeat", 3}, {"RepeatMirrored", 4}
+    };
+
+    const std::vector<SEnumerant> sampler_filter_modes = {
+      {"Nearest", 0}, {"Linear", 1}
+    };
+
+    const std::vector<SEnumerant> image_formats = {
+      {"Unknown", 0}, {"Rgba32f", 1}, {"Rgba16f", 2}, {"R32f", 3}, {"Rgba8", 4}, {"Rgba8Snorm", 5},
+      {"Rg32f", 6}, {"Rg16f", 7}, {"R11fG11fB10f", 8}, {"R16f", 9}, {"Rgba16", 10}, {"Rgb10A2", 11},
+      {"Rg16", 12}, {"Rg8", 13}, {"R16", 14}, {"R8", 15}, {"Rgba16Snorm", 16}, {"Rg16Snorm", 17},
+      {"Rg8Snorm", 18}, {"R16Snorm", 19}, {"R8Snorm", 20}, {"Rgba32i", 21}, {"Rgba16i", 22},
+      {"Rgba8i", 23}, {"R32i", 24}, {"Rg32i", 25}, {"Rg16i", 26}, {"Rg8i", 27}, {"R16i", 28},
+      {"R8i", 29}, {"Rgba32ui", 30}, {"Rgba16ui", 31}, {"Rgba8ui", 32}, {"R32ui", 33},
+      {"Rgb10a2ui", 34}, {"Rg32ui", 35}, {"Rg16ui", 36}, {"Rg8ui", 37}, {"R16ui", 38}, {"R8ui", 39}
+    };
+
+    const std::vector<SEnumerant> access_qualifiers = {
+      {"ReadOnly", 0}, {"WriteOnly", 1}, {"ReadWrite", 2}
+    };
+
+    const std::vector<SEnumerant> decorations = {
+      {"RelaxedPrecision", 0}, {"SpecId", 1}, {"Block", 2}, {"BufferBlock", 3}, {"RowMajor", 4},
+      {"ColMajor", 5}, {"ArrayStride", 6}, {"MatrixStride", 7}, {"GLSLShared", 8},
+      {"GLSLPacked", 9}, {"CPacked", 10}, {"BuiltIn", 11}, {"NoPerspective", 13}, {"Flat", 14},
+      {"Patch", 15}, {"Centroid", 16}, {"Sample", 17}, {"Invariant", 18}, {"Restrict", 19},
+      {"Aliased", 20}, {"Volatile", 21}, {"Constant", 22}, {"Coherent", 23}, {"NonWritable", 24},
+      {"NonReadable", 25}, {"Uniform", 26}, {"UniformId", 27}, {"SaturatedConversion", 28},
+      {"Stream", 29}, {"Location", 30}, {"Component", 31}, {"Index", 32}, {"Binding", 33},
+      {"DescriptorSet", 34}, {"Offset", 35}, {"XfbBuffer", 36}, {"XfbStride", 37},
+      {"FuncParamAttr", 38}, {"FPRoundingMode", 39}, {"FPFastMathMode", 40},
+      {"LinkageAttributes", 41}, {"NoContraction", 42}, {"InputAttachmentIndex", 43},
+      {"Alignment", 44}, {"MaxByteOffset", 45}, {"AlignmentId", 46}, {"MaxByteOffsetId", 47},
+      {"CounterBuffer", 5634}, {"UserSemantic", 5635}
+    };
+
+    const std::vector<SEnumerant> builtins = {
+      {"Position", 0}, {"PointSize", 1}, {"ClipDistance", 3}, {"CullDistance", 4}, {"VertexId", 5},
+      {"InstanceId", 6}, {"PrimitiveId", 7}, {"InvocationId", 8}, {"Layer", 9},
+      {"ViewportIndex", 10}, {"TessLevelOuter", 11}, {"TessLevelInner", 12}, {"TessCoord", 13},
+      {"PatchVertices", 14}, {"FragCoord", 15}, {"PointCoord", 16}, {"FrontFacing", 17},
+      {"SampleId", 18}, {"SamplePosition", 19}, {"SampleMask", 20}, {"FragDepth", 22},
+      {"HelperInvocation", 23}, {"NumWorkgroups", 24}, {"WorkgroupSize", 25}, {"WorkgroupId", 26},
+      {"LocalInvocationId", 27}, {"GlobalInvocationId", 28}, {"LocalInvocationIndex", 29},
+      {"WorkDim", 30}, {"GlobalSize", 31}, {"EnqueuedWorkgroupSize", 32}, {"GlobalOffset", 33},
+      {"GlobalLinearId", 34}, {"SubgroupSize", 36}, {"SubgroupMaxSize", 37}, {"NumSubgroups", 38},
+      {"NumEnqueuedSubgroups", 39}, {"SubgroupId", 40}, {"SubgroupLocalInvocationId", 41},
+      {"VertexIndex", 42}, {"InstanceIndex", 43}, {"BaseVertex", 4424}, {"BaseInstance", 4425},
+      {"DrawIndex", 4426}, {"DeviceIndex", 4438}, {"ViewIndex", 4440}
+    };
+
+    const std::vector<SEnumerant> capabilities = {
+      {"Matrix", 0}, {"Shader", 1}, {"Geometry", 2}, {"Tessellation", 3}, {"Addresses", 4},
+      {"Linkage", 5}, {"Kernel", 6}, {"Vector16", 7}, {"Float16Buffer", 8}, {"Float16", 9},
+      {"Float64", 10}, {"Int64", 11}, {"Int64Atomics", 12}, {"ImageBasic", 13},
+      {"ImageReadWrite", 14}, {"ImageMipmap", 15}, {"Pipes", 17}, {"Groups", 18},
+      {"DeviceEnqueue", 19}, {"LiteralSampler", 20}, {"AtomicStorage", 21}, {"Int16", 22},
+      {"TessellationPointSize", 23}, {"GeometryPointSize", 24}, {"ImageGatherExtended", 25},
+      {"StorageImageMultisample", 27}, {"UniformBufferArrayDynamicIndexing", 28},
+      {"SampledImageArrayDynamicIndexing", 29}, {"StorageBufferArrayDynamicIndexing", 30},
+      {"StorageImageArrayDynamicIndexing", 31}, {"ClipDistance", 32}, {"CullDistance", 33},
+      {"ImageCubeArray", 34}, {"SampleRateShading", 35}, {"ImageRect", 36}, {"SampledRect", 37},
+      {"GenericPointer", 38}, {"Int8", 39}, {"InputAttachment", 40}, {"SparseResidency", 41},
+      {"MinLod", 42}, {"Sampled1D", 43}, {"Image1D", 44}, {"SampledCubeArray", 45},
+      {"SampledBuffer", 46}, {"ImageBuffer", 47}, {"ImageMSArray", 48},
+      {"StorageImageExtendedFormats", 49}, {"ImageQuery", 50}, {"DerivativeControl", 51},
+      {"InterpolationFunction", 52}, {"TransformFeedback", 53}, {"GeometryStreams", 54},
+      {"StorageImageReadWithoutFormat", 55}, {"StorageImageWriteWithoutFormat", 56},
+      {"MultiViewport", 57}, {"SubgroupDispatch", 58}, {"NamedBarrier", 59}, {"PipeStorage", 60},
+      {"GroupNonUniform", 61}, {"DrawParameters", 4427}, {"StorageBuffer16BitAccess", 4433},
+      {"VariablePointersStorageBuffer", 4441}, {"VariablePointers", 4442},
+      {"VulkanMemoryModel", 5345}, {"PhysicalStorageBufferAddresses", 5347}
+    };
+
+    const std::vector<SEnumerant> group_operations = {
+      {"Reduce", 0}, {"InclusiveScan", 1}, {"ExclusiveScan", 2}
+    };
+
+    const std::vector<SEnumerant> function_control = {
+      {"Inline", 0x1}, {"DontInline", 0x2}, {"Pure", 0x4}, {"Const", 0x8}
+    };
+
+    const std::vector<SEnumerant> selection_control = {
+      {"Flatten", 0x1}, {"DontFlatten", 0x2}
+    };
+
+    const std::vector<SEnumerant> loop_control = {
+      {"Unroll", 0x1}, {"DontUnroll", 0x2}, {"DependencyInfinite", 0x4}, {"DependencyLength", 0x8},
+      {"MinIterations", 0x10}, {"MaxIterations", 0x20}, {"IterationMultiple", 0x40},
+      {"PeelCount", 0x80}, {"PartialCount", 0x100}
+    };
+
+    const std::vector<SEnumerant> memory_access = {
+      {"Volatile", 0x1}, {"Aligned", 0x2}, {"Nontemporal", 0x4}, {"MakePointerAvailable", 0x8},
+      {"MakePointerVisible", 0x10}, {"NonPrivatePointer", 0x20}
+    };
+
+    const std::vector<SEnumerant> image_operands = {
+      {"Bias", 0x1}, {"Lod", 0x2}, {"Grad", 0x4}, {"ConstOffset", 0x8}, {"Offset", 0x10},
+      {"ConstOffsets", 0x20}, {"Sample", 0x40}, {"MinLod", 0x80}, {"MakeTexelAvailable", 0x100},
+      {"MakeTexelVisible", 0x200}, {"NonPrivateTexel", 0x400}, {"VolatileTexel", 0x800},
+      {"SignExtend", 0x1000}, {"ZeroExtend", 0x2000}
+    };
+
+    const std::vector<SEnumerant> no_enumerants;
+
+    // Indexed by instruction number, starting at 1
+    const char* const glsl_instruction_names[] = {
+      "Round", "RoundEven", "Trunc", "FAbs", "SAbs", "FSign", "SSign", "Floor", "Ceil", "Fract",
+      "Radians", "Degrees", "Sin", "Cos", "Tan", "Asin", "Acos", "Atan", "Sinh", "Cosh", "Tanh",
+      "Asinh", "Acosh", "Atanh", "Atan2", "Pow", "Exp", "Log", "Exp2", "Log2", "Sqrt",
+      "InverseSqrt", "Determinant", "MatrixInverse", "Modf", "ModfStruct", "FMin", "UMin", "SMin",
+      "FMax", "UMax", "SMax", "FClamp", "UClamp", "SClamp", "FMix", "IMix", "Step", "SmoothStep",
+      "Fma", "Frexp", "FrexpStruct", "Ldexp", "PackSnorm4x8", "PackUnorm4x8", "PackSnorm2x16",
+      "PackUnorm2x16", "PackHalf2x16", "PackDouble2x32", "UnpackSnorm2x16", "UnpackUnorm2x16",
+      "UnpackHalf2x16", "UnpackSnorm4x8", "UnpackUnorm4x8", "UnpackDouble2x32", "Length",
+      "Distance", "Cross", "Normalize", "FaceForward", "Reflect", "Refract", "FindILsb",
+      "FindSMsb", "FindUMsb", "InterpolateAtCentroid", "InterpolateAtSample",
+      "InterpolateAtOffset", "NMin", "NMax", "NClamp"
+    };
+    const uint32_t num_glsl_instructions = sizeof(glsl_instruction_names) / sizeof(glsl_instruction_names[0]);
+
+    bool name_equals(const char* a, const char* b, size_t len) {
+      return strncmp(a, b, len) == 0 && a[len] == '\0';
+    }
+  };
+
+  bool SInstructionSet::getOpcode(const char* name, size_t len, uint32_t* opcode) {
+    if(lookup_table.size() == 0) {
+      initialize();
+    }
+
+    // Only used when assembling text, where a linear scan is not the bottleneck
+    for(const SInstructionInfo& info : infos) {
+      if(name_equals(info.name, name, len)) {
+	*opcode = info.opcode;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  bool SInstructionSet::isMaskKind(SOperandKind kind) {
+    return kind == OPERAND_FUNCTION_CONTROL || kind == OPERAND_SELECTION_CONTROL ||
+      kind == OPERAND_LOOP_CONTROL || kind == OPERAND_OPTIONAL_MEMORY_ACCESS ||
+      kind == OPERAND_IMAGE_OPERANDS || kind == OPERAND_OPTIONAL_IMAGE_OPERANDS;
+  }
+
+  const std::vector<SEnumerant>& SInstructionSet::getEnumerants(SOperandKind kind) {
+    switch(kind) {
+    case OPERAND_SOURCE_LANGUAGE: return source_languages;
+    case OPERAND_EXECUTION_MODEL: return execution_models;
+    case OPERAND_ADDRESSING_MODEL: return addressing_models;
+    case OPERAND_MEMORY_MODEL: return memory_models;
+    case OPERAND_EXECUTION_MODE: return execution_modes;
+    case OPERAND_STORAGE_CLASS: return storage_classes;
+    case OPERAND_DIM: return dims;
+    case OPERAND_SAMPLER_ADDRESSING_MODE: return sampler_addressing_modes;
+    case OPERAND_SAMPLER_FILTER_MODE: return sampler_filter_modes;
+    case OPERAND_IMAGE_FORMAT: return image_formats;
+    case OPERAND_ACCESS_QUALIFIER:
+    case OPERAND_OPTIONAL_ACCESS_QUALIFIER: return access_qualifiers;
+    case OPERAND_DECORATION: return decorations;
+    case OPERAND_BUILTIN: return builtins;
+    case OPERAND_CAPABILITY: return capabilities;
+    case OPERAND_GROUP_OPERATION: return group_operations;
+    case OPERAND_FUNCTION_CONTROL: return function_control;
+    case OPERAND_SELECTION_CONTROL: return selection_control;
+    case OPERAND_LOOP_CONTROL: return loop_control;
+    case OPERAND_OPTIONAL_MEMORY_ACCESS: return memory_access;
+    case OPERAND_IMAGE_OPERANDS:
+    case OPERAND_OPTIONAL_IMAGE_OPERANDS: return image_operands;
+    default: return no_enumerants;
+    }
+  }
+
+  const char* SInstructionSet::getEnumName(SOperandKind kind, uint32_t value) {
+    for(const SEnumerant& e : SInstructionSet::getEnumerants(kind)) {
+      if(e.value == value) {
+	return e.name;
+      }
+    }
+    return nullptr;
+  }
+
+  bool SInstructionSet::getEnumValue(SOperandKind kind, const char* name, size_t len, uint32_t* value) {
+    if(SInstructionSet::isMaskKind(kind) && name_equals("None", name, len)) {
+      *value = 0;
+      return true;
+    }
+
+    for(const SEnumerant& e : SInstructionSet::getEnumerants(kind)) {
+      if(name_equals(e.name, name, len)) {
+	*value = e.value;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  const char* SInstructionSet::getGLSLInstructionName(uint32_t number) {
+    if(number == 0 || number > num_glsl_instructions) {
+      return nullptr;
+    }
+    return glsl_instruction_names[number - 1];
+  }
+
+  bool SInstructionSet::getGLSLInstructionNumber(const char* name, size_t len, uint32_t* number) {
+    for(uint32_t i = 0; i < num_glsl_instructions; i++) {
+      if(name_equals(glsl_instruction_names[i], name, len)) {
+	*number = i + 1;
+	return true;
+      }
+    }
+    return false;
+  }
+};
@@ -0,0 +1,159 @@
+#ifndef __SPURV_INSTRUCTION_SET
+#define __SPURV_INSTRUCTION_SET
+
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+
+namespace spurv {
+
+  /*
+   * SOperandKind - The kinds of operands an instruction may have (after result type and result id)
+   */
+
+  enum SOperandKind {
+    OPERAND_ID,
+    OPERAND_LITERAL,
+    OPERAND_STRING,
+    OPERAND_OPTIONAL_ID,
+    OPERAND_OPTIONAL_LITERAL,
+    OPERAND_OPTIONAL_STRING,
+
+    // These consume the rest of the instruction
+    OPERAND_VARIABLE_IDS,
+    OPERAND_VARIABLE_LITERALS,
+    OPERAND_VARIABLE_STRINGS,
+    OPERAND_VARIABLE_LITERAL_ID, // Pairs of <literal> <id> (OpSwitch)
+    OPERAND_VARIABLE_ID_LITERAL, // Pairs of <id> <literal> (OpGroupMemberDecorate)
+
+    // Enumerants, one word each
+    OPERAND_SOURCE_LANGUAGE,
+    OPERAND_EXECUTION_MODEL,
+    OPERAND_ADDRESSING_MODEL,
+    OPERAND_MEMORY_MODEL,
+    OPERAND_EXECUTION_MODE,
+    OPERAND_STORAGE_CLASS,
+    OPERAND_DIM,
+    OPERAND_SAMPLER_ADDRESSING_MODE,
+    OPERAND_SAMPLER_FILTER_MODE,
+    OPERAND_IMAGE_FORMAT,
+    OPERAND_ACCESS_QUALIFIER,
+    OPERAND_OPTIONAL_ACCESS_QUALIFIER,
+    OPERAND_DECORATION,
+    OPERAND_BUILTIN,
+    OPERAND_CAPABILITY,
+    OPERAND_GROUP_OPERATION,
+
+    // Bit masks, the set bits may pull in extra operands
+    OPERAND_FUNCTION_CONTROL,
+    OPERAND_SELECTION_CONTROL,
+    OPERAND_LOOP_CONTROL,
+    OPERAND_OPTIONAL_MEMORY_ACCESS,
+    OPERAND_IMAGE_OPERANDS,
+    OPERAND_OPTIONAL_IMAGE_OPERANDS,
+
+    OPERAND_END
+  };
+
+
+  /*
+   * SModuleSection - The sections of a module, in the order mandated by the logical layout
+   */
+
+  enum SModuleSection {
+    SECTION_CAPABILITY,
+    SECTION_EXTENSION,
+    SECTION_EXT_INST_IMPORT,
+    SECTION_MEMORY_MODEL,
+    SECTION_ENTRY_POINT,
+    SECTION_EXECUTION_MODE,
+    SECTION_DEBUG_STRING,
+    SECTION_DEBUG_NAME,
+    SECTION_DEBUG_MODULE_PROCESSED,
+    SECTION_ANNOTATION,
+    SECTION_DECLARATION,
+    SECTION_FUNCTION,
+    SECTION_ANY // OpLine, OpNoLine, OpNop and the like may appear in several sections
+  };
+
+
+  /*
+   * SInstructionInfo - Static information about a single opcode
+   */
+
+  struct SInstructionInfo {
+    uint32_t opcode;
+    const char* name;
+    bool has_type;
+    bool has_result;
+    SModuleSection section;
+    std::vector<SOperandKind> operands;
+  };
+
+
+  /*
+   * SEnumerant - Name of a value of an enumerated operand kind or of a mask bit
+   */
+
+  struct SEnumerant {
+    const char* name;
+    uint32_t value;
+  };
+
+
+  /*
+   * SDecodedOperand - One logical operand of an instruction, as found by SInstructionSet::decodeOperands
+   */
+
+  struct SDecodedOperand {
+    SOperandKind kind; // Parameters of enumerants and masks are reported as OPERAND_ID or OPERAND_LITERAL
+    int offset; // Index into the operand words (i.e. after result type and result id)
+    int num_words;
+  };
+
+
+  /*
+   * SInstructionSet - Lookup table for the instructions in the core SPIR-V grammar
+   * (the parts of it that spurv emits or that commonly show up in binaries from other tools)
+   */
+
+  class SInstructionSet {
+    static std::vector<SInstructionInfo> infos;
+    static std::vector<const SInstructionInfo*> lookup_table;
+
+    static void initialize();
+
+  public:
+
+    // Returns nullptr if the opcode is unknown
+    static const SInstructionInfo* getInfo(uint32_t opcode);
+
+    // Splits the operands of an instruction (after result type and result id) into
+    // logical operands. The result is appended to res, so that the vector may be reused.
+    // Returns false if the operands did not match the grammar
+    static bool decodeOperands(uint32_t opcode, const uint32_t* operands, int num_operands,
+			       std::vector<SDecodedOperand>& res);
+
+    // Number of extra operands taken by a set bit in the given mask kind, and whether they are ids
+    static int getMaskParameterCount(SOperandKind kind, uint32_t bit, bool* are_ids);
+
+    // Number of words occupied by a nul-terminated literal string, or -1 if it is not terminated
+    static int stringWordLength(const uint32_t* words, int max_words);
+
+    // Returns false if the name is not an opcode name (e.g. "OpLoad")
+    static bool getOpcode(const char* name, size_t len, uint32_t* opcode);
+
+    // Names of enumerants and mask bits. Optional kinds share the tables of the plain ones
+    static bool isMaskKind(SOperandKind kind);
+    static const std::vector<SEnumerant>& getEnumerants(SOperandKind kind);
+    static const char* getEnumName(SOperandKind kind, uint32_t value); // nullptr if unknown
+    static bool getEnumValue(SOperandKind kind, const char* name, size_t len, uint32_t* value);
+
+    // Names of the GLSL.std.450 extended instructions, as used with OpExtInst
+    static const char* getGLSLInstructionName(uint32_t number); // nullptr if unknown
+    static bool getGLSLInstructionNumber(const char* name, size_t len, uint32_t* number);
+  };
+
+};
+
+#endif // __SPURV_INSTRUCTION_SET
@@ -0,0 +1,199 @@
+#include "invariant_hoisting.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "dead_code_elimination.hpp"
+
+#include <algorithm>
+
+namespace spurv {
+
+  /*
+   * SInvariantHoister members
+   */
+
+  bool SInvariantHoister::enabled = true;
+
+  std::unordered_map<int, std::vector<int> > SInvariantHoister::hoisted;
+  std::unordered_set<int> SInvariantHoister::hoisted_events;
+
+  int SInvariantHoister::num_hoisted = 0;
+
+
+  /*
+   * SInvariantHoister member functions
+   */
+
+  bool SInvariantHoister::is_hoistable(const SNodeInfo& info, bool& uses_derivatives) {
+    uses_derivatives = false;
+
+    switch(info.kind) {
+    case NODE_EXPRESSION:
+      if(info.operation == EXPR_LOOKUP) {
+	// Textures are read-only. Their lookups are written with an explicit level of detail
+	SNodeInfo looked_up;
+	info.operands[0]->getNodeInfo(looked_up);
+	return looked_up.type.kind == STypeKind::KIND_MAT ||
+	  looked_up.type.kind == STypeKind::KIND_TEXTURE;
+      }
+
+      uses_derivatives = info.operation == EXPR_DPDX || info.operation == EXPR_DPDY;
+      return true;
+    case NODE_GLSL_FUNCTION:
+    case NODE_CONSTRUCT_MATRIX:
+      return true;
+    case NODE_LOAD:
+      {
+	SPointerInfo pointer;
+	info.pointer->getPointerInfo(pointer);
+	return pointer.storage == SStorageClass::STORAGE_UNIFORM ||
+	  pointer.storage == SStorageClass::STORAGE_UNIFORM_CONSTANT;
+      }
+    default:
+      // Selections may be written as branches, and the rest are not computed by themselves
+      return false;
+    }
+  }
+
+  int SInvariantHoister::operand_depth(const SNodeInfo& info,
+				       const std::unordered_map<const SValueBase*, int>& depths) {
+    std::vector<const SValueBase*> operands = info.operands;
+    if(info.kind == NODE_LOAD) {
+      SPointerInfo pointer;
+      info.pointer->getPointerInfo(pointer);
+      while(pointer.parent != nullptr) {
+	operands.push_back(pointer.index);
+	pointer.parent->getPointerInfo(pointer);
+      }
+    }
+
+    // Values not declared in live events (like constants and inputs) are computed outside all loops
+    int depth = 0;
+    for(const SValueBase* operand : operands) {
+      std::unordered_map<const SValueBase*, int>::const_iterator it = depths.find(operand);
+      if(it != depths.end()) {
+	depth = std::max(depth, it->second);
+      }
+    }
+
+    return depth;
+  }
+
+  void SInvariantHoister::analyze() {
+    SInvariantHoister::clear();
+    SInvariantHoister::num_hoisted = 0;
+
+    if(!SInvariantHoister::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    std::vector<SRegion> regions; // The if-statements and loops we are in
+    std::unordered_map<const SValueBase*, int> depths; // Number of loops each value is computed in
+    int loop_depth = 0;
+
+    SEventInfo ev;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_IF:
+	regions.push_back({false, (int)i, 0, false});
+	break;
+      case EVENT_END_IF:
+	regions.pop_back();
+	break;
+      case EVENT_FOR_BEGIN:
+	regions.push_back({true, (int)i, ev.iterations, false});
+	loop_depth++;
+	depths[ev.values[0]] = loop_depth;
+	break;
+      case EVENT_FOR_END:
+	regions.pop_back();
+	loop_depth--;
+	break;
+      case EVENT_BREAK:
+      case EVENT_CONTINUE:
+	for(SRegion& region : regions) {
+	  region.has_exit = true;
+	}
+	break;
+      case EVENT_DECLARATION:
+      case EVENT_LOAD:
+	{
+	  // Node infos are not reused here, as getDSType leaves the inner types of scalars as they were
+	  SNodeInfo info;
+	  ev.values[0]->getNodeInfo(info);
+	  if(info.kind == NODE_CONSTANT) {
+	    break;
+	  }
+
+	  bool uses_derivatives = false;
+	  int depth = loop_depth;
+	  int target = -1; // Region of the outermost loop to hoist out of
+	  if(SInvariantHoister::is_hoistable(info, uses_derivatives)) {
+	    int operands = SInvariantHoister::operand_depth(info, depths);
+
+	    for(int k = (int)regions.size() - 1; k >= 0; k--) {
+	      const SRegion& region = regions[k];
+	      if(!region.is_loop || operands >= depth ||
+		 (uses_derivatives && (region.has_exit || region.iterations <= 0))) {
+		break;
+	      }
+
+	      target = k;
+	      depth--;
+	    }
+	  }
+
+	  if(target >= 0) {
+	    SInvariantHoister::hoisted[regions[target].event_num].push_back(i);
+	    SInvariantHoister::hoisted_events.insert(i);
+	    SInvariantHoister::num_hoisted++;
+	  }
+	  depths[ev.values[0]] = depth;
+	}
+	break;
+      default:
+	break;
+      }
+    }
+  }
+
+  void SInvariantHoister::write_hoisted(std::vector<uint32_t>& bin, int event_num) {
+    std::unordered_map<int, std::vector<int> >::iterator it = SInvariantHoister::hoisted.find(event_num);
+    if(it == SInvariantHoister::hoisted.end()) {
+      return;
+    }
+
+    // In the order they were recorded, so that operands come first
+    for(int hoisted_event : it->second) {
+      SEventRegistry::events[hoisted_event]->ensure_written(bin);
+    }
+  }
+
+  bool SInvariantHoister::isHoisted(int event_num) {
+    return SInvariantHoister::hoisted_events.count(event_num);
+  }
+
+  void SInvariantHoister::clear() {
+    SInvariantHoister::hoisted.clear();
+    SInvariantHoister::hoisted_events.clear();
+  }
+
+  void SInvariantHoister::setEnabled(bool enabled) {
+    SInvariantHoister::enabled = enabled;
+  }
+
+  bool SInvariantHoister::isEnabled() {
+    return SInvariantHoister::enabled;
+  }
+
+  int SInvariantHoister::getNumHoisted() {
+    return SInvariantHoister::num_hoisted;
+  }
+
+};
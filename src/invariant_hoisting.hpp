@@ -0,0 +1,93 @@
+#ifndef __SPURV_INVARIANT_HOISTING
+#define __SPURV_INVARIANT_HOISTING
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SValueBase;
+  struct SNodeInfo;
+
+  /*
+   * SInvariantHoister - Computes values in for-loops that do not change between iterations
+   * once before the loop, instead of in every iteration (loop-invariant code motion).
+   *
+   * A value is hoisted out of a loop if it is an expression, GLSL function or construction
+   * on values computed outside the loop (or hoisted out of it), or a load from a uniform or
+   * uniform constant through such indices. Lookups into arrays and storage images are left
+   * in place, as they read memory that may be stored to. Only values in the top-level block
+   * of the loop body are hoisted, never out of if-statements, so nothing that is only
+   * computed under a condition is computed unconditionally. A value may be hoisted out of
+   * several nested loops at once.
+   *
+   * Operations relying on implicit derivatives (derivatives, and sampling with implicit
+   * level of detail) need the whole quad to compute them alike. They are only hoisted out
+   * of loops that run at least once and where no break or continue is recorded before
+   * them, so that every invocation reaching the loop would have computed them in its first
+   * iteration, as it now does in the preheader
+   */
+
+  class SInvariantHoister {
+    static bool enabled;
+
+    // Event numbers of the values hoisted, by the event beginning the loop they are hoisted out of
+    static std::unordered_map<int, std::vector<int> > hoisted;
+    static std::unordered_set<int> hoisted_events;
+
+    static int num_hoisted;
+
+    struct SRegion {
+      bool is_loop;
+      int event_num;
+      int iterations;
+      bool has_exit; // Whether a break or continue has been recorded in it so far
+    };
+
+    SInvariantHoister() = delete;
+
+    // Whether the value may be hoisted at all, and whether it relies on implicit derivatives
+    static bool is_hoistable(const SNodeInfo& info, bool& uses_derivatives);
+
+    // The loop depth at which the operands (or the indices, for loads) are computed
+    static int operand_depth(const SNodeInfo& info,
+			     const std::unordered_map<const SValueBase*, int>& depths);
+
+    // Finds the values to hoist among the live events in SEventRegistry. Expects
+    // SDeadCodeEliminator and SLocalPromoter to have analyzed them
+    static void analyze();
+
+    // Writes the values hoisted out of the loop begun by the given event. To be called
+    // before the loop is written
+    static void write_hoisted(std::vector<uint32_t>& bin, int event_num);
+
+    // Whether the value declared or loaded by the event is hoisted out of a loop
+    static bool isHoisted(int event_num);
+
+    static void clear();
+
+    friend class SForBeginEvent;
+    friend class SCodeSinker;
+    friend class SGraphExporter;
+    friend class SPassManager;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Hoisting is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of values hoisted out of loops in the last compiled shader
+    static int getNumHoisted();
+  };
+
+};
+
+#endif // __SPURV_INVARIANT_HOISTING
@@ -0,0 +1,153 @@
+#include "load_elimination.hpp"
+#include "dead_code_elimination.hpp"
+#include "node_cache_impl.hpp"
+#include "pointers.hpp"
+#include "trace.hpp"
+
+namespace spurv {
+
+  /*
+   * SLoadEliminator members
+   */
+
+  bool SLoadEliminator::enabled = true;
+
+  std::unordered_map<SNodeKey, SPointerBase*, SNodeKeyHash> SLoadEliminator::chains;
+  std::unordered_set<const SPointerBase*> SLoadEliminator::hoisted_chains;
+  std::vector<SPointerBase*> SLoadEliminator::chain_order;
+
+  int SLoadEliminator::loads_reused = 0;
+  int SLoadEliminator::chains_reused = 0;
+  int SLoadEliminator::num_loads_reused = 0;
+  int SLoadEliminator::num_chains_reused = 0;
+  int SLoadEliminator::loads_missed = 0;
+  int SLoadEliminator::chains_missed = 0;
+
+
+  /*
+   * SLoadEliminator member functions
+   */
+
+  bool SLoadEliminator::isHoisted(const SPointerBase* chain) {
+    return SLoadEliminator::hoisted_chains.count(chain);
+  }
+
+  void SLoadEliminator::write_chains(std::vector<uint32_t>& bin) {
+    for(SPointerBase* chain : SLoadEliminator::chain_order) {
+      if(SDeadCodeEliminator::isPointerLive(chain->getID())) {
+	chain->ensure_defined(bin);
+      }
+    }
+  }
+
+  void SLoadEliminator::trace(const std::string& shader) {
+    STrace::addCounter("load eliminator", "cache", shader, STrace::now(),
+		       { {"loads reused", SLoadEliminator::loads_reused},
+			 {"loads missed", SLoadEliminator::loads_missed},
+			 {"chains reused", SLoadEliminator::chains_reused},
+			 {"chains missed", SLoadEliminator::chains_missed} });
+  }
+
+  void SLoadEliminator::clear() {
+    SLoadEliminator::chains.clear();
+    SLoadEliminator::hoisted_chains.clear();
+    SLoadEliminator::chain_order.clear();
+
+    SLoadEliminator::num_loads_reused = SLoadEliminator::loads_reused;
+    SLoadEliminator::num_chains_reused = SLoadEliminator::chains_reused;
+    SLoadEliminator::loads_reused = 0;
+    SLoadEliminator::chains_reused = 0;
+    SLoadEliminator::loads_missed = 0;
+    SLoadEliminator::chains_missed = 0;
+  }
+
+  void SLoadEliminator::setEnabled(bool enabled) {
+    SLoadEliminator::enabled = enabled;
+  }
+
+  bool SLoadEliminator::isEnabled() {
+    return SLoadEliminator::enabled;
+  }
+
+  int SLoadEliminator::getNumLoadsReused() {
+    return SLoadEliminator::num_loads_reused;
+  }
+
+  int SLoadEliminator::getNumChainsReused() {
+    return SLoadEliminator::num_chains_reused;
+  }
+
+  std::vector<int> SLoadEliminator::getPath(const SPointerBase* pointer) {
+    std::vector<int> path;
+    SPointerInfo info;
+    SNodeInfo index_info;
+    while(pointer != nullptr) {
+      pointer->getPointerInfo(info);
+      if(info.parent) {
+	info.index->getNodeInfo(index_info);
+	path.push_back(index_info.id);
+      } else {
+	path.push_back(info.id);
+      }
+      pointer = info.parent;
+    }
+
+    return std::vector<int>(path.rbegin(), path.rend());
+  }
+
+  void* SLoadEliminator::findLoad(const SNodeKey& key, SStorageClass storage) {
+    if(!SLoadEliminator::enabled) {
+      return nullptr;
+    }
+
+    // Only storage buffers can be stored to
+    void* load = SNodeCache::find<void>(key, storage == SStorageClass::STORAGE_STORAGE_BUFFER);
+    if(load) {
+      SLoadEliminator::loads_reused++;
+    } else {
+      SLoadEliminator::loads_missed++;
+    }
+    return load;
+  }
+
+  void SLoadEliminator::insertLoad(const SNodeKey& key, void* load, SStorageClass storage) {
+    if(!SLoadEliminator::enabled) {
+      return;
+    }
+
+    SNodeCache::insert(key, load, storage == SStorageClass::STORAGE_STORAGE_BUFFER);
+  }
+
+  bool SLoadEliminator::isHoistable(const SPointerBase* parent, const SValueBase& index) {
+    if(!SLoadEliminator::enabled || !SNodeCache::isEnabled()) {
+      return false;
+    }
+
+    SPointerInfo parent_info;
+    parent->getPointerInfo(parent_info);
+
+    SNodeInfo index_info;
+    index.getNodeInfo(index_info);
+
+    return (parent_info.parent == nullptr || SLoadEliminator::isHoisted(parent)) &&
+      index_info.kind == NODE_CONSTANT;
+  }
+
+  SPointerBase* SLoadEliminator::findChain(const SNodeKey& key) {
+    std::unordered_map<SNodeKey, SPointerBase*, SNodeKeyHash>::iterator it = SLoadEliminator::chains.find(key);
+    if(it == SLoadEliminator::chains.end()) {
+      SLoadEliminator::chains_missed++;
+      return nullptr;
+    }
+
+    SLoadEliminator::chains_reused++;
+    return it->second;
+  }
+
+  void SLoadEliminator::insertChain(const SNodeKey& key, SPointerBase* chain) {
+    SLoadEliminator::chains[key] = chain;
+    SLoadEliminator::hoisted_chains.insert(chain);
+    SLoadEliminator::chain_order.push_back(chain);
+  }
+
+};
@@ -0,0 +1,108 @@
+#ifndef __SPURV_LOAD_ELIMINATION
+#define __SPURV_LOAD_ELIMINATION
+
+#include "declarations.hpp"
+#include "node_cache.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SPointerBase;
+  class SValueBase;
+
+  /*
+   * SLoadEliminator - Reuses loads from uniforms, uniform constants (like textures) and
+   * storage buffers, and the access chains into them, instead of writing them again every
+   * time the same member is read.
+   *
+   * A load is keyed by the variable and the ids of the indices leading to the loaded
+   * member, so loads through different chains with the same indices are shared. Loads
+   * from uniforms and uniform constants, which are read-only, are reused wherever they
+   * are known to have been written (see SNodeCache). Loads from storage buffers are in
+   * addition only reused in their own scope, as long as no store has been recorded since.
+   *
+   * Access chains with constant indices only, into one of these variables, are shared as
+   * well. They are written at the start of the function, so that they are available in
+   * every block using them
+   */
+
+  class SLoadEliminator {
+    static bool enabled;
+
+    static std::unordered_map<SNodeKey, SPointerBase*, SNodeKeyHash> chains;
+    static std::unordered_set<const SPointerBase*> hoisted_chains;
+    static std::vector<SPointerBase*> chain_order; // Hoisted chains, in the order they were created
+
+    // Counted while recording, and kept for the statistics when the shader is compiled
+    static int loads_reused;
+    static int chains_reused;
+    static int num_loads_reused;
+    static int num_chains_reused;
+
+    // Lookups of loads and chains that found none, for the trace
+    static int loads_missed;
+    static int chains_missed;
+
+    SLoadEliminator() = delete;
+
+    // Whether the chain is shared and written at the start of the function
+    static bool isHoisted(const SPointerBase* chain);
+
+    // Writes the live hoisted chains. To be called after the variable definitions of the function
+    static void write_chains(std::vector<uint32_t>& bin);
+
+    // Adds the loads and chains reused and missed in the shader being compiled to the
+    // trace, see STrace
+    static void trace(const std::string& shader);
+
+    // Also keeps the statistics of the shader just compiled
+    static void clear();
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+    template<typename tt, SStorageClass storage>
+    friend class SAccessChain;
+
+    friend class SPassManager;
+    friend class SFunctionBase;
+
+  public:
+
+    // Elimination is on by default, and needs SNodeCache to be enabled as well
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Numbers of loads and access chains reused in the last compiled shader
+    static int getNumLoadsReused();
+    static int getNumChainsReused();
+
+    // For the pointers
+
+    static constexpr bool isEliminated(SStorageClass storage) {
+      return storage == SStorageClass::STORAGE_UNIFORM ||
+	storage == SStorageClass::STORAGE_UNIFORM_CONSTANT ||
+	storage == SStorageClass::STORAGE_STORAGE_BUFFER;
+    }
+
+    // The ids of the variable and the indices leading to the pointed-to member
+    static std::vector<int> getPath(const SPointerBase* pointer);
+
+    static void* findLoad(const SNodeKey& key, SStorageClass storage);
+    static void insertLoad(const SNodeKey& key, void* load, SStorageClass storage);
+
+    // Whether a chain into parent with the given index can be hoisted and shared
+    static bool isHoistable(const SPointerBase* parent, const SValueBase& index);
+
+    static SPointerBase* findChain(const SNodeKey& key);
+    static void insertChain(const SNodeKey& key, SPointerBase* chain);
+  };
+
+};
+
+#endif // __SPURV_LOAD_ELIMINATION
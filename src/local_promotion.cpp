@@ -0,0 +1,339 @@
+#include "local_promotion.hpp"
+#include "event_registry.hpp"
+#include "variable_registry.hpp"
+#include "pointers.hpp"
+#include "dead_code_elimination.hpp"
+#include "utils.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace spurv {
+
+  /*
+   * SLocalPromoter members
+   */
+
+  bool SLocalPromoter::enabled = true;
+  bool SLocalPromoter::analyzed = false;
+
+  std::unordered_map<int, int> SLocalPromoter::indices;
+  std::vector<int> SLocalPromoter::pointer_ids;
+  std::vector<bool> SLocalPromoter::needs_undef;
+  std::unordered_set<int> SLocalPromoter::iterators;
+  std::unordered_map<int, std::vector<bool> > SLocalPromoter::loop_stores;
+
+  int SLocalPromoter::num_promoted = 0;
+
+  std::vector<uint32_t> SLocalPromoter::values;
+  std::vector<int> SLocalPromoter::type_ids;
+  std::unordered_map<int, std::vector<SLocalPromoter::SEdge> > SLocalPromoter::edges;
+  std::unordered_map<int, std::vector<SLocalPromoter::SBackEdgeOperand> > SLocalPromoter::back_edges;
+
+  unsigned int SLocalPromoter::scan_position = 0;
+  int SLocalPromoter::current_block = -1;
+
+
+  /*
+   * SLocalPromoter member functions
+   */
+
+  const SPointerBase* SLocalPromoter::root(const SPointerBase* pointer) {
+    SPointerInfo info;
+    pointer->getPointerInfo(info);
+    while(info.parent != nullptr) {
+      pointer = info.parent;
+      pointer->getPointerInfo(info);
+    }
+
+    return pointer;
+  }
+
+  void SLocalPromoter::analyze() {
+    SLocalPromoter::clear();
+    SLocalPromoter::num_promoted = 0;
+
+    if(!SLocalPromoter::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // Locals indexed into through access chains stay in memory
+    std::unordered_set<int> escaping;
+    SEventInfo ev;
+    SNodeInfo node;
+    SPointerInfo pointer;
+    for(const STimeEventBase* event : events) {
+      event->getEventInfo(ev);
+
+      const SPointerBase* accessed = nullptr;
+      if(ev.kind == EVENT_STORE) {
+	accessed = ev.pointer;
+      } else if(ev.kind == EVENT_LOAD) {
+	ev.values[0]->getNodeInfo(node);
+	accessed = node.pointer;
+      } else if(ev.kind == EVENT_FOR_BEGIN) {
+	ev.pointer->getPointerInfo(pointer);
+	SLocalPromoter::iterators.insert(pointer.id);
+      }
+
+      if(accessed != nullptr && accessed != SLocalPromoter::root(accessed)) {
+	SLocalPromoter::root(accessed)->getPointerInfo(pointer);
+	escaping.insert(pointer.id);
+      }
+    }
+
+    for(SVariableEntryBase* variable : SVariableRegistry::variables) {
+      int id = variable->getPointerID();
+      if(!escaping.count(id) && !SLocalPromoter::iterators.count(id)) {
+	SLocalPromoter::indices[id] = SLocalPromoter::pointer_ids.size();
+	SLocalPromoter::pointer_ids.push_back(id);
+      }
+    }
+
+    int num_locals = SLocalPromoter::pointer_ids.size();
+    SLocalPromoter::num_promoted = num_locals + SLocalPromoter::iterators.size();
+
+    // Locals first accessed by anything but a store outside all control structures may
+    // be loaded before they are stored. Only live events are written, so only they count
+    std::vector<bool> accessed(num_locals, false);
+    SLocalPromoter::needs_undef.assign(num_locals, false);
+
+    std::vector<int> loops; // Iterators of the loops we are in
+    int depth = 0;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_IF:
+	depth++;
+	break;
+      case EVENT_END_IF:
+	depth--;
+	break;
+      case EVENT_FOR_BEGIN:
+	ev.pointer->getPointerInfo(pointer);
+	loops.push_back(pointer.id);
+	SLocalPromoter::loop_stores[pointer.id].assign(num_locals, false);
+	depth++;
+	break;
+      case EVENT_FOR_END:
+	loops.pop_back();
+	depth--;
+	break;
+      case EVENT_LOAD:
+      case EVENT_STORE:
+	{
+	  const SPointerBase* p = ev.pointer;
+	  if(ev.kind == EVENT_LOAD) {
+	    ev.values[0]->getNodeInfo(node);
+	    p = node.pointer;
+	  }
+	  p->getPointerInfo(pointer);
+
+	  std::unordered_map<int, int>::iterator it = SLocalPromoter::indices.find(pointer.id);
+	  if(it == SLocalPromoter::indices.end()) {
+	    break;
+	  }
+
+	  if(!accessed[it->second]) {
+	    accessed[it->second] = true;
+	    SLocalPromoter::needs_undef[it->second] = ev.kind == EVENT_LOAD || depth > 0;
+	  }
+
+	  if(ev.kind == EVENT_STORE) {
+	    for(int loop : loops) {
+	      SLocalPromoter::loop_stores[loop][it->second] = true;
+	    }
+	  }
+	}
+	break;
+      default:
+	break;
+      }
+    }
+
+    SLocalPromoter::analyzed = true;
+  }
+
+  bool SLocalPromoter::isPromoted(int pointer_id) {
+    return SLocalPromoter::analyzed &&
+      (SLocalPromoter::indices.count(pointer_id) || SLocalPromoter::iterators.count(pointer_id));
+  }
+
+  void SLocalPromoter::write_initial_values(std::vector<uint32_t>& bin, unsigned int function_start) {
+    SLocalPromoter::scan_position = function_start;
+    SLocalPromoter::current_block = -1;
+
+    if(!SLocalPromoter::analyzed) {
+      return;
+    }
+
+    // The types are defined by now
+    SLocalPromoter::type_ids.assign(SLocalPromoter::pointer_ids.size(), 0);
+    for(SVariableEntryBase* variable : SVariableRegistry::variables) {
+      std::unordered_map<int, int>::iterator it = SLocalPromoter::indices.find(variable->getPointerID());
+      if(it != SLocalPromoter::indices.end()) {
+	SLocalPromoter::type_ids[it->second] = variable->getTypeID();
+      }
+    }
+
+    SLocalPromoter::values.assign(SLocalPromoter::pointer_ids.size(), 0);
+    for(unsigned int i = 0; i < SLocalPromoter::pointer_ids.size(); i++) {
+      if(SLocalPromoter::needs_undef[i]) {
+	SLocalPromoter::values[i] = SUtils::getNewID();
+
+	// OpUndef <result_type> <result_id>
+	SUtils::add(bin, (3 << 16) | 1);
+	SUtils::add(bin, SLocalPromoter::type_ids[i]);
+	SUtils::add(bin, SLocalPromoter::values[i]);
+      }
+    }
+  }
+
+  int SLocalPromoter::block(const std::vector<uint32_t>& bin) {
+    while(SLocalPromoter::scan_position < bin.size()) {
+      uint32_t word = bin[SLocalPromoter::scan_position];
+
+      // OpLabel
+      if((word & 0xffff) == 248) {
+	SLocalPromoter::current_block = bin[SLocalPromoter::scan_position + 1];
+      }
+
+      SLocalPromoter::scan_position += word >> 16;
+    }
+
+    return SLocalPromoter::current_block;
+  }
+
+  uint32_t SLocalPromoter::load(int pointer_id) {
+    int index = SLocalPromoter::indices[pointer_id];
+    if(SLocalPromoter::values[index] == 0) {
+      printf("[spurv::SLocalPromoter] Local %d was loaded without a value\n", pointer_id);
+      exit(-1);
+    }
+
+    return SLocalPromoter::values[index];
+  }
+
+  void SLocalPromoter::store(int pointer_id, uint32_t value_id) {
+    SLocalPromoter::values[SLocalPromoter::indices[pointer_id]] = value_id;
+  }
+
+  void SLocalPromoter::branch(std::vector<uint32_t>& bin, int target) {
+    if(!SLocalPromoter::analyzed) {
+      return;
+    }
+
+    // The back edge of a loop, fill in the values it brings to the header
+    std::unordered_map<int, std::vector<SBackEdgeOperand> >::iterator it = SLocalPromoter::back_edges.find(target);
+    if(it != SLocalPromoter::back_edges.end()) {
+      for(const SBackEdgeOperand& operand : it->second) {
+	bin[operand.position] = SLocalPromoter::values[operand.index];
+      }
+
+      SLocalPromoter::back_edges.erase(it);
+      return;
+    }
+
+    SLocalPromoter::edges[target].push_back({SLocalPromoter::block(bin), SLocalPromoter::values});
+  }
+
+  void SLocalPromoter::label(std::vector<uint32_t>& bin, int label) {
+    std::unordered_map<int, std::vector<SEdge> >::iterator it = SLocalPromoter::edges.find(label);
+    if(!SLocalPromoter::analyzed || it == SLocalPromoter::edges.end()) {
+      return;
+    }
+
+    const std::vector<SEdge>& incoming = it->second;
+    for(unsigned int i = 0; i < SLocalPromoter::values.size(); i++) {
+      bool same = true;
+      for(const SEdge& edge : incoming) {
+	same = same && edge.values[i] == incoming[0].values[i];
+      }
+
+      if(same) {
+	SLocalPromoter::values[i] = incoming[0].values[i];
+	continue;
+      }
+
+      SLocalPromoter::values[i] = SUtils::getNewID();
+
+      // OpPhi <result_type> <result_id> (<value> <parent>)...
+      SUtils::add(bin, ((3 + 2 * incoming.size()) << 16) | 245);
+      SUtils::add(bin, SLocalPromoter::type_ids[i]);
+      SUtils::add(bin, SLocalPromoter::values[i]);
+      for(const SEdge& edge : incoming) {
+	SUtils::add(bin, edge.values[i]);
+	SUtils::add(bin, edge.block);
+      }
+    }
+
+    SLocalPromoter::edges.erase(it);
+  }
+
+  void SLocalPromoter::loop_header(std::vector<uint32_t>& bin, int header_label, int continue_label,
+				   int iterator_id) {
+    if(!SLocalPromoter::analyzed) {
+      return;
+    }
+
+    // Only entered from the block before the loop, until the back edge is written
+    std::unordered_map<int, std::vector<SEdge> >::iterator it = SLocalPromoter::edges.find(header_label);
+    int preheader = it->second[0].block;
+    SLocalPromoter::edges.erase(it);
+
+    const std::vector<bool>& stored = SLocalPromoter::loop_stores[iterator_id];
+    for(unsigned int i = 0; i < SLocalPromoter::values.size(); i++) {
+      if(!stored[i]) {
+	continue;
+      }
+
+      uint32_t phi_id = SUtils::getNewID();
+
+      // OpPhi <result_type> <result_id> <value_before> <preheader> <value_after> <continue>
+      SUtils::add(bin, (7 << 16) | 245);
+      SUtils::add(bin, SLocalPromoter::type_ids[i]);
+      SUtils::add(bin, phi_id);
+      SUtils::add(bin, SLocalPromoter::values[i]);
+      SUtils::add(bin, preheader);
+      SLocalPromoter::back_edges[header_label].push_back({(int)i, (unsigned int)bin.size()});
+      SUtils::add(bin, 0); // Filled in by branch
+      SUtils::add(bin, continue_label);
+
+      SLocalPromoter::values[i] = phi_id;
+    }
+  }
+
+  void SLocalPromoter::clear() {
+    SLocalPromoter::analyzed = false;
+
+    SLocalPromoter::indices.clear();
+    SLocalPromoter::pointer_ids.clear();
+    SLocalPromoter::needs_undef.clear();
+    SLocalPromoter::iterators.clear();
+    SLocalPromoter::loop_stores.clear();
+
+    SLocalPromoter::values.clear();
+    SLocalPromoter::type_ids.clear();
+    SLocalPromoter::edges.clear();
+    SLocalPromoter::back_edges.clear();
+  }
+
+  void SLocalPromoter::setEnabled(bool enabled) {
+    SLocalPromoter::enabled = enabled;
+  }
+
+  bool SLocalPromoter::isEnabled() {
+    return SLocalPromoter::enabled;
+  }
+
+  int SLocalPromoter::getNumPromoted() {
+    return SLocalPromoter::num_promoted;
+  }
+
+};
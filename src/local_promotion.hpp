@@ -0,0 +1,131 @@
+#ifndef __SPURV_LOCAL_PROMOTION
+#define __SPURV_LOCAL_PROMOTION
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SPointerBase;
+
+  /*
+   * SLocalPromoter - Keeps local variables in SSA values instead of function memory
+   * (commonly known as mem2reg).
+   *
+   * Locals that are only loaded and stored as a whole, never through access chains, are
+   * promoted. Their OpVariable is left out, a store just makes the stored value the
+   * current value of the local, and a load takes on the current value's id. Where
+   * control flow merges, the current values of the incoming edges are joined with an
+   * OpPhi where they differ. Loop headers get an OpPhi for each local stored in the
+   * loop, whose value from the back edge is filled in when the back edge is written.
+   * Locals that may be loaded before they are stored start out as an OpUndef.
+   *
+   * The iterators of for-loops are promoted as well, to an OpPhi in the loop header
+   */
+
+  class SLocalPromoter {
+    static bool enabled;
+    static bool analyzed;
+
+    // Analysis
+    static std::unordered_map<int, int> indices; // Index of each promoted local, by pointer id
+    static std::vector<int> pointer_ids;
+    static std::vector<bool> needs_undef;
+    static std::unordered_set<int> iterators; // Pointer ids of promoted loop iterators
+    static std::unordered_map<int, std::vector<bool> > loop_stores; // Locals stored in each loop, by iterator
+
+    static int num_promoted;
+
+    // Writing
+    struct SEdge {
+      int block;
+      std::vector<uint32_t> values;
+    };
+
+    struct SBackEdgeOperand {
+      int index;
+      unsigned int position;
+    };
+
+    static std::vector<uint32_t> values; // Current value of each local
+    static std::vector<int> type_ids;
+    static std::unordered_map<int, std::vector<SEdge> > edges; // Edges not yet joined, by target label
+    static std::unordered_map<int, std::vector<SBackEdgeOperand> > back_edges; // By loop header label
+
+    static unsigned int scan_position;
+    static int current_block;
+
+    SLocalPromoter() = delete;
+
+    static const SPointerBase* root(const SPointerBase* pointer);
+
+    // Finds the locals to promote among those in SVariableRegistry, for the events
+    // currently in SEventRegistry. Expects SDeadCodeEliminator to have analyzed them
+    static void analyze();
+
+    static bool isPromoted(int pointer_id);
+
+    // Called after the variable definitions of the function starting at function_start
+    // in bin, defines the initial values of the locals
+    static void write_initial_values(std::vector<uint32_t>& bin, unsigned int function_start);
+
+    // The label of the block currently being written
+    static int block(const std::vector<uint32_t>& bin);
+
+    static uint32_t load(int pointer_id);
+    static void store(int pointer_id, uint32_t value_id);
+
+    // To be called before a branch to target is written
+    static void branch(std::vector<uint32_t>& bin, int target);
+
+    // To be called right after label is written, writes the OpPhis joining its incoming edges.
+    // Blocks without incoming edges (like the ones following a break) keep the current values
+    static void label(std::vector<uint32_t>& bin, int label);
+
+    // To be called right after the header of the loop with the given iterator is labeled,
+    // writes the OpPhis of the locals stored in the loop
+    static void loop_header(std::vector<uint32_t>& bin, int header_label, int continue_label,
+			    int iterator_id);
+
+    static void clear();
+
+    friend class SVariableRegistry;
+    friend class SStoreForwarder;
+    friend class SIfThen;
+    friend class SForLoop;
+
+    template<typename tt, SStorageClass storage>
+    friend class SPointerVar;
+
+    template<typename tt, SStorageClass storage>
+    friend class SLoadedVal;
+
+    template<typename tt>
+    friend class SStoreEvent;
+
+    template<typename tt>
+    friend class SelectConstruct;
+
+    friend class SPassManager;
+    friend class SFunctionBase;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Promotion is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of locals (including loop iterators) promoted in the last compiled shader
+    static int getNumPromoted();
+  };
+
+};
+
+#endif // __SPURV_LOCAL_PROMOTION
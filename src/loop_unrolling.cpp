@@ -0,0 +1,231 @@
+#include "loop_unrolling.hpp"
+#include "event_registry.hpp"
+#include "variable_registry.hpp"
+#include "pointers.hpp"
+
+#include "loop_unrolling_impl.hpp"
+#include "values_impl.hpp"
+#include "value_wrapper_impl.hpp"
+#include "utils_impl.hpp"
+
+namespace spurv {
+
+  /*
+   * SCloneMap member functions
+   */
+
+  SPointerBase* SCloneMap::clone_pointer(SPointerBase* pointer) {
+    std::unordered_map<const SPointerBase*, SPointerBase*>::iterator it = this->pointers.find(pointer);
+    if(it != this->pointers.end()) {
+      return it->second;
+    }
+
+    SPointerBase* copy = pointer->clone(*this);
+    this->pointers[pointer] = copy;
+    return copy;
+  }
+
+  void SCloneMap::nextIteration() {
+    this->values.clear();
+    this->pointers.clear();
+    this->blocks.clear();
+  }
+
+  bool SCloneMap::hasValue(const SValueBase* value) const {
+    return this->values.count(value);
+  }
+
+  void SCloneMap::setValue(const SValueBase* value, SValueBase* copy) {
+    this->values[value] = copy;
+  }
+
+  void SCloneMap::setBlock(const SControlStructureBase* block, SControlStructureBase* copy) {
+    this->blocks[block] = copy;
+  }
+
+  bool SCloneMap::redeclare(const SValueBase* value) {
+    return this->redeclared.insert(value).second;
+  }
+
+
+  /*
+   * SLoopUnroller members
+   */
+
+  int SLoopUnroller::max_unrolled_size = SLoopUnroller::default_max_unrolled_size;
+
+
+  /*
+   * SLoopUnroller member functions
+   */
+
+  long long SLoopUnroller::body_size(const std::vector<STimeEventBase*>& body) {
+    long long size = 0;
+    std::vector<long long> weights(1, 1);
+
+    SEventInfo info;
+    SNodeInfo node;
+    for(const STimeEventBase* event : body) {
+      event->getEventInfo(info);
+
+      switch(info.kind) {
+      case EVENT_DECLARATION:
+	// Constants are not in the function body, loads are counted by their event, and
+	// parameters are written with the function
+	info.values[0]->getNodeInfo(node);
+	if(node.kind != NODE_CONSTANT && node.kind != NODE_LOAD && node.kind != NODE_CUSTOM &&
+	   node.kind != NODE_PARAMETER) {
+	  size += weights.back();
+	}
+	break;
+      case EVENT_LOAD:
+      case EVENT_STORE:
+      case EVENT_IMAGE_STORE:
+	size += weights.back();
+	break;
+      case EVENT_FOR_BEGIN:
+	weights.push_back(weights.back() * (info.iterations > 1 ? info.iterations : 1));
+	break;
+      case EVENT_FOR_END:
+	weights.pop_back();
+	break;
+      default:
+	break;
+      }
+    }
+
+    return size;
+  }
+
+  bool SLoopUnroller::jumps_out(const std::vector<STimeEventBase*>& body) {
+    int depth = 0;
+
+    SEventInfo info;
+    for(const STimeEventBase* event : body) {
+      event->getEventInfo(info);
+
+      if(info.kind == EVENT_FOR_BEGIN) {
+	depth++;
+      } else if(info.kind == EVENT_FOR_END) {
+	depth--;
+      } else if((info.kind == EVENT_BREAK || info.kind == EVENT_CONTINUE) && depth == 0) {
+	return true;
+      }
+    }
+
+    return false;
+  }
+
+  void SLoopUnroller::replay(const std::vector<STimeEventBase*>& body, SCloneMap& map) {
+    for(STimeEventBase* event : body) {
+      event->replay(map);
+    }
+  }
+
+  void SLoopUnroller::unroll(SForLoop* loop) {
+    std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // The loop has just been ended, find where it began
+    SEventInfo info;
+    int begin = (int)events.size() - 2;
+    for(; begin >= 0; begin--) {
+      events[begin]->getEventInfo(info);
+      if(info.kind == EVENT_FOR_BEGIN && info.pointer == loop->iterator_pointer) {
+	break;
+      }
+    }
+
+    std::vector<STimeEventBase*> body(events.begin() + begin + 1, events.end() - 1);
+    int iterations = loop->end - loop->start;
+
+    // The number of copies of the body, left as a loop if 0
+    int factor = 0;
+    switch(loop->unroll) {
+    case SUnroll::UNROLL_AUTO:
+      // Asking the driver not to unroll the loop keeps it
+      if(!loop->control.dont_unroll && iterations > 0 &&
+	 (long long)iterations * SLoopUnroller::body_size(body) <= SLoopUnroller::max_unrolled_size) {
+	factor = iterations;
+      }
+      break;
+    case SUnroll::UNROLL_NONE:
+      break;
+    case SUnroll::UNROLL_FULL:
+      factor = iterations;
+      break;
+    case SUnroll::UNROLL_PARTIAL:
+      factor = loop->unroll_factor > 0 ? loop->unroll_factor : SLoopUnroller::default_factor;
+      break;
+    }
+
+    if(factor > iterations) {
+      factor = iterations;
+    }
+
+    // A loop over an empty range does nothing, and is left out along with its body
+    bool is_empty = iterations <= 0 && loop->unroll != SUnroll::UNROLL_NONE && !loop->control.dont_unroll;
+
+    if(!is_empty && (factor == 0 || (factor == 1 && iterations > 1) || SLoopUnroller::jumps_out(body))) {
+      return;
+    }
+
+    // Take the loop out, and record the body again in its place
+    std::vector<STimeEventBase*> removed(events.begin() + begin, events.end());
+    events.resize(begin);
+
+    SCloneMap map;
+    int first_unrolled = loop->start;
+
+    if(factor < iterations) {
+      int num_trips = iterations / factor;
+
+      SForLoop* partial = SUtils::allocate<SForLoop>(loop->start, loop->start + num_trips * factor);
+      partial->set_step(factor);
+
+      // The lengths and counts are in iterations of the original loop
+      partial->control.unroll = loop->control.unroll;
+      partial->control.dont_unroll = loop->control.dont_unroll;
+      partial->control.dependency_infinite = loop->control.dependency_infinite;
+      SEventRegistry::addForBegin(partial);
+
+      for(int i = 0; i < factor; i++) {
+	map.nextIteration();
+	map.setValue(loop->iterator_val, i == 0 ?
+		     partial->iterator_val :
+		     &(*partial->iterator_val + i));
+	SLoopUnroller::replay(body, map);
+      }
+
+      SEventRegistry::addForEnd(partial);
+
+      first_unrolled += num_trips * factor;
+    }
+
+    for(int i = first_unrolled; i < loop->end; i++) {
+      map.nextIteration();
+      map.setValue(loop->iterator_val, SUtils::allocate<Constant<int> >(i));
+      SLoopUnroller::replay(body, map);
+    }
+
+    // The iterators of the removed loops are not needed anymore
+    SPointerInfo pointer_info;
+    for(STimeEventBase* event : removed) {
+      event->getEventInfo(info);
+      if(info.kind == EVENT_FOR_BEGIN) {
+	info.pointer->getPointerInfo(pointer_info);
+	SVariableRegistry::remove_variable(pointer_info.id);
+      }
+
+      delete event;
+    }
+  }
+
+  void SLoopUnroller::setMaxUnrolledSize(int size) {
+    SLoopUnroller::max_unrolled_size = size;
+  }
+
+  int SLoopUnroller::getMaxUnrolledSize() {
+    return SLoopUnroller::max_unrolled_size;
+  }
+
+};
@@ -0,0 +1,104 @@
+#ifndef __SPURV_LOOP_UNROLLING
+#define __SPURV_LOOP_UNROLLING
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SValueBase;
+  class SControlStructureBase;
+  class STimeEventBase;
+
+  /*
+   * SCloneMap - Maps the values, pointers and control structures recorded in a loop body to
+   * their copies in the iteration currently being unrolled. Anything recorded outside the
+   * body maps to itself
+   */
+
+  class SCloneMap {
+    std::unordered_map<const SValueBase*, SValueBase*> values;
+    std::unordered_map<const SPointerBase*, SPointerBase*> pointers;
+    std::unordered_map<const SControlStructureBase*, SControlStructureBase*> blocks;
+
+    std::unordered_set<const SValueBase*> redeclared; // Kept between iterations
+
+    SPointerBase* clone_pointer(SPointerBase* pointer);
+
+  public:
+
+    // Forgets the copies made for the previous iteration
+    void nextIteration();
+
+    bool hasValue(const SValueBase* value) const;
+    void setValue(const SValueBase* value, SValueBase* copy);
+    void setBlock(const SControlStructureBase* block, SControlStructureBase* copy);
+
+    // Returns true the first time it is called for value. Nodes that are their own copy
+    // (like constants) are declared again, once, as the body they were declared in is removed
+    bool redeclare(const SValueBase* value);
+
+    template<typename tt>
+    SValue<tt>* value(SValue<tt>* value);
+
+    // Access chains are copied on first use in each iteration, variables map to themselves
+    template<typename pt>
+    pt* pointer(pt* pointer);
+
+    template<typename bt>
+    bt* block(bt* block);
+  };
+
+
+  /*
+   * SLoopUnroller - Unrolls for-loops when they are ended, by removing the recorded body from
+   * SEventRegistry and recording it again once per iteration, with the iterator replaced by a
+   * constant. Since the copies are made through the node factories, they are folded (see
+   * SConstantFolder) and shared between iterations (see SNodeCache) where possible.
+   *
+   * Full unrolling leaves no loop at all. Partial unrolling by a factor k records the body k
+   * times in a loop stepping k at a time, with the iterator replaced by iterator + i in the
+   * i-th copy, followed by the remaining iterations fully unrolled. Loops with a break or
+   * continue of their own are never unrolled, since the copies would not be able to jump
+   * past each other. UNROLL_AUTO unrolls fully if the number of instructions in the body
+   * times the number of iterations is within the maximum unrolled size. Loops over an empty
+   * range are left out, unless they are not to be unrolled at all
+   */
+
+  class SLoopUnroller {
+    static int max_unrolled_size;
+    static const int default_factor = 4;
+
+    SLoopUnroller() = delete;
+
+    // Number of instructions recorded in body, with nested loops counted once per iteration
+    static long long body_size(const std::vector<STimeEventBase*>& body);
+
+    // Whether body breaks out of or continues the loop it is the body of
+    static bool jumps_out(const std::vector<STimeEventBase*>& body);
+
+    static void replay(const std::vector<STimeEventBase*>& body, SCloneMap& map);
+
+    // Called when the loop has been ended
+    static void unroll(SForLoop* loop);
+
+    friend class SFunctionInliner;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    static const int default_max_unrolled_size = 128;
+
+    // The limit for UNROLL_AUTO, 0 turns automatic unrolling off
+    static void setMaxUnrolledSize(int size);
+    static int getMaxUnrolledSize();
+  };
+
+};
+
+#endif // __SPURV_LOOP_UNROLLING
@@ -0,0 +1,42 @@
+#ifndef __SPURV_LOOP_UNROLLING_IMPL
+#define __SPURV_LOOP_UNROLLING_IMPL
+
+#include "loop_unrolling.hpp"
+#include "values.hpp"
+#include "pointers.hpp"
+#include "control_flow.hpp"
+
+namespace spurv {
+
+  /*
+   * SCloneMap member functions
+   */
+
+  template<typename tt>
+  SValue<tt>* SCloneMap::value(SValue<tt>* value) {
+    std::unordered_map<const SValueBase*, SValueBase*>::iterator it = this->values.find(value);
+    if(it == this->values.end()) {
+      return value;
+    }
+
+    return static_cast<SValue<tt>*>(it->second);
+  }
+
+  template<typename pt>
+  pt* SCloneMap::pointer(pt* pointer) {
+    return static_cast<pt*>(this->clone_pointer(pointer));
+  }
+
+  template<typename bt>
+  bt* SCloneMap::block(bt* block) {
+    std::unordered_map<const SControlStructureBase*, SControlStructureBase*>::iterator it = this->blocks.find(block);
+    if(it == this->blocks.end()) {
+      return block;
+    }
+
+    return static_cast<bt*>(it->second);
+  }
+
+};
+
+#endif // __SPURV_LOOP_UNROLLING_IMPL
@@ -0,0 +1,378 @@
+#include "module.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+#include <algorithm>
+
+namespace spurv {
+
+  static const uint32_t spirv_magic_number = 0x07230203;
+  static const uint32_t spirv_magic_number_swapped = 0x03022307;
+  static const int header_size = 5;
+
+  namespace {
+
+    // The nul-terminated literal string at the start of words
+    std::string get_string(const std::vector<uint32_t>& words) {
+      std::string res;
+      for(uint32_t word : words) {
+	for(int i = 0; i < 4; i++) {
+	  char c = (char)((word >> (8 * i)) & 0xff);
+	  if(c == '\0') {
+	    return res;
+	  }
+	  res.push_back(c);
+	}
+      }
+      return res;
+    }
+
+    // Removes the instructions for which is_removed returns true, and counts them
+    template<typename F>
+    int remove_instructions(std::vector<SInstruction>& instructions, F is_removed) {
+      std::vector<SInstruction>::iterator it = std::remove_if(instructions.begin(), instructions.end(),
+							      is_removed);
+      int count = instructions.end() - it;
+      instructions.erase(it, instructions.end());
+      return count;
+    }
+  };
+
+  /*
+   * SBinaryReader member functions
+   */
+
+  SBinaryReader::SBinaryReader(const uint32_t* words, size_t num_words) {
+    if(num_words < header_size || words[0] != spirv_magic_number) {
+      printf("[spurv::SBinaryReader] Binary does not start with a valid SPIR-V header\n");
+      exit(-1);
+    }
+
+    this->words = words;
+    this->num_words = num_words;
+    this->position = header_size;
+  }
+
+  uint32_t SBinaryReader::getVersion() const {
+    return this->words[1];
+  }
+
+  uint32_t SBinaryReader::getGenerator() const {
+    return this->words[2];
+  }
+
+  uint32_t SBinaryReader::getBound() const {
+    return this->words[3];
+  }
+
+  uint32_t SBinaryReader::getSchema() const {
+    return this->words[4];
+  }
+
+  size_t SBinaryReader::getPosition() const {
+    return this->position;
+  }
+
+  bool SBinaryReader::next(SInstructionView& view) {
+    if(this->position >= this->num_words) {
+      return false;
+    }
+
+    uint32_t first = this->words[this->position];
+    uint32_t count = first >> 16;
+
+    if(count == 0 || this->position + count > this->num_words) {
+      printf("[spurv::SBinaryReader] Invalid word count %u at word %zu\n", count, this->position);
+      exit(-1);
+    }
+
+    view.opcode = first & 0xffff;
+    view.num_words = count;
+    view.words = this->words + this->position;
+
+    this->position += count;
+    return true;
+  }
+
+
+  /*
+   * SInstruction member functions
+   */
+
+  SInstruction::SInstruction() : opcode(0), type_id(0), result_id(0) { }
+
+  SInstruction::SInstruction(uint32_t opcode, uint32_t type_id, uint32_t result_id,
+			     const std::vector<uint32_t>& operands)
+    : opcode(opcode), type_id(type_id), result_id(result_id), operands(operands) { }
+
+  int SInstruction::getWordCount() const {
+    return 1 + (this->type_id != 0) + (this->result_id != 0) + (int)this->operands.size();
+  }
+
+  void SInstruction::emit(std::vector<uint32_t>& res) const {
+    res.push_back(((uint32_t)this->getWordCount() << 16) | this->opcode);
+    if(this->type_id) {
+      res.push_back(this->type_id);
+    }
+    if(this->result_id) {
+      res.push_back(this->result_id);
+    }
+    res.insert(res.end(), this->operands.begin(), this->operands.end());
+  }
+
+
+  /*
+   * SModule member functions
+   */
+
+  SModule::SModule() {
+    this->clear();
+  }
+
+  void SModule::clear() {
+    this->version = 0x00010000;
+    this->generator = 0;
+    this->bound = 1;
+    this->schema = 0;
+
+    this->capabilities.clear();
+    this->extensions.clear();
+    this->ext_inst_imports.clear();
+    this->memory_models.clear();
+    this->entry_points.clear();
+    this->execution_modes.clear();
+    this->debug.clear();
+    this->annotations.clear();
+    this->declarations.clear();
+    this->functions.clear();
+  }
+
+  uint32_t SModule::getNewID() {
+    return this->bound++;
+  }
+
+  void SModule::parse(const std::vector<uint32_t>& binary) {
+    this->parse(binary.data(), binary.size());
+  }
+
+  void SModule::parse(const uint32_t* words, size_t num_words) {
+    this->clear();
+
+    // Binaries written on a machine of the other endianness are swapped once up front
+    std::vector<uint32_t> swapped;
+    if(num_words > 0 && words[0] == spirv_magic_number_swapped) {
+      swapped.resize(num_words);
+      for(size_t i = 0; i < num_words; i++) {
+	uint32_t w = words[i];
+	swapped[i] = (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000) | (w << 24);
+      }
+      words = swapped.data();
+    }
+
+    SBinaryReader reader(words, num_words);
+    this->version = reader.getVersion();
+    this->generator = reader.getGenerator();
+    this->bound = reader.getBound();
+    this->schema = reader.getSchema();
+
+    std::vector<SInstruction>* current_section = &this->capabilities;
+    SModuleFunction* current_function = nullptr;
+    SModuleBlock* current_block = nullptr;
+
+    SInstructionView view;
+    while(reader.next(view)) {
+      const SInstructionInfo* info = SInstructionSet::getInfo(view.opcode);
+      if(!info) {
+	printf("[spurv::SModule::parse] Unknown opcode %u at word %zu\n", view.opcode,
+	       reader.getPosition() - view.num_words);
+	exit(-1);
+      }
+
+      int fixed_words = 1 + info->has_type + info->has_result;
+      if((int)view.num_words < fixed_words) {
+	printf("[spurv::SModule::parse] %s has too few words\n", info->name);
+	exit(-1);
+      }
+
+      SInstruction inst;
+      inst.opcode = view.opcode;
+      int i = 1;
+      if(info->has_type) {
+	inst.type_id = view.words[i++];
+      }
+      if(info->has_result) {
+	inst.result_id = view.words[i++];
+      }
+      inst.operands.assign(view.words + i, view.words + view.num_words);
+
+      if(current_function) {
+	switch(view.opcode) {
+	case 55: // OpFunctionParameter
+	  current_function->parameters.push_back(std::move(inst));
+	  break;
+	case 56: // OpFunctionEnd
+	  current_function = nullptr;
+	  current_block = nullptr;
+	  break;
+	case 248: // OpLabel
+	  current_function->blocks.push_back(SModuleBlock());
+	  current_block = &current_function->blocks.back();
+	  current_block->label_id = inst.result_id;
+	  break;
+	default:
+	  if(current_block) {
+	    current_block->instructions.push_back(std::move(inst));
+	  } else if(view.opcode == 8 || view.opcode == 317) { // OpLine, OpNoLine
+	    current_function->parameters.push_back(std::move(inst));
+	  } else {
+	    printf("[spurv::SModule::parse] %s outside of any block\n", info->name);
+	    exit(-1);
+	  }
+	}
+	continue;
+      }
+
+      if(view.opcode == 54) { // OpFunction
+	this->functions.push_back(SModuleFunction());
+	current_function = &this->functions.back();
+	current_function->definition = std::move(inst);
+	continue;
+      }
+
+      if(this->functions.size() > 0) {
+	printf("[spurv::SModule::parse] %s found after function definitions\n", info->name);
+	exit(-1);
+      }
+
+      switch(info->section) {
+      case SECTION_CAPABILITY:
+	current_section = &this->capabilities;
+	break;
+      case SECTION_EXTENSION:
+	current_section = &this->extensions;
+	break;
+      case SECTION_EXT_INST_IMPORT:
+	current_section = &this->ext_inst_imports;
+	break;
+      case SECTION_MEMORY_MODEL:
+	current_section = &this->memory_models;
+	break;
+      case SECTION_ENTRY_POINT:
+	current_section = &this->entry_points;
+	break;
+      case SECTION_EXECUTION_MODE:
+	current_section = &this->execution_modes;
+	break;
+      case SECTION_DEBUG_STRING:
+      case SECTION_DEBUG_NAME:
+      case SECTION_DEBUG_MODULE_PROCESSED:
+	current_section = &this->debug;
+	break;
+      case SECTION_ANNOTATION:
+	current_section = &this->annotations;
+	break;
+      case SECTION_DECLARATION:
+	current_section = &this->declarations;
+	break;
+      case SECTION_FUNCTION:
+	printf("[spurv::SModule::parse] %s found outside of function\n", info->name);
+	exit(-1);
+      case SECTION_ANY:
+	// OpVariable, OpUndef, OpLine etc. outside functions belong with the declarations,
+	// and so do the OpExtInsts of non-semantic instruction sets (e.g. debug info from glslang)
+	if(view.opcode == 59 || view.opcode == 1 || view.opcode == 12) {
+	  current_section = &this->declarations;
+	}
+	break;
+      }
+
+      current_section->push_back(std::move(inst));
+    }
+
+    if(current_function) {
+      printf("[spurv::SModule::parse] Missing OpFunctionEnd\n");
+      exit(-1);
+    }
+  }
+
+  void SModule::emit(std::vector<uint32_t>& res) const {
+    res.push_back(spirv_magic_number);
+    res.push_back(this->version);
+    res.push_back(this->generator);
+    res.push_back(this->bound);
+    res.push_back(this->schema);
+
+    const std::vector<SInstruction>* sections[] = {&this->capabilities, &this->extensions,
+						   &this->ext_inst_imports, &this->memory_models,
+						   &this->entry_points, &this->execution_modes,
+						   &this->debug, &this->annotations,
+						   &this->declarations};
+
+    for(const std::vector<SInstruction>* section : sections) {
+      for(const SInstruction& inst : *section) {
+	inst.emit(res);
+      }
+    }
+
+    for(const SModuleFunction& function : this->functions) {
+      function.definition.emit(res);
+
+      for(const SInstruction& inst : function.parameters) {
+	inst.emit(res);
+      }
+
+      for(const SModuleBlock& block : function.blocks) {
+	// OpLabel <result_id>
+	res.push_back((2 << 16) | 248);
+	res.push_back(block.label_id);
+
+	for(const SInstruction& inst : block.instructions) {
+	  inst.emit(res);
+	}
+      }
+
+      // OpFunctionEnd
+      res.push_back((1 << 16) | 56);
+    }
+  }
+
+  int SModule::stripDebugInfo() {
+    int count = this->debug.size();
+    this->debug.clear();
+
+    // Results of non-semantic instructions may only be used by other non-semantic instructions
+    std::unordered_set<uint32_t> non_semantic_sets;
+    count += remove_instructions(this->ext_inst_imports, [&non_semantic_sets](const SInstruction& inst) {
+	if(get_string(inst.operands).compare(0, 12, "NonSemantic.") != 0) {
+	  return false;
+	}
+
+	non_semantic_sets.insert(inst.result_id);
+	return true;
+      });
+
+    if(non_semantic_sets.size()) {
+      count += remove_instructions(this->extensions, [](const SInstruction& inst) {
+	  return get_string(inst.operands) == "SPV_KHR_non_semantic_info";
+	});
+    }
+
+    auto is_debug = [&non_semantic_sets](const SInstruction& inst) {
+      return inst.opcode == 8 || inst.opcode == 317 || // OpLine, OpNoLine
+	(inst.opcode == 12 && non_semantic_sets.count(inst.operands[0])); // OpExtInst
+    };
+
+    count += remove_instructions(this->declarations, is_debug);
+    for(SModuleFunction& function : this->functions) {
+      count += remove_instructions(function.parameters, is_debug);
+      for(SModuleBlock& block : function.blocks) {
+	count += remove_instructions(block.instructions, is_debug);
+      }
+    }
+
+    return count;
+  }
+
+};
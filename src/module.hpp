@@ -0,0 +1,136 @@
+#ifndef __SPURV_MODULE
+#define __SPURV_MODULE
+
+#include "instruction_set.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spurv {
+
+  /*
+   * SInstructionView - A single instruction as it lies in a binary, without copying it
+   */
+
+  struct SInstructionView {
+    uint32_t opcode;
+    uint32_t num_words; // Including the opcode word
+    const uint32_t* words; // words[0] is the opcode word
+  };
+
+
+  /*
+   * SBinaryReader - Streams the instructions of a SPIR-V binary in host byte order
+   */
+
+  class SBinaryReader {
+    const uint32_t* words;
+    size_t num_words;
+    size_t position;
+
+  public:
+    SBinaryReader(const uint32_t* words, size_t num_words);
+
+    uint32_t getVersion() const;
+    uint32_t getGenerator() const;
+    uint32_t getBound() const;
+    uint32_t getSchema() const;
+
+    // Index of the next instruction in the word stream
+    size_t getPosition() const;
+
+    // Returns false when there are no more instructions
+    bool next(SInstructionView& view);
+  };
+
+
+  /*
+   * SInstruction - A single instruction. Result type and result id are 0 if the opcode has none
+   */
+
+  struct SInstruction {
+    uint32_t opcode;
+    uint32_t type_id;
+    uint32_t result_id;
+    std::vector<uint32_t> operands;
+
+    SInstruction();
+    SInstruction(uint32_t opcode, uint32_t type_id, uint32_t result_id,
+		 const std::vector<uint32_t>& operands = {});
+
+    int getWordCount() const;
+    void emit(std::vector<uint32_t>& res) const;
+  };
+
+
+  /*
+   * SModuleBlock - A basic block, beginning with its label. The last instruction is the terminator
+   */
+
+  struct SModuleBlock {
+    uint32_t label_id;
+    std::vector<SInstruction> instructions;
+  };
+
+
+  /*
+   * SModuleFunction - A function definition with its blocks.
+   * OpLine/OpNoLine that precede the first label are kept among the parameters
+   */
+
+  struct SModuleFunction {
+    SInstruction definition;
+    std::vector<SInstruction> parameters;
+    std::vector<SModuleBlock> blocks;
+  };
+
+
+  /*
+   * SModule - In-memory representation of a complete SPIR-V module, sorted into its logical sections.
+   * Valid modules are emitted word-for-word as they were parsed.
+   *
+   * Parsed modules are not lifted into the values of SShader, so the passes run on recorded
+   * shaders (see SPassManager) do not apply to them. What is done to a parsed module before it
+   * is emitted again is done by the member functions of SModule, such as stripDebugInfo
+   */
+
+  class SModule {
+  public:
+    uint32_t version;
+    uint32_t generator;
+    uint32_t bound;
+    uint32_t schema;
+
+    std::vector<SInstruction> capabilities;
+    std::vector<SInstruction> extensions;
+    std::vector<SInstruction> ext_inst_imports;
+    std::vector<SInstruction> memory_models;
+    std::vector<SInstruction> entry_points;
+    std::vector<SInstruction> execution_modes;
+    std::vector<SInstruction> debug; // Strings, sources, names and processed-annotations, in order
+    std::vector<SInstruction> annotations;
+    std::vector<SInstruction> declarations; // Types, constants, global variables
+    std::vector<SModuleFunction> functions;
+
+    SModule();
+
+    void parse(const uint32_t* words, size_t num_words);
+    void parse(const std::vector<uint32_t>& binary);
+
+    void emit(std::vector<uint32_t>& res) const;
+
+    // Removes names, strings, sources, line information and the instructions of non-semantic
+    // instruction sets (e.g. NonSemantic.Shader.DebugInfo.100), none of which affect what the
+    // module computes. Returns the number of instructions removed
+    int stripDebugInfo();
+
+    // Allocates a fresh id by bumping the bound
+    uint32_t getNewID();
+
+    void clear();
+  };
+
+};
+
+#endif // __SPURV_MODULE
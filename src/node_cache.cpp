@@ -0,0 +1,131 @@
+#include "node_cache.hpp"
+#include "trace.hpp"
+
+namespace spurv {
+
+  /*
+   * SNodeKey member functions
+   */
+
+  bool SNodeKey::operator==(const SNodeKey& key) const {
+    return this->node_class == key.node_class &&
+      this->operation == key.operation &&
+      this->operands == key.operands;
+  }
+
+  std::size_t SNodeKeyHash::operator()(const SNodeKey& key) const {
+    std::size_t h = std::hash<const void*>()(key.node_class);
+    h = h * 31 + (std::size_t)key.operation;
+    for(int id : key.operands) {
+      h = h * 31 + (std::size_t)id;
+    }
+    return h;
+  }
+
+
+  /*
+   * SNodeCache members
+   */
+
+  std::unordered_map<SNodeKey, SNodeCache::Entry, SNodeKeyHash> SNodeCache::entries;
+
+  std::vector<bool> SNodeCache::open_scopes = {true};
+  std::vector<int> SNodeCache::scope_stack = {0};
+  int SNodeCache::memory_epoch = 0;
+
+  bool SNodeCache::enabled = true;
+
+  int SNodeCache::num_hits = 0;
+  int SNodeCache::num_misses = 0;
+
+
+  /*
+   * SNodeCache member functions
+   */
+
+  void* SNodeCache::find_node(const SNodeKey& key, bool reads_memory) {
+    if(!SNodeCache::enabled) {
+      return nullptr;
+    }
+
+    std::unordered_map<SNodeKey, Entry, SNodeKeyHash>::iterator it = SNodeCache::entries.find(key);
+    if(it == SNodeCache::entries.end()) {
+      SNodeCache::num_misses++;
+      return nullptr;
+    }
+
+    const Entry& entry = it->second;
+
+    // The node must dominate the current position
+    if(!SNodeCache::open_scopes[entry.scope]) {
+      SNodeCache::num_misses++;
+      return nullptr;
+    }
+
+    // Memory may have changed since, either in between or in an earlier iteration of an enclosing loop
+    if(reads_memory && (entry.memory_epoch != SNodeCache::memory_epoch ||
+			entry.scope != SNodeCache::scope_stack.back())) {
+      SNodeCache::num_misses++;
+      return nullptr;
+    }
+
+    SNodeCache::num_hits++;
+    return entry.node;
+  }
+
+  void SNodeCache::insert_node(const SNodeKey& key, void* node, bool reads_memory) {
+    if(!SNodeCache::enabled) {
+      return;
+    }
+
+    Entry entry;
+    entry.node = node;
+    entry.scope = SNodeCache::scope_stack.back();
+    entry.memory_epoch = reads_memory ? SNodeCache::memory_epoch : -1;
+
+    SNodeCache::entries[key] = entry;
+  }
+
+  void SNodeCache::enterScope() {
+    SNodeCache::scope_stack.push_back(SNodeCache::open_scopes.size());
+    SNodeCache::open_scopes.push_back(true);
+  }
+
+  void SNodeCache::exitScope() {
+    // The outermost scope is never closed
+    if(SNodeCache::scope_stack.size() <= 1) {
+      return;
+    }
+
+    SNodeCache::open_scopes[SNodeCache::scope_stack.back()] = false;
+    SNodeCache::scope_stack.pop_back();
+  }
+
+  void SNodeCache::noteMemoryWrite() {
+    SNodeCache::memory_epoch++;
+  }
+
+  void SNodeCache::trace(const std::string& shader) {
+    STrace::addCounter("node cache", "cache", shader, STrace::now(),
+		       { {"hits", SNodeCache::num_hits}, {"misses", SNodeCache::num_misses} });
+  }
+
+  void SNodeCache::clear() {
+    SNodeCache::entries.clear();
+    SNodeCache::num_hits = 0;
+    SNodeCache::num_misses = 0;
+
+    SNodeCache::open_scopes = {true};
+    SNodeCache::scope_stack = {0};
+    SNodeCache::memory_epoch = 0;
+  }
+
+  void SNodeCache::setEnabled(bool enabled) {
+    SNodeCache::enabled = enabled;
+  }
+
+  bool SNodeCache::isEnabled() {
+    return SNodeCache::enabled;
+  }
+
+};
@@ -0,0 +1,110 @@
+#ifndef __SPURV_NODE_CACHE
+#define __SPURV_NODE_CACHE
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <initializer_list>
+#include <cstddef>
+
+namespace spurv {
+
+  /*
+   * SNodeKey - Identifies a pure node by its class (which fixes both its result type and
+   * its operand types), its operation and the ids of its operands. Equal constants share
+   * ids, so expressions on the same constant values get equal keys
+   */
+
+  struct SNodeKey {
+    const void* node_class;
+    int operation;
+    std::vector<int> operands;
+
+    bool operator==(const SNodeKey& key) const;
+  };
+
+  struct SNodeKeyHash {
+    std::size_t operator()(const SNodeKey& key) const;
+  };
+
+
+  /*
+   * SNodeCache - Hash-consing of the nodes created by the expression and function
+   * factories, so that writing the same pure expression twice gives back the node
+   * created the first time, instead of emitting it twice.
+   *
+   * A node is only handed out again where it is known to have been computed: in the
+   * scope (loop body or branch) it was created in, or in scopes nested inside it.
+   * Nodes that read memory (lookups into arrays and images) are in addition only
+   * reused in their own scope, as long as no store has been recorded since.
+   * Each load is its own event in SEventRegistry, so loads are only cached for the
+   * read-only and buffer variables SLoadEliminator deals with
+   */
+
+  class SNodeCache {
+    struct Entry {
+      void* node;
+      int scope;
+      int memory_epoch; // -1 if the node does not read memory
+    };
+
+    static std::unordered_map<SNodeKey, Entry, SNodeKeyHash> entries;
+
+    static std::vector<bool> open_scopes; // Indexed by scope number
+    static std::vector<int> scope_stack;
+    static int memory_epoch;
+
+    static bool enabled;
+
+    // Lookups since the last compile, for the trace
+    static int num_hits;
+    static int num_misses;
+
+    static void* find_node(const SNodeKey& key, bool reads_memory);
+    static void insert_node(const SNodeKey& key, void* node, bool reads_memory);
+
+    static void enterScope();
+    static void exitScope();
+    static void noteMemoryWrite();
+
+    // Adds the hits and misses of the shader being compiled to the trace, see STrace
+    static void trace(const std::string& shader);
+
+    static void clear();
+
+    template<typename NodeType>
+    static const void* getNodeClass();
+
+    SNodeCache() = delete;
+
+    friend class SEventRegistry;
+    friend class SFunctionBase;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // The cache is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Used by the node factories
+    template<typename NodeType>
+    static SNodeKey makeKey(int operation, std::initializer_list<int> operands);
+
+    template<typename NodeType>
+    static SNodeKey makeKey(int operation, const std::vector<int>& operands);
+
+    template<typename NodeType>
+    static NodeType* find(const SNodeKey& key, bool reads_memory);
+
+    template<typename NodeType>
+    static void insert(const SNodeKey& key, NodeType* node, bool reads_memory);
+  };
+
+};
+
+#endif // __SPURV_NODE_CACHE
@@ -0,0 +1,51 @@
+#ifndef __SPURV_NODE_CACHE_IMPL
+#define __SPURV_NODE_CACHE_IMPL
+
+#include "node_cache.hpp"
+
+namespace spurv {
+
+  /*
+   * SNodeCache member functions
+   */
+
+  // One distinct address per node class
+  template<typename NodeType>
+  inline constexpr char node_class_tag = 0;
+
+  template<typename NodeType>
+  const void* SNodeCache::getNodeClass() {
+    return &node_class_tag<NodeType>;
+  }
+
+  template<typename NodeType>
+  SNodeKey SNodeCache::makeKey(int operation, std::initializer_list<int> operands) {
+    SNodeKey key;
+    key.node_class = SNodeCache::getNodeClass<NodeType>();
+    key.operation = operation;
+    key.operands = operands;
+    return key;
+  }
+
+  template<typename NodeType>
+  SNodeKey SNodeCache::makeKey(int operation, const std::vector<int>& operands) {
+    SNodeKey key;
+    key.node_class = SNodeCache::getNodeClass<NodeType>();
+    key.operation = operation;
+    key.operands = operands;
+    return key;
+  }
+
+  template<typename NodeType>
+  NodeType* SNodeCache::find(const SNodeKey& key, bool reads_memory) {
+    return (NodeType*)SNodeCache::find_node(key, reads_memory);
+  }
+
+  template<typename NodeType>
+  void SNodeCache::insert(const SNodeKey& key, NodeType* node, bool reads_memory) {
+    SNodeCache::insert_node(key, (void*)node, reads_memory);
+  }
+
+};
+
+#endif // __SPURV_NODE_CACHE_IMPL
@@ -0,0 +1,346 @@
+#include "pass_manager.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "trace.hpp"
+#include "constant_folding.hpp"
+#include "algebraic_simplification.hpp"
+#include "node_cache.hpp"
+#include "loop_unrolling.hpp"
+#include "slp_vectorization.hpp"
+#include "strength_reduction.hpp"
+#include "load_elimination.hpp"
+#include "dead_store_elimination.hpp"
+#include "dead_code_elimination.hpp"
+#include "fma_contraction.hpp"
+#include "local_promotion.hpp"
+#include "store_forwarding.hpp"
+#include "invariant_hoisting.hpp"
+#include "code_sinking.hpp"
+#include "function_inlining.hpp"
+
+#include <cstdio>
+
+namespace spurv {
+
+  namespace {
+
+    constexpr int level_bit(SOptimizationLevel level) {
+      return 1 << (int)level;
+    }
+
+    // The passes that only remove work, and those that may also grow the binary
+    const int levels_cheap = level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_1) |
+      level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_2) | level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_SIZE);
+    const int levels_full = level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_2) |
+      level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_SIZE);
+    const int levels_speed = level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_2);
+
+    // Inlining small bodies removes calls, but may still grow the binary
+    const int levels_inline = level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_1) |
+      level_bit(SOptimizationLevel::OPTIMIZATION_LEVEL_2);
+  };
+
+
+  /*
+   * SPassManager members
+   */
+
+  const std::vector<SPassManager::SPass> SPassManager::passes = {
+    // Applied while recording
+    {"constant folding", levels_cheap, &SConstantFolder::setEnabled, &SConstantFolder::isEnabled,
+     nullptr, nullptr},
+    {"algebraic simplification", levels_cheap, &SAlgebraicSimplifier::setEnabled,
+     &SAlgebraicSimplifier::isEnabled, nullptr, nullptr},
+    {"node cache", levels_cheap, &SNodeCache::setEnabled, &SNodeCache::isEnabled, nullptr, nullptr},
+    {"load elimination", levels_cheap, &SLoadEliminator::setEnabled, &SLoadEliminator::isEnabled,
+     // Still being counted, the numbers of the shader are kept when it is cleaned up
+     []() { return SLoadEliminator::loads_reused + SLoadEliminator::chains_reused; },
+     nullptr},
+    {"function inlining", levels_inline,
+     [](bool enabled) {
+       SFunctionInliner::setMaxInlinedSize(enabled ? SFunctionInliner::default_max_inlined_size : 0);
+     },
+     []() { return SFunctionInliner::getMaxInlinedSize() > 0; },
+     []() { return SFunctionInliner::inlined; }, nullptr},
+    {"loop unrolling", levels_speed,
+     [](bool enabled) {
+       SLoopUnroller::setMaxUnrolledSize(enabled ? SLoopUnroller::default_max_unrolled_size : 0);
+     },
+     []() { return SLoopUnroller::getMaxUnrolledSize() > 0; }, nullptr, nullptr},
+    {"slp vectorization", levels_full, &SSlpVectorizer::setEnabled, &SSlpVectorizer::isEnabled,
+     &SSlpVectorizer::getNumVectorized, nullptr},
+
+    // Run by compile()
+    {"dead store elimination", levels_cheap, &SDeadStoreEliminator::setEnabled,
+     &SDeadStoreEliminator::isEnabled, &SDeadStoreEliminator::getNumEliminated,
+     [](std::vector<uint32_t>&, SPrecision) { SDeadStoreEliminator::analyze(); }},
+    {"dead code elimination", levels_cheap, &SDeadCodeEliminator::setEnabled,
+     &SDeadCodeEliminator::isEnabled, &SDeadCodeEliminator::getNumEliminated,
+     [](std::vector<uint32_t>&, SPrecision) { SDeadCodeEliminator::analyze(); }},
+    {"fma contraction", levels_cheap, &SFmaContractor::setEnabled, &SFmaContractor::isEnabled,
+     &SFmaContractor::getNumContracted,
+     [](std::vector<uint32_t>& bin, SPrecision precision) {
+       SFmaContractor::analyze(precision);
+       SFmaContractor::write_decorations(bin);
+     }},
+    {"local promotion", levels_cheap, &SLocalPromoter::setEnabled, &SLocalPromoter::isEnabled,
+     &SLocalPromoter::getNumPromoted,
+     [](std::vector<uint32_t>&, SPrecision) { SLocalPromoter::analyze(); }},
+    {"store forwarding", levels_cheap, &SStoreForwarder::setEnabled, &SStoreForwarder::isEnabled,
+     &SStoreForwarder::getNumForwarded,
+     [](std::vector<uint32_t>&, SPrecision) { SStoreForwarder::analyze(); }},
+    {"invariant hoisting", levels_full, &SInvariantHoister::setEnabled, &SInvariantHoister::isEnabled,
+     &SInvariantHoister::getNumHoisted,
+     [](std::vector<uint32_t>&, SPrecision) { SInvariantHoister::analyze(); }},
+    {"code sinking", levels_speed, &SCodeSinker::setEnabled, &SCodeSinker::isEnabled,
+     &SCodeSinker::getNumSunk,
+     [](std::vector<uint32_t>&, SPrecision) { SCodeSinker::analyze(); }},
+
+    // Applied while writing
+    {"strength reduction", levels_cheap, &SStrengthReducer::setEnabled, &SStrengthReducer::isEnabled,
+     &SStrengthReducer::getNumReduced, nullptr}
+  };
+
+  SOptimizationLevel SPassManager::level = SOptimizationLevel::OPTIMIZATION_LEVEL_2;
+
+  std::vector<SPassStats> SPassManager::stats;
+  int SPassManager::num_instructions = 0;
+
+  bool SPassManager::dump_graphs = false;
+  SGraphFormat SPassManager::dump_format = GRAPH_FORMAT_DOT;
+  std::vector<std::pair<std::string, std::string> > SPassManager::graph_dumps;
+
+
+  /*
+   * SPassManager member functions
+   */
+
+  const SPassManager::SPass* SPassManager::find(const std::string& name) {
+    for(const SPass& pass : SPassManager::passes) {
+      if(name == pass.name) {
+	return &pass;
+      }
+    }
+
+    return nullptr;
+  }
+
+  SPassManager::SSettings SPassManager::getSettings() {
+    SSettings settings;
+    settings.level = SPassManager::level;
+    for(const SPass& pass : SPassManager::passes) {
+      settings.enabled.push_back(pass.is_enabled());
+    }
+
+    return settings;
+  }
+
+  void SPassManager::setSettings(const SSettings& settings) {
+    SPassManager::level = settings.level;
+    for(unsigned int i = 0; i < SPassManager::passes.size(); i++) {
+      SPassManager::passes[i].set_enabled(settings.enabled[i]);
+    }
+  }
+
+  int SPassManager::count_instructions() {
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    int count = 0;
+    SEventInfo ev;
+    SNodeInfo info;
+    SPointerInfo pointer;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_DECLARATION:
+	ev.values[0]->getNodeInfo(info);
+	if(info.kind != NODE_CONSTANT && !SFmaContractor::isFused(ev.values[0])) {
+	  count++;
+	}
+	break;
+      case EVENT_LOAD:
+	ev.values[0]->getNodeInfo(info);
+	SLocalPromoter::root(info.pointer)->getPointerInfo(pointer);
+	if(!SLocalPromoter::isPromoted(pointer.id) && SStoreForwarder::getForwardedID(ev.values[0]) < 0) {
+	  count++;
+	}
+	break;
+      case EVENT_STORE:
+	SLocalPromoter::root(ev.pointer)->getPointerInfo(pointer);
+	if(!SLocalPromoter::isPromoted(pointer.id) && !SStoreForwarder::isDropped(i) &&
+	   !SDeadStoreEliminator::isDead(i)) {
+	  count++;
+	}
+	break;
+      default:
+	count++;
+	break;
+      }
+    }
+
+    return count;
+  }
+
+  void SPassManager::dump_graph(const std::string& stage, const std::vector<const SValueBase*>& outputs) {
+    std::string graph;
+    SGraphExporter::exportGraph(outputs, SPassManager::dump_format, graph);
+    SPassManager::graph_dumps.push_back(std::make_pair(stage, graph));
+  }
+
+  void SPassManager::begin() {
+    SPassManager::stats.clear();
+    SPassManager::graph_dumps.clear();
+
+    for(const SPass& pass : SPassManager::passes) {
+      SPassStats pass_stats;
+      pass_stats.name = pass.name;
+      pass_stats.enabled = pass.is_enabled();
+      pass_stats.is_scheduled = pass.run != nullptr;
+      pass_stats.time = 0.0;
+      pass_stats.instructions = 0;
+      pass_stats.count = pass.count ? 0 : -1;
+
+      SPassManager::stats.push_back(pass_stats);
+    }
+  }
+
+  void SPassManager::run(std::vector<uint32_t>& bin, SPrecision precision, const std::string& shader,
+			 const std::string& function, const std::vector<const SValueBase*>& outputs) {
+    // What was found in the events of the last function does not apply to these
+    SDeadStoreEliminator::clear();
+    SDeadCodeEliminator::clear();
+    SLocalPromoter::clear();
+    SStoreForwarder::clear();
+    SInvariantHoister::clear();
+    SCodeSinker::clear();
+
+    std::string prefix = function.empty() ? "" : function + ": ";
+    if(SPassManager::dump_graphs) {
+      SPassManager::dump_graph(prefix + "recorded", outputs);
+    }
+
+    int instructions = SPassManager::count_instructions();
+    for(unsigned int i = 0; i < SPassManager::passes.size(); i++) {
+      const SPass& pass = SPassManager::passes[i];
+      if(!pass.run) {
+	continue;
+      }
+
+      // Disabled passes are run as well, to clear what they found in the last shader
+      double begin = STrace::now();
+      STraceSpan span(pass.name, "pass", shader);
+
+      pass.run(bin, precision);
+
+      span.end();
+      SPassManager::stats[i].time += STrace::now() - begin;
+
+      int remaining = SPassManager::count_instructions();
+      SPassManager::stats[i].instructions += remaining - instructions;
+      instructions = remaining;
+
+      if(pass.count) {
+	SPassManager::stats[i].count += pass.count();
+      }
+
+      if(SPassManager::dump_graphs) {
+	SPassManager::dump_graph(prefix + pass.name, outputs);
+      }
+    }
+  }
+
+  void SPassManager::finish(const std::vector<uint32_t>& bin, unsigned int function_start) {
+    SPassManager::num_instructions = 0;
+    for(unsigned int i = function_start; i < bin.size(); i += bin[i] >> 16) {
+      SPassManager::num_instructions++;
+    }
+
+    // The scheduled passes have been counted function by function
+    for(unsigned int i = 0; i < SPassManager::passes.size(); i++) {
+      if(SPassManager::passes[i].count && !SPassManager::passes[i].run) {
+	SPassManager::stats[i].count = SPassManager::passes[i].count();
+      }
+    }
+  }
+
+  void SPassManager::setLevel(SOptimizationLevel level) {
+    SPassManager::level = level;
+
+    for(const SPass& pass : SPassManager::passes) {
+      pass.set_enabled(pass.levels & level_bit(level));
+    }
+  }
+
+  SOptimizationLevel SPassManager::getLevel() {
+    return SPassManager::level;
+  }
+
+  std::vector<std::string> SPassManager::getPassNames() {
+    std::vector<std::string> names;
+    for(const SPass& pass : SPassManager::passes) {
+      names.push_back(pass.name);
+    }
+
+    return names;
+  }
+
+  bool SPassManager::setPassEnabled(const std::string& name, bool enabled) {
+    const SPass* pass = SPassManager::find(name);
+    if(!pass) {
+      return false;
+    }
+
+    pass->set_enabled(enabled);
+    return true;
+  }
+
+  bool SPassManager::isPassEnabled(const std::string& name) {
+    const SPass* pass = SPassManager::find(name);
+    return pass && pass->is_enabled();
+  }
+
+  const std::vector<SPassStats>& SPassManager::getStats() {
+    return SPassManager::stats;
+  }
+
+  int SPassManager::getNumInstructions() {
+    return SPassManager::num_instructions;
+  }
+
+  std::string SPassManager::getReport() {
+    std::string report;
+    char line[128];
+
+    snprintf(line, sizeof(line), "%-26s %-8s %10s %13s %6s\n",
+	     "pass", "enabled", "time (us)", "instructions", "count");
+    report += line;
+
+    for(const SPassStats& pass : SPassManager::stats) {
+      std::string time = pass.is_scheduled ? std::to_string((int)(pass.time + 0.5)) : "-";
+      std::string instructions = pass.is_scheduled ? std::to_string(pass.instructions) : "-";
+      std::string count = pass.count >= 0 ? std::to_string(pass.count) : "-";
+
+      snprintf(line, sizeof(line), "%-26s %-8s %10s %13s %6s\n", pass.name.c_str(),
+	       pass.enabled ? "yes" : "no", time.c_str(), instructions.c_str(), count.c_str());
+      report += line;
+    }
+
+    snprintf(line, sizeof(line), "%d instructions in the function bodies\n", SPassManager::num_instructions);
+    report += line;
+    return report;
+  }
+
+  void SPassManager::setGraphDumps(bool dump, SGraphFormat format) {
+    SPassManager::dump_graphs = dump;
+    SPassManager::dump_format = format;
+  }
+
+  const std::vector<std::pair<std::string, std::string> >& SPassManager::getGraphDumps() {
+    return SPassManager::graph_dumps;
+  }
+
+};
@@ -0,0 +1,139 @@
+#ifndef __SPURV_PASS_MANAGER
+#define __SPURV_PASS_MANAGER
+
+#include "declarations.hpp"
+#include "graph_export.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace spurv {
+
+  class SValueBase;
+
+  /*
+   * SPassStats - What an optimization pass did to the last compiled shader
+   */
+
+  struct SPassStats {
+    std::string name;
+    bool enabled;
+
+    // Whether compile() runs the pass by itself. The others are applied by the node factories
+    // while the shader is recorded or written, and are neither timed nor counted in instructions
+    bool is_scheduled;
+
+    double time; // Microseconds spent in the pass, over all functions
+    int instructions; // Change in the number of instructions written, estimated from the events
+    int count; // What the pass counts (values eliminated, loads forwarded and so on), -1 if nothing
+  };
+
+
+  /*
+   * SPassManager - Knows the optimization passes by name, turns them on and off by
+   * optimization level, and runs the ones scheduled by compile() in order on the entry
+   * point and on each function (see SFunction), timing them (as STrace spans of category
+   * "pass", and in the stats) and estimating how many instructions each of them removed.
+   *
+   * The passes applied by the node factories act on what is recorded while they are
+   * enabled, so a level is to be set before the shader is recorded. Passes can still be
+   * turned on and off one by one afterwards, by name or through their own classes. The
+   * graph of the shader (see SGraphExporter) can be dumped before the scheduled passes and
+   * after each of them
+   */
+
+  class SPassManager {
+    // What the passes are set to, kept by shaders with a level of their own
+    struct SSettings {
+      SOptimizationLevel level;
+      std::vector<bool> enabled; // By pass
+    };
+
+    struct SPass {
+      const char* name;
+      int levels; // Bit mask of the SOptimizationLevels the pass is enabled at
+
+      void (*set_enabled)(bool enabled);
+      bool (*is_enabled)();
+      int (*count)(); // nullptr if the pass counts nothing
+
+      // Runs the pass on the events in SEventRegistry, nullptr if not scheduled by compile()
+      void (*run)(std::vector<uint32_t>& bin, SPrecision precision);
+    };
+
+    static const std::vector<SPass> passes; // In the order they are applied
+
+    static SOptimizationLevel level;
+
+    static std::vector<SPassStats> stats;
+    static int num_instructions;
+
+    static bool dump_graphs;
+    static SGraphFormat dump_format;
+    static std::vector<std::pair<std::string, std::string> > graph_dumps;
+
+    SPassManager() = delete;
+
+    static const SPass* find(const std::string& name);
+
+    static SSettings getSettings();
+    static void setSettings(const SSettings& settings);
+
+    // Number of instructions the events in SEventRegistry would be written as, with what
+    // the passes run so far have found. OpPhis and the definitions of types and constants
+    // are not counted
+    static int count_instructions();
+
+    static void dump_graph(const std::string& stage, const std::vector<const SValueBase*>& outputs);
+
+    // Resets the stats and dumps, before the passes are run on the first function of a shader
+    static void begin();
+
+    // Runs the passes scheduled by compile() on the events in SEventRegistry, after the header
+    // of the module is written, adding to the stats. function names the function in the
+    // dumps, and is empty for the entry point
+    static void run(std::vector<uint32_t>& bin, SPrecision precision, const std::string& shader,
+		    const std::string& function, const std::vector<const SValueBase*>& outputs);
+
+    // Counts the instructions of the functions written from function_start in bin, and what
+    // the passes applied while recording and writing did
+    static void finish(const std::vector<uint32_t>& bin, unsigned int function_start);
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+    friend class SFunctionBase;
+
+  public:
+
+    // Enables the passes of the level and disables the rest
+    static void setLevel(SOptimizationLevel level);
+    static SOptimizationLevel getLevel();
+
+    static std::vector<std::string> getPassNames();
+
+    // Return false if there is no pass with the name
+    static bool setPassEnabled(const std::string& name, bool enabled);
+    static bool isPassEnabled(const std::string& name);
+
+    // Of every pass, in the order they are applied, for the last compiled shader
+    static const std::vector<SPassStats>& getStats();
+
+    // Number of instructions in the function bodies of the last compiled shader
+    static int getNumInstructions();
+
+    // The stats as a table, one pass per line
+    static std::string getReport();
+
+    // Dumps are off by default, and replaced at every compile
+    static void setGraphDumps(bool dump, SGraphFormat format = GRAPH_FORMAT_DOT);
+
+    // The graphs dumped while compiling the last shader, each with the pass run before it
+    // ("recorded" for the one dumped before any pass), prefixed by the function for functions
+    static const std::vector<std::pair<std::string, std::string> >& getGraphDumps();
+  };
+
+};
+
+#endif // __SPURV_PASS_MANAGER
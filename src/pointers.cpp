@@ -24,4 +24,8 @@ namespace spurv {
     this->is_defined = true;
   }
 
+  SPointerBase* SPointerBase::clone(SCloneMap& map) {
+    return this;
+  }
+
 };
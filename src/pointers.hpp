@@ -7,11 +7,28 @@
 
 namespace spurv {
 
+  /*
+   * SPointerInfo - Type-independent description of a pointer
+   */
+
+  struct SPointerInfo {
+    int id;
+    SStorageClass storage;
+    DSType type; // Type pointed to
+    
+    const SPointerBase* parent; // Pointer indexed into, for access chains
+    const SValueBase* index; // Index value, for access chains
+  };
+
+  
   /*
    * SPointerBase - base for pointers
    */
 
   class SPointerBase {
+  public:
+    virtual void getPointerInfo(SPointerInfo& info) const = 0;
+
   protected:
 
     unsigned int id;
@@ -32,9 +49,16 @@ namespace spurv {
     virtual int getChainLength() = 0;
     virtual void outputChainNumber(std::vector<uint32_t>& res) = 0;
 
+    // Returns the equivalent of this pointer in an unrolled loop iteration, see SCloneMap.
+    // Variables are the same in every iteration
+    virtual SPointerBase* clone(SCloneMap& map);
+
     template<typename tt, SStorageClass storage>
     friend class SAccessChain;
 
+    friend class SCloneMap;
+    friend class SLoadEliminator;
+
     template<typename tt>
     friend class SStoreEvent;
 
@@ -103,9 +127,13 @@ namespace spurv {
     virtual int getChainLength();
     virtual void outputChainNumber(std::vector<uint32_t>& res);
 
-    
+    // A chain into this pointer, shared if possible (see SLoadEliminator)
+    template<typename rtype>
+    SAccessChain<rtype, storage>& access_chain(SValue<int_s>& index);
+
   public:
     virtual SValue<tt>& load();
+    virtual void getPointerInfo(SPointerInfo& info) const;
     
     template<int n>
     SAccessChain<typename member_access_result<tt, n>::type, storage>& member();
@@ -150,6 +178,11 @@ namespace spurv {
     virtual void ensure_type_decorated(std::vector<uint32_t>& res,
 				       std::vector<bool*>& declaration_states);
 
+    virtual SPointerBase* clone(SCloneMap& map);
+
+  public:
+    virtual void getPointerInfo(SPointerInfo& info) const;
+
     friend class SUtils;
   };
 
@@ -170,6 +203,10 @@ namespace spurv {
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void ensure_type_decorated(std::vector<uint32_t>& res,
 				       std::vector<bool*>& declaration_states);
+
+  public:
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<tt>* clone(SCloneMap& map);
     
     friend class SUtils;
     
@@ -2,6 +2,11 @@
 #define __SPURV_POINTERS_IMPL
 
 #include "pointers.hpp"
+#include "loop_unrolling_impl.hpp"
+#include "local_promotion.hpp"
+#include "load_elimination.hpp"
+#include "store_forwarding.hpp"
+#include "node_cache_impl.hpp"
 
 namespace spurv {
 
@@ -26,13 +31,36 @@ namespace spurv {
 
   template<typename tt, SStorageClass storage>
   SValue<tt>& SPointerVar<tt, storage>::load() {
+    // Loads of the same member of a uniform or storage buffer are shared, see SLoadEliminator
+    SNodeKey key;
+    if constexpr(SLoadEliminator::isEliminated(storage)) {
+	key = SNodeCache::makeKey<SLoadedVal<tt, storage> >(0, SLoadEliminator::getPath(this));
+	SLoadedVal<tt, storage>* val = (SLoadedVal<tt, storage>*)SLoadEliminator::findLoad(key, storage);
+	if(val) {
+	  return *val;
+	}
+      }
+
     SLoadEvent<tt> *ev = SEventRegistry::addLoad<tt>(this->id);
     SLoadedVal<tt, storage> *val = SUtils::allocate<SLoadedVal<tt, storage> >(this);
     ev->val_p = val;
 
+    if constexpr(SLoadEliminator::isEliminated(storage)) {
+	SLoadEliminator::insertLoad(key, val, storage);
+      }
+
     return *val;
   }
 
+  template<typename tt, SStorageClass storage>
+  void SPointerVar<tt, storage>::getPointerInfo(SPointerInfo& info) const {
+    info.id = this->id;
+    info.storage = storage;
+    tt::getDSType(&info.type);
+    info.parent = nullptr;
+    info.index = nullptr;
+  }
+
   template<typename tt, SStorageClass storage>
   void SPointerVar<tt, storage>::define(std::vector<uint32_t>& res) {
     // OpVariable
@@ -45,6 +73,14 @@ namespace spurv {
   template<typename tt, SStorageClass storage>
   void SPointerVar<tt, storage>::ensure_type_defined(std::vector<uint32_t>& res,
 					std::vector<SDeclarationState*>& declaration_states) {
+    // Promoted locals are never pointed to
+    if constexpr(storage == SStorageClass::STORAGE_FUNCTION) {
+	if(SLocalPromoter::isPromoted(this->id)) {
+	  tt::ensure_defined(res, declaration_states);
+	  return;
+	}
+      }
+
     SPointer<storage, tt>::ensure_defined(res, declaration_states);
 
     // If not a local variable, declare pointer in type-declaration section
@@ -74,15 +110,35 @@ namespace spurv {
   SAccessChain<typename member_access_result<tt, n>::type, storage>& SPointerVar<tt, storage>::member() {
     using rtype = typename member_access_result<tt, n>::type;
 
-    return *SUtils::allocate<SAccessChain<rtype, storage> >(this, n);
+    int index = n;
+    return this->template access_chain<rtype>(SValueWrapper::unwrap_to<int, int_s>(index));
   }
 
   template<typename tt, SStorageClass storage>
   template<typename tind>
   SAccessChain<typename index_access_result<tt>::type, storage>& SPointerVar<tt, storage>::operator[](tind&& ind) {
     using rtype = typename index_access_result<tt>::type;
-    
-    return *SUtils::allocate<SAccessChain<rtype, storage> >(this, ind);
+
+    return this->template access_chain<rtype>(SValueWrapper::unwrap_to<tind, int_s>(ind));
+  }
+
+  template<typename tt, SStorageClass storage>
+  template<typename rtype>
+  SAccessChain<rtype, storage>& SPointerVar<tt, storage>::access_chain(SValue<int_s>& index) {
+    if constexpr(SLoadEliminator::isEliminated(storage)) {
+	if(SLoadEliminator::isHoistable(this, index)) {
+	  SNodeKey key = SNodeCache::makeKey<SAccessChain<rtype, storage> >(0, {(int)this->id, index.getID()});
+	  SAccessChain<rtype, storage>* chain = (SAccessChain<rtype, storage>*)SLoadEliminator::findChain(key);
+	  if(!chain) {
+	    chain = SUtils::allocate<SAccessChain<rtype, storage> >(this, index);
+	    SLoadEliminator::insertChain(key, chain);
+	  }
+
+	  return *chain;
+	}
+      }
+
+    return *SUtils::allocate<SAccessChain<rtype, storage> >(this, index);
   }
 
 
@@ -140,6 +196,26 @@ namespace spurv {
     SPointer<storage, tt>::ensure_decorated(res, declaration_states);
   }
 
+  template<typename tt, SStorageClass storage>
+  SPointerBase* SAccessChain<tt, storage>::clone(SCloneMap& map) {
+    // Hoisted chains are the same in every iteration
+    if(SLoadEliminator::isHoisted(this)) {
+      return this;
+    }
+
+    // Otherwise a new chain in every iteration, as the index may differ, and the chain
+    // is defined in the block it is first used in
+    SPointerBase* parent = map.pointer(this->acb);
+    return SUtils::allocate<SAccessChain<tt, storage> >(parent, *map.value(this->index_value));
+  }
+
+  template<typename tt, SStorageClass storage>
+  void SAccessChain<tt, storage>::getPointerInfo(SPointerInfo& info) const {
+    SPointerVar<tt, storage>::getPointerInfo(info);
+    info.parent = this->acb;
+    info.index = this->index_value;
+  }
+
   /*
    * SLoadedVal member functions
    */
@@ -150,6 +226,21 @@ namespace spurv {
 
   template<typename tt, SStorageClass storage>
   void SLoadedVal<tt, storage>::define(std::vector<uint32_t>& res) {
+    // Takes on the id of the value last stored, see SLocalPromoter
+    if constexpr(storage == SStorageClass::STORAGE_FUNCTION) {
+	if(SLocalPromoter::isPromoted(this->pointer->getID())) {
+	  this->id = SLocalPromoter::load(this->pointer->getID());
+	  return;
+	}
+
+	// Or of the value stored right before, see SStoreForwarder
+	int forwarded_id = SStoreForwarder::getForwardedID(this);
+	if(forwarded_id >= 0) {
+	  this->id = forwarded_id;
+	  return;
+	}
+      }
+
     this->pointer->ensure_defined(res);
 
     // OpLoad
@@ -173,6 +264,19 @@ namespace spurv {
 
     tt::ensure_decorated(res, declaration_states);
   }
+
+  template<typename tt, SStorageClass storage>
+  void SLoadedVal<tt, storage>::getNodeInfo(SNodeInfo& info) const {
+    SValue<tt>::getNodeInfo(info);
+    info.kind = NODE_LOAD;
+    info.pointer = this->pointer;
+  }
+
+  template<typename tt, SStorageClass storage>
+  SValue<tt>* SLoadedVal<tt, storage>::clone(SCloneMap& map) {
+    // Loads are repeated, the pointed-to value may have changed since
+    return &map.pointer(this->pointer)->load();
+  }
   
 };
 
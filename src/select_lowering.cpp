@@ -0,0 +1,117 @@
+#include "select_lowering.hpp"
+#include "values.hpp"
+
+#include <unordered_set>
+#include <limits>
+
+namespace spurv {
+
+  /*
+   * SSelectLowering members
+   */
+
+  int SSelectLowering::max_cost = 8;
+  std::vector<uint32_t>* SSelectLowering::definitions = nullptr;
+  std::vector<SDeclarationState*>* SSelectLowering::declaration_states = nullptr;
+
+
+  /*
+   * SSelectLowering member functions
+   */
+
+  int SSelectLowering::node_cost(const SNodeInfo& info) {
+    switch(info.kind) {
+    case NODE_CONSTANT:
+      // Defined along with the types
+      return 0;
+    case NODE_EXPRESSION:
+      if(info.operation == EXPR_LOOKUP) {
+	SNodeInfo source;
+	info.operands[0]->getNodeInfo(source);
+
+	switch(source.type.kind) {
+	case STypeKind::KIND_ARR:
+	case STypeKind::KIND_RUN_ARR:
+	case STypeKind::KIND_IMAGE:
+	  // The index may only be in range when the condition holds
+	  return -1;
+	case STypeKind::KIND_TEXTURE:
+	  return 4;
+	default:
+	  return 1;
+	}
+      }
+
+      return info.operation == EXPR_DIVISION || info.operation == EXPR_REM ||
+	info.operation == EXPR_MOD ? 2 : 1;
+    case NODE_GLSL_FUNCTION:
+      return 4;
+    case NODE_CONSTRUCT_MATRIX:
+    case NODE_SELECT:
+    case NODE_LOAD:
+      return 1;
+    default:
+      return -1;
+    }
+  }
+
+  int SSelectLowering::cost(const std::vector<const SValueBase*>& values, int limit) {
+    std::unordered_set<const SValueBase*> visited;
+    std::vector<const SValueBase*> worklist = values;
+
+    int total = 0;
+    SNodeInfo info;
+    while(worklist.size()) {
+      const SValueBase* value = worklist.back();
+      worklist.pop_back();
+
+      if(value->isDefined() || !visited.insert(value).second) {
+	continue;
+      }
+
+      value->getNodeInfo(info);
+      int c = SSelectLowering::node_cost(info);
+      if(c < 0) {
+	return -1;
+      }
+
+      total += c;
+      if(total > limit) {
+	return total;
+      }
+
+      worklist.insert(worklist.end(), info.operands.begin(), info.operands.end());
+    }
+
+    return total;
+  }
+
+  bool SSelectLowering::shouldLower(const SValueBase* val_true, const SValueBase* val_false,
+				    SSelectionControl control) {
+    if(control == SELECTION_CONTROL_DONT_FLATTEN) {
+      return false;
+    }
+
+    // Flattening only needs the whole graph to be safe to evaluate
+    int limit = control == SELECTION_CONTROL_FLATTEN ?
+      std::numeric_limits<int>::max() : SSelectLowering::max_cost;
+    int c = SSelectLowering::cost({val_true, val_false}, limit);
+
+    return c >= 0 && c <= limit;
+  }
+
+  void SSelectLowering::setDefinitions(std::vector<uint32_t>* definitions,
+				       std::vector<SDeclarationState*>* declaration_states) {
+    SSelectLowering::definitions = definitions;
+    SSelectLowering::declaration_states = declaration_states;
+  }
+
+  void SSelectLowering::setMaxCost(int cost) {
+    SSelectLowering::max_cost = cost;
+  }
+
+  int SSelectLowering::getMaxCost() {
+    return SSelectLowering::max_cost;
+  }
+
+};
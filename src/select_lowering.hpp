@@ -0,0 +1,65 @@
+#ifndef __SPURV_SELECT_LOWERING
+#define __SPURV_SELECT_LOWERING
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace spurv {
+
+  class SValueBase;
+  struct SNodeInfo;
+
+  /*
+   * SSelectLowering - Decides whether a select is written as a single OpSelect rather
+   * than as a branch to a block per operand, joined by an OpPhi.
+   *
+   * OpSelect evaluates both operands, so the instructions that are not yet defined when
+   * the select is defined are counted (shared ones once), weighted by a rough estimate of
+   * their cost. Selects within the maximum cost are lowered. Lookups into arrays and
+   * storage images, and custom values, are never evaluated unconditionally, as they may
+   * be guarded by the condition. SELECTION_CONTROL_FLATTEN lowers regardless of cost,
+   * SELECTION_CONTROL_DONT_FLATTEN always branches
+   */
+
+  class SSelectLowering {
+    static int max_cost;
+
+    // Where the condition vectors of lowered selects are defined, as whether a select is
+    // lowered is only known once its function body is written
+    static std::vector<uint32_t>* definitions;
+    static std::vector<SDeclarationState*>* declaration_states;
+
+    SSelectLowering() = delete;
+
+    // Cost of defining info's node, or -1 if it must not be defined unconditionally
+    static int node_cost(const SNodeInfo& info);
+
+    // Cost of defining what is not yet defined of values, stopping once it exceeds limit.
+    // Returns -1 if any of it must not be defined unconditionally
+    static int cost(const std::vector<const SValueBase*>& values, int limit);
+
+    static bool shouldLower(const SValueBase* val_true, const SValueBase* val_false,
+			    SSelectionControl control);
+
+    // Set while the function bodies of a shader are written
+    static void setDefinitions(std::vector<uint32_t>* definitions,
+			       std::vector<SDeclarationState*>* declaration_states);
+
+    template<typename tt>
+    friend class SelectConstruct;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // 0 only lowers selects between values that are already defined
+    static void setMaxCost(int cost);
+    static int getMaxCost();
+  };
+
+};
+
+#endif // __SPURV_SELECT_LOWERING
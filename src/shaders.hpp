@@ -2,6 +2,9 @@
 #define __SPURV_SHADER
 
 #include "control_flow.hpp"
+#include "graph_export.hpp"
+#include "trace.hpp"
+#include "pass_manager.hpp"
 
 #include <set>
 #include <stack>
@@ -93,6 +96,9 @@ namespace spurv {
       
       virtual void* getValue() = 0;
 
+      virtual void definePointer(std::vector<uint32_t>& bin,
+				 std::vector<SDeclarationState*>& declaration_states) = 0;
+
       template<typename tt>
       SValue<tt>* getValueTyped() {
 	DSType dt = this->getPointerDSType();
@@ -154,6 +160,11 @@ namespace spurv {
 	return (void*)this->val;
       }
 
+      virtual void definePointer(std::vector<uint32_t>& bin,
+				 std::vector<SDeclarationState*>& declaration_states) {
+	this->input_var->ensure_type_defined(bin, declaration_states);
+      }
+
       virtual int getPointerID() {
 	return input_var->getID();
       }
@@ -195,6 +206,9 @@ namespace spurv {
       SBuiltinVariable builtin_id;
 
       virtual int getPointerID() = 0;
+
+      virtual void definePointer(std::vector<uint32_t>& bin,
+				 std::vector<SDeclarationState*>& declaration_states) = 0;
       
       void decorate(std::vector<uint32_t>& bin) {
 	// Decorate <builtin_id> Builtin <builtin_type>
@@ -218,6 +232,11 @@ namespace spurv {
       virtual int getPointerID() {
 	return this->pointer->getID();
       }
+
+      virtual void definePointer(std::vector<uint32_t>& bin,
+				 std::vector<SDeclarationState*>& declaration_states) {
+	this->pointer->ensure_type_defined(bin, declaration_states);
+      }
     };
     
     // We use this to reset the type declaration_states (stored for each type) after compilation
@@ -234,6 +253,21 @@ namespace spurv {
 
     std::set<SExtension> extensions;
 
+    SPrecision precision;
+
+    // The passes are shared by all shaders, so the level set on one is only applied while
+    // it is recorded and compiled, and the settings from before are restored after that, or
+    // when the shader is destroyed without being compiled
+    bool has_optimization_level;
+    SOptimizationLevel optimization_level;
+    SPassManager::SSettings outer_pass_settings;
+
+    uint32_t version; // Of SPIR-V, as in the header. Raised by the features used
+
+    // Used to tag trace spans
+    std::string name;
+    double record_begin;
+
     int glsl_id;
     int entry_point_id;
     int entry_point_declaration_size_index;
@@ -244,6 +278,7 @@ namespace spurv {
     void output_shader_header_end(std::vector<uint32_t>& binary);
     void output_used_builtin_ids(std::vector<uint32_t>& bin);
     void output_shader_header_decorate_begin(std::vector<uint32_t>& bin);
+    void output_interface_variable_definitions(std::vector<uint32_t>& bin);
 
     void output_shader_header_output_variables(std::vector<uint32_t>& binary,
 					       int n);
@@ -269,11 +304,15 @@ namespace spurv {
     void output_output_tree_type_definitions(std::vector<uint32_t>& binary, SValue<in1>& val,
 					     NodeTypes&&... args);
 
-    void output_main_function_begin(std::vector<uint32_t>& res);
+    // The type of the entry point goes to definitions, the entry point itself to body
+    void output_main_function_begin(std::vector<uint32_t>& definitions, std::vector<uint32_t>& body);
     
     void output_main_function_end(std::vector<uint32_t>& res);
     
     int get_num_defined_builtins();
+    int get_num_interface_uniforms(); // Listed in the entry point from SPIR-V 1.4
+
+    void require_version(uint32_t version);
 
     void create_output_variables();
     
@@ -289,6 +328,21 @@ namespace spurv {
     
   public:
     SShader();
+    ~SShader();
+
+    // Name used in trace output (see STrace)
+    void setName(const std::string& name);
+    const std::string& getName() const;
+
+    // How freely floating point arithmetic may be rewritten, PRECISION_STRICT by default
+    void setPrecision(SPrecision precision);
+    SPrecision getPrecision() const;
+
+    // Enables the optimization passes of the level for this shader, see SPassManager. Passes
+    // applied while recording only act on what is recorded afterwards, so this is to be set
+    // first. Holds until the shader is compiled, other shaders keep the level set with
+    // SPassManager::setLevel
+    void setOptimizationLevel(SOptimizationLevel level);
     
     template<SBuiltinVariable ind>
     SValue<typename BuiltinInfo<type, ind>::type >& getBuiltin();
@@ -313,21 +367,39 @@ namespace spurv {
     template<typename tt>
     SLocal<tt>& local();
 
-    // One argument means 0 - arg0, two arguments means arg0 - arg1
-    SValue<int_s>& forLoop(int arg0, int arg1 = 0);
+    // One argument means 0 - arg0, two arguments means arg0 - arg1. The loop is unrolled
+    // when it is ended, see SLoopUnroller. unroll_factor is the number of copies of the
+    // body for UNROLL_PARTIAL, 0 for the default. control is passed on to the driver for
+    // loops that are not unrolled fully, and raises the SPIR-V version if needed
+    SValue<int_s>& forLoop(int arg0, int arg1 = 0,
+			   SUnroll unroll = SUnroll::UNROLL_AUTO, int unroll_factor = 0,
+			   const SLoopControl& control = SLoopControl());
 
     void endLoop();
 
-    void ifThen(SValue<bool_s>& condition);
+    void ifThen(SValue<bool_s>& condition, SSelectionControl control = SELECTION_CONTROL_NONE);
     void elseThen();
     void endIf();
 
     void breakLoop();
     void continueLoop();
+
+    // Defines a function of Signature, as Ret(Args...) of spurv types, from a body taking
+    // SValue<Args>&... and returning SValue<Ret>&. The body is recorded once, and called
+    // through the returned SFunction, or recorded again inline, see SFunctionInliner.
+    // control is passed on to the driver for calls that are not inlined
+    template<typename Signature, typename Body>
+    SFunction<Signature>& function(Body&& body, SInline inlining = SInline::INLINE_AUTO,
+				   SFunctionControl control = FUNCTION_CONTROL_NONE);
     
     template<typename... NodeTypes>
     void compile(std::vector<uint32_t>& res, NodeTypes&&... args);
 
+    // Appends the graph built so far to out, see SGraphExporter. Takes the
+    // same output values as compile, and must be called before it
+    template<typename... NodeTypes>
+    void exportGraph(std::string& out, SGraphFormat format, NodeTypes&&... args);
+
   };
 
   template<typename... InputTypes>
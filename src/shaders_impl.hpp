@@ -2,6 +2,7 @@
 #define __SPURV_SHADERS_IMPL
 
 #include "shaders.hpp"
+#include "validator.hpp"
 
 namespace spurv {
 
@@ -14,6 +15,66 @@ namespace spurv {
   SShader<type, InputTypes...>::SShader() {
 
     input_entries = std::vector<InputVariableBase*>(sizeof...(InputTypes), nullptr);
+
+    this->version = 0x00010000; // 1.0
+
+    this->precision = SPrecision::PRECISION_STRICT;
+    this->has_optimization_level = false;
+    this->optimization_level = SOptimizationLevel::OPTIMIZATION_LEVEL_2;
+
+    switch(type) {
+    case SShaderType::SHADER_VERTEX:
+      this->name = "vertex shader";
+      break;
+    case SShaderType::SHADER_FRAGMENT:
+      this->name = "fragment shader";
+      break;
+    case SShaderType::SHADER_COMPUTE:
+      this->name = "compute shader";
+      break;
+    }
+
+    // Recording of the shader ends when compile is called
+    this->record_begin = STrace::now();
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  SShader<type, InputTypes...>::~SShader() {
+    // The level is still applied if the shader was not compiled since it was set
+    if(this->has_optimization_level) {
+      SPassManager::setSettings(this->outer_pass_settings);
+    }
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  void SShader<type, InputTypes...>::setName(const std::string& name) {
+    this->name = name;
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  const std::string& SShader<type, InputTypes...>::getName() const {
+    return this->name;
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  void SShader<type, InputTypes...>::setPrecision(SPrecision precision) {
+    this->precision = precision;
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  SPrecision SShader<type, InputTypes...>::getPrecision() const {
+    return this->precision;
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  void SShader<type, InputTypes...>::setOptimizationLevel(SOptimizationLevel level) {
+    if(!this->has_optimization_level) {
+      this->outer_pass_settings = SPassManager::getSettings();
+    }
+
+    this->has_optimization_level = true;
+    this->optimization_level = level;
+    SPassManager::setLevel(level);
   }
 
 
@@ -26,6 +87,18 @@ namespace spurv {
     return this->builtin_entries.size();
   }
 
+  template<SShaderType type, typename... InputTypes>
+  int SShader<type, InputTypes...>::get_num_interface_uniforms() {
+    return this->version >= 0x00010400 ? this->uniform_bindings.size() : 0;
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  void SShader<type, InputTypes...>::require_version(uint32_t version) {
+    if(version > this->version) {
+      this->version = version;
+    }
+  }
+
   template<SShaderType type, typename... InputTypes>
   void SShader<type, InputTypes...>::create_output_variables() {
     return;
@@ -133,7 +206,7 @@ namespace spurv {
   template<SShaderType type, typename... InputTypes>
   void SShader<type, InputTypes...>::output_preamble(std::vector<uint32_t>& binary) {
     binary.push_back(0x07230203); // Magic number
-    binary.push_back(0x00010000); // Version number (1.0.0)
+    binary.push_back(this->version); // Version number
     binary.push_back(0x124);      // Generator's magic number (not officially registered)
     this->id_max_bound_index = binary.size();
     binary.push_back(0); // We'll set this later
@@ -223,6 +296,11 @@ namespace spurv {
 
     output_used_builtin_ids(bin);
 
+    // From SPIR-V 1.4, the entry point lists all global variables it uses
+    for(int i = 0; i < this->get_num_interface_uniforms(); i++) {
+      SUtils::add(bin, this->uniform_bindings[i]->getPointerID());
+    }
+
   }
 
   template<SShaderType type, typename... InputTypes>
@@ -293,26 +371,52 @@ namespace spurv {
 
 
   template<SShaderType type, typename... InputTypes>
-  void SShader<type, InputTypes...>::output_main_function_begin(std::vector<uint32_t>& res) {
-    SType<STypeKind::KIND_VOID>::ensure_defined(res, this->defined_type_declaration_states);
+  void SShader<type, InputTypes...>::output_interface_variable_definitions(std::vector<uint32_t>& bin) {
+
+    // These are listed in the entry point and decorated, so they must be defined even
+    // if all loads from them were eliminated. The live ones are defined through the
+    // (possibly copied) pointer objects used by the loads and stores
+    for(unsigned int i = 0; i < this->input_entries.size(); i++) {
+      if(!SDeadCodeEliminator::isPointerLive(this->input_entries[i]->getPointerID())) {
+	this->input_entries[i]->definePointer(bin, this->defined_type_declaration_states);
+      }
+    }
+
+    for(unsigned int i = 0; i < this->builtin_entries.size(); i++) {
+      if(!SDeadCodeEliminator::isPointerLive(this->builtin_entries[i]->getPointerID())) {
+	this->builtin_entries[i]->definePointer(bin, this->defined_type_declaration_states);
+      }
+    }
+
+    for(unsigned int i = 0; i < this->uniform_bindings.size(); i++) {
+      if(!SDeadCodeEliminator::isPointerLive(this->uniform_bindings[i]->getPointerID())) {
+	this->uniform_bindings[i]->definePointer(bin, this->defined_type_declaration_states);
+      }
+    }
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  void SShader<type, InputTypes...>::output_main_function_begin(std::vector<uint32_t>& definitions,
+								 std::vector<uint32_t>& body) {
+    SType<STypeKind::KIND_VOID>::ensure_defined(definitions, this->defined_type_declaration_states);
 
     int void_function_type = SUtils::getNewID();
 
     // OpTypeFunction <result_id> <result type> <result_id>
-    SUtils::add(res, (3 << 16) | 33);
-    SUtils::add(res, void_function_type);
-    SUtils::add(res, SType<STypeKind::KIND_VOID>::getID());
+    SUtils::add(definitions, (3 << 16) | 33);
+    SUtils::add(definitions, void_function_type);
+    SUtils::add(definitions, SType<STypeKind::KIND_VOID>::getID());
 
     // OpFunction <result type> <result_id> <function_control> <function_type>
-    SUtils::add(res, (5 << 16) | 54);
-    SUtils::add(res, SType<STypeKind::KIND_VOID>::getID());
-    SUtils::add(res, entry_point_id);
-    SUtils::add(res, 0);
-    SUtils::add(res, void_function_type);
+    SUtils::add(body, (5 << 16) | 54);
+    SUtils::add(body, SType<STypeKind::KIND_VOID>::getID());
+    SUtils::add(body, entry_point_id);
+    SUtils::add(body, 0);
+    SUtils::add(body, void_function_type);
 
     // OpLabel <result_id>
-    SUtils::add(res, (2 << 16) | 248);
-    SUtils::add(res, SUtils::getNewID());
+    SUtils::add(body, (2 << 16) | 248);
+    SUtils::add(body, SUtils::getNewID());
 
   }
 
@@ -452,8 +556,8 @@ namespace spurv {
   }
 
   template<SShaderType type, typename... InputTypes>
-  void SShader<type, InputTypes...>::ifThen(SValue<bool_s>& condition) {
-    SIfThen* it = SUtils::allocate<SIfThen>(&condition);
+  void SShader<type, InputTypes...>::ifThen(SValue<bool_s>& condition, SSelectionControl control) {
+    SIfThen* it = SUtils::allocate<SIfThen>(&condition, control);
     this->block_stack.push_back(it);
     SEventRegistry::addIf(it);
   }
@@ -495,8 +599,24 @@ namespace spurv {
   }
 
   template<SShaderType type, typename... InputTypes>
-  SValue<int_s>& SShader<type, InputTypes...>::forLoop(int arg0, int arg1) {
+  SValue<int_s>& SShader<type, InputTypes...>::forLoop(int arg0, int arg1,
+						       SUnroll unroll, int unroll_factor,
+						       const SLoopControl& control) {
+    if(control.unroll && control.dont_unroll) {
+      printf("[spurv] A loop can not be both unrolled and not unrolled\n");
+      exit(-1);
+    }
+    if(control.dependency_length < 0 || control.min_iterations < 0 || control.max_iterations < 0 ||
+       (control.max_iterations && control.min_iterations > control.max_iterations)) {
+      printf("[spurv] Invalid dependency length or iteration counts in loop control\n");
+      exit(-1);
+    }
+
     SForLoop* fl = SUtils::allocate<SForLoop>(arg0, arg1);
+    fl->unroll = unroll;
+    fl->unroll_factor = unroll_factor;
+    fl->control = control;
+    this->require_version(control.getRequiredVersion());
     this->block_stack.push_back(fl);
     SEventRegistry::addForBegin(fl);
 
@@ -517,6 +637,8 @@ namespace spurv {
     SForLoop* fl = (SForLoop*)this->block_stack[this->block_stack.size() - 1];
     this->block_stack.pop_back();
     SEventRegistry::addForEnd(fl);
+
+    SLoopUnroller::unroll(fl);
   }
 
   template<SShaderType type, typename... InputTypes>
@@ -557,15 +679,50 @@ namespace spurv {
     SEventRegistry::addContinue(fl);
   }
 
+  template<SShaderType type, typename... InputTypes>
+  template<typename Signature, typename Body>
+  SFunction<Signature>& SShader<type, InputTypes...>::function(Body&& body, SInline inlining,
+							       SFunctionControl control) {
+    SFunction<Signature>* function = SUtils::allocate<SFunction<Signature> >(body, inlining, control);
+
+    // Functions that are always inlined are only recorded where they are called
+    if(inlining == SInline::INLINE_ALWAYS) {
+      return *function;
+    }
+
+    // The body is recorded outside of the blocks the function is defined in
+    std::vector<SControlStructureBase*> outer_blocks;
+    std::swap(outer_blocks, this->block_stack);
+
+    function->record();
+
+    if(this->block_stack.size()) {
+      printf("[spurv] There were unfinished loops/if statements in function\n");
+      exit(-1);
+    }
+
+    std::swap(outer_blocks, this->block_stack);
+
+    return *function;
+  }
+
   template<SShaderType type, typename... InputTypes>
   template<typename... NodeTypes>
   void SShader<type, InputTypes...>::compile(std::vector<uint32_t>& res, NodeTypes&&... args) {
 
+    if(STrace::isEnabled()) {
+      STrace::addSpan("record", "record", this->name, this->record_begin, STrace::now());
+    }
+
+    STraceSpan compile_span("compile", "compile", this->name);
+
     if(this->block_stack.size()) {
       printf("[spurv] There were unfinished loops/if statements in shader\n");
       exit(-1);
     }
 
+    STraceSpan header_span("header", "compile", this->name);
+
     this->create_output_variables(args...);
 
     this->output_preamble(res);
@@ -577,35 +734,127 @@ namespace spurv {
 
     this->output_shader_header_end(res);
 
-    res[this->entry_point_declaration_size_index] |= ( 3 + 2 + this->input_entries.size() + num_args + get_num_defined_builtins()) << 16;
+    res[this->entry_point_declaration_size_index] |= ( 3 + 2 + this->input_entries.size() + num_args + get_num_defined_builtins() +
+						     get_num_interface_uniforms()) << 16;
 
 
     this->output_shader_header_decorate_begin(res);
     this->output_shader_header_decorate_output_variables(res, 0, args...);
     this->output_shader_header_decorate_tree(res, args...);
 
-    SEventRegistry::write_type_definitions(res,
+    header_span.end();
+
+    // In case another shader has changed the passes since the level was set
+    if(this->has_optimization_level) {
+      SPassManager::setLevel(this->optimization_level);
+    }
+
+    std::vector<const SValueBase*> outputs = { &args... };
+    SPassManager::begin();
+    SPassManager::run(res, this->precision, this->name, "", outputs);
+
+    STraceSpan types_span("type definitions", "compile", this->name);
+
+    SStrengthReducer::reset();
+    SSlpVectorizer::reset();
+
+    // Types and constants of the functions are only known once the calls to them are written,
+    // but go before any function body
+    std::vector<uint32_t> definitions;
+    std::vector<uint32_t> bodies;
+
+    this->output_interface_variable_definitions(definitions);
+    SEventRegistry::write_type_definitions(definitions,
 					   this->defined_type_declaration_states);
-    this->output_output_tree_type_definitions(res, args...);
+    this->output_output_tree_type_definitions(definitions, args...);
+
+    types_span.end();
+    STraceSpan body_span("function body", "compile", this->name);
+
+    SSelectLowering::setDefinitions(&definitions, &this->defined_type_declaration_states);
 
-    this->output_main_function_begin(res);
+    this->output_main_function_begin(definitions, bodies);
 
-    SVariableRegistry::write_variable_definitions(res);
+    SVariableRegistry::write_variable_definitions(bodies);
+    SLocalPromoter::write_initial_values(bodies, 0);
+    SLoadEliminator::write_chains(bodies);
 
-    SEventRegistry::write_events(res);
+    SEventRegistry::write_events(bodies);
 
-    this->output_main_function_end(res);
+    this->output_main_function_end(bodies);
+
+    body_span.end();
+
+    SFunctionBase::compile_functions(res, definitions, bodies, this->precision, this->name,
+				     this->defined_type_declaration_states);
+
+    SSelectLowering::setDefinitions(nullptr, nullptr);
+
+    res.insert(res.end(), definitions.begin(), definitions.end());
+    unsigned int function_start = res.size();
+    res.insert(res.end(), bodies.begin(), bodies.end());
+
+    SPassManager::finish(res, function_start);
 
     res[this->id_max_bound_index] = SUtils::getCurrentID();
 
+#ifndef NDEBUG
+    if(SValidator::isEnabled()) {
+      STraceSpan validate_span("validate", "compile", this->name);
+
+      std::string validation_error;
+      if(!SValidator::validate(res, validation_error)) {
+	printf("[spurv::SShader::compile] Generated invalid SPIR-V: %s\n", validation_error.c_str());
+	exit(-1);
+      }
+    }
+#endif // NDEBUG
+
+    STraceSpan cleanup_span("cleanup", "compile", this->name);
+
+    SNodeCache::trace(this->name);
+    SLoadEliminator::trace(this->name);
+
     this->cleanup_declaration_states();
     this->cleanup_decoration_states();
 
+    SFunctionBase::clear();
     SUtils::resetID();
     SUtils::clearAllocations();
     SConstantRegistry::resetRegistry();
     SEventRegistry::clear();
     SVariableRegistry::clear();
+    SNodeCache::clear();
+    SDeadCodeEliminator::clear();
+    SDeadStoreEliminator::clear();
+    SLocalPromoter::clear();
+    SFmaContractor::clear();
+    SLoadEliminator::clear();
+    SStoreForwarder::clear();
+    SInvariantHoister::clear();
+    SCodeSinker::clear();
+    SFunctionInliner::clear();
+
+    if(this->has_optimization_level) {
+      SPassManager::setSettings(this->outer_pass_settings);
+      this->has_optimization_level = false;
+    }
+
+    cleanup_span.end();
+    compile_span.end();
+    
+    this->record_begin = STrace::now();
+  }
+
+  template<SShaderType type, typename... InputTypes>
+  template<typename... NodeTypes>
+  void SShader<type, InputTypes...>::exportGraph(std::string& out, SGraphFormat format,
+						 NodeTypes&&... args) {
+    STraceSpan span("export graph", "export", this->name);
+    
+    std::vector<const SValueBase*> outputs = { &args... };
+    
+    SGraphExporter::exportGraph(outputs, format, out);
   }
 };
 #endif // __SPURV_SHADERS_IMPL
@@ -0,0 +1,38 @@
+#include "slp_vectorization.hpp"
+
+namespace spurv {
+
+  /*
+   * SSlpVectorizer members
+   */
+
+  bool SSlpVectorizer::enabled = true;
+
+  int SSlpVectorizer::num_vectorized = 0;
+
+
+  /*
+   * SSlpVectorizer member functions
+   */
+
+  void SSlpVectorizer::reset() {
+    SSlpVectorizer::num_vectorized = 0;
+  }
+
+  void SSlpVectorizer::count() {
+    SSlpVectorizer::num_vectorized++;
+  }
+
+  void SSlpVectorizer::setEnabled(bool enabled) {
+    SSlpVectorizer::enabled = enabled;
+  }
+
+  bool SSlpVectorizer::isEnabled() {
+    return SSlpVectorizer::enabled;
+  }
+
+  int SSlpVectorizer::getNumVectorized() {
+    return SSlpVectorizer::num_vectorized;
+  }
+
+};
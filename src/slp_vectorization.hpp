@@ -0,0 +1,55 @@
+#ifndef __SPURV_SLP_VECTORIZATION
+#define __SPURV_SLP_VECTORIZATION
+
+#include "declarations.hpp"
+
+namespace spurv {
+
+  /*
+   * SSlpVectorizer - Computes vectors constructed from the same operation on each component
+   * as a single vector operation on the vectors of the operands (superword-level
+   * parallelism), as in vec3(a.x + b.x, a.y + b.y, a.z + b.z), which becomes a + b.
+   *
+   * Components that are all additions, subtractions, multiplications, negations or float
+   * divisions are vectorized when the construction is recorded (see ConstructMatrix),
+   * recursively through operands that are the same operation on each component as well.
+   * Operands whose components are extracted from one vector in order are that vector,
+   * the rest are gathered like any other construction: as a constant, a shuffle or an
+   * OpCompositeConstruct. A construction is only vectorized if that takes fewer
+   * instructions than computing and gathering the components, assuming nothing else uses
+   * them. Integer division is left per component, where SStrengthReducer may reduce it
+   */
+
+  class SSlpVectorizer {
+    static bool enabled;
+    static int num_vectorized;
+
+    // Number of operations deep a vectorization may reach
+    static constexpr int max_depth = 4;
+
+    SSlpVectorizer() = delete;
+
+    static void reset();
+
+    static void count();
+
+    template<int n, int m, typename inner>
+    friend class ConstructMatrix;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Vectorization is on by default. Only affects constructions recorded afterwards
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of constructions written as vector operations in the last compiled shader. Copies
+    // in unrolled loops are replaced by their vector operations, and not counted
+    static int getNumVectorized();
+  };
+
+};
+
+#endif // __SPURV_SLP_VECTORIZATION
@@ -0,0 +1,200 @@
+#include "store_forwarding.hpp"
+#include "event_registry.hpp"
+#include "pointers.hpp"
+#include "dead_code_elimination.hpp"
+#include "local_promotion.hpp"
+
+#include <algorithm>
+
+namespace spurv {
+
+  /*
+   * SStoreForwarder members
+   */
+
+  bool SStoreForwarder::enabled = true;
+
+  std::unordered_map<const SValueBase*, const SValueBase*> SStoreForwarder::forwarded;
+  std::unordered_set<int> SStoreForwarder::dropped_stores;
+  std::unordered_set<int> SStoreForwarder::eliminated;
+
+  int SStoreForwarder::num_forwarded = 0;
+  int SStoreForwarder::num_dropped = 0;
+
+
+  /*
+   * SStoreForwarder member functions
+   */
+
+  bool SStoreForwarder::get_access(const SPointerBase* pointer, SAccess& access) {
+    access.path.clear();
+    access.constant.clear();
+
+    SPointerInfo info;
+    SNodeInfo index_info;
+    while(true) {
+      pointer->getPointerInfo(info);
+      if(info.parent == nullptr) {
+	break;
+      }
+
+      info.index->getNodeInfo(index_info);
+      access.path.push_back(index_info.id);
+      access.constant.push_back(index_info.kind == NODE_CONSTANT);
+      pointer = info.parent;
+    }
+
+    if(info.storage != SStorageClass::STORAGE_FUNCTION || SLocalPromoter::isPromoted(info.id)) {
+      return false;
+    }
+
+    access.path.push_back(info.id);
+    access.constant.push_back(true);
+    std::reverse(access.path.begin(), access.path.end());
+    std::reverse(access.constant.begin(), access.constant.end());
+    return true;
+  }
+
+  bool SStoreForwarder::may_alias(const SAccess& a, const SAccess& b) {
+    if(a.path[0] != b.path[0]) {
+      return false;
+    }
+
+    // Equal constants share ids, so constant indices with different ids are different members
+    unsigned int length = std::min(a.path.size(), b.path.size());
+    for(unsigned int i = 1; i < length; i++) {
+      if(a.path[i] != b.path[i] && a.constant[i] && b.constant[i]) {
+	return false;
+      }
+    }
+
+    return true;
+  }
+
+  void SStoreForwarder::analyze() {
+    SStoreForwarder::clear();
+    SStoreForwarder::num_forwarded = 0;
+    SStoreForwarder::num_dropped = 0;
+
+    if(!SStoreForwarder::enabled) {
+      return;
+    }
+
+    const std::vector<STimeEventBase*>& events = SEventRegistry::events;
+
+    // The stores made so far in the current block, with the values stored
+    std::vector<std::pair<SAccess, const SValueBase*> > available;
+
+    std::unordered_map<int, std::vector<int> > stores; // Event numbers, by local
+    std::unordered_set<int> loaded; // Locals with loads that are not forwarded
+    std::unordered_set<int> iterators; // Written by the loops themselves
+
+    SEventInfo ev;
+    SNodeInfo node;
+    SPointerInfo pointer;
+    SAccess access;
+    for(unsigned int i = 0; i < events.size(); i++) {
+      if(!SDeadCodeEliminator::isEventLive(i)) {
+	continue;
+      }
+      events[i]->getEventInfo(ev);
+
+      switch(ev.kind) {
+      case EVENT_DECLARATION:
+      case EVENT_IMAGE_STORE:
+	break;
+      case EVENT_STORE:
+	if(SStoreForwarder::get_access(ev.pointer, access) && !iterators.count(access.path[0])) {
+	  available.erase(std::remove_if(available.begin(), available.end(),
+					 [&](const std::pair<SAccess, const SValueBase*>& store) {
+					   return SStoreForwarder::may_alias(store.first, access);
+					 }), available.end());
+	  available.push_back(std::make_pair(access, ev.values[0]));
+	  stores[access.path[0]].push_back(i);
+	}
+	break;
+      case EVENT_LOAD:
+	ev.values[0]->getNodeInfo(node);
+	if(SStoreForwarder::get_access(node.pointer, access) && !iterators.count(access.path[0])) {
+	  bool is_forwarded = false;
+	  for(const std::pair<SAccess, const SValueBase*>& store : available) {
+	    if(store.first.path == access.path) {
+	      SStoreForwarder::forwarded[ev.values[0]] = store.second;
+	      SStoreForwarder::num_forwarded++;
+	      is_forwarded = true;
+	      break;
+	    }
+	  }
+
+	  if(!is_forwarded) {
+	    loaded.insert(access.path[0]);
+	  }
+	}
+	break;
+      case EVENT_FOR_BEGIN:
+	ev.pointer->getPointerInfo(pointer);
+	iterators.insert(pointer.id);
+	available.clear();
+	break;
+      default:
+	// Control flow, the next block may be reached from elsewhere
+	available.clear();
+	break;
+      }
+    }
+
+    // Nothing reads what is stored to locals whose loads are all forwarded
+    for(const std::pair<const int, std::vector<int> >& local : stores) {
+      if(loaded.count(local.first)) {
+	continue;
+      }
+
+      SStoreForwarder::dropped_stores.insert(local.second.begin(), local.second.end());
+      SStoreForwarder::eliminated.insert(local.first);
+      SStoreForwarder::num_dropped += local.second.size();
+    }
+  }
+
+  int SStoreForwarder::getForwardedID(const SValueBase* load) {
+    std::unordered_map<const SValueBase*, const SValueBase*>::iterator it = SStoreForwarder::forwarded.find(load);
+    if(it == SStoreForwarder::forwarded.end()) {
+      return -1;
+    }
+
+    // The stored value may itself be a forwarded or promoted load, whose id is set when it is written
+    SNodeInfo info;
+    it->second->getNodeInfo(info);
+    return info.id;
+  }
+
+  bool SStoreForwarder::isDropped(int event_num) {
+    return SStoreForwarder::dropped_stores.count(event_num);
+  }
+
+  bool SStoreForwarder::isEliminated(int pointer_id) {
+    return SStoreForwarder::eliminated.count(pointer_id);
+  }
+
+  void SStoreForwarder::clear() {
+    SStoreForwarder::forwarded.clear();
+    SStoreForwarder::dropped_stores.clear();
+    SStoreForwarder::eliminated.clear();
+  }
+
+  void SStoreForwarder::setEnabled(bool enabled) {
+    SStoreForwarder::enabled = enabled;
+  }
+
+  bool SStoreForwarder::isEnabled() {
+    return SStoreForwarder::enabled;
+  }
+
+  int SStoreForwarder::getNumForwarded() {
+    return SStoreForwarder::num_forwarded;
+  }
+
+  int SStoreForwarder::getNumDropped() {
+    return SStoreForwarder::num_dropped;
+  }
+
+};
@@ -0,0 +1,87 @@
+#ifndef __SPURV_STORE_FORWARDING
+#define __SPURV_STORE_FORWARDING
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace spurv {
+
+  class SPointerBase;
+  class SValueBase;
+
+  /*
+   * SStoreForwarder - Gives loads from local variables the value stored right before,
+   * for the locals SLocalPromoter leaves in memory (those indexed into through access
+   * chains, or all of them if promotion is disabled).
+   *
+   * Within a block, a load from the same member (the same variable, with the same index
+   * ids) as an earlier store takes on the id of the stored value instead of being written,
+   * as long as no store that may alias it has been recorded in between. Stores to locals
+   * whose loads are all forwarded are left out, together with the variable itself
+   */
+
+  class SStoreForwarder {
+    static bool enabled;
+
+    // Analysis
+    static std::unordered_map<const SValueBase*, const SValueBase*> forwarded; // Stored value, by load
+    static std::unordered_set<int> dropped_stores; // By event number
+    static std::unordered_set<int> eliminated; // Pointer ids of locals no longer accessed
+
+    static int num_forwarded;
+    static int num_dropped;
+
+    // A store to or load from a local, as the ids of the variable and the indices
+    struct SAccess {
+      std::vector<int> path;
+      std::vector<bool> constant; // Whether each index is constant
+    };
+
+    SStoreForwarder() = delete;
+
+    // Returns false if the pointer is not into a local left in memory
+    static bool get_access(const SPointerBase* pointer, SAccess& access);
+
+    static bool may_alias(const SAccess& a, const SAccess& b);
+
+    // Finds the loads to forward among the live events in SEventRegistry. Expects
+    // SDeadCodeEliminator and SLocalPromoter to have analyzed them
+    static void analyze();
+
+    // The id of the value forwarded to the load, -1 if it is not forwarded
+    static int getForwardedID(const SValueBase* load);
+
+    static bool isDropped(int event_num);
+    static bool isEliminated(int pointer_id);
+
+    static void clear();
+
+    friend class SVariableRegistry;
+    friend class SPassManager;
+
+    template<typename tt, SStorageClass storage>
+    friend class SLoadedVal;
+
+    template<typename tt>
+    friend class SStoreEvent;
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Forwarding is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Numbers of loads forwarded and stores left out in the last compiled shader
+    static int getNumForwarded();
+    static int getNumDropped();
+  };
+
+};
+
+#endif // __SPURV_STORE_FORWARDING
@@ -0,0 +1,356 @@
+#include "strength_reduction.hpp"
+#include "constant_registry_impl.hpp"
+#include "types_impl.hpp"
+#include "utils_impl.hpp"
+
+namespace spurv {
+
+  /*
+   * Utility functions
+   */
+
+  // Returns k if d is 2^k, -1 otherwise
+  static int exact_log2(uint32_t d) {
+    if(d == 0 || (d & (d - 1)) != 0) {
+      return -1;
+    }
+
+    int k = 0;
+    while((d >> k) != 1) {
+      k++;
+    }
+
+    return k;
+  }
+
+
+  /*
+   * SStrengthReducer members
+   */
+
+  bool SStrengthReducer::enabled = true;
+  int SStrengthReducer::num_reduced = 0;
+
+
+  /*
+   * SStrengthReducer member functions
+   */
+
+  SStrengthReducer::SReduction SStrengthReducer::plan(SExprOp op, bool is_signed, uint32_t divisor) {
+    SReduction reduction = {REDUCTION_NONE, op, is_signed, divisor, 0, 0};
+
+    if(!SStrengthReducer::enabled) {
+      return reduction;
+    }
+
+    if(!is_signed) {
+      if(divisor < 2) {
+	return reduction;
+      }
+
+      int k = exact_log2(divisor);
+      if(k > 0) {
+	if(op == EXPR_DIVISION) {
+	  reduction.kind = REDUCTION_UNSIGNED_SHIFT;
+	  reduction.shift = k;
+	} else {
+	  reduction.kind = REDUCTION_MASK;
+	  reduction.magic = divisor - 1;
+	}
+
+	return reduction;
+      }
+
+      // 2^(l - 1) < divisor < 2^l
+      int l = 32 - __builtin_clz(divisor);
+
+      // Look for the smallest p = 32 + s for which ceil(2^p / divisor) fits in 32 bits and
+      // is close enough to 2^p / divisor for the quotient to be exact for all dividends
+      for(int s = 0; s < l; s++) {
+	uint64_t two_p = (uint64_t)1 << (32 + s);
+	uint64_t m = (two_p + divisor - 1) / divisor;
+	if(m < ((uint64_t)1 << 32) && m * divisor - two_p <= ((uint64_t)1 << s)) {
+	  reduction.kind = REDUCTION_UNSIGNED_MAGIC;
+	  reduction.magic = (uint32_t)m;
+	  reduction.shift = s;
+	  return reduction;
+	}
+      }
+
+      // The magic number needs 33 bits, the top one is added back after the multiplication
+      reduction.kind = REDUCTION_UNSIGNED_MAGIC_ADD;
+      reduction.magic = (uint32_t)((((uint64_t)1 << 32) * (((uint64_t)1 << l) - divisor)) / divisor + 1);
+      reduction.shift = l - 1;
+      return reduction;
+    }
+
+    int32_t d = (int32_t)divisor;
+    if(d == 0 || d == 1 || d == -1 || divisor == 0x80000000u) {
+      return reduction;
+    }
+
+    uint32_t ad = d < 0 ? -divisor : divisor;
+    int k = exact_log2(ad);
+
+    if(op == EXPR_MOD) {
+      // The result of OpSMod has the sign of the divisor
+      if(d > 0 && k > 0) {
+	reduction.kind = REDUCTION_MASK;
+	reduction.magic = divisor - 1;
+      }
+
+      return reduction;
+    }
+
+    if(k > 0) {
+      reduction.kind = REDUCTION_SIGNED_POW2;
+      reduction.shift = k;
+      return reduction;
+    }
+
+    // Hacker's Delight, figure 10-1
+    const uint32_t two31 = 0x80000000u;
+    uint32_t t = two31 + (divisor >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    uint32_t q1 = two31 / anc;
+    uint32_t r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad;
+    uint32_t r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+      p++;
+      q1 *= 2;
+      r1 *= 2;
+      if(r1 >= anc) {
+	q1++;
+	r1 -= anc;
+      }
+
+      q2 *= 2;
+      r2 *= 2;
+      if(r2 >= ad) {
+	q2++;
+	r2 -= ad;
+      }
+
+      delta = ad - r2;
+    } while(q1 < delta || (q1 == delta && r1 == 0));
+
+    reduction.kind = REDUCTION_SIGNED_MAGIC;
+    reduction.magic = d < 0 ? -(q2 + 1) : q2 + 1;
+    reduction.shift = p - 32;
+    return reduction;
+  }
+
+  std::vector<uint32_t> SStrengthReducer::constants(const SReduction& reduction) {
+    switch(reduction.kind) {
+    case REDUCTION_UNSIGNED_SHIFT:
+      return { (uint32_t)reduction.shift };
+    case REDUCTION_MASK:
+      return { reduction.magic };
+    case REDUCTION_SIGNED_POW2:
+      return { 31, 32 - (uint32_t)reduction.shift, (uint32_t)reduction.shift,
+	       ~(((uint32_t)1 << reduction.shift) - 1) };
+    case REDUCTION_UNSIGNED_MAGIC:
+      return { reduction.magic, (uint32_t)reduction.shift, reduction.divisor };
+    case REDUCTION_UNSIGNED_MAGIC_ADD:
+      return { reduction.magic, 1, (uint32_t)reduction.shift, reduction.divisor };
+    case REDUCTION_SIGNED_MAGIC:
+      return { reduction.magic, (uint32_t)reduction.shift, 31, reduction.divisor };
+    default:
+      return {};
+    }
+  }
+
+  uint32_t SStrengthReducer::constant(const SReduction& reduction, uint32_t value) {
+    return SConstantRegistry::getIDInteger(32, reduction.is_signed ? 1 : 0, (int)value);
+  }
+
+  uint32_t SStrengthReducer::add(std::vector<uint32_t>& bin, const SReduction& reduction, int opcode,
+				 uint32_t a, uint32_t b) {
+    uint32_t id = SUtils::getNewID();
+
+    // <opcode> <result_type> <result_id> <operand_1> <operand_2>
+    SUtils::add(bin, (5 << 16) | opcode);
+    SUtils::add(bin, reduction.is_signed ? int_s::getID() : uint_s::getID());
+    SUtils::add(bin, id);
+    SUtils::add(bin, a);
+    SUtils::add(bin, b);
+
+    return id;
+  }
+
+  uint32_t SStrengthReducer::mul_high(std::vector<uint32_t>& bin, const SReduction& reduction, uint32_t a) {
+    uint32_t product_id = SUtils::getNewID();
+
+    // OpUMulExtended / OpSMulExtended <result_type> <result_id> <operand_1> <operand_2>
+    SUtils::add(bin, (5 << 16) | (reduction.is_signed ? 152 : 151));
+    if(reduction.is_signed) {
+      SUtils::add(bin, SStruct<SDecoration::NONE, int_s, int_s>::getID());
+    } else {
+      SUtils::add(bin, SStruct<SDecoration::NONE, uint_s, uint_s>::getID());
+    }
+    SUtils::add(bin, product_id);
+    SUtils::add(bin, a);
+    SUtils::add(bin, SStrengthReducer::constant(reduction, reduction.magic));
+
+    uint32_t id = SUtils::getNewID();
+
+    // OpCompositeExtract <result_type> <result_id> <composite> <index>
+    SUtils::add(bin, (5 << 16) | 81);
+    SUtils::add(bin, reduction.is_signed ? int_s::getID() : uint_s::getID());
+    SUtils::add(bin, id);
+    SUtils::add(bin, product_id);
+    SUtils::add(bin, 1); // The high word
+
+    return id;
+  }
+
+  void SStrengthReducer::reset() {
+    SStrengthReducer::num_reduced = 0;
+  }
+
+  void SStrengthReducer::setEnabled(bool enabled) {
+    SStrengthReducer::enabled = enabled;
+  }
+
+  bool SStrengthReducer::isEnabled() {
+    return SStrengthReducer::enabled;
+  }
+
+  int SStrengthReducer::getNumReduced() {
+    return SStrengthReducer::num_reduced;
+  }
+
+  void SStrengthReducer::defineConstants(SExprOp op, bool is_signed, uint32_t divisor,
+					 std::vector<uint32_t>& bin,
+					 std::vector<SDeclarationState*>& declaration_states) {
+    SReduction reduction = SStrengthReducer::plan(op, is_signed, divisor);
+    if(reduction.kind == REDUCTION_NONE) {
+      return;
+    }
+
+    if(reduction.kind == REDUCTION_UNSIGNED_MAGIC || reduction.kind == REDUCTION_UNSIGNED_MAGIC_ADD) {
+      SStruct<SDecoration::NONE, uint_s, uint_s>::ensure_defined(bin, declaration_states);
+    } else if(reduction.kind == REDUCTION_SIGNED_MAGIC) {
+      SStruct<SDecoration::NONE, int_s, int_s>::ensure_defined(bin, declaration_states);
+    }
+
+    for(uint32_t value : SStrengthReducer::constants(reduction)) {
+      if(is_signed) {
+	SConstantRegistry::ensureDefinedConstant<int32_t>((int32_t)value, SUtils::getNewID(), bin);
+      } else {
+	SConstantRegistry::ensureDefinedConstant<uint32_t>(value, SUtils::getNewID(), bin);
+      }
+    }
+  }
+
+  bool SStrengthReducer::write(SExprOp op, bool is_signed, uint32_t divisor,
+			       uint32_t result_id, uint32_t dividend_id, std::vector<uint32_t>& bin) {
+    SReduction r = SStrengthReducer::plan(op, is_signed, divisor);
+    if(r.kind == REDUCTION_NONE) {
+      return false;
+    }
+
+    unsigned int start = bin.size();
+    uint32_t x = dividend_id;
+    uint32_t q = 0;
+
+    switch(r.kind) {
+    case REDUCTION_UNSIGNED_SHIFT:
+      // OpShiftRightLogical
+      add(bin, r, 194, x, constant(r, r.shift));
+      break;
+
+    case REDUCTION_MASK:
+      // OpBitwiseAnd
+      add(bin, r, 199, x, constant(r, r.magic));
+      break;
+
+    case REDUCTION_SIGNED_POW2:
+      {
+	// Add 2^k - 1 to negative dividends, built from the sign bit
+	uint32_t bias = r.shift == 1 ? x : add(bin, r, 195, x, constant(r, 31)); // OpShiftRightArithmetic
+	bias = add(bin, r, 194, bias, constant(r, 32 - r.shift)); // OpShiftRightLogical
+	uint32_t u = add(bin, r, 128, x, bias); // OpIAdd
+
+	if(op == EXPR_DIVISION) {
+	  q = add(bin, r, 195, u, constant(r, r.shift)); // OpShiftRightArithmetic
+
+	  if((int32_t)divisor < 0) {
+	    // OpSNegate <result_type> <result_id> <operand>
+	    SUtils::add(bin, (4 << 16) | 126);
+	    SUtils::add(bin, int_s::getID());
+	    SUtils::add(bin, SUtils::getNewID());
+	    SUtils::add(bin, q);
+	  }
+	} else {
+	  uint32_t v = add(bin, r, 199, u, constant(r, ~(((uint32_t)1 << r.shift) - 1))); // OpBitwiseAnd
+	  add(bin, r, 130, x, v); // OpISub
+	}
+      }
+      break;
+
+    case REDUCTION_UNSIGNED_MAGIC:
+      q = mul_high(bin, r, x);
+      if(r.shift > 0) {
+	q = add(bin, r, 194, q, constant(r, r.shift)); // OpShiftRightLogical
+      }
+      break;
+
+    case REDUCTION_UNSIGNED_MAGIC_ADD:
+      {
+	// q = (t + ((x - t) >> 1)) >> (l - 1), which does not overflow
+	uint32_t t = mul_high(bin, r, x);
+	uint32_t v = add(bin, r, 130, x, t); // OpISub
+	v = add(bin, r, 194, v, constant(r, 1)); // OpShiftRightLogical
+	v = add(bin, r, 128, t, v); // OpIAdd
+	q = add(bin, r, 194, v, constant(r, r.shift)); // OpShiftRightLogical
+      }
+      break;
+
+    case REDUCTION_SIGNED_MAGIC:
+      {
+	q = mul_high(bin, r, x);
+
+	// The magic number overflowed into the sign bit
+	if((int32_t)divisor > 0 && (int32_t)r.magic < 0) {
+	  q = add(bin, r, 128, q, x); // OpIAdd
+	} else if((int32_t)divisor < 0 && (int32_t)r.magic > 0) {
+	  q = add(bin, r, 130, q, x); // OpISub
+	}
+
+	if(r.shift > 0) {
+	  q = add(bin, r, 195, q, constant(r, r.shift)); // OpShiftRightArithmetic
+	}
+
+	// Round towards zero by adding one to negative quotients
+	uint32_t sign = add(bin, r, 194, q, constant(r, 31)); // OpShiftRightLogical
+	q = add(bin, r, 128, q, sign); // OpIAdd
+      }
+      break;
+
+    default:
+      break;
+    }
+
+    // The remainder of a magic division
+    if(op != EXPR_DIVISION && r.kind != REDUCTION_MASK && r.kind != REDUCTION_SIGNED_POW2) {
+      uint32_t product = add(bin, r, 132, q, constant(r, divisor)); // OpIMul
+      add(bin, r, 130, x, product); // OpISub
+    }
+
+    // Give the last instruction the expression's id
+    unsigned int last = start;
+    for(unsigned int i = start; i < bin.size(); i += bin[i] >> 16) {
+      last = i;
+    }
+    bin[last + 2] = result_id;
+
+    SStrengthReducer::num_reduced++;
+
+    return true;
+  }
+
+};
@@ -0,0 +1,92 @@
+#ifndef __SPURV_STRENGTH_REDUCTION
+#define __SPURV_STRENGTH_REDUCTION
+
+#include "declarations.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace spurv {
+
+  /*
+   * SStrengthReducer - Writes 32-bit integer division, remainder and modulo by a scalar
+   * constant with cheaper instructions, as integer division is slow on most GPUs.
+   *
+   * Unsigned division by 2^k is a logical shift, the remainder a mask. Signed division by
+   * +-2^k adds 2^k - 1 to negative dividends before the arithmetic shift, so that it rounds
+   * towards zero as OpSDiv does, and OpSMod by a positive 2^k is a mask. Other divisors
+   * (apart from 0 and +-1) are multiplied by a magic number (Granlund and Montgomery),
+   * taking the high word from OpUMulExtended / OpSMulExtended with a fix-up where the magic
+   * number does not fit, and remainders are computed from the quotient. OpSMod by other
+   * divisors, and by negative ones, is left as it is
+   */
+
+  class SStrengthReducer {
+    static bool enabled;
+    static int num_reduced;
+
+    enum SReductionKind {
+      REDUCTION_NONE,
+      REDUCTION_UNSIGNED_SHIFT,
+      REDUCTION_MASK,
+      REDUCTION_UNSIGNED_MAGIC,
+      REDUCTION_UNSIGNED_MAGIC_ADD,
+      REDUCTION_SIGNED_POW2,
+      REDUCTION_SIGNED_MAGIC
+    };
+
+    struct SReduction {
+      SReductionKind kind;
+      SExprOp op;
+      bool is_signed;
+      uint32_t divisor;
+
+      uint32_t magic;
+      int shift;
+    };
+
+    SStrengthReducer() = delete;
+
+    static SReduction plan(SExprOp op, bool is_signed, uint32_t divisor);
+
+    // The constants the reduction uses, of the operand type
+    static std::vector<uint32_t> constants(const SReduction& reduction);
+
+    static uint32_t constant(const SReduction& reduction, uint32_t value);
+
+    static uint32_t add(std::vector<uint32_t>& bin, const SReduction& reduction, int opcode,
+			uint32_t a, uint32_t b);
+
+    // The high word of the product of a and the magic number
+    static uint32_t mul_high(std::vector<uint32_t>& bin, const SReduction& reduction, uint32_t a);
+
+    static void reset();
+
+    template<SShaderType type, typename... InputTypes>
+    friend class SShader;
+
+  public:
+
+    // Reduction is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Number of divisions, remainders and moduli reduced in the last compiled shader
+    static int getNumReduced();
+
+    // For the expression factories. op is EXPR_DIVISION, EXPR_REM or EXPR_MOD
+
+    // Defines the types and constants the reduction of op by divisor needs
+    static void defineConstants(SExprOp op, bool is_signed, uint32_t divisor,
+				std::vector<uint32_t>& bin,
+				std::vector<SDeclarationState*>& declaration_states);
+
+    // Writes the reduction of op by divisor with the given result id, returns false
+    // without writing anything if op is not reduced
+    static bool write(SExprOp op, bool is_signed, uint32_t divisor,
+		      uint32_t result_id, uint32_t dividend_id, std::vector<uint32_t>& bin);
+  };
+
+};
+
+#endif // __SPURV_STRENGTH_REDUCTION
@@ -0,0 +1,254 @@
+#include "trace.hpp"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <process.h>
+#define SPURV_GETPID _getpid
+#else
+#include <unistd.h>
+#define SPURV_GETPID getpid
+#endif
+
+namespace spurv {
+
+  namespace {
+
+    struct TraceEvent {
+      const char* name;
+      const char* category;
+      std::string shader;
+      double begin, end;
+      int thread;
+
+      bool is_counter;
+      std::vector<std::pair<const char*, int> > values;
+    };
+
+    struct TraceState {
+      std::mutex mutex;
+      std::vector<TraceEvent> events;
+
+      // Small thread numbers are easier to read in the viewers than hashed ids
+      std::unordered_map<std::thread::id, int> thread_numbers;
+
+      std::string exit_path;
+
+      int get_thread_number() {
+	std::thread::id id = std::this_thread::get_id();
+	std::unordered_map<std::thread::id, int>::iterator it = thread_numbers.find(id);
+	if(it != thread_numbers.end()) {
+	  return it->second;
+	}
+
+	int number = thread_numbers.size() + 1;
+	thread_numbers[id] = number;
+	return number;
+      }
+    };
+
+    std::atomic<bool> trace_enabled(false);
+
+    // Leaked on purpose, so that it is still alive when the atexit handler runs
+    TraceState& get_state() {
+      static TraceState* state = new TraceState();
+      return *state;
+    }
+
+    void write_at_exit() {
+      const std::string& path = get_state().exit_path;
+      if(!STrace::writeFile(path)) {
+	printf("[spurv::STrace] Could not write trace to %s\n", path.c_str());
+      }
+    }
+
+    // Turns tracing on if SPURV_TRACE is set, before main runs
+    struct TraceEnvironment {
+      TraceEnvironment() {
+	const char* path = getenv("SPURV_TRACE");
+	if(path && *path) {
+	  get_state().exit_path = path;
+	  STrace::start();
+	  atexit(write_at_exit);
+	}
+      }
+    } trace_environment;
+
+    void append_escaped(std::string& out, const char* str) {
+      for(; *str; str++) {
+	char c = *str;
+	if(c == '"' || c == '\\') {
+	  out += '\\';
+	  out += c;
+	} else if((unsigned char)c < 0x20) {
+	  char buf[8];
+	  snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+	  out += buf;
+	} else {
+	  out += c;
+	}
+      }
+    }
+  };
+
+
+  /*
+   * STrace member functions
+   */
+
+  void STrace::start() {
+    trace_enabled.store(true, std::memory_order_relaxed);
+  }
+
+  void STrace::stop() {
+    trace_enabled.store(false, std::memory_order_relaxed);
+  }
+
+  bool STrace::isEnabled() {
+    return trace_enabled.load(std::memory_order_relaxed);
+  }
+
+  double STrace::now() {
+    std::chrono::steady_clock::duration d = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double, std::micro>(d).count();
+  }
+
+  void STrace::addSpan(const char* name, const char* category, const std::string& shader,
+		       double begin, double end) {
+    if(!STrace::isEnabled()) {
+      return;
+    }
+
+    TraceState& state = get_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    TraceEvent ev;
+    ev.name = name;
+    ev.category = category;
+    ev.shader = shader;
+    ev.begin = begin;
+    ev.end = end;
+    ev.thread = state.get_thread_number();
+    ev.is_counter = false;
+    state.events.push_back(ev);
+  }
+
+  void STrace::addCounter(const char* name, const char* category, const std::string& shader,
+			  double time, const std::vector<std::pair<const char*, int> >& values) {
+    if(!STrace::isEnabled()) {
+      return;
+    }
+
+    TraceState& state = get_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    TraceEvent ev;
+    ev.name = name;
+    ev.category = category;
+    ev.shader = shader;
+    ev.begin = time;
+    ev.end = time;
+    ev.thread = state.get_thread_number();
+    ev.is_counter = true;
+    ev.values = values;
+    state.events.push_back(ev);
+  }
+
+  void STrace::write(std::string& out) {
+    TraceState& state = get_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    int pid = SPURV_GETPID();
+    char buf[128];
+
+    out += "{\"traceEvents\": [";
+    for(unsigned int i = 0; i < state.events.size(); i++) {
+      const TraceEvent& ev = state.events[i];
+
+      out += i ? ",\n  {\"name\": \"" : "\n  {\"name\": \"";
+      append_escaped(out, ev.name);
+      out += "\", \"cat\": \"";
+      append_escaped(out, ev.category);
+
+      if(ev.is_counter) {
+	// Counter events ("C") have their series in args, so the shader goes in the id,
+	// which gives each shader its own track
+	snprintf(buf, sizeof(buf), "\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d",
+		 ev.begin, pid, ev.thread);
+	out += buf;
+	out += ", \"id\": \"";
+	append_escaped(out, ev.shader.c_str());
+	out += "\", \"args\": {";
+	for(unsigned int k = 0; k < ev.values.size(); k++) {
+	  out += k ? ", \"" : "\"";
+	  append_escaped(out, ev.values[k].first);
+	  snprintf(buf, sizeof(buf), "\": %d", ev.values[k].second);
+	  out += buf;
+	}
+	out += "}}";
+	continue;
+      }
+
+      // Complete events ("X") carry both the start and the duration
+      snprintf(buf, sizeof(buf), "\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d",
+	       ev.begin, ev.end - ev.begin, pid, ev.thread);
+      out += buf;
+      out += ", \"args\": {\"shader\": \"";
+      append_escaped(out, ev.shader.c_str());
+      out += "\"}}";
+    }
+    out += "\n], \"displayTimeUnit\": \"ms\"}\n";
+  }
+
+  bool STrace::writeFile(const std::string& path) {
+    std::string out;
+    STrace::write(out);
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) {
+      return false;
+    }
+
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    return fclose(f) == 0 && ok;
+  }
+
+  void STrace::clear() {
+    TraceState& state = get_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    state.events.clear();
+  }
+
+
+  /*
+   * STraceSpan member functions
+   */
+
+  STraceSpan::STraceSpan(const char* name, const char* category, const std::string& shader) {
+    this->name = name;
+    this->category = category;
+    this->shader = &shader;
+    this->active = STrace::isEnabled();
+    this->begin = this->active ? STrace::now() : 0.0;
+  }
+
+  STraceSpan::~STraceSpan() {
+    this->end();
+  }
+
+  void STraceSpan::end() {
+    if(this->active) {
+      this->active = false;
+      STrace::addSpan(this->name, this->category, *this->shader, this->begin, STrace::now());
+    }
+  }
+
+};
@@ -0,0 +1,75 @@
+#ifndef __SPURV_TRACE
+#define __SPURV_TRACE
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace spurv {
+
+  /*
+   * STrace - Collects spans (recording of a shader, the phases of SShader::compile,
+   * optimization passes) and counters (hits and misses of the caches of a compile) as
+   * Chrome trace events, which can be loaded into chrome://tracing or Perfetto next to
+   * traces from the rest of a build. Every event is tagged with the shader name, the
+   * process and the thread.
+   *
+   * Tracing is off by default, and costs a single check per span when off. It is
+   * turned on with start(), or by setting the environment variable SPURV_TRACE to a
+   * file name, in which case the trace is written to that file when the program exits
+   */
+
+  class STrace {
+  public:
+    STrace() = delete;
+
+    static void start();
+    static void stop();
+    static bool isEnabled();
+
+    // Microseconds on the clock used for the spans
+    static double now();
+
+    // Records a finished span. category is e.g. "compile", "pass" or "export"
+    static void addSpan(const char* name, const char* category, const std::string& shader,
+			double begin, double end);
+
+    // Records the values of a counter at time, one series per value. category is e.g. "cache"
+    static void addCounter(const char* name, const char* category, const std::string& shader,
+			   double time, const std::vector<std::pair<const char*, int> >& values);
+
+    // Appends the collected events as a JSON trace object to out
+    static void write(std::string& out);
+    // Returns false if the file could not be written
+    static bool writeFile(const std::string& path);
+
+    static void clear();
+  };
+
+
+  /*
+   * STraceSpan - Records a span from construction until end() is called or it
+   * goes out of scope. Does nothing if tracing is off when it is constructed
+   */
+
+  class STraceSpan {
+    const char* name;
+    const char* category;
+    const std::string* shader;
+    double begin;
+    bool active;
+
+  public:
+    // shader must outlive the span
+    STraceSpan(const char* name, const char* category, const std::string& shader);
+    ~STraceSpan();
+
+    STraceSpan(const STraceSpan&) = delete;
+    STraceSpan& operator=(const STraceSpan&) = delete;
+
+    void end();
+  };
+
+};
+
+#endif // __SPURV_TRACE
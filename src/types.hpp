@@ -101,6 +101,9 @@ namespace spurv {
     static void ensure_defined(std::vector<uint32_t>& bin, std::vector<SDeclarationState*>& declaration_states);
     static void define(std::vector<uint32_t>& bin);
     static constexpr int getSize();
+
+    template<typename tt>
+    static SValue<SBool>& cons(tt&& arg);
   };
 
 
@@ -458,6 +461,11 @@ namespace spurv {
     typedef void_s type;
   };
 
+  template<>
+  struct MapSType<bool> {
+    typedef SBool type;
+  };
+
   template<>
   struct MapSType<int32_t> {
     typedef int_s type;
@@ -480,7 +488,7 @@ namespace spurv {
 
   template<int n, int m>
   struct MapSType<falg::Matrix<n, m> > {
-    typedef SType<STypeKind::KIND_MAT, n, m> type;
+    typedef SMat<n, m, float_s> type;
   };
 
 
@@ -498,6 +506,11 @@ namespace spurv {
     typedef void type;
   };
 
+  template<>
+  struct InvMapSType<SBool> {
+    typedef bool type;
+  };
+
   template<>
   struct InvMapSType<uint_s> {
     typedef uint32_t type;
@@ -90,6 +90,18 @@ namespace spurv {
 									       std::vector<SDeclarationState*>& declaration_states) { }
 
 
+  /*
+   * Bool member functions
+   */
+
+  template<typename tt>
+  SValue<SBool>& SBool::cons(tt&& arg) {
+    static_assert(std::is_convertible<tt, bool>::value, "Value must be convertible to bool");
+    SValue<SBool>* value = SUtils::allocate<Constant<bool> >(static_cast<bool>(arg));
+    return *value;
+  }
+
+
   /*
    * Int member functions
    */
@@ -234,6 +246,10 @@ namespace spurv {
 						    std::vector<SDeclarationState*>& declaration_states) {
     tt::ensure_defined(bin, declaration_states);
     SPointer<storage, tt>::ensure_defined(bin, declaration_states);
+
+    // The length is given as a constant
+    int_s::ensure_defined(bin, declaration_states);
+    SConstantRegistry::ensureDefinedConstant<int32_t>(n, SUtils::getNewID(), bin);
   }
 
   template<int n, SStorageClass storage, typename tt>
@@ -250,10 +266,11 @@ namespace spurv {
     SArr<n, storage, tt>::ensureInitID();
     SArr<n, storage, tt>::declareDefined();
 
+    // OpTypeArray <result_id> <element_type> <length>
     SUtils::add(bin, (4 << 16) | 28);
     SUtils::add(bin, SArr<n, storage, tt>::declarationState.id);
     SUtils::add(bin, tt::getID());
-    SUtils::add(bin, n);
+    SUtils::add(bin, SConstantRegistry::getIDInteger(32, 1, n));
   }
 
   template<int n, SStorageClass storage, typename tt>
@@ -1,4 +1,5 @@
 #include "utils.hpp"
+#include "disassembler.hpp"
 
 #include <vector>
 
@@ -72,17 +73,8 @@ namespace spurv {
   void SUtils::binaryPrettyPrint(const std::vector<uint32_t>& shader) {
 
     printf("[spurv] Pretty print begin\n");
-    
-    int i = 5;
-    while(i < (int)shader.size()) {
-      int s = shader[i] >> 16;
-      printf("%d ", shader[i] & ((1 << 16) - 1));
-      for(int j = 1; j < s; j++) {
-	printf("%d ", shader[i + j]);
-      }
-      printf("\n");
-      i += s;
-    }
+
+    SDisassembler::disassemble(shader.data(), shader.size(), stdout, DISASSEMBLE_FRIENDLY_NAMES);
 
     printf("[spurv] Pretty print end\n");
   }
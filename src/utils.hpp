@@ -35,11 +35,12 @@ namespace spurv {
     template<typename... Types>
     struct sum_num_elements;
 
+    // Decided from the types alone, so that they can be used in constant expressions
     template<typename First, typename... Types>
-    static constexpr bool has_only_1_comps(First&& ft, Types&&... args);
+    static constexpr bool has_only_1_comps();
 
     template<typename First, typename... Types>
-    static constexpr bool has_only_n_comps(int n, First&& ft, Types&&... args);
+    static constexpr bool has_only_n_comps(int n);
     
     template<typename First, typename... Types>
     static constexpr bool isSTypeRecursive();
@@ -172,6 +173,14 @@ namespace spurv {
     template<typename tt>
     friend class SImageStoreEvent;
 
+    template<typename tt>
+    friend class SReturnEvent;
+
+    friend class SFunctionBase;
+
+    template<typename Ret, typename... Args>
+    friend class SFunctionCall;
+
     friend class SIfThen;
     
     friend class SForBeginEvent;
@@ -179,6 +188,10 @@ namespace spurv {
     friend class SForEndEvent;
     
     friend class SForLoop;
+    friend struct SLoopControl;
+    friend class SLocalPromoter;
+    friend class SStrengthReducer;
+    friend class SFmaContractor;
     
   public:
 
@@ -72,23 +72,18 @@ namespace spurv {
       SUtils::num_elements<typename SValueWrapper::ToType<FirstType>::type>::value; };
 
   template<typename First, typename... InnerTypes>
-  constexpr bool SUtils::has_only_1_comps(First&& ft, InnerTypes&&... args) {
-    bool s = true;
-    if constexpr(sizeof...(InnerTypes) > 0) {
-	s = SUtils::has_only_1_comps(args...);
-      }
-    
-    return (SUtils::num_elements<First>::value == 1) && s;
+  constexpr bool SUtils::has_only_1_comps() {
+    return SUtils::has_only_n_comps<First, InnerTypes...>(1);
   }
 
   template<typename First, typename... InnerTypes>
-  constexpr bool SUtils::has_only_n_comps(int n, First&& ft, InnerTypes&&... args) {
+  constexpr bool SUtils::has_only_n_comps(int n) {
     bool s = true;
     if constexpr(sizeof...(InnerTypes) > 0) {
-	s = SUtils::has_only_n_comps(n, args...);
+	s = SUtils::has_only_n_comps<InnerTypes...>(n);
       }
 
-    return (SUtils::num_elements<First>::value == n) && s;
+    return (SUtils::num_elements<typename SValueWrapper::ToType<First>::type>::value == n) && s;
   }
 
   
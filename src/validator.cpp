@@ -0,0 +1,1640 @@
+#include "validator.hpp"
+#include "instruction_set.hpp"
+
+#include <cstdio>
+#include <cstdarg>
+#include <tuple>
+#include <algorithm>
+
+namespace spurv {
+
+  namespace {
+
+    const uint32_t spirv_magic_number = 0x07230203;
+    const uint32_t max_bound = 0x400000; // Universal limit on ids
+
+    enum {
+      OP_NOP = 0, OP_UNDEF = 1, OP_NAME = 5, OP_MEMBER_NAME = 6, OP_LINE = 8,
+      OP_EXT_INST_IMPORT = 11, OP_EXT_INST = 12, OP_MEMORY_MODEL = 14,
+      OP_ENTRY_POINT = 15, OP_EXECUTION_MODE = 16,
+      OP_TYPE_VOID = 19, OP_TYPE_BOOL = 20, OP_TYPE_INT = 21, OP_TYPE_FLOAT = 22,
+      OP_TYPE_VECTOR = 23, OP_TYPE_MATRIX = 24, OP_TYPE_IMAGE = 25, OP_TYPE_SAMPLER = 26,
+      OP_TYPE_SAMPLED_IMAGE = 27, OP_TYPE_ARRAY = 28, OP_TYPE_RUNTIME_ARRAY = 29,
+      OP_TYPE_STRUCT = 30, OP_TYPE_OPAQUE = 31, OP_TYPE_POINTER = 32, OP_TYPE_FUNCTION = 33,
+      OP_CONSTANT_TRUE = 41, OP_CONSTANT_FALSE = 42, OP_CONSTANT = 43,
+      OP_CONSTANT_COMPOSITE = 44, OP_CONSTANT_NULL = 46,
+      OP_SPEC_CONSTANT_TRUE = 48, OP_SPEC_CONSTANT_FALSE = 49, OP_SPEC_CONSTANT = 50,
+      OP_SPEC_CONSTANT_COMPOSITE = 51, OP_SPEC_CONSTANT_OP = 52,
+      OP_FUNCTION = 54, OP_FUNCTION_PARAMETER = 55, OP_FUNCTION_END = 56, OP_FUNCTION_CALL = 57,
+      OP_VARIABLE = 59, OP_LOAD = 61, OP_STORE = 62, OP_ACCESS_CHAIN = 65,
+      OP_IN_BOUNDS_ACCESS_CHAIN = 66,
+      OP_DECORATE = 71, OP_MEMBER_DECORATE = 72, OP_GROUP_DECORATE = 74,
+      OP_GROUP_MEMBER_DECORATE = 75,
+      OP_VECTOR_SHUFFLE = 79, OP_COMPOSITE_CONSTRUCT = 80, OP_COMPOSITE_EXTRACT = 81,
+      OP_COMPOSITE_INSERT = 82, OP_COPY_OBJECT = 83,
+      OP_SAMPLED_IMAGE = 86, OP_IMAGE_SAMPLE_IMPLICIT_LOD = 87,
+      OP_PHI = 245, OP_LOOP_MERGE = 246, OP_SELECTION_MERGE = 247, OP_LABEL = 248,
+      OP_BRANCH = 249, OP_BRANCH_CONDITIONAL = 250, OP_SWITCH = 251, OP_KILL = 252,
+      OP_RETURN = 253, OP_RETURN_VALUE = 254, OP_UNREACHABLE = 255,
+      OP_NO_LINE = 317, OP_EXECUTION_MODE_ID = 331, OP_DECORATE_ID = 332,
+      OP_TERMINATE_INVOCATION = 4416, OP_DECORATE_STRING = 5632, OP_MEMBER_DECORATE_STRING = 5633
+    };
+
+    enum {
+      DECORATION_ROW_MAJOR = 4, DECORATION_COL_MAJOR = 5, DECORATION_ARRAY_STRIDE = 6,
+      DECORATION_MATRIX_STRIDE = 7, DECORATION_BLOCK = 2, DECORATION_BUFFER_BLOCK = 3,
+      DECORATION_BUILTIN = 11, DECORATION_LOCATION = 30, DECORATION_COMPONENT = 31,
+      DECORATION_INDEX = 32, DECORATION_BINDING = 33, DECORATION_DESCRIPTOR_SET = 34,
+      DECORATION_OFFSET = 35, DECORATION_COUNTER_BUFFER = 5634, DECORATION_USER_SEMANTIC = 5635
+    };
+
+    enum {
+      STORAGE_CLASS_UNIFORM_CONSTANT = 0, STORAGE_CLASS_INPUT = 1, STORAGE_CLASS_UNIFORM = 2,
+      STORAGE_CLASS_OUTPUT = 3, STORAGE_CLASS_FUNCTION = 7, STORAGE_CLASS_STORAGE_BUFFER = 12
+    };
+
+    enum {
+      FLAG_LOCATION = 1, FLAG_BUILTIN = 2, FLAG_BINDING = 4, FLAG_DESCRIPTOR_SET = 8,
+      FLAG_BUILTIN_MEMBER = 16
+    };
+
+    struct ValidationBlock {
+      uint32_t label;
+      uint32_t pos;
+      uint32_t merge;
+      uint32_t continue_target;
+      uint32_t terminator_pos;
+      bool is_loop_header;
+      bool unmerged_conditional;
+      int first_successor; // Successor labels are kept in one flat array
+      int num_successors;
+      int first_predecessor;
+      int num_predecessors;
+    };
+
+    struct ValidationUse {
+      uint32_t id;
+      int block;
+      uint32_t pos;
+    };
+
+    struct ValidationDecoration {
+      uint32_t opcode;
+      uint32_t target;
+      int member;
+      uint32_t decoration;
+      uint32_t pos;
+    };
+
+
+    /*
+     * SValidationContext - State of a single validation run
+     */
+
+    class SValidationContext {
+      const uint32_t* words;
+      size_t num_words;
+      uint32_t version;
+      uint32_t bound;
+      std::string* error;
+
+      // Per-id information, kept as plain arrays into the storage vectors below
+      uint32_t* def_pos; // Position of defining instruction, 0 if not (yet) defined
+      uint32_t* type_of;
+      int* def_function; // -1 for module-level definitions
+      int* def_block;
+      uint8_t* flags;
+      std::vector<uint32_t> uint_storage;
+      std::vector<int> int_storage;
+      std::vector<uint8_t> flag_storage;
+
+      std::vector<SDecodedOperand> operands;
+      int current_section;
+      int num_memory_models;
+
+      std::vector<ValidationDecoration> decorations;
+      std::vector<std::pair<uint32_t, uint32_t> > forward_references; // (id, pos)
+      std::vector<uint32_t> entry_points;
+      std::vector<uint32_t> execution_modes;
+      std::vector<uint32_t> function_calls;
+      std::vector<uint32_t> global_variables;
+      std::vector<uint32_t> type_declarations;
+      std::vector<std::tuple<uint32_t, int, uint32_t, uint32_t> > decoration_keys;
+      std::vector<uint32_t> entry_functions;
+
+      // Per-function state
+      int function_index;
+      bool in_function;
+      uint32_t function_pos;
+      uint32_t function_return_type;
+      int num_parameters;
+      int current_block;
+      bool block_has_non_phi;
+      bool block_has_non_variable;
+      uint32_t pending_merge;
+      std::vector<ValidationBlock> blocks;
+      int num_blocks;
+      std::vector<uint32_t> successors;
+      std::vector<int> predecessors;
+      std::vector<ValidationUse> uses;
+      std::vector<std::pair<uint32_t, int> > phis; // (pos, block)
+      std::vector<int> idom;
+      std::vector<int> post_order_number;
+      std::vector<int> post_order;
+      std::vector<std::pair<int, int> > search_stack;
+      std::vector<int> merge_owner;
+      std::vector<bool> is_merge_or_continue;
+
+      // Opcodes below this limit whose operands are all ids, so that they need no decoding
+      static const uint32_t id_table_size = 512;
+      static bool only_id_operands[id_table_size];
+      static int8_t num_fixed_ids[id_table_size]; // -1 if the number of ids is variable
+      static bool id_table_initialized;
+
+      bool fail(uint32_t pos, const char* format, ...);
+
+      uint32_t getOpcode(uint32_t pos) const { return this->words[pos] & 0xffff; }
+      uint32_t getWordCount(uint32_t pos) const { return this->words[pos] >> 16; }
+
+      // Information about type ids
+      uint32_t typeOpcode(uint32_t type) const;
+      uint32_t typeOperand(uint32_t type, int n) const;
+      int typeNumOperands(uint32_t type) const;
+      uint32_t scalarType(uint32_t type) const;
+      int componentCount(uint32_t type) const;
+      bool isFloat(uint32_t type) const;
+      bool isInt(uint32_t type) const;
+      bool isBool(uint32_t type) const;
+      bool isType(uint32_t id) const;
+      bool getConstantInt(uint32_t id, uint32_t* value) const;
+      bool isConstant(uint32_t id) const;
+
+      uint32_t getOperand(uint32_t pos, int fixed, int n) const { return this->words[pos + fixed + n]; }
+
+      bool checkLayout(uint32_t pos, uint32_t opcode, const SInstructionInfo* info);
+      bool checkIds(uint32_t pos, uint32_t opcode, const SInstructionInfo* info, int fixed, int num_id_operands);
+      bool checkFunctionStructure(uint32_t pos, uint32_t opcode, uint32_t type_id, uint32_t result_id,
+				  int fixed, int count);
+      bool checkTypes(uint32_t pos, uint32_t opcode, uint32_t type_id, int fixed, int count);
+      bool checkTypeDeclaration(uint32_t pos, uint32_t opcode, int count);
+      bool checkComposite(uint32_t pos, uint32_t type_id, const uint32_t* constituents, int num,
+			  bool require_constants);
+      bool walkIndices(uint32_t pos, uint32_t type, const uint32_t* indices, int num, bool literal,
+		       uint32_t* res);
+
+      bool finishFunction();
+      bool computeDominators();
+      bool dominates(int a, int b) const;
+      int blockOfLabel(uint32_t label) const;
+
+      bool finishModule();
+
+    public:
+      // The context is reused between runs, to keep allocations out of the way
+      bool run(const uint32_t* words, size_t num_words, std::string& error);
+    };
+
+
+    /*
+     * SValidationContext member functions
+     */
+
+    bool SValidationContext::only_id_operands[SValidationContext::id_table_size];
+    int8_t SValidationContext::num_fixed_ids[SValidationContext::id_table_size];
+    bool SValidationContext::id_table_initialized = false;
+
+    bool SValidationContext::fail(uint32_t pos, const char* format, ...) {
+      char buffer[512];
+      int n = 0;
+      if(pos) {
+	const SInstructionInfo* info = SInstructionSet::getInfo(this->getOpcode(pos));
+	n = snprintf(buffer, sizeof(buffer), "[word %u, %s] ", pos, info ? info->name : "unknown opcode");
+      }
+
+      va_list args;
+      va_start(args, format);
+      vsnprintf(buffer + n, sizeof(buffer) - n, format, args);
+      va_end(args);
+
+      *this->error = buffer;
+      return false;
+    }
+
+    uint32_t SValidationContext::typeOpcode(uint32_t type) const {
+      return type && this->def_pos[type] ? this->getOpcode(this->def_pos[type]) : 0;
+    }
+
+    uint32_t SValidationContext::typeOperand(uint32_t type, int n) const {
+      return this->words[this->def_pos[type] + 2 + n];
+    }
+
+    int SValidationContext::typeNumOperands(uint32_t type) const {
+      return (int)this->getWordCount(this->def_pos[type]) - 2;
+    }
+
+    uint32_t SValidationContext::scalarType(uint32_t type) const {
+      return this->typeOpcode(type) == OP_TYPE_VECTOR ? this->typeOperand(type, 0) : type;
+    }
+
+    int SValidationContext::componentCount(uint32_t type) const {
+      return this->typeOpcode(type) == OP_TYPE_VECTOR ? (int)this->typeOperand(type, 1) : 1;
+    }
+
+    bool SValidationContext::isFloat(uint32_t type) const {
+      return this->typeOpcode(this->scalarType(type)) == OP_TYPE_FLOAT;
+    }
+
+    bool SValidationContext::isInt(uint32_t type) const {
+      return this->typeOpcode(this->scalarType(type)) == OP_TYPE_INT;
+    }
+
+    bool SValidationContext::isBool(uint32_t type) const {
+      return this->typeOpcode(this->scalarType(type)) == OP_TYPE_BOOL;
+    }
+
+    bool SValidationContext::isType(uint32_t id) const {
+      uint32_t op = this->typeOpcode(id);
+      return op >= OP_TYPE_VOID && op <= OP_TYPE_FUNCTION;
+    }
+
+    bool SValidationContext::getConstantInt(uint32_t id, uint32_t* value) const {
+      if(this->typeOpcode(id) != OP_CONSTANT || !this->isInt(this->type_of[id])) {
+	return false;
+      }
+      *value = this->words[this->def_pos[id] + 3];
+      return true;
+    }
+
+    bool SValidationContext::isConstant(uint32_t id) const {
+      uint32_t op = this->typeOpcode(id);
+      return (op >= OP_CONSTANT_TRUE && op <= OP_SPEC_CONSTANT_OP) || op == OP_UNDEF;
+    }
+
+    int SValidationContext::blockOfLabel(uint32_t label) const {
+      if(label >= this->bound || !this->def_pos[label] ||
+	 this->getOpcode(this->def_pos[label]) != OP_LABEL ||
+	 this->def_function[label] != this->function_index) {
+	return -1;
+      }
+      return this->def_block[label];
+    }
+
+    bool SValidationContext::run(const uint32_t* words, size_t num_words, std::string& error) {
+      this->words = words;
+      this->num_words = num_words;
+      this->error = &error;
+
+      this->current_section = SECTION_CAPABILITY;
+      this->num_memory_models = 0;
+      this->function_index = -1;
+      this->in_function = false;
+      this->current_block = -1;
+      this->pending_merge = 0;
+
+      this->decorations.clear();
+      this->forward_references.clear();
+      this->entry_points.clear();
+      this->execution_modes.clear();
+      this->function_calls.clear();
+      this->global_variables.clear();
+      this->type_declarations.clear();
+
+      if(!id_table_initialized) {
+	for(uint32_t op = 0; op < id_table_size; op++) {
+	  const SInstructionInfo* info = SInstructionSet::getInfo(op);
+	  bool ids = info != nullptr;
+	  num_fixed_ids[op] = 0;
+	  for(unsigned int i = 0; ids && i < info->operands.size(); i++) {
+	    ids = info->operands[i] == OPERAND_ID || info->operands[i] == OPERAND_VARIABLE_IDS;
+	    num_fixed_ids[op] = info->operands[i] == OPERAND_ID ? num_fixed_ids[op] + 1 : -1;
+	  }
+	  only_id_operands[op] = ids;
+	}
+	id_table_initialized = true;
+      }
+
+      if(this->num_words < 5 || this->words[0] != spirv_magic_number) {
+	return this->fail(0, "Binary does not start with a valid SPIR-V header");
+      }
+
+      this->version = this->words[1];
+      this->bound = this->words[3];
+      if(this->bound == 0 || this->bound > max_bound) {
+	return this->fail(0, "Invalid id bound %u", this->bound);
+      }
+
+      this->uint_storage.assign(2 * this->bound, 0);
+      this->int_storage.assign(2 * this->bound, -1);
+      this->flag_storage.assign(this->bound, 0);
+      this->def_pos = this->uint_storage.data();
+      this->type_of = this->def_pos + this->bound;
+      this->def_function = this->int_storage.data();
+      this->def_block = this->def_function + this->bound;
+      this->flags = this->flag_storage.data();
+
+      uint32_t pos = 5;
+      while(pos < this->num_words) {
+	uint32_t count = this->getWordCount(pos);
+	uint32_t opcode = this->getOpcode(pos);
+
+	if(count == 0 || pos + count > this->num_words) {
+	  return this->fail(0, "[word %u] Invalid word count %u", pos, count);
+	}
+
+	const SInstructionInfo* info = SInstructionSet::getInfo(opcode);
+	if(!info) {
+	  return this->fail(0, "[word %u] Unknown opcode %u", pos, opcode);
+	}
+
+	int fixed = 1 + info->has_type + info->has_result;
+	if((int)count < fixed) {
+	  return this->fail(pos, "Too few words");
+	}
+
+	uint32_t type_id = info->has_type ? this->words[pos + 1] : 0;
+	uint32_t result_id = info->has_result ? this->words[pos + fixed - 1] : 0;
+
+	this->operands.clear();
+	bool all_ids = opcode < id_table_size && only_id_operands[opcode];
+	if(all_ids) {
+	  // Still need to check the number of operands. Variable id lists always come last
+	  int num_ops = count - fixed;
+	  int expected = num_fixed_ids[opcode];
+	  if(expected >= 0 ? num_ops != expected : num_ops < (int)info->operands.size() - 1) {
+	    return this->fail(pos, "Operands do not match the grammar");
+	  }
+	} else if(!SInstructionSet::decodeOperands(opcode, this->words + pos + fixed, count - fixed,
+						   this->operands)) {
+	  return this->fail(pos, "Operands do not match the grammar");
+	}
+
+	if(!this->checkLayout(pos, opcode, info) ||
+	   !this->checkIds(pos, opcode, info, fixed, all_ids ? count - fixed : -1) ||
+	   !this->checkFunctionStructure(pos, opcode, type_id, result_id, fixed, count)) {
+	  return false;
+	}
+
+	if(result_id) {
+	  this->def_pos[result_id] = pos;
+	  this->type_of[result_id] = type_id;
+	  // Functions themselves are module-level, so that they can be called from anywhere
+	  this->def_function[result_id] = this->in_function && opcode != OP_FUNCTION ? this->function_index : -1;
+	  this->def_block[result_id] = this->in_function ? this->current_block : -1;
+	}
+
+	if(!this->checkTypes(pos, opcode, type_id, fixed, count)) {
+	  return false;
+	}
+
+	if(opcode == OP_FUNCTION_END && !this->finishFunction()) {
+	  return false;
+	}
+
+	pos += count;
+      }
+
+      if(this->in_function) {
+	return this->fail(0, "Missing OpFunctionEnd");
+      }
+
+      return this->finishModule();
+    }
+
+    bool SValidationContext::checkLayout(uint32_t pos, uint32_t opcode, const SInstructionInfo* info) {
+      int section = info->section;
+
+      if(opcode == OP_FUNCTION) {
+	section = SECTION_FUNCTION;
+      } else if(section == SECTION_ANY) {
+	// Outside functions, OpExtInst is used for non-semantic instructions such as debug info
+	if(opcode == OP_VARIABLE || opcode == OP_UNDEF || opcode == OP_EXT_INST) {
+	  section = this->in_function ? SECTION_FUNCTION : SECTION_DECLARATION;
+	} else {
+	  return true; // OpNop, OpLine and OpNoLine may appear anywhere
+	}
+      }
+
+      if(this->in_function) {
+	if(section != SECTION_FUNCTION) {
+	  return this->fail(pos, "Instruction is not allowed inside a function");
+	}
+	return true;
+      }
+
+      if(section == SECTION_FUNCTION && opcode != OP_FUNCTION) {
+	return this->fail(pos, "Instruction is only allowed inside a function");
+      }
+
+      if(section < this->current_section) {
+	return this->fail(pos, "Instruction appears out of the logical layout order");
+      }
+
+      if(opcode == OP_MEMORY_MODEL) {
+	this->num_memory_models++;
+      }
+
+      this->current_section = section;
+      return true;
+    }
+
+    // num_id_operands is -1 if the operands were decoded, otherwise all operands are ids
+    bool SValidationContext::checkIds(uint32_t pos, uint32_t opcode, const SInstructionInfo* info, int fixed,
+				      int num_id_operands) {
+      if(info->has_type) {
+	uint32_t type_id = this->words[pos + 1];
+	if(type_id == 0 || type_id >= this->bound || !this->def_pos[type_id]) {
+	  return this->fail(pos, "Result type %%%u is not defined", type_id);
+	}
+	if(!this->isType(type_id)) {
+	  return this->fail(pos, "Result type %%%u is not a type", type_id);
+	}
+      }
+
+      if(info->has_result) {
+	uint32_t result_id = this->words[pos + fixed - 1];
+	if(result_id == 0 || result_id >= this->bound) {
+	  return this->fail(pos, "Result id %u is out of bounds (bound is %u)", result_id, this->bound);
+	}
+	if(this->def_pos[result_id]) {
+	  return this->fail(pos, "Result id %%%u is defined twice", result_id);
+	}
+      }
+
+      const SDecodedOperand* decoded = this->operands.data();
+      int num = num_id_operands >= 0 ? num_id_operands : (int)this->operands.size();
+      for(int i = 0; i < num; i++) {
+	int offset = i;
+	if(num_id_operands < 0) {
+	  if(decoded[i].kind != OPERAND_ID) {
+	    continue;
+	  }
+	  offset = decoded[i].offset;
+	}
+
+	uint32_t id = this->words[pos + fixed + offset];
+	if(id == 0 || id >= this->bound) {
+	  return this->fail(pos, "Operand id %u is out of bounds (bound is %u)", id, this->bound);
+	}
+
+	// Forward references are allowed to targets of debug and annotation
+	// instructions, entry points, branch targets, OpPhi operands and called functions
+	bool forward_allowed = false;
+	switch(opcode) {
+	case OP_NAME:
+	case OP_MEMBER_NAME:
+	case OP_DECORATE:
+	case OP_MEMBER_DECORATE:
+	case OP_GROUP_DECORATE:
+	case OP_GROUP_MEMBER_DECORATE:
+	case OP_DECORATE_ID:
+	case OP_DECORATE_STRING:
+	case OP_MEMBER_DECORATE_STRING:
+	case OP_ENTRY_POINT:
+	case OP_EXECUTION_MODE:
+	case OP_EXECUTION_MODE_ID:
+	case OP_PHI:
+	case OP_LOOP_MERGE:
+	case OP_SELECTION_MERGE:
+	case OP_BRANCH:
+	  forward_allowed = true;
+	  break;
+	case OP_BRANCH_CONDITIONAL:
+	case OP_SWITCH:
+	  forward_allowed = offset > 0;
+	  break;
+	case OP_FUNCTION_CALL:
+	  forward_allowed = offset == 0;
+	  break;
+	}
+
+	if(forward_allowed) {
+	  // Labels are checked at the end of the function, OpPhi operands by finishFunction
+	  if(!this->in_function) {
+	    this->forward_references.push_back(std::make_pair(id, pos));
+	  } else if(opcode == OP_FUNCTION_CALL) {
+	    this->forward_references.push_back(std::make_pair(id, pos));
+	  }
+	  continue;
+	}
+
+	if(!this->def_pos[id]) {
+	  return this->fail(pos, "Id %%%u is used before it is defined", id);
+	}
+
+	if(this->def_function[id] >= 0) {
+	  if(this->def_function[id] != this->function_index || !this->in_function) {
+	    return this->fail(pos, "Id %%%u is used outside of the function defining it", id);
+	  }
+	  this->uses.push_back({id, this->current_block, pos});
+	}
+      }
+
+      return true;
+    }
+
+    bool SValidationContext::checkFunctionStructure(uint32_t pos, uint32_t opcode, uint32_t type_id,
+						    uint32_t result_id, int fixed, int count) {
+      if(!this->in_function) {
+	if(opcode == OP_FUNCTION) {
+	  this->in_function = true;
+	  this->function_index++;
+	  this->function_pos = pos;
+	  this->function_return_type = type_id;
+	  this->num_parameters = 0;
+	  this->current_block = -1;
+	  this->pending_merge = 0;
+	  this->num_blocks = 0;
+	  this->successors.clear();
+	  this->uses.clear();
+	  this->phis.clear();
+	}
+	return true;
+      }
+
+      if(opcode == OP_FUNCTION) {
+	return this->fail(pos, "Function definitions cannot be nested");
+      }
+
+      if(this->pending_merge) {
+	bool ok = this->pending_merge == OP_SELECTION_MERGE ?
+	  (opcode == OP_BRANCH_CONDITIONAL || opcode == OP_SWITCH) :
+	  (opcode == OP_BRANCH || opcode == OP_BRANCH_CONDITIONAL);
+	if(!ok) {
+	  return this->fail(pos, "Merge instruction must be immediately followed by a branch");
+	}
+	this->pending_merge = 0;
+      }
+
+      switch(opcode) {
+      case OP_FUNCTION_PARAMETER:
+	if(this->num_blocks) {
+	  return this->fail(pos, "OpFunctionParameter after the first block");
+	}
+	this->num_parameters++;
+	return true;
+      case OP_FUNCTION_END:
+	if(this->current_block >= 0) {
+	  return this->fail(pos, "Block %%%u is not terminated", this->blocks[this->current_block].label);
+	}
+	return true;
+      case OP_LABEL:
+	if(this->current_block >= 0) {
+	  return this->fail(pos, "Block %%%u is not terminated before the next label",
+			    this->blocks[this->current_block].label);
+	}
+	if(this->num_blocks == (int)this->blocks.size()) {
+	  this->blocks.push_back(ValidationBlock());
+	}
+	this->current_block = this->num_blocks++;
+	{
+	  ValidationBlock& block = this->blocks[this->current_block];
+	  block.label = result_id;
+	  block.pos = pos;
+	  block.merge = 0;
+	  block.continue_target = 0;
+	  block.terminator_pos = 0;
+	  block.is_loop_header = false;
+	  block.unmerged_conditional = false;
+	  block.first_successor = (int)this->successors.size();
+	  block.num_successors = 0;
+	}
+	this->block_has_non_phi = false;
+	this->block_has_non_variable = false;
+	return true;
+      case OP_LINE:
+      case OP_NO_LINE:
+      case OP_NOP:
+	return true;
+      }
+
+      if(this->current_block < 0) {
+	return this->fail(pos, "Instruction is not inside a block");
+      }
+
+      ValidationBlock& block = this->blocks[this->current_block];
+
+      if(opcode == OP_PHI) {
+	if(this->block_has_non_phi) {
+	  return this->fail(pos, "OpPhi must come before all other instructions in the block");
+	}
+	this->phis.push_back(std::make_pair(pos, this->current_block));
+      } else {
+	this->block_has_non_phi = true;
+      }
+
+      if(opcode == OP_VARIABLE) {
+	if(this->current_block != 0 || this->block_has_non_variable) {
+	  return this->fail(pos, "Function variables must be declared at the start of the first block");
+	}
+      } else {
+	this->block_has_non_variable = true;
+      }
+
+      switch(opcode) {
+      case OP_SELECTION_MERGE:
+      case OP_LOOP_MERGE:
+	if(block.merge) {
+	  return this->fail(pos, "Block %%%u has more than one merge instruction", block.label);
+	}
+	block.merge = this->getOperand(pos, fixed, 0);
+	if(opcode == OP_LOOP_MERGE) {
+	  block.continue_target = this->getOperand(pos, fixed, 1);
+	  block.is_loop_header = true;
+	}
+	this->pending_merge = opcode;
+	break;
+      case OP_BRANCH:
+	this->successors.push_back(this->getOperand(pos, fixed, 0));
+	break;
+      case OP_BRANCH_CONDITIONAL:
+	this->successors.push_back(this->getOperand(pos, fixed, 1));
+	this->successors.push_back(this->getOperand(pos, fixed, 2));
+	block.unmerged_conditional = !block.merge &&
+	  this->getOperand(pos, fixed, 1) != this->getOperand(pos, fixed, 2);
+	break;
+      case OP_SWITCH:
+	this->successors.push_back(this->getOperand(pos, fixed, 1));
+	for(int i = 3; i < count - fixed; i += 2) {
+	  this->successors.push_back(this->getOperand(pos, fixed, i));
+	}
+	if(!block.merge) {
+	  return this->fail(pos, "OpSwitch must be preceded by OpSelectionMerge");
+	}
+	break;
+      case OP_KILL:
+      case OP_RETURN:
+      case OP_RETURN_VALUE:
+      case OP_UNREACHABLE:
+      case OP_TERMINATE_INVOCATION:
+	break;
+      default:
+	return true;
+      }
+
+      if(opcode != OP_SELECTION_MERGE && opcode != OP_LOOP_MERGE) {
+	block.num_successors = (int)this->successors.size() - block.first_successor;
+	block.terminator_pos = pos;
+	this->current_block = -1;
+      }
+      return true;
+    }
+
+    bool SValidationContext::checkTypeDeclaration(uint32_t pos, uint32_t opcode, int count) {
+      const uint32_t* ops = this->words + pos + 2;
+      int num_ops = count - 2;
+
+      for(int i = 0; i < num_ops; i++) {
+	bool is_type_operand = (opcode == OP_TYPE_VECTOR || opcode == OP_TYPE_MATRIX ||
+				opcode == OP_TYPE_IMAGE || opcode == OP_TYPE_SAMPLED_IMAGE ||
+				opcode == OP_TYPE_ARRAY || opcode == OP_TYPE_RUNTIME_ARRAY) ? i == 0 :
+	  (opcode == OP_TYPE_STRUCT || opcode == OP_TYPE_FUNCTION) ? true :
+	  opcode == OP_TYPE_POINTER ? i == 1 : false;
+	if(is_type_operand && !this->isType(ops[i])) {
+	  return this->fail(pos, "Operand %%%u is not a type", ops[i]);
+	}
+      }
+
+      switch(opcode) {
+      case OP_TYPE_INT:
+	if((ops[0] != 8 && ops[0] != 16 && ops[0] != 32 && ops[0] != 64) || ops[1] > 1) {
+	  return this->fail(pos, "Invalid integer width or signedness");
+	}
+	break;
+      case OP_TYPE_FLOAT:
+	if(ops[0] != 16 && ops[0] != 32 && ops[0] != 64) {
+	  return this->fail(pos, "Invalid float width");
+	}
+	break;
+      case OP_TYPE_VECTOR:
+	{
+	  uint32_t c = this->typeOpcode(ops[0]);
+	  if(c != OP_TYPE_INT && c != OP_TYPE_FLOAT && c != OP_TYPE_BOOL) {
+	    return this->fail(pos, "Vector component type must be a scalar");
+	  }
+	  if(ops[1] < 2) {
+	    return this->fail(pos, "Vectors must have at least two components");
+	  }
+	}
+	break;
+      case OP_TYPE_MATRIX:
+	if(this->typeOpcode(ops[0]) != OP_TYPE_VECTOR || !this->isFloat(ops[0])) {
+	  return this->fail(pos, "Matrix column type must be a float vector");
+	}
+	if(ops[1] < 2) {
+	  return this->fail(pos, "Matrices must have at least two columns");
+	}
+	break;
+      case OP_TYPE_ARRAY:
+	{
+	  uint32_t length;
+	  if(!this->getConstantInt(ops[1], &length) || length == 0) {
+	    return this->fail(pos, "Array length must be a positive integer constant");
+	  }
+	}
+	break;
+      case OP_TYPE_FUNCTION:
+	if(this->typeOpcode(ops[0]) == OP_TYPE_FUNCTION) {
+	  return this->fail(pos, "Functions cannot return functions");
+	}
+	break;
+      }
+
+      // Duplicates are found by finishModule
+      if(opcode != OP_TYPE_STRUCT && opcode != OP_TYPE_ARRAY && opcode != OP_TYPE_RUNTIME_ARRAY &&
+	 opcode != OP_TYPE_POINTER && opcode != OP_TYPE_OPAQUE) {
+	this->type_declarations.push_back(pos);
+      }
+
+      return true;
+    }
+
+    bool SValidationContext::walkIndices(uint32_t pos, uint32_t type, const uint32_t* indices, int num,
+					 bool literal, uint32_t* res) {
+      for(int i = 0; i < num; i++) {
+	uint32_t index = 0;
+	bool known = literal;
+	if(literal) {
+	  index = indices[i];
+	} else {
+	  known = this->getConstantInt(indices[i], &index);
+	}
+
+	switch(this->typeOpcode(type)) {
+	case OP_TYPE_STRUCT:
+	  if(!known) {
+	    return this->fail(pos, "Struct members must be indexed by constants");
+	  }
+	  if((int)index >= this->typeNumOperands(type)) {
+	    return this->fail(pos, "Struct member index %u is out of range", index);
+	  }
+	  type = this->typeOperand(type, index);
+	  break;
+	case OP_TYPE_VECTOR:
+	case OP_TYPE_MATRIX:
+	  if(known && index >= this->typeOperand(type, 1)) {
+	    return this->fail(pos, "Index %u is out of range", index);
+	  }
+	  type = this->typeOperand(type, 0);
+	  break;
+	case OP_TYPE_ARRAY:
+	case OP_TYPE_RUNTIME_ARRAY:
+	  type = this->typeOperand(type, 0);
+	  break;
+	default:
+	  return this->fail(pos, "Indexing into a non-composite type");
+	}
+      }
+
+      *res = type;
+      return true;
+    }
+
+    bool SValidationContext::checkComposite(uint32_t pos, uint32_t type_id, const uint32_t* constituents,
+					    int num, bool require_constants) {
+      for(int i = 0; i < num; i++) {
+	if(require_constants && !this->isConstant(constituents[i])) {
+	  return this->fail(pos, "Constituent %%%u is not a constant", constituents[i]);
+	}
+      }
+
+      switch(this->typeOpcode(type_id)) {
+      case OP_TYPE_VECTOR:
+	{
+	  uint32_t component = this->typeOperand(type_id, 0);
+	  int total = 0;
+	  for(int i = 0; i < num; i++) {
+	    uint32_t t = this->type_of[constituents[i]];
+	    if(this->scalarType(t) != component) {
+	      return this->fail(pos, "Constituent %%%u has the wrong component type", constituents[i]);
+	    }
+	    total += this->componentCount(t);
+	  }
+	  if(total != (int)this->typeOperand(type_id, 1)) {
+	    return this->fail(pos, "Constituents have %d components, expected %u", total,
+			      this->typeOperand(type_id, 1));
+	  }
+	}
+	return true;
+      case OP_TYPE_MATRIX:
+      case OP_TYPE_ARRAY:
+      case OP_TYPE_STRUCT:
+	{
+	  uint32_t op = this->typeOpcode(type_id);
+	  uint32_t expected_num = op == OP_TYPE_STRUCT ? (uint32_t)this->typeNumOperands(type_id) : 0;
+	  if(op == OP_TYPE_MATRIX) {
+	    expected_num = this->typeOperand(type_id, 1);
+	  } else if(op == OP_TYPE_ARRAY) {
+	    this->getConstantInt(this->typeOperand(type_id, 1), &expected_num);
+	  }
+
+	  if((uint32_t)num != expected_num) {
+	    return this->fail(pos, "Expected %u constituents, got %d", expected_num, num);
+	  }
+
+	  for(int i = 0; i < num; i++) {
+	    uint32_t expected = this->typeOperand(type_id, op == OP_TYPE_STRUCT ? i : 0);
+	    if(this->type_of[constituents[i]] != expected) {
+	      return this->fail(pos, "Constituent %%%u does not have type %%%u", constituents[i], expected);
+	    }
+	  }
+	}
+	return true;
+      default:
+	return this->fail(pos, "Result type is not a composite");
+      }
+    }
+
+    bool SValidationContext::checkTypes(uint32_t pos, uint32_t opcode, uint32_t type_id, int fixed, int count) {
+      if(opcode >= OP_TYPE_VOID && opcode <= OP_TYPE_FUNCTION) {
+	return this->checkTypeDeclaration(pos, opcode, count);
+      }
+
+      const uint32_t* ops = this->words + pos + fixed;
+      int num_ops = count - fixed;
+
+      // Types of id operands, where that makes sense
+      uint32_t t0 = num_ops > 0 && ops[0] < this->bound ? this->type_of[ops[0]] : 0;
+      uint32_t t1 = num_ops > 1 && ops[1] < this->bound ? this->type_of[ops[1]] : 0;
+      uint32_t t2 = num_ops > 2 && ops[2] < this->bound ? this->type_of[ops[2]] : 0;
+
+      switch(opcode) {
+      case OP_CONSTANT_TRUE:
+      case OP_CONSTANT_FALSE:
+      case OP_SPEC_CONSTANT_TRUE:
+      case OP_SPEC_CONSTANT_FALSE:
+	if(this->typeOpcode(type_id) != OP_TYPE_BOOL) {
+	  return this->fail(pos, "Result type must be bool");
+	}
+	break;
+      case OP_CONSTANT:
+      case OP_SPEC_CONSTANT:
+	{
+	  uint32_t op = this->typeOpcode(type_id);
+	  if(op != OP_TYPE_INT && op != OP_TYPE_FLOAT) {
+	    return this->fail(pos, "Result type must be a scalar integer or float");
+	  }
+	  int expected_words = (int)(this->typeOperand(type_id, 0) + 31) / 32;
+	  if(num_ops != expected_words) {
+	    return this->fail(pos, "Literal has %d words, expected %d", num_ops, expected_words);
+	  }
+	}
+	break;
+      case OP_CONSTANT_COMPOSITE:
+      case OP_SPEC_CONSTANT_COMPOSITE:
+	return this->checkComposite(pos, type_id, ops, num_ops, true);
+      case OP_COMPOSITE_CONSTRUCT:
+	return this->checkComposite(pos, type_id, ops, num_ops, false);
+
+      case OP_FUNCTION:
+	if(this->typeOpcode(ops[1]) != OP_TYPE_FUNCTION || this->typeOperand(ops[1], 0) != type_id) {
+	  return this->fail(pos, "Function type %%%u does not match the return type", ops[1]);
+	}
+	break;
+      case OP_FUNCTION_PARAMETER:
+	{
+	  uint32_t function_type = this->words[this->function_pos + 4];
+	  if(this->num_parameters >= this->typeNumOperands(function_type) ||
+	     this->typeOperand(function_type, this->num_parameters) != type_id) {
+	    return this->fail(pos, "Parameter does not match the function type");
+	  }
+	}
+	break;
+      case OP_RETURN:
+	if(this->typeOpcode(this->function_return_type) != OP_TYPE_VOID) {
+	  return this->fail(pos, "OpReturn in a function with non-void return type");
+	}
+	break;
+      case OP_RETURN_VALUE:
+	if(t0 != this->function_return_type) {
+	  return this->fail(pos, "Returned value does not have the function's return type");
+	}
+	break;
+
+      case OP_VARIABLE:
+	if(this->typeOpcode(type_id) != OP_TYPE_POINTER || this->typeOperand(type_id, 0) != ops[0]) {
+	  return this->fail(pos, "Result type must be a pointer with the same storage class");
+	}
+	if((ops[0] == STORAGE_CLASS_FUNCTION) != this->in_function) {
+	  return this->fail(pos, "Function storage class must be used for, and only for, variables in functions");
+	}
+	if(num_ops > 1 && this->type_of[ops[1]] != this->typeOperand(type_id, 1)) {
+	  return this->fail(pos, "Initializer does not have the pointee type");
+	}
+	if(!this->in_function) {
+	  this->global_variables.push_back(pos);
+	}
+	break;
+      case OP_LOAD:
+	if(this->typeOpcode(t0) != OP_TYPE_POINTER || this->typeOperand(t0, 1) != type_id) {
+	  return this->fail(pos, "Pointer %%%u does not point to the result type", ops[0]);
+	}
+	break;
+      case OP_STORE:
+	if(this->typeOpcode(t0) != OP_TYPE_POINTER || this->typeOperand(t0, 1) != t1) {
+	  return this->fail(pos, "Pointer %%%u does not point to the type of object %%%u", ops[0], ops[1]);
+	}
+	break;
+      case OP_ACCESS_CHAIN:
+      case OP_IN_BOUNDS_ACCESS_CHAIN:
+	{
+	  if(this->typeOpcode(t0) != OP_TYPE_POINTER) {
+	    return this->fail(pos, "Base %%%u is not a pointer", ops[0]);
+	  }
+	  if(this->typeOpcode(type_id) != OP_TYPE_POINTER ||
+	     this->typeOperand(type_id, 0) != this->typeOperand(t0, 0)) {
+	    return this->fail(pos, "Result type must be a pointer with the storage class of the base");
+	  }
+	  uint32_t res;
+	  if(!this->walkIndices(pos, this->typeOperand(t0, 1), ops + 1, num_ops - 1, false, &res)) {
+	    return false;
+	  }
+	  if(res != this->typeOperand(type_id, 1)) {
+	    return this->fail(pos, "Indexed type %%%u does not match the result pointee type", res);
+	  }
+	}
+	break;
+
+      case OP_COMPOSITE_EXTRACT:
+	{
+	  uint32_t res;
+	  if(!this->walkIndices(pos, t0, ops + 1, num_ops - 1, true, &res)) {
+	    return false;
+	  }
+	  if(res != type_id) {
+	    return this->fail(pos, "Extracted type %%%u does not match the result type", res);
+	  }
+	}
+	break;
+      case OP_COMPOSITE_INSERT:
+	{
+	  uint32_t res;
+	  if(t1 != type_id) {
+	    return this->fail(pos, "Composite does not have the result type");
+	  }
+	  if(!this->walkIndices(pos, t1, ops + 2, num_ops - 2, true, &res)) {
+	    return false;
+	  }
+	  if(res != t0) {
+	    return this->fail(pos, "Object does not have the type of the indexed member");
+	  }
+	}
+	break;
+      case OP_VECTOR_SHUFFLE:
+	{
+	  if(this->typeOpcode(type_id) != OP_TYPE_VECTOR ||
+	     this->typeOpcode(t0) != OP_TYPE_VECTOR || this->typeOpcode(t1) != OP_TYPE_VECTOR ||
+	     this->scalarType(t0) != this->scalarType(type_id) ||
+	     this->scalarType(t1) != this->scalarType(type_id)) {
+	    return this->fail(pos, "Operands and result must be vectors of the same component type");
+	  }
+	  if(num_ops - 2 != this->componentCount(type_id)) {
+	    return this->fail(pos, "Number of components does not match the result type");
+	  }
+	  uint32_t total = this->componentCount(t0) + this->componentCount(t1);
+	  for(int i = 2; i < num_ops; i++) {
+	    if(ops[i] >= total && ops[i] != 0xffffffff) {
+	      return this->fail(pos, "Component index %u is out of range", ops[i]);
+	    }
+	  }
+	}
+	break;
+      case OP_COPY_OBJECT:
+	if(t0 != type_id) {
+	  return this->fail(pos, "Operand does not have the result type");
+	}
+	break;
+
+      case 127: // OpFNegate
+      case 129: case 131: case 133: case 136: case 140: case 141: // OpFAdd .. OpFMod
+      case 207: case 208: case 209: case 210: case 211: case 212: case 213: case 214: case 215: // Derivatives
+	if(!this->isFloat(type_id) || this->typeOpcode(type_id) == OP_TYPE_MATRIX) {
+	  return this->fail(pos, "Result type must be a float scalar or vector");
+	}
+	for(int i = 0; i < num_ops; i++) {
+	  if(this->type_of[ops[i]] != type_id) {
+	    return this->fail(pos, "Operand %%%u does not have the result type", ops[i]);
+	  }
+	}
+	break;
+      case 126: // OpSNegate
+      case 128: case 130: case 132: case 134: case 135: case 137: case 138: case 139: // OpIAdd .. OpSMod
+      case 197: case 198: case 199: // Bitwise or, xor, and
+      case 200: // OpNot
+	if(!this->isInt(type_id)) {
+	  return this->fail(pos, "Result type must be an integer scalar or vector");
+	}
+	for(int i = 0; i < num_ops; i++) {
+	  uint32_t t = this->type_of[ops[i]];
+	  if(!this->isInt(t) || this->componentCount(t) != this->componentCount(type_id) ||
+	     this->typeOperand(this->scalarType(t), 0) != this->typeOperand(this->scalarType(type_id), 0)) {
+	    return this->fail(pos, "Operand %%%u does not match the result type", ops[i]);
+	  }
+	}
+	break;
+      case 194: case 195: case 196: // Shifts
+	if(!this->isInt(type_id) || t0 != type_id || !this->isInt(t1) ||
+	   this->componentCount(t1) != this->componentCount(type_id)) {
+	  return this->fail(pos, "Operands must be integers with the result's component count");
+	}
+	break;
+
+      case 142: // OpVectorTimesScalar
+	if(this->typeOpcode(type_id) != OP_TYPE_VECTOR || !this->isFloat(type_id) ||
+	   t0 != type_id || t1 != this->scalarType(type_id)) {
+	  return this->fail(pos, "Operands must be a float vector of the result type and its component type");
+	}
+	break;
+      case 143: // OpMatrixTimesScalar
+	if(this->typeOpcode(type_id) != OP_TYPE_MATRIX || t0 != type_id ||
+	   t1 != this->typeOperand(this->typeOperand(type_id, 0), 0)) {
+	  return this->fail(pos, "Operands must be a matrix of the result type and its component type");
+	}
+	break;
+      case 144: // OpVectorTimesMatrix
+	if(this->typeOpcode(t1) != OP_TYPE_MATRIX || this->typeOperand(t1, 0) != t0 ||
+	   this->typeOpcode(type_id) != OP_TYPE_VECTOR ||
+	   (uint32_t)this->componentCount(type_id) != this->typeOperand(t1, 1) ||
+	   this->scalarType(type_id) != this->scalarType(t0)) {
+	  return this->fail(pos, "Vector and matrix dimensions do not match");
+	}
+	break;
+      case 145: // OpMatrixTimesVector
+	if(this->typeOpcode(t0) != OP_TYPE_MATRIX || this->typeOperand(t0, 0) != type_id ||
+	   this->typeOpcode(t1) != OP_TYPE_VECTOR ||
+	   (uint32_t)this->componentCount(t1) != this->typeOperand(t0, 1) ||
+	   this->scalarType(t1) != this->scalarType(type_id)) {
+	  return this->fail(pos, "Matrix and vector dimensions do not match");
+	}
+	break;
+      case 146: // OpMatrixTimesMatrix
+	if(this->typeOpcode(t0) != OP_TYPE_MATRIX || this->typeOpcode(t1) != OP_TYPE_MATRIX ||
+	   this->typeOpcode(type_id) != OP_TYPE_MATRIX ||
+	   (uint32_t)this->componentCount(this->typeOperand(t1, 0)) != this->typeOperand(t0, 1) ||
+	   this->typeOperand(type_id, 0) != this->typeOperand(t0, 0) ||
+	   this->typeOperand(type_id, 1) != this->typeOperand(t1, 1)) {
+	  return this->fail(pos, "Matrix dimensions do not match");
+	}
+	break;
+      case 148: // OpDot
+	if(t0 != t1 || this->typeOpcode(t0) != OP_TYPE_VECTOR || !this->isFloat(t0) ||
+	   this->scalarType(t0) != type_id) {
+	  return this->fail(pos, "Operands must be float vectors of the same type, with the result as component type");
+	}
+	break;
+
+      case 154: case 155: // OpAny, OpAll
+	if(this->typeOpcode(type_id) != OP_TYPE_BOOL || this->typeOpcode(t0) != OP_TYPE_VECTOR ||
+	   !this->isBool(t0)) {
+	  return this->fail(pos, "Operand must be a bool vector, result a bool");
+	}
+	break;
+      case 156: case 157: // OpIsNan, OpIsInf
+	if(!this->isBool(type_id) || !this->isFloat(t0) ||
+	   this->componentCount(type_id) != this->componentCount(t0)) {
+	  return this->fail(pos, "Result must be a bool with the operand's component count");
+	}
+	break;
+      case 164: case 165: case 166: case 167: case 168: // Logical
+	if(!this->isBool(type_id)) {
+	  return this->fail(pos, "Result type must be bool");
+	}
+	for(int i = 0; i < num_ops; i++) {
+	  if(this->type_of[ops[i]] != type_id) {
+	    return this->fail(pos, "Operand %%%u does not have the result type", ops[i]);
+	  }
+	}
+	break;
+      case 169: // OpSelect
+	if(t1 != type_id || t2 != type_id) {
+	  return this->fail(pos, "Objects must have the result type");
+	}
+	if(!this->isBool(t0) || (this->componentCount(t0) != 1 &&
+				 this->componentCount(t0) != this->componentCount(type_id))) {
+	  return this->fail(pos, "Condition must be a bool or a bool vector of the result's size");
+	}
+	break;
+      case 170: case 171: case 172: case 173: case 174: case 175: case 176: case 177: case 178: case 179:
+	if(!this->isBool(type_id) || !this->isInt(t0) || !this->isInt(t1) ||
+	   this->componentCount(t0) != this->componentCount(type_id) ||
+	   this->componentCount(t1) != this->componentCount(type_id) ||
+	   this->typeOperand(this->scalarType(t0), 0) != this->typeOperand(this->scalarType(t1), 0)) {
+	  return this->fail(pos, "Operands must be integers of equal width and the result's component count");
+	}
+	break;
+      case 180: case 181: case 182: case 183: case 184: case 185:
+      case 186: case 187: case 188: case 189: case 190: case 191:
+	if(!this->isBool(type_id) || !this->isFloat(t0) || t0 != t1 ||
+	   this->componentCount(t0) != this->componentCount(type_id)) {
+	  return this->fail(pos, "Operands must be floats of the same type and the result's component count");
+	}
+	break;
+
+      case 109: case 110: // OpConvertFToU, OpConvertFToS
+      case 111: case 112: // OpConvertSToF, OpConvertUToF
+      case 113: case 114: // OpUConvert, OpSConvert
+      case 115: // OpFConvert
+	{
+	  bool from_float = opcode == 109 || opcode == 110 || opcode == 115;
+	  bool to_float = opcode == 111 || opcode == 112 || opcode == 115;
+	  if((from_float ? !this->isFloat(t0) : !this->isInt(t0)) ||
+	     (to_float ? !this->isFloat(type_id) : !this->isInt(type_id)) ||
+	     this->componentCount(t0) != this->componentCount(type_id)) {
+	    return this->fail(pos, "Operand and result types do not match the conversion");
+	  }
+	}
+	break;
+
+      case OP_EXT_INST:
+	if(this->typeOpcode(ops[0]) != OP_EXT_INST_IMPORT) {
+	  return this->fail(pos, "%%%u is not an extended instruction set", ops[0]);
+	}
+	break;
+      case OP_SAMPLED_IMAGE:
+	if(this->typeOpcode(type_id) != OP_TYPE_SAMPLED_IMAGE || this->typeOperand(type_id, 0) != t0) {
+	  return this->fail(pos, "Result type must be a sampled image of the image's type");
+	}
+	break;
+      case 87: case 88: case 89: case 90: case 91: case 92: // Image sampling
+	if(this->typeOpcode(t0) != OP_TYPE_SAMPLED_IMAGE) {
+	  return this->fail(pos, "Operand %%%u is not a sampled image", ops[0]);
+	}
+	break;
+
+      case OP_BRANCH_CONDITIONAL:
+	if(this->typeOpcode(t0) != OP_TYPE_BOOL) {
+	  return this->fail(pos, "Condition must be a scalar bool");
+	}
+	if(num_ops != 3 && num_ops != 5) {
+	  return this->fail(pos, "There must be zero or two branch weights");
+	}
+	break;
+      case OP_SWITCH:
+	if(this->typeOpcode(t0) != OP_TYPE_INT) {
+	  return this->fail(pos, "Selector must be a scalar integer");
+	}
+	break;
+      case OP_LOOP_MERGE:
+	if(ops[0] == ops[1]) {
+	  return this->fail(pos, "Merge block and continue target must differ");
+	}
+	break;
+
+      case OP_FUNCTION_CALL:
+	this->function_calls.push_back(pos);
+	break;
+      case OP_DECORATE:
+      case OP_DECORATE_ID:
+      case OP_DECORATE_STRING:
+	this->decorations.push_back({opcode, ops[0], -1, ops[1], pos});
+	break;
+      case OP_MEMBER_DECORATE:
+      case OP_MEMBER_DECORATE_STRING:
+	this->decorations.push_back({opcode, ops[0], (int)ops[1], ops[2], pos});
+	break;
+      case OP_ENTRY_POINT:
+	this->entry_points.push_back(pos);
+	break;
+      case OP_EXECUTION_MODE:
+      case OP_EXECUTION_MODE_ID:
+	this->execution_modes.push_back(pos);
+	break;
+      }
+
+      return true;
+    }
+
+    bool SValidationContext::dominates(int a, int b) const {
+      while(b != a) {
+	int next = this->idom[b];
+	if(next == b) {
+	  return false;
+	}
+	b = next;
+      }
+      return true;
+    }
+
+    bool SValidationContext::computeDominators() {
+      int n = this->num_blocks;
+      this->idom.assign(n, -1);
+      this->post_order_number.assign(n, -1);
+
+      // Iterative depth-first search for the post order. Blocks are marked
+      // as visited by giving them a temporary post order number
+      std::vector<int>& post_order = this->post_order;
+      std::vector<std::pair<int, int> >& stack = this->search_stack;
+      post_order.clear();
+      stack.clear();
+      stack.push_back(std::make_pair(0, 0));
+      this->post_order_number[0] = n;
+      while(stack.size()) {
+	std::pair<int, int>& top = stack.back();
+	const ValidationBlock& block = this->blocks[top.first];
+	if(top.second < block.num_successors) {
+	  int s = this->def_block[this->successors[block.first_successor + top.second++]];
+	  if(this->post_order_number[s] < 0) {
+	    this->post_order_number[s] = n;
+	    stack.push_back(std::make_pair(s, 0));
+	  }
+	} else {
+	  this->post_order_number[top.first] = (int)post_order.size();
+	  post_order.push_back(top.first);
+	  stack.pop_back();
+	}
+      }
+
+      // Cooper, Harvey and Kennedy - converges in a couple of passes for structured code
+      this->idom[0] = 0;
+      bool changed = true;
+      while(changed) {
+	changed = false;
+	for(int i = (int)post_order.size() - 2; i >= 0; i--) {
+	  int b = post_order[i];
+	  int new_idom = -1;
+	  const ValidationBlock& block = this->blocks[b];
+	  for(int k = 0; k < block.num_predecessors; k++) {
+	    int p = this->predecessors[block.first_predecessor + k];
+	    if(this->idom[p] < 0) {
+	      continue;
+	    }
+	    if(new_idom < 0) {
+	      new_idom = p;
+	      continue;
+	    }
+
+	    int x = p, y = new_idom;
+	    while(x != y) {
+	      while(this->post_order_number[x] < this->post_order_number[y]) {
+		x = this->idom[x];
+	      }
+	      while(this->post_order_number[y] < this->post_order_number[x]) {
+		y = this->idom[y];
+	      }
+	    }
+	    new_idom = x;
+	  }
+
+	  if(new_idom != this->idom[b]) {
+	    this->idom[b] = new_idom;
+	    changed = true;
+	  }
+	}
+      }
+
+      return true;
+    }
+
+    bool SValidationContext::finishFunction() {
+      this->in_function = false;
+
+      int n = this->num_blocks;
+      if(n == 0) {
+	return true; // Function declaration
+      }
+
+      std::vector<int>& merge_owner = this->merge_owner;
+      std::vector<bool>& is_merge_or_continue = this->is_merge_or_continue;
+      merge_owner.assign(n, -1);
+      is_merge_or_continue.assign(n, false);
+
+      // Count predecessors, then lay them out in one flat array
+      for(int i = 0; i < n; i++) {
+	this->blocks[i].num_predecessors = 0;
+      }
+
+      for(int i = 0; i < n; i++) {
+	const ValidationBlock& block = this->blocks[i];
+	for(int k = 0; k < block.num_successors; k++) {
+	  uint32_t target = this->successors[block.first_successor + k];
+	  int s = this->blockOfLabel(target);
+	  if(s < 0) {
+	    return this->fail(block.terminator_pos, "Branch target %%%u is not a label in this function", target);
+	  }
+	  if(s == 0) {
+	    return this->fail(block.terminator_pos, "The entry block cannot be a branch target");
+	  }
+	  if(std::find(this->successors.begin() + block.first_successor,
+		       this->successors.begin() + block.first_successor + k, target) ==
+	     this->successors.begin() + block.first_successor + k) {
+	    this->blocks[s].num_predecessors++;
+	  }
+	}
+      }
+
+      int total = 0;
+      for(int i = 0; i < n; i++) {
+	this->blocks[i].first_predecessor = total;
+	total += this->blocks[i].num_predecessors;
+	this->blocks[i].num_predecessors = 0;
+      }
+      this->predecessors.resize(total);
+
+      for(int i = 0; i < n; i++) {
+	const ValidationBlock& block = this->blocks[i];
+	for(int k = 0; k < block.num_successors; k++) {
+	  ValidationBlock& target = this->blocks[this->def_block[this->successors[block.first_successor + k]]];
+	  int last = target.first_predecessor + target.num_predecessors - 1;
+	  if(target.num_predecessors == 0 || this->predecessors[last] != i) {
+	    this->predecessors[target.first_predecessor + target.num_predecessors++] = i;
+	  }
+	}
+      }
+
+      for(int i = 0; i < n; i++) {
+	const ValidationBlock& block = this->blocks[i];
+
+	if(block.merge) {
+	  int m = this->blockOfLabel(block.merge);
+	  if(m < 0) {
+	    return this->fail(block.pos, "Merge block %%%u is not a label in this function", block.merge);
+	  }
+	  if(m == i) {
+	    return this->fail(block.pos, "Block %%%u is its own merge block", block.label);
+	  }
+	  if(merge_owner[m] >= 0) {
+	    return this->fail(block.pos, "Block %%%u is the merge block of more than one header", block.merge);
+	  }
+	  merge_owner[m] = i;
+	  is_merge_or_continue[m] = true;
+	}
+
+	if(block.is_loop_header) {
+	  int c = this->blockOfLabel(block.continue_target);
+	  if(c < 0) {
+	    return this->fail(block.pos, "Continue target %%%u is not a label in this function",
+			      block.continue_target);
+	  }
+	  is_merge_or_continue[c] = true;
+	}
+      }
+
+      // A conditional branch without merge instruction must break out of or continue a construct
+      for(int i = 0; i < n; i++) {
+	const ValidationBlock& block = this->blocks[i];
+	if(block.unmerged_conditional &&
+	   !is_merge_or_continue[this->def_block[this->successors[block.first_successor]]] &&
+	   !is_merge_or_continue[this->def_block[this->successors[block.first_successor + 1]]]) {
+	  return this->fail(block.terminator_pos, "Conditional branch needs a merge instruction");
+	}
+      }
+
+      this->computeDominators();
+
+      for(const ValidationUse& use : this->uses) {
+	int def = this->def_block[use.id];
+	if(def < 0 || this->idom[use.block] < 0) {
+	  continue; // Parameters dominate everything, and uses in unreachable blocks are not checked
+	}
+	if(this->idom[def] < 0 || !this->dominates(def, use.block)) {
+	  return this->fail(use.pos, "Definition of %%%u does not dominate its use", use.id);
+	}
+      }
+
+      for(const std::pair<uint32_t, int>& phi : this->phis) {
+	uint32_t phi_pos = phi.first;
+	int b = phi.second;
+	uint32_t type_id = this->words[phi_pos + 1];
+	int num_ops = (int)this->getWordCount(phi_pos) - 3;
+	const uint32_t* ops = this->words + phi_pos + 3;
+
+	if(num_ops % 2) {
+	  return this->fail(phi_pos, "Operands must come in (value, parent) pairs");
+	}
+
+	const int* preds_begin = this->predecessors.data() + this->blocks[b].first_predecessor;
+	const int* preds_end = preds_begin + this->blocks[b].num_predecessors;
+	if(this->idom[b] >= 0 && num_ops / 2 != this->blocks[b].num_predecessors) {
+	  return this->fail(phi_pos, "Has %d parents, but the block has %d predecessors",
+			    num_ops / 2, this->blocks[b].num_predecessors);
+	}
+
+	for(int i = 0; i < num_ops; i += 2) {
+	  uint32_t value = ops[i];
+	  int parent = this->blockOfLabel(ops[i + 1]);
+	  if(parent < 0 || std::find(preds_begin, preds_end, parent) == preds_end) {
+	    return this->fail(phi_pos, "Parent %%%u is not a predecessor of the block", ops[i + 1]);
+	  }
+	  if(!this->def_pos[value]) {
+	    return this->fail(phi_pos, "Value %%%u is not defined", value);
+	  }
+	  if(this->type_of[value] != type_id) {
+	    return this->fail(phi_pos, "Value %%%u does not have the result type", value);
+	  }
+	  if(this->def_function[value] >= 0) {
+	    if(this->def_function[value] != this->function_index) {
+	      return this->fail(phi_pos, "Value %%%u is defined in another function", value);
+	    }
+	    int def = this->def_block[value];
+	    if(def >= 0 && this->idom[parent] >= 0 && (this->idom[def] < 0 || !this->dominates(def, parent))) {
+	      return this->fail(phi_pos, "Definition of %%%u does not dominate parent %%%u", value, ops[i + 1]);
+	    }
+	  }
+	}
+      }
+
+      return true;
+    }
+
+    bool SValidationContext::finishModule() {
+      if(this->num_memory_models != 1) {
+	return this->fail(0, "There must be exactly one OpMemoryModel");
+      }
+
+      // Two non-aggregate, non-pointer types with the same operands are not allowed
+      const uint32_t* words = this->words;
+      std::sort(this->type_declarations.begin(), this->type_declarations.end(),
+		[words](uint32_t a, uint32_t b) {
+		  if(words[a] != words[b]) { // Opcode and word count
+		    return words[a] < words[b];
+		  }
+		  return std::lexicographical_compare(words + a + 2, words + a + (words[a] >> 16),
+						      words + b + 2, words + b + (words[b] >> 16));
+		});
+      for(unsigned int i = 1; i < this->type_declarations.size(); i++) {
+	uint32_t a = this->type_declarations[i - 1], b = this->type_declarations[i];
+	if(words[a] == words[b] && std::equal(words + a + 2, words + a + (words[a] >> 16), words + b + 2)) {
+	  return this->fail(std::max(a, b), "Type is declared more than once, first as %%%u", words[std::min(a, b) + 1]);
+	}
+      }
+
+      for(const std::pair<uint32_t, uint32_t>& ref : this->forward_references) {
+	if(!this->def_pos[ref.first]) {
+	  return this->fail(ref.second, "Id %%%u is never defined", ref.first);
+	}
+      }
+
+      for(uint32_t pos : this->function_calls) {
+	const uint32_t* ops = this->words + pos + 3;
+	int num_args = (int)this->getWordCount(pos) - 4;
+	uint32_t callee = ops[0];
+	if(this->typeOpcode(callee) != OP_FUNCTION) {
+	  return this->fail(pos, "%%%u is not a function", callee);
+	}
+	uint32_t function_type = this->words[this->def_pos[callee] + 4];
+	if(this->typeOperand(function_type, 0) != this->words[pos + 1]) {
+	  return this->fail(pos, "Result type does not match the return type of %%%u", callee);
+	}
+	if(num_args != this->typeNumOperands(function_type) - 1) {
+	  return this->fail(pos, "Wrong number of arguments to %%%u", callee);
+	}
+	for(int i = 0; i < num_args; i++) {
+	  if(this->type_of[ops[1 + i]] != this->typeOperand(function_type, 1 + i)) {
+	    return this->fail(pos, "Argument %%%u has the wrong type", ops[1 + i]);
+	  }
+	}
+      }
+
+      std::vector<uint32_t>& entry_functions = this->entry_functions;
+      entry_functions.clear();
+      for(uint32_t pos : this->entry_points) {
+	uint32_t function = this->words[pos + 2];
+	if(this->typeOpcode(function) != OP_FUNCTION) {
+	  return this->fail(pos, "Entry point %%%u is not a function", function);
+	}
+	entry_functions.push_back(function);
+
+	int name_len = SInstructionSet::stringWordLength(this->words + pos + 3, this->getWordCount(pos) - 3);
+	for(uint32_t i = 3 + name_len; i < this->getWordCount(pos); i++) {
+	  uint32_t id = this->words[pos + i];
+	  if(this->typeOpcode(id) != OP_VARIABLE) {
+	    return this->fail(pos, "Interface %%%u is not a variable", id);
+	  }
+	  uint32_t storage = this->words[this->def_pos[id] + 3];
+	  if(this->version < 0x00010400 && storage != STORAGE_CLASS_INPUT && storage != STORAGE_CLASS_OUTPUT) {
+	    return this->fail(pos, "Interface %%%u must have Input or Output storage class", id);
+	  }
+	}
+      }
+
+      for(uint32_t pos : this->execution_modes) {
+	if(std::find(entry_functions.begin(), entry_functions.end(), this->words[pos + 1]) ==
+	   entry_functions.end()) {
+	  return this->fail(pos, "%%%u is not an entry point", this->words[pos + 1]);
+	}
+      }
+
+      // Decorations
+      std::vector<std::tuple<uint32_t, int, uint32_t, uint32_t> >& keys = this->decoration_keys;
+      keys.clear();
+      for(const ValidationDecoration& d : this->decorations) {
+	uint32_t target_op = this->typeOpcode(d.target);
+
+	if(d.member >= 0) {
+	  if(target_op != OP_TYPE_STRUCT) {
+	    return this->fail(d.pos, "Member decoration target %%%u is not a struct", d.target);
+	  }
+	  if(d.member >= this->typeNumOperands(d.target)) {
+	    return this->fail(d.pos, "Member %d is out of range", d.member);
+	  }
+	  if(d.decoration == DECORATION_BUILTIN) {
+	    this->flags[d.target] |= FLAG_BUILTIN_MEMBER;
+	  }
+	} else {
+	  switch(d.decoration) {
+	  case DECORATION_BLOCK:
+	  case DECORATION_BUFFER_BLOCK:
+	    if(target_op != OP_TYPE_STRUCT) {
+	      return this->fail(d.pos, "Block decoration on %%%u, which is not a struct", d.target);
+	    }
+	    break;
+	  case DECORATION_ROW_MAJOR:
+	  case DECORATION_COL_MAJOR:
+	  case DECORATION_MATRIX_STRIDE:
+	    return this->fail(d.pos, "Decoration only applies to struct members");
+	  case DECORATION_ARRAY_STRIDE:
+	    if(target_op != OP_TYPE_ARRAY && target_op != OP_TYPE_RUNTIME_ARRAY && target_op != OP_TYPE_POINTER) {
+	      return this->fail(d.pos, "ArrayStride on %%%u, which is not an array or pointer type", d.target);
+	    }
+	    break;
+	  case DECORATION_BUILTIN:
+	    if(target_op != OP_VARIABLE && target_op != OP_CONSTANT_COMPOSITE &&
+	       target_op != OP_SPEC_CONSTANT_COMPOSITE) {
+	      return this->fail(d.pos, "BuiltIn on %%%u, which is not a variable", d.target);
+	    }
+	    this->flags[d.target] |= FLAG_BUILTIN;
+	    break;
+	  case DECORATION_LOCATION:
+	  case DECORATION_COMPONENT:
+	  case DECORATION_INDEX:
+	  case DECORATION_BINDING:
+	  case DECORATION_DESCRIPTOR_SET:
+	  case DECORATION_OFFSET:
+	    if(target_op != OP_VARIABLE) {
+	      return this->fail(d.pos, "Decoration on %%%u, which is not a variable", d.target);
+	    }
+	    this->flags[d.target] |= d.decoration == DECORATION_LOCATION ? FLAG_LOCATION :
+	      d.decoration == DECORATION_BINDING ? FLAG_BINDING :
+	      d.decoration == DECORATION_DESCRIPTOR_SET ? FLAG_DESCRIPTOR_SET : 0;
+	    break;
+	  }
+	}
+
+	if(d.decoration != DECORATION_COUNTER_BUFFER && d.decoration != DECORATION_USER_SEMANTIC) {
+	  keys.push_back(std::make_tuple(d.target, d.member, d.decoration, d.pos));
+	}
+      }
+
+      std::sort(keys.begin(), keys.end());
+      for(unsigned int i = 1; i < keys.size(); i++) {
+	if(std::get<0>(keys[i]) == std::get<0>(keys[i - 1]) &&
+	   std::get<1>(keys[i]) == std::get<1>(keys[i - 1]) &&
+	   std::get<2>(keys[i]) == std::get<2>(keys[i - 1])) {
+	  return this->fail(std::get<3>(keys[i]), "%%%u is decorated twice with decoration %u",
+			    std::get<0>(keys[i]), std::get<2>(keys[i]));
+	}
+      }
+
+      // Interface and resource variables need to be reachable from the API
+      for(uint32_t pos : this->global_variables) {
+	uint32_t id = this->words[pos + 2];
+	uint32_t storage = this->words[pos + 3];
+	uint32_t pointee = this->typeOperand(this->words[pos + 1], 1);
+
+	if(storage == STORAGE_CLASS_INPUT || storage == STORAGE_CLASS_OUTPUT) {
+	  if(!(this->flags[id] & (FLAG_LOCATION | FLAG_BUILTIN)) &&
+	     !(this->flags[pointee] & FLAG_BUILTIN_MEMBER)) {
+	    return this->fail(pos, "Interface variable %%%u has neither Location nor BuiltIn", id);
+	  }
+	} else if(storage == STORAGE_CLASS_UNIFORM || storage == STORAGE_CLASS_UNIFORM_CONSTANT ||
+		  storage == STORAGE_CLASS_STORAGE_BUFFER) {
+	  if((this->flags[id] & (FLAG_BINDING | FLAG_DESCRIPTOR_SET)) != (FLAG_BINDING | FLAG_DESCRIPTOR_SET)) {
+	    return this->fail(pos, "Resource variable %%%u needs both DescriptorSet and Binding", id);
+	  }
+	}
+      }
+
+      return true;
+    }
+
+  };
+
+
+  /*
+   * SValidator members
+   */
+
+  bool SValidator::enabled = true;
+
+
+  /*
+   * SValidator member functions
+   */
+
+  void SValidator::setEnabled(bool enabled) {
+    SValidator::enabled = enabled;
+  }
+
+  bool SValidator::isEnabled() {
+    return SValidator::enabled;
+  }
+
+  bool SValidator::validate(const uint32_t* words, size_t num_words, std::string& error) {
+    static thread_local SValidationContext context;
+    return context.run(words, num_words, error);
+  }
+
+  bool SValidator::validate(const std::vector<uint32_t>& binary, std::string& error) {
+    return SValidator::validate(binary.data(), binary.size(), error);
+  }
+
+};
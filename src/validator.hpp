@@ -0,0 +1,39 @@
+#ifndef __SPURV_VALIDATOR
+#define __SPURV_VALIDATOR
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace spurv {
+
+  /*
+   * SValidator - Structural validation of SPIR-V binaries, meant to catch errors
+   * in the emitted code before the driver sees it. Checks logical layout,
+   * definition before use and dominance, result and operand types of the
+   * instructions spurv emits, structured control flow and decorations.
+   * Runs in time roughly linear in the size of the binary.
+   *
+   * SShader::compile validates what it writes in builds without NDEBUG, and
+   * exits if the binary is not valid, unless turned off with setEnabled
+   */
+
+  class SValidator {
+    static bool enabled;
+
+  public:
+    SValidator() = delete;
+
+    // Validation of compiled shaders is on by default
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // Returns false and fills in error with the first problem found
+    static bool validate(const uint32_t* words, size_t num_words, std::string& error);
+    static bool validate(const std::vector<uint32_t>& binary, std::string& error);
+  };
+
+};
+
+#endif // __SPURV_VALIDATOR
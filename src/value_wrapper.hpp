@@ -273,6 +273,7 @@ namespace spurv {
       std::is_base_of<SValue<tt>, ss>::value ||
       (std::is_fundamental<typename InvMapSType<tt>::type>::value &&
        std::is_convertible<ss, typename InvMapSType<tt>::type>::value) ||
+      std::is_same<typename MapSType<ss>::type, tt>::value || // Host matrices
       is_spurv_castable<typename SValueWrapper::ToType<ss>::type, tt>::value;
   };
   
@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <vector>
+#include <utility>
 
 namespace spurv {
 
@@ -125,12 +126,120 @@ namespace spurv {
   };
 
   
+  /*
+   * SNodeKind - The different kinds of nodes, as reported by SValueBase::getNodeInfo
+   */
+
+  enum SNodeKind {
+    NODE_CONSTANT,
+    NODE_EXPRESSION,
+    NODE_GLSL_FUNCTION,
+    NODE_CONSTRUCT_MATRIX,
+    NODE_SELECT,
+    NODE_LOAD,
+    NODE_CUSTOM,
+    NODE_PARAMETER,
+    NODE_FUNCTION_CALL
+  };
+
+  class SValueBase;
+
+
+  /*
+   * swizzle_result - Type of k components taken out of a vector of type tt
+   */
+
+  template<typename tt, int k>
+  struct swizzle_result {
+    using type = void_s;
+  };
+
+  template<int n, typename inner, int k>
+  struct swizzle_result<SMat<n, 1, inner>, k> {
+    using type = SMat<k, 1, inner>;
+  };
+
+
+  /*
+   * IsSwizzle - A concept requiring tt to be a vector having all of the components is
+   */
+
+  template<typename tt, int... is>
+  concept IsSwizzle =
+    is_spurv_mat_type<tt>::value && tt::mm == 1 && sizeof...(is) > 1 && sizeof...(is) <= 4 &&
+    ((is >= 0 && is < tt::nn) && ...);
+
+
+  /*
+   * Named swizzles, from xy() to wwww(). Each SPURV_SWIZZLEk_ macro adds a component to
+   * the name and indices given to it
+   */
+
+#define SPURV_SWIZZLE(name, k, ...)					\
+  SValue<typename swizzle_result<tt, k>::type>& name()			\
+    requires IsSwizzle<tt, __VA_ARGS__> { return this->template swizzle<__VA_ARGS__>(); }
+
+#define SPURV_SWIZZLE_LAST(a, i, F)	\
+  F(a, i, x, 0) F(a, i, y, 1) F(a, i, z, 2) F(a, i, w, 3)
+
+#define SPURV_SWIZZLE2_(a, i, b, j) SPURV_SWIZZLE(a##b, 2, i, j)
+#define SPURV_SWIZZLE2(a, i) SPURV_SWIZZLE_LAST(a, i, SPURV_SWIZZLE2_)
+
+#define SPURV_SWIZZLE3__(ab, i, j, c, k) SPURV_SWIZZLE(ab##c, 3, i, j, k)
+#define SPURV_SWIZZLE3_(a, i, b, j)					\
+  SPURV_SWIZZLE3__(a##b, i, j, x, 0) SPURV_SWIZZLE3__(a##b, i, j, y, 1) \
+  SPURV_SWIZZLE3__(a##b, i, j, z, 2) SPURV_SWIZZLE3__(a##b, i, j, w, 3)
+#define SPURV_SWIZZLE3(a, i) SPURV_SWIZZLE_LAST(a, i, SPURV_SWIZZLE3_)
+
+#define SPURV_SWIZZLE4___(abc, i, j, k, d, l) SPURV_SWIZZLE(abc##d, 4, i, j, k, l)
+#define SPURV_SWIZZLE4__(ab, i, j, c, k)					\
+  SPURV_SWIZZLE4___(ab##c, i, j, k, x, 0) SPURV_SWIZZLE4___(ab##c, i, j, k, y, 1) \
+  SPURV_SWIZZLE4___(ab##c, i, j, k, z, 2) SPURV_SWIZZLE4___(ab##c, i, j, k, w, 3)
+#define SPURV_SWIZZLE4_(a, i, b, j)					\
+  SPURV_SWIZZLE4__(a##b, i, j, x, 0) SPURV_SWIZZLE4__(a##b, i, j, y, 1) \
+  SPURV_SWIZZLE4__(a##b, i, j, z, 2) SPURV_SWIZZLE4__(a##b, i, j, w, 3)
+#define SPURV_SWIZZLE4(a, i) SPURV_SWIZZLE_LAST(a, i, SPURV_SWIZZLE4_)
+
+#define SPURV_SWIZZLES(k)						\
+  SPURV_SWIZZLE##k(x, 0) SPURV_SWIZZLE##k(y, 1) SPURV_SWIZZLE##k(z, 2) SPURV_SWIZZLE##k(w, 3)
+
+  
+  /*
+   * SNodeInfo - Type-independent description of a node
+   */
+
+  struct SNodeInfo {
+    SNodeKind kind;
+    int id;
+    int operation; // SExprOp for expressions, GLSLFunction for GLSL functions, -1 otherwise
+    DSType type;
+    std::string value; // Printed value, for constants
+
+    std::vector<const SValueBase*> operands;
+    const SPointerBase* pointer; // Pointer loaded from, for loads
+  };
+
+
+  /*
+   * SValueBase - Non-templated base of SValue, lets the graph be inspected
+   * without knowing the types of the nodes
+   */
+
+  class SValueBase {
+  public:
+    virtual void getNodeInfo(SNodeInfo& info) const = 0;
+
+    // Whether the node has been written to the binary currently being compiled
+    virtual bool isDefined() const = 0;
+  };
+
+  
   /*
    * SValue - The mother of all nodes in the syntax trees
    */
   
   template<typename tt>
-  class SValue {
+  class SValue : public SValueBase {
     static_assert(is_spurv_type<tt>::value);
   protected:
     unsigned int id;
@@ -142,6 +251,8 @@ namespace spurv {
     SValue();
     
     virtual void print_nodes_post_order(std::ostream& str) const;
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual bool isDefined() const;
 
     int getID() const;
     
@@ -155,17 +266,43 @@ namespace spurv {
     virtual void ensure_type_defined(std::vector<uint32_t>& res,
 				     std::vector<SDeclarationState*>& declaration_states);
 
+    // Returns the equivalent of this node with the operands replaced by their copies in map,
+    // used when unrolling loops. Nodes without operands return themselves
+    virtual SValue<tt>* clone(SCloneMap& map);
+
     template<typename ti>
     SValue<typename lookup_result<tt>::type>& operator[](SValue<ti>& index);
     
     SValue<typename lookup_result<tt>::type>& operator[](int s); // Lookup operator that requires constants
 
+    // The vector of the given components of this vector, as v.zyx in GLSL. Written as
+    // a single OpVectorShuffle, see ConstructMatrix
+    template<int... is>
+    SValue<typename swizzle_result<tt, sizeof...(is)>::type>& swizzle() requires IsSwizzle<tt, is...>;
+
+    SPURV_SWIZZLES(2)
+    SPURV_SWIZZLES(3)
+    SPURV_SWIZZLES(4)
+
     // Image storing
     template<typename tind, typename tval>
     void store(tind&& ind, tval&& val);
     
     friend class SUtils;
   };
+
+#undef SPURV_SWIZZLES
+#undef SPURV_SWIZZLE4
+#undef SPURV_SWIZZLE4_
+#undef SPURV_SWIZZLE4__
+#undef SPURV_SWIZZLE4___
+#undef SPURV_SWIZZLE3
+#undef SPURV_SWIZZLE3_
+#undef SPURV_SWIZZLE3__
+#undef SPURV_SWIZZLE2
+#undef SPURV_SWIZZLE2_
+#undef SPURV_SWIZZLE_LAST
+#undef SPURV_SWIZZLE
   
 
   /*
@@ -180,6 +317,7 @@ namespace spurv {
     virtual void define(std::vector<uint32_t>& res);
     virtual void ensure_type_defined(std::vector<uint32_t>& res,
 				     std::vector<SDeclarationState*>& declaration_states);
+    virtual void getNodeInfo(SNodeInfo& info) const;
     
     tt value;
 
@@ -280,6 +418,8 @@ namespace spurv {
 
   public:
     virtual void define(std::vector<uint32_t>& res);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<tt>* clone(SCloneMap& map);
 
     friend class SUtils;
   };
@@ -310,6 +450,8 @@ namespace spurv {
     // Thus, we avoid copies
     SExpr(const SExpr<tt, op, tt2, tt3>& e) = delete;
 
+    // Writes the addition as an Fma of the product in operand fused_operand, see SFmaContractor
+    void define_fma(std::vector<uint32_t>& res, int fused_operand);
 
   public:
     virtual void print_nodes_post_order(std::ostream& str) const ;
@@ -317,11 +459,21 @@ namespace spurv {
     virtual void define(std::vector<uint32_t>& res);
     virtual void ensure_type_decorated(std::vector<uint32_t>& bin,
 				       std::vector<bool*>& decoration_states);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<tt>* clone(SCloneMap& map);
 
       void register_left_node(SValue<tt2>& node);
       void register_right_node(SValue<tt3>& node);
 
       friend class SUtils;
+
+      template<typename tt_, SExprOp op_, typename tt2_, typename tt3_>
+      friend class SExpr;
+
+      template<int n, int m, typename inner>
+      friend class ConstructMatrix;
+
+      friend class SAlgebraicSimplifier;
   };
   
   
@@ -333,7 +485,7 @@ namespace spurv {
   class ConstructMatrix : public SValue<SMat<n, m, inner> > {
   protected:
 
-    bool using_columns();
+    bool using_columns() const;
     
     template<typename... Types>
     ConstructMatrix(Types&&... args);
@@ -344,19 +496,112 @@ namespace spurv {
     template<typename t1, typename... trest>
     void insertColumns(int u, t1&& first, trest&&... args);
 
+    // Turns this into an OpConstantComposite (or OpConstantNull) if all components are constants
+    void detect_constant();
+
+    // Finds the vector and index component was extracted from, if it is a lookup with a
+    // constant index into a vector with k components
+    template<int k, int s>
+    static bool find_extraction(SValue<inner>* component, void*& source, int& index);
+
+    // Turns this into an OpVectorShuffle if it is a vector of components extracted
+    // from at most two other vectors with constant indices
+    void detect_shuffle();
+
+    SValueBase* shuffle_source(int i) const;
+    int shuffle_source_id(int i) const;
+    void ensure_shuffle_source_defined(int i, std::vector<uint32_t>& res);
+    void ensure_shuffle_source_type_defined(int i, std::vector<uint32_t>& res,
+					    std::vector<SDeclarationState*>& declaration_states);
+
+    template<std::size_t... is>
+    ConstructMatrix<n, 1, inner>* construct_column(int col, std::index_sequence<is...>);
+
+    // Constructs a matrix from components of type ct, laid out as in this->components
+    template<typename ct, std::size_t... is>
+    ConstructMatrix<n, m, inner>* construct_from(const std::vector<void*>& components, std::index_sequence<is...>);
+
+    // Finds the operands of each component, if all components are op on the same types
+    template<SExprOp op>
+    static bool find_operation(const std::vector<void*>& components,
+			       std::vector<void*>& lhs, std::vector<void*>& rhs);
+
+    // Finds the operation all components are, and their operands, if it can be vectorized
+    static bool find_isomorphic(const std::vector<void*>& components, SExprOp& op,
+				std::vector<void*>& lhs, std::vector<void*>& rhs);
+
+    // The vector with n components that components are extracted from in order, if any
+    static SValue<SMat<n, 1, inner> >* find_source(const std::vector<void*>& components);
+
+    // Number of instructions needed to get the vector of components, computing it as a vector
+    // operation if that is cheaper (see SSlpVectorizer). scalar_cost is set to the number of
+    // instructions computing the components themselves
+    static int vector_cost(const std::vector<void*>& components, int depth,
+			   int& scalar_cost, bool& is_vectorized);
+
+    // The vector of components, as found cheapest by vector_cost
+    static SValue<SMat<n, 1, inner> >& vectorize(const std::vector<void*>& components, int depth);
+
+    template<std::size_t... is>
+    static SValue<SMat<n, 1, inner> >& gather(const std::vector<void*>& components, std::index_sequence<is...>);
+
+    // Computes this vector as a vector operation if that is cheaper, see SSlpVectorizer
+    void detect_vectorization();
+
     std::vector<void*> components; // Values in row-major order
 
+    bool is_constant, is_null;
+    std::vector<int> constituent_ids; // Of the constant components or columns
+
+    // Set for shuffles, see detect_shuffle
+    std::vector<void*> shuffle_sources; // Of type SValue<SMat<k, 1, inner> >
+    std::vector<int> shuffle_source_sizes; // k of each source
+    std::vector<int> shuffle_indices; // Into the sources laid end to end, one per component
+
+    SValue<SMat<n, 1, inner> >* vectorized; // Set if computed as a vector operation
+
   public:
     virtual void define(std::vector<uint32_t>& res);
     virtual void ensure_type_defined(std::vector<uint32_t>& res,
 				     std::vector<SDeclarationState*>& declaration_states);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<SMat<n, m, inner> >* clone(SCloneMap& map);
   
     friend class SUtils;
+
+    template<int n2, int m2, typename inner2>
+    friend class ConstructMatrix;
+
+    friend class SAlgebraicSimplifier;
+    friend class SConstantFolder;
+  };
+
+
+  /*
+   * select_condition - Condition type of an OpSelect choosing between values of type tt.
+   * Before SPIR-V 1.4, only scalars and vectors can be selected, and vectors need a
+   * condition per component
+   */
+
+  template<typename tt>
+  struct select_condition {
+    static constexpr bool selectable = tt::getKind() == STypeKind::KIND_BOOL ||
+      tt::getKind() == STypeKind::KIND_INT ||
+      tt::getKind() == STypeKind::KIND_FLOAT;
+    using type = SBool;
+  };
+
+  template<int n, typename inner>
+  struct select_condition<SMat<n, 1, inner> > {
+    static constexpr bool selectable = true;
+    using type = SMat<n, 1, SBool>;
   };
 
 
   /*
-   * SelectConstruct - Represents a conditional choice between two values
+   * SelectConstruct - Represents a conditional choice between two values. Written as an
+   * OpSelect when both values are cheap to evaluate (see SSelectLowering), as a branch
+   * otherwise
    */
 
   template<typename tt>
@@ -364,10 +609,15 @@ namespace spurv {
     
     SValue<tt> *val_true, *val_false;
     SValue<SBool >* condition;
+    SSelectionControl control;
 
     SelectConstruct(SValue<SBool>& cond,
 		    SValue<tt>& true_val,
-		    SValue<tt>& false_val);
+		    SValue<tt>& false_val,
+		    SSelectionControl control);
+
+    void define_branch(std::vector<uint32_t>& res);
+    void define_select(std::vector<uint32_t>& res);
     
   public:
     virtual void define(std::vector<uint32_t>& res);
@@ -375,6 +625,8 @@ namespace spurv {
 				     std::vector<SDeclarationState*>& declaration_states);
     virtual void ensure_type_decorated(std::vector<uint32_t>& bin,
 				       std::vector<bool*>& decoration_states);
+    virtual void getNodeInfo(SNodeInfo& info) const;
+    virtual SValue<tt>* clone(SCloneMap& map);
     
     friend class SUtils;
   };
@@ -8,6 +8,13 @@
 #include "value_wrapper.hpp"
 #include "utils_impl.hpp"
 #include "expressions_impl.hpp"
+#include "loop_unrolling_impl.hpp"
+#include "select_lowering.hpp"
+#include "local_promotion.hpp"
+#include "slp_vectorization.hpp"
+
+#include <sstream>
+#include <algorithm>
 
 namespace spurv {
     
@@ -25,6 +32,27 @@ namespace spurv {
     str << this->id << std::endl;
   }
 
+  template<typename tt>
+  void SValue<tt>::getNodeInfo(SNodeInfo& info) const {
+    info.kind = NODE_CUSTOM;
+    info.id = this->id;
+    info.operation = -1;
+    tt::getDSType(&info.type);
+    info.value.clear();
+    info.operands.clear();
+    info.pointer = nullptr;
+  }
+
+  template<typename tt>
+  bool SValue<tt>::isDefined() const {
+    return this->defined;
+  }
+
+  template<typename tt>
+  SValue<tt>* SValue<tt>::clone(SCloneMap& map) {
+    return this;
+  }
+
   template<typename tt>
   SValue<tt>::SValue() {
     this->id = SUtils::getNewID();
@@ -60,7 +88,14 @@ namespace spurv {
   template<typename tt>
   Constant<tt>::Constant(const tt& val) {
     this->value = val;
-    if constexpr(std::is_same<tt, float>::value ||
+    if constexpr(std::is_same<tt, bool>::value) {
+	if(SConstantRegistry::isRegisteredBool(val)) {
+	  this->id = SConstantRegistry::getIDBool(val);
+	} else {
+	  SConstantRegistry::registerBool(val, this->id);
+	}
+
+      } else if constexpr(std::is_same<tt, float>::value ||
 		 std::is_same<tt, double>::value) {
 	if(SConstantRegistry::isRegisteredFloat(sizeof(tt) * 8, val)) {
 	  this->id = SConstantRegistry::getIDFloat(sizeof(tt) * 8, val);
@@ -87,6 +122,20 @@ namespace spurv {
     // res);
   }
   
+  template<typename tt>
+  void Constant<tt>::getNodeInfo(SNodeInfo& info) const {
+    SValue<typename MapSType<tt>::type>::getNodeInfo(info);
+    info.kind = NODE_CONSTANT;
+
+    if constexpr(std::is_same<tt, bool>::value) {
+	info.value = this->value ? "true" : "false";
+      } else if constexpr(std::is_arithmetic<tt>::value) {
+	std::ostringstream oss;
+	oss << this->value;
+	info.value = oss.str();
+      }
+  }
+
   template<typename tt>
   void Constant<tt>::ensure_type_defined(std::vector<uint32_t>& res,
 					 std::vector<SDeclarationState*>& states) {
@@ -211,6 +260,24 @@ namespace spurv {
     }
   }
 
+  template<typename tt>
+  void SGLSLHomoFun<tt>::getNodeInfo(SNodeInfo& info) const {
+    SValue<tt>::getNodeInfo(info);
+    info.kind = NODE_GLSL_FUNCTION;
+    info.operation = this->opcode;
+    info.operands.assign(this->args.begin(), this->args.end());
+  }
+
+  template<typename tt>
+  SValue<tt>* SGLSLHomoFun<tt>::clone(SCloneMap& map) {
+    std::vector<SValue<tt>*> args(this->args.size());
+    for(unsigned int i = 0; i < this->args.size(); i++) {
+      args[i] = map.value(this->args[i]);
+    }
+
+    return &construct_glsl_function<tt>(this->opcode, args);
+  }
+
   
   /*
    * SCustomVal member functions
@@ -227,7 +294,7 @@ namespace spurv {
    */
 
   template<int n, int m, typename inner>
-  bool ConstructMatrix<n, m, inner>::using_columns() {
+  bool ConstructMatrix<n, m, inner>::using_columns() const {
     return (n > 1 && m > 1 && this->components.size() == m);
   }
 
@@ -238,25 +305,41 @@ namespace spurv {
     static_assert(num ==  n * m, // sizeof...(args) == n * m,
     		  "Number of arguments to matrix construction does not match number of components in matrix");
 
+    // A single host matrix gives every element
+    constexpr bool from_host = sizeof...(Types) == 1 &&
+      (is_falg_mat<typename std::remove_cv<typename std::remove_reference<Types>::type>::type>::value && ...);
+
     // Only vectors can be constructed with concatenating other vectors
     // Matrices, on the other hand, must be given every element explicitly, or constructed from columns only
-    static_assert((m == 1 || n == 1) || SUtils::has_only_1_comps(args...) || SUtils::has_only_n_comps(n, args...),
+    static_assert((m == 1 || n == 1) || from_host ||
+		  SUtils::has_only_1_comps<Types...>() || SUtils::has_only_n_comps<Types...>(n),
 		  "Matrices must be constructed with every element explicitly, or from columns exclusively");
 
-    if constexpr (m == 1 || n == 1 || SUtils::has_only_1_comps(args...)) {
+    if constexpr (m == 1 || n == 1 || from_host || SUtils::has_only_1_comps<Types...>()) {
 	this->components.resize(n * m);
 	insertComponents(0, args...);
       } else {
       this->components.resize(m);
       insertColumns(0, args...);
     }
+
+    this->detect_constant();
+    this->detect_shuffle();
+    this->detect_vectorization();
   }
 
   template<int n, int m, typename inner>
   template<typename t1, typename... trest>
   void ConstructMatrix<n, m, inner>::insertComponents(int u, t1&& first, trest&&... rest) {
     int plus = 1;
-    if constexpr(is_spurv_value<t1>::value) {
+    if constexpr(is_falg_mat<typename std::remove_cv<typename std::remove_reference<t1>::type>::type>::value) {
+	// Host matrices and vectors give one constant per element, FlatAlg stores them in row-major order
+	using in_t = typename std::remove_cv<typename std::remove_reference<t1>::type>::type;
+	for(int i = 0; i < SUtils::num_elements<in_t>::value; i++) {
+	  this->components[u + i] = (void*)&SValueWrapper::unwrap_to<float, inner>(first[i]);
+	}
+	plus = SUtils::num_elements<in_t>::value;
+      } else if constexpr(is_spurv_value<t1>::value) {
 	using in_t = typename std::remove_reference<t1>::type::type;
 	if constexpr(is_spurv_mat_type<in_t>::value) {
 	    for(int i = 0; i < in_t::getArg0() * in_t::getArg1(); i++) {
@@ -285,8 +368,407 @@ namespace spurv {
       }
   }
 
+  template<int n, int m, typename inner>
+  template<std::size_t... is>
+  ConstructMatrix<n, 1, inner>* ConstructMatrix<n, m, inner>::construct_column(int col, std::index_sequence<is...>) {
+    return SUtils::allocate<ConstructMatrix<n, 1, inner> >(*(SValue<inner>*)this->components[is * m + col]...);
+  }
+
+  template<int n, int m, typename inner>
+  template<typename ct, std::size_t... is>
+  ConstructMatrix<n, m, inner>* ConstructMatrix<n, m, inner>::construct_from(const std::vector<void*>& components,
+									 std::index_sequence<is...>) {
+    return SUtils::allocate<ConstructMatrix<n, m, inner> >(*(SValue<ct>*)components[is]...);
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::detect_constant() {
+    this->is_constant = false;
+    this->is_null = false;
+
+    using ctype = typename InvMapSType<inner>::type;
+
+    if constexpr(std::is_void<ctype>::value) {
+	return;
+      } else {
+      bool all_zero = true;
+
+      if(this->using_columns()) {
+	for(unsigned int i = 0; i < this->components.size(); i++) {
+	  ConstructMatrix<n, 1, inner>* column =
+	    dynamic_cast<ConstructMatrix<n, 1, inner>*>((SValue<SMat<n, 1, inner> >*)this->components[i]);
+	  if(column == nullptr || !column->is_constant) {
+	    return;
+	  }
+
+	  all_zero = all_zero && column->is_null;
+	}
+      } else {
+	for(unsigned int i = 0; i < this->components.size(); i++) {
+	  Constant<ctype>* c = dynamic_cast<Constant<ctype>*>((SValue<inner>*)this->components[i]);
+	  if(c == nullptr) {
+	    return;
+	  }
+
+	  // The bit pattern must be zero, -0.0 is not a null constant
+	  if constexpr(std::is_same<ctype, float>::value) {
+	      all_zero = all_zero && c->value == 0.0f && !std::signbit(c->value);
+	    } else {
+	    all_zero = all_zero && c->value == ctype(0);
+	  }
+	}
+
+	if constexpr(n > 1 && m > 1) {
+	    // Matrix constants are composed of column constants
+	    std::vector<void*> columns(m);
+	    for(int i = 0; i < m; i++) {
+	      columns[i] = (void*)(SValue<SMat<n, 1, inner> >*)this->construct_column(i, std::make_index_sequence<n>());
+	    }
+	    this->components = columns;
+	  }
+      }
+
+      std::vector<int>& ids = this->constituent_ids;
+      ids.resize(this->components.size());
+      for(unsigned int i = 0; i < this->components.size(); i++) {
+	ids[i] = this->using_columns() ?
+	  ((SValue<SMat<n, 1, inner> >*)this->components[i])->getID() :
+	  ((SValue<inner>*)this->components[i])->getID();
+      }
+
+      // Equal constants share ids, as for scalars
+      if(SConstantRegistry::isRegisteredComposite(n, m, ids)) {
+	this->id = SConstantRegistry::getIDComposite(n, m, ids);
+      } else {
+	SConstantRegistry::registerComposite(n, m, ids, this->id);
+      }
+
+      this->is_constant = true;
+      this->is_null = all_zero;
+    }
+  }
+
+  template<int n, int m, typename inner>
+  template<int k, int s>
+  bool ConstructMatrix<n, m, inner>::find_extraction(SValue<inner>* component, void*& source, int& index) {
+    SExpr<inner, EXPR_LOOKUP, SMat<k, 1, inner>, SInt<32, s> >* lookup =
+      dynamic_cast<SExpr<inner, EXPR_LOOKUP, SMat<k, 1, inner>, SInt<32, s> >*>(component);
+    if(lookup == nullptr) {
+      return false;
+    }
+
+    typename InvMapSType<SInt<32, s> >::type value;
+    if(!SConstantFolder::getConstant(*lookup->v2, value) || (int64_t)value < 0 || (int64_t)value >= k) {
+      return false;
+    }
+
+    source = (void*)lookup->v1;
+    index = value;
+    return true;
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::detect_shuffle() {
+    if constexpr(m == 1 && n > 1) {
+      if(this->is_constant) {
+	return;
+      }
+
+      std::vector<void*> sources;
+      std::vector<int> sizes;
+      std::vector<int> components(n); // Source number and index of each component
+
+      for(int i = 0; i < n; i++) {
+	SValue<inner>* component = (SValue<inner>*)this->components[i];
+	void* source;
+	int size, index;
+
+	if(find_extraction<2, 1>(component, source, index) || find_extraction<2, 0>(component, source, index)) {
+	  size = 2;
+	} else if(find_extraction<3, 1>(component, source, index) || find_extraction<3, 0>(component, source, index)) {
+	  size = 3;
+	} else if(find_extraction<4, 1>(component, source, index) || find_extraction<4, 0>(component, source, index)) {
+	  size = 4;
+	} else {
+	  return;
+	}
+
+	unsigned int s = 0;
+	while(s < sources.size() && sources[s] != source) {
+	  s++;
+	}
+
+	if(s == sources.size()) {
+	  if(sources.size() == 2) {
+	    return; // OpVectorShuffle takes two vectors
+	  }
+
+	  sources.push_back(source);
+	  sizes.push_back(size);
+	}
+
+	components[i] = (s == 0 ? 0 : sizes[0]) + index;
+      }
+
+      this->shuffle_sources = sources;
+      this->shuffle_source_sizes = sizes;
+      this->shuffle_indices = components;
+    }
+  }
+
+  template<int n, int m, typename inner>
+  SValueBase* ConstructMatrix<n, m, inner>::shuffle_source(int i) const {
+    switch(this->shuffle_source_sizes[i]) {
+    case 2:
+      return (SValue<SMat<2, 1, inner> >*)this->shuffle_sources[i];
+    case 3:
+      return (SValue<SMat<3, 1, inner> >*)this->shuffle_sources[i];
+    default:
+      return (SValue<SMat<4, 1, inner> >*)this->shuffle_sources[i];
+    }
+  }
+
+  template<int n, int m, typename inner>
+  int ConstructMatrix<n, m, inner>::shuffle_source_id(int i) const {
+    switch(this->shuffle_source_sizes[i]) {
+    case 2:
+      return ((SValue<SMat<2, 1, inner> >*)this->shuffle_sources[i])->getID();
+    case 3:
+      return ((SValue<SMat<3, 1, inner> >*)this->shuffle_sources[i])->getID();
+    default:
+      return ((SValue<SMat<4, 1, inner> >*)this->shuffle_sources[i])->getID();
+    }
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::ensure_shuffle_source_defined(int i, std::vector<uint32_t>& res) {
+    switch(this->shuffle_source_sizes[i]) {
+    case 2:
+      ((SValue<SMat<2, 1, inner> >*)this->shuffle_sources[i])->ensure_defined(res);
+      break;
+    case 3:
+      ((SValue<SMat<3, 1, inner> >*)this->shuffle_sources[i])->ensure_defined(res);
+      break;
+    default:
+      ((SValue<SMat<4, 1, inner> >*)this->shuffle_sources[i])->ensure_defined(res);
+      break;
+    }
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::ensure_shuffle_source_type_defined(int i, std::vector<uint32_t>& res,
+									std::vector<SDeclarationState*>& declaration_states) {
+    switch(this->shuffle_source_sizes[i]) {
+    case 2:
+      ((SValue<SMat<2, 1, inner> >*)this->shuffle_sources[i])->ensure_type_defined(res, declaration_states);
+      break;
+    case 3:
+      ((SValue<SMat<3, 1, inner> >*)this->shuffle_sources[i])->ensure_type_defined(res, declaration_states);
+      break;
+    default:
+      ((SValue<SMat<4, 1, inner> >*)this->shuffle_sources[i])->ensure_type_defined(res, declaration_states);
+      break;
+    }
+  }
+
+  template<int n, int m, typename inner>
+  template<SExprOp op>
+  bool ConstructMatrix<n, m, inner>::find_operation(const std::vector<void*>& components,
+						    std::vector<void*>& lhs, std::vector<void*>& rhs) {
+    using rhs_type = typename std::conditional<op == EXPR_NEGATIVE, void_s, inner>::type;
+
+    lhs.clear();
+    rhs.clear();
+    for(void* component : components) {
+      SExpr<inner, op, inner, rhs_type>* expr =
+	dynamic_cast<SExpr<inner, op, inner, rhs_type>*>((SValue<inner>*)component);
+      if(expr == nullptr) {
+	return false;
+      }
+
+      lhs.push_back((void*)expr->v1);
+      if constexpr(op != EXPR_NEGATIVE) {
+	  rhs.push_back((void*)expr->v2);
+	}
+    }
+
+    return true;
+  }
+
+  template<int n, int m, typename inner>
+  bool ConstructMatrix<n, m, inner>::find_isomorphic(const std::vector<void*>& components, SExprOp& op,
+						     std::vector<void*>& lhs, std::vector<void*>& rhs) {
+    if(find_operation<EXPR_ADDITION>(components, lhs, rhs)) {
+      op = EXPR_ADDITION;
+    } else if(find_operation<EXPR_SUBTRACTION>(components, lhs, rhs)) {
+      op = EXPR_SUBTRACTION;
+    } else if(find_operation<EXPR_MULTIPLICATION>(components, lhs, rhs)) {
+      op = EXPR_MULTIPLICATION;
+    } else if(find_operation<EXPR_NEGATIVE>(components, lhs, rhs)) {
+      op = EXPR_NEGATIVE;
+    } else if(inner::getKind() == STypeKind::KIND_FLOAT &&
+	      find_operation<EXPR_DIVISION>(components, lhs, rhs)) {
+      op = EXPR_DIVISION;
+    } else {
+      return false;
+    }
+
+    return true;
+  }
+
+  template<int n, int m, typename inner>
+  SValue<SMat<n, 1, inner> >* ConstructMatrix<n, m, inner>::find_source(const std::vector<void*>& components) {
+    void* source = nullptr;
+    for(int i = 0; i < n; i++) {
+      void* component_source;
+      int index;
+      if(!(find_extraction<n, 1>((SValue<inner>*)components[i], component_source, index) ||
+	   find_extraction<n, 0>((SValue<inner>*)components[i], component_source, index)) ||
+	 index != i || (i > 0 && component_source != source)) {
+	return nullptr;
+      }
+
+      source = component_source;
+    }
+
+    return (SValue<SMat<n, 1, inner> >*)source;
+  }
+
+  template<int n, int m, typename inner>
+  int ConstructMatrix<n, m, inner>::vector_cost(const std::vector<void*>& components, int depth,
+						int& scalar_cost, bool& is_vectorized) {
+    using ctype = typename InvMapSType<inner>::type;
+
+    scalar_cost = 0;
+    is_vectorized = false;
+
+    // Gathered as a constant, the source itself or a single instruction
+    bool is_constant = !std::is_void<ctype>::value;
+    if constexpr(!std::is_void<ctype>::value) {
+	for(void* component : components) {
+	  is_constant = is_constant && dynamic_cast<Constant<ctype>*>((SValue<inner>*)component) != nullptr;
+	}
+      }
+    int gather_cost = is_constant || find_source(components) ? 0 : 1;
+
+    SExprOp op;
+    std::vector<void*> lhs, rhs;
+    if(depth >= SSlpVectorizer::max_depth || !find_isomorphic(components, op, lhs, rhs)) {
+      return gather_cost;
+    }
+
+    std::vector<void*> distinct = components;
+    std::sort(distinct.begin(), distinct.end());
+    scalar_cost = std::unique(distinct.begin(), distinct.end()) - distinct.begin();
+
+    int lhs_scalar_cost, rhs_scalar_cost = 0;
+    bool lhs_vectorized, rhs_vectorized;
+    int vector_cost = 1 + ConstructMatrix<n, m, inner>::vector_cost(lhs, depth + 1, lhs_scalar_cost, lhs_vectorized);
+    if(rhs.size()) {
+      vector_cost += ConstructMatrix<n, m, inner>::vector_cost(rhs, depth + 1, rhs_scalar_cost, rhs_vectorized);
+    }
+
+    scalar_cost += lhs_scalar_cost + rhs_scalar_cost;
+    is_vectorized = vector_cost < gather_cost + scalar_cost;
+    return std::min(vector_cost, gather_cost + scalar_cost);
+  }
+
+  template<int n, int m, typename inner>
+  template<std::size_t... is>
+  SValue<SMat<n, 1, inner> >& ConstructMatrix<n, m, inner>::gather(const std::vector<void*>& components,
+								  std::index_sequence<is...>) {
+    return *SUtils::allocate<ConstructMatrix<n, 1, inner> >(*(SValue<inner>*)components[is]...);
+  }
+
+  template<int n, int m, typename inner>
+  SValue<SMat<n, 1, inner> >& ConstructMatrix<n, m, inner>::vectorize(const std::vector<void*>& components, int depth) {
+    using vt = SMat<n, 1, inner>;
+
+    int scalar_cost;
+    bool is_vectorized;
+    ConstructMatrix<n, m, inner>::vector_cost(components, depth, scalar_cost, is_vectorized);
+
+    if(!is_vectorized) {
+      SValue<vt>* source = find_source(components);
+      return source ? *source : gather(components, std::make_index_sequence<n>());
+    }
+
+    SExprOp op;
+    std::vector<void*> lhs, rhs;
+    find_isomorphic(components, op, lhs, rhs);
+
+    SValue<vt>& v1 = vectorize(lhs, depth + 1);
+    switch(op) {
+    case EXPR_ADDITION:
+      return construct_expression<vt, EXPR_ADDITION, vt, vt>(v1, &vectorize(rhs, depth + 1));
+    case EXPR_SUBTRACTION:
+      return construct_expression<vt, EXPR_SUBTRACTION, vt, vt>(v1, &vectorize(rhs, depth + 1));
+    case EXPR_MULTIPLICATION:
+      return construct_expression<vt, EXPR_MULTIPLICATION, vt, vt>(v1, &vectorize(rhs, depth + 1));
+    case EXPR_DIVISION:
+      return construct_expression<vt, EXPR_DIVISION, vt, vt>(v1, &vectorize(rhs, depth + 1));
+    default:
+      return construct_expression<vt, EXPR_NEGATIVE, vt, void_s>(v1, nullptr);
+    }
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::detect_vectorization() {
+    this->vectorized = nullptr;
+
+    if constexpr(m == 1 && n > 1) {
+      if(this->is_constant || this->shuffle_sources.size() || !SSlpVectorizer::isEnabled()) {
+	return;
+      }
+
+      int scalar_cost;
+      bool is_vectorized;
+      ConstructMatrix<n, m, inner>::vector_cost(this->components, 0, scalar_cost, is_vectorized);
+      if(!is_vectorized) {
+	return;
+      }
+
+      this->vectorized = &ConstructMatrix<n, m, inner>::vectorize(this->components, 0);
+
+      // The vector operations are recorded after this, but must be declared before it
+      SEventRegistry::defer_declaration(this);
+    }
+  }
+
   template<int n, int m, typename inner>
   void ConstructMatrix<n, m, inner>::define(std::vector<uint32_t>& res) {
+    if(this->is_constant) {
+      // Defined together with the types
+      return;
+    }
+
+    if(this->vectorized) {
+      // Takes on the id of the vector operation, see SSlpVectorizer
+      this->vectorized->ensure_defined(res);
+      this->id = this->vectorized->getID();
+      SSlpVectorizer::count();
+      return;
+    }
+
+    if(this->shuffle_sources.size()) {
+      for(unsigned int i = 0; i < this->shuffle_sources.size(); i++) {
+	this->ensure_shuffle_source_defined(i, res);
+      }
+
+      // OpVectorShuffle <result_type> <result_id> <vector_1> <vector_2> <components...>
+      SUtils::add(res, ((5 + n) << 16) | 79);
+      SUtils::add(res, SMat<n, m, inner>::getID());
+      SUtils::add(res, this->id);
+      SUtils::add(res, this->shuffle_source_id(0));
+      SUtils::add(res, this->shuffle_source_id(this->shuffle_sources.size() - 1));
+
+      for(int index : this->shuffle_indices) {
+	SUtils::add(res, index);
+      }
+
+      return;
+    }
+
     for(unsigned int i = 0; i < this->components.size(); i++) {
       ((SValue<inner>*)this->components[i])->ensure_defined(res);
     }
@@ -344,15 +826,102 @@ namespace spurv {
 						  std::vector<SDeclarationState*>& declaration_states) {
     // A bit hacky but oh well
     SMat<n, m, inner>::ensure_defined(res, declaration_states);
+
+    // A null constant does not need its components, nor does a shuffle or vectorization
+    if(this->vectorized) {
+      this->vectorized->ensure_type_defined(res, declaration_states);
+    } else if(this->shuffle_sources.size()) {
+      for(unsigned int i = 0; i < this->shuffle_sources.size(); i++) {
+	this->ensure_shuffle_source_type_defined(i, res, declaration_states);
+      }
+    } else if(!this->is_null) {
+      for(unsigned int i = 0; i < this->components.size(); i++) {
+	if(this->using_columns()) {
+	  ((SValue<SMat<n, 1, inner> >*)this->components[i])->ensure_type_defined(res,
+										  declaration_states);
+	} else {
+	  ((SValue<inner>*)this->components[i])->ensure_type_defined(res,
+								     declaration_states);
+	}
+      }
+    }
+
+    if(this->is_constant) {
+      SConstantRegistry::ensureDefinedComposite(n, m, this->constituent_ids, this->is_null,
+						SMat<n, m, inner>::getID(), res);
+    }
+  }
+
+  template<int n, int m, typename inner>
+  void ConstructMatrix<n, m, inner>::getNodeInfo(SNodeInfo& info) const {
+    SValue<SMat<n, m, inner> >::getNodeInfo(info);
+    info.kind = this->is_constant ? NODE_CONSTANT : NODE_CONSTRUCT_MATRIX;
+
+    if(this->is_null) {
+      info.value = "null";
+      return;
+    }
+
+    if(this->vectorized) {
+      info.operands.push_back(this->vectorized);
+      return;
+    }
+
+    if(this->shuffle_sources.size()) {
+      for(unsigned int i = 0; i < this->shuffle_sources.size(); i++) {
+	info.operands.push_back(this->shuffle_source(i));
+      }
+      return;
+    }
+
     for(unsigned int i = 0; i < this->components.size(); i++) {
       if(this->using_columns()) {
-	((SValue<SMat<n, 1, inner> >*)this->components[i])->ensure_type_defined(res,
-										declaration_states);
+	info.operands.push_back((SValue<SMat<n, 1, inner> >*)this->components[i]);
       } else {
-	((SValue<inner>*)this->components[i])->ensure_type_defined(res,
-								   declaration_states);
+	info.operands.push_back((SValue<inner>*)this->components[i]);
       }
     }
+
+    if(this->is_constant) {
+      SNodeInfo component;
+      info.value = "(";
+      for(unsigned int i = 0; i < info.operands.size(); i++) {
+	info.operands[i]->getNodeInfo(component);
+	info.value += (i ? ", " : "") + component.value;
+      }
+      info.value += ")";
+    }
+  }
+
+  template<int n, int m, typename inner>
+  SValue<SMat<n, m, inner> >* ConstructMatrix<n, m, inner>::clone(SCloneMap& map) {
+    if(this->is_constant) {
+      return this;
+    }
+
+    // The vector operation is replayed before this
+    if constexpr(m == 1) {
+	if(this->vectorized) {
+	  return map.value(this->vectorized);
+	}
+      }
+
+    std::vector<void*> components(this->components.size());
+    if constexpr(n > 1 && m > 1) {
+	if(this->using_columns()) {
+	  for(int i = 0; i < m; i++) {
+	    components[i] = (void*)map.value((SValue<SMat<n, 1, inner> >*)this->components[i]);
+	  }
+
+	  return this->construct_from<SMat<n, 1, inner> >(components, std::make_index_sequence<m>());
+	}
+      }
+
+    for(int i = 0; i < n * m; i++) {
+      components[i] = (void*)map.value((SValue<inner>*)this->components[i]);
+    }
+
+    return this->construct_from<inner>(components, std::make_index_sequence<n * m>());
   }
 
 
@@ -363,16 +932,61 @@ namespace spurv {
   template<typename tt>
   SelectConstruct<tt>::SelectConstruct(SValue<SBool>& cond,
 				   SValue<tt>& true_val,
-				   SValue<tt>& false_val) {
+				   SValue<tt>& false_val,
+				   SSelectionControl control) {
     this->condition = &cond;
     this->val_true = &true_val;
     this->val_false = &false_val;
+    this->control = control;
   }
 
   template<typename tt>
   void SelectConstruct<tt>::define(std::vector<uint32_t>& res) {
 
     this->condition->ensure_defined(res);
+
+    if constexpr(select_condition<tt>::selectable) {
+	if(SSelectLowering::shouldLower(this->val_true, this->val_false, this->control)) {
+	  this->define_select(res);
+	  return;
+	}
+      }
+
+    this->define_branch(res);
+  }
+
+  template<typename tt>
+  void SelectConstruct<tt>::define_select(std::vector<uint32_t>& res) {
+    this->val_true->ensure_defined(res);
+    this->val_false->ensure_defined(res);
+
+    using ct = typename select_condition<tt>::type;
+
+    uint32_t condition_id = this->condition->getID();
+    if constexpr(!std::is_same<ct, SBool>::value) {
+	ct::ensure_defined(*SSelectLowering::definitions, *SSelectLowering::declaration_states);
+
+	// OpCompositeConstruct <result_type> <result_id> <condition>...
+	condition_id = SUtils::getNewID();
+	SUtils::add(res, ((3 + tt::nn) << 16) | 80);
+	SUtils::add(res, ct::getID());
+	SUtils::add(res, condition_id);
+	for(int i = 0; i < tt::nn; i++) {
+	  SUtils::add(res, this->condition->getID());
+	}
+      }
+
+    // OpSelect <result_type> <result_id> <condition> <object_true> <object_false>
+    SUtils::add(res, (6 << 16) | 169);
+    SUtils::add(res, tt::getID());
+    SUtils::add(res, this->getID());
+    SUtils::add(res, condition_id);
+    SUtils::add(res, this->val_true->getID());
+    SUtils::add(res, this->val_false->getID());
+  }
+
+  template<typename tt>
+  void SelectConstruct<tt>::define_branch(std::vector<uint32_t>& res) {
     
     uint32_t final_label = SUtils::getNewID();
     uint32_t true_label = SUtils::getNewID();
@@ -381,7 +995,7 @@ namespace spurv {
     // OpSelectionMerge <label> <selection control>
     SUtils::add(res, (3 << 16) | 247);
     SUtils::add(res, final_label);
-    SUtils::add(res, 0); // None
+    SUtils::add(res, this->control);
 
     // OpBranchConditional <condition> <true_branch> <false_branch>
     SUtils::add(res, (4 << 16) | 250);
@@ -393,8 +1007,10 @@ namespace spurv {
     SUtils::add(res, (2 << 16) | 248);
     SUtils::add(res, true_label);
 
-    // Optimally, we can define this value inside this branch only
+    // Values only used here are sunk into this branch, see SCodeSinker. Selections among
+    // them may be branches too, so the branch may end in another block than it began
     this->val_true->ensure_defined(res);
+    int true_parent = SLocalPromoter::block(res);
 
     // OpBranch <final_label>
     SUtils::add(res, (2 << 16) | 249);
@@ -405,6 +1021,7 @@ namespace spurv {
     SUtils::add(res, false_label);
 
     this->val_false->ensure_defined(res);
+    int false_parent = SLocalPromoter::block(res);
 
     // OpBranch <final_label>
     SUtils::add(res, (2 << 16) | 249);
@@ -419,9 +1036,9 @@ namespace spurv {
     SUtils::add(res, tt::getID());
     SUtils::add(res, this->getID());
     SUtils::add(res, this->val_true->getID());
-    SUtils::add(res, true_label);
+    SUtils::add(res, true_parent);
     SUtils::add(res, this->val_false->getID());
-    SUtils::add(res, false_label);
+    SUtils::add(res, false_parent);
     
   }
 
@@ -429,7 +1046,6 @@ namespace spurv {
   void SelectConstruct<tt>::ensure_type_defined(std::vector<uint32_t>& res,
 						std::vector<SDeclarationState*>& declaration_states) {
     tt::ensure_defined(res, declaration_states);
-    SPointer<STORAGE_FUNCTION, tt>::ensure_defined(res, declaration_states);
     this->condition->ensure_type_defined(res, declaration_states);
     this->val_true->ensure_type_defined(res, declaration_states);
     this->val_false->ensure_type_defined(res, declaration_states);
@@ -438,12 +1054,26 @@ namespace spurv {
   template<typename tt>
   void SelectConstruct<tt>::ensure_type_decorated(std::vector<uint32_t>& res,
 						  std::vector<bool*>& decoration_states) {
-    SPointer<STORAGE_FUNCTION, tt>::ensure_decorated(res, decoration_states);
     this->condition->ensure_type_decorated(res, decoration_states);
     this->val_true->ensure_type_decorated(res, decoration_states);
     this->val_false->ensure_type_decorated(res, decoration_states);
   }
 
+  template<typename tt>
+  void SelectConstruct<tt>::getNodeInfo(SNodeInfo& info) const {
+    SValue<tt>::getNodeInfo(info);
+    info.kind = NODE_SELECT;
+    info.operands.push_back(this->condition);
+    info.operands.push_back(this->val_true);
+    info.operands.push_back(this->val_false);
+  }
+
+  template<typename tt>
+  SValue<tt>* SelectConstruct<tt>::clone(SCloneMap& map) {
+    return &select(*map.value(this->condition), *map.value(this->val_true), *map.value(this->val_false),
+		   this->control);
+  }
+
   
   // Shorthand
   template<typename t1, typename t2>
@@ -451,164 +1081,213 @@ namespace spurv {
     using type = typename SValueWrapper::unambiguous_unwrapped_allow_primitives<t1, t2>::type;
   };
   
+  // control is a hint on whether to branch, see SSelectionControl
   template<typename t1, typename t2, typename t3>
-  SelectConstruct<typename ruu<t2, t3>::type>& select(t1&& cond,
-						      t2&& true_val,
-						      t3&& false_val) {
+  SValue<typename ruu<t2, t3>::type>& select(t1&& cond,
+					     t2&& true_val,
+					     t3&& false_val,
+					     SSelectionControl control = SELECTION_CONTROL_NONE) {
     using tt1 = typename std::remove_reference<t1>::type;
 
     using unwrapped_res_type = typename ruu<t2, t3>::type;
 
     static_assert(SValueWrapper::does_wrap<tt1, SBool>::value);
 
-    SelectConstruct<unwrapped_res_type>* v =
-      SUtils::allocate<SelectConstruct<unwrapped_res_type> >(SValueWrapper::unwrap_to<t1, SBool>(cond),
-							     SValueWrapper::unwrap_to<t2, unwrapped_res_type>(true_val),
-							     SValueWrapper::unwrap_to<t3, unwrapped_res_type>(false_val));
+    SValue<SBool>& c = SValueWrapper::unwrap_to<t1, SBool>(cond);
+    SValue<unwrapped_res_type>& vt = SValueWrapper::unwrap_to<t2, unwrapped_res_type>(true_val);
+    SValue<unwrapped_res_type>& vf = SValueWrapper::unwrap_to<t3, unwrapped_res_type>(false_val);
+
+    SValue<unwrapped_res_type>* folded = SConstantFolder::foldSelect<unwrapped_res_type>(c, vt, vf);
+    if(folded) {
+      return *folded;
+    }
+
+    SNodeKey key = SNodeCache::makeKey<SelectConstruct<unwrapped_res_type> >(control, {c.getID(), vt.getID(), vf.getID()});
+    SelectConstruct<unwrapped_res_type>* v = SNodeCache::find<SelectConstruct<unwrapped_res_type> >(key, false);
+    if(v) {
+      return *v;
+    }
+
+    v = SUtils::allocate<SelectConstruct<unwrapped_res_type> >(c, vt, vf, control);
+    SNodeCache::insert(key, v, false);
     return *v;
   }
+
+  // Marks value as precise, like the GLSL qualifier: the arithmetic it is computed from
+  // is written as is, without being contracted (see SFmaContractor)
+  template<typename tt>
+  SValue<tt>& precise(SValue<tt>& value) {
+    SFmaContractor::precise_values.insert(&value);
+    return value;
+  }
+
+  // Returns a call to the GLSL function, folded to a constant if all arguments are
+  // constants (see SConstantFolder), or an identical call recorded earlier if it is
+  // available here (see SNodeCache)
+  template<typename tt>
+  SValue<tt>& construct_glsl_function(GLSLFunction opcode, const std::vector<SValue<tt>*>& args) {
+    SValue<tt>* folded = SConstantFolder::foldGLSLFunction<tt>(opcode, args);
+    if(folded) {
+      return *folded;
+    }
+
+    std::vector<int> ids;
+    for(SValue<tt>* arg : args) {
+      ids.push_back(arg->getID());
+    }
+
+    SNodeKey key = SNodeCache::makeKey<SGLSLHomoFun<tt> >(opcode, ids);
+    SGLSLHomoFun<tt>* f = SNodeCache::find<SGLSLHomoFun<tt> >(key, false);
+    if(f) {
+      return *f;
+    }
+
+    f = SUtils::allocate<SGLSLHomoFun<tt> >(opcode, args);
+    SNodeCache::insert(key, f, false);
+    return *f;
+  }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& round(SValue<tt>& v1) {
+  SValue<tt>& round(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to round must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ROUND, v);
+    return construct_glsl_function<tt>(GLSL_ROUND, v);
   }
 
   template<typename tt>
-  SGLSLHomoFun<tt>& round_even(SValue<tt>& v1) {
+  SValue<tt>& round_even(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to round_even must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ROUND_EVEN, v);
+    return construct_glsl_function<tt>(GLSL_ROUND_EVEN, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& trunc(SValue<tt>& v1) {
+  SValue<tt>& trunc(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to trunc must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_TRUNC, v);
+    return construct_glsl_function<tt>(GLSL_TRUNC, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& fabs(SValue<tt>& v1) {
+  SValue<tt>& fabs(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to fabs must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_FABS, v);
+    return construct_glsl_function<tt>(GLSL_FABS, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& sabs(SValue<tt>& v1) {
+  SValue<tt>& sabs(SValue<tt>& v1) {
     static_assert(is_spurv_signed_int_type<tt>::value, "Input to sabs must be a signed int value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_SABS, v);
+    return construct_glsl_function<tt>(GLSL_SABS, v);
   }
 
   template<typename tt>
-  SGLSLHomoFun<tt>& floor(SValue<tt>& v1) {
+  SValue<tt>& floor(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to floor must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_FLOOR, v);
+    return construct_glsl_function<tt>(GLSL_FLOOR, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& ceil(SValue<tt>& v1) {
+  SValue<tt>& ceil(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to ceil must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_CEIL, v);
+    return construct_glsl_function<tt>(GLSL_CEIL, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& fract(SValue<tt>& v1) {
+  SValue<tt>& fract(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to fract must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_FRACT, v);
+    return construct_glsl_function<tt>(GLSL_FRACT, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& sin(SValue<tt>& v1) {
+  SValue<tt>& sin(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to sin must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_SIN, v);
+    return construct_glsl_function<tt>(GLSL_SIN, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& cos(SValue<tt>& v1) {
+  SValue<tt>& cos(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to cos must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_COS, v);
+    return construct_glsl_function<tt>(GLSL_COS, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& tan(SValue<tt>& v1) {
+  SValue<tt>& tan(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to tan must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_TAN, v);
+    return construct_glsl_function<tt>(GLSL_TAN, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& asin(SValue<tt>& v1) {
+  SValue<tt>& asin(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to asin must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ASIN, v);
+    return construct_glsl_function<tt>(GLSL_ASIN, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& acos(SValue<tt>& v1) {
+  SValue<tt>& acos(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to acos must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ACOS, v);
+    return construct_glsl_function<tt>(GLSL_ACOS, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& atan(SValue<tt>& v1) {
+  SValue<tt>& atan(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to atan must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ATAN, v);
+    return construct_glsl_function<tt>(GLSL_ATAN, v);
   }
   
   template<typename tt>
-  SGLSLHomoFun<tt>& exp(SValue<tt>& v1) {
+  SValue<tt>& exp(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to exp must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_EXP, v);
+    return construct_glsl_function<tt>(GLSL_EXP, v);
   }
 
   template<typename tt>
-  SGLSLHomoFun<tt>& log(SValue<tt>& v1) {
+  SValue<tt>& log(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to log must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_LOG, v);
+    return construct_glsl_function<tt>(GLSL_LOG, v);
   }
 
   template<typename tt>
-  SGLSLHomoFun<tt>& sqrt(SValue<tt>& v1) {
+  SValue<tt>& sqrt(SValue<tt>& v1) {
     static_assert(is_spurv_float_type<tt>::value, "Input to sqrt must be a floating point value");
     std::vector<SValue<tt>*> v = {&v1};
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_SQRT, v);
+    return construct_glsl_function<tt>(GLSL_SQRT, v);
   }
 
   template<typename t1, typename t2>
-  SGLSLHomoFun<typename uwr<t1, t2>::type>& atan2(t1&& in1, t2&& in2) {
+  SValue<typename uwr<t1, t2>::type>& atan2(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
     static_assert(is_spurv_float_type<tt>::value, "Input to atan2 must be floating point value");
     std::vector<SValue<tt>*> v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
 				  &SValueWrapper::unwrap_to<t2, tt>(in2)};
     
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_ATAN2, v);
+    return construct_glsl_function<tt>(GLSL_ATAN2, v);
   }
   
   template<typename t1, typename t2>
-  SGLSLHomoFun<typename uwr<t1, t2>::type>& pow(t1&& in1, t2&& in2) {
+  SValue<typename uwr<t1, t2>::type>& pow(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
     static_assert(is_spurv_float_type<tt>::value, "Input to pow must be floating point value");
     std::vector<SValue<tt>*> v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
 				  &SValueWrapper::unwrap_to<t2, tt>(in2)};
     
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_POW, v);
+    return construct_glsl_function<tt>(GLSL_POW, v);
   }
 
   template<typename t1, typename t2>
-  SGLSLHomoFun<typename uwr<t1, t2>::type>& max(t1&& in1, t2&& in2) {
+  SValue<typename uwr<t1, t2>::type>& max(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
 
     std::vector<SValue<tt>* > v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
@@ -634,11 +1313,11 @@ namespace spurv {
       exit(-1);
     }
 
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(ft, v);
+    return construct_glsl_function<tt>(ft, v);
   }
 
   template<typename t1, typename t2>
-  SGLSLHomoFun<typename uwr<t1, t2>::type>& min(t1&& in1, t2&& in2) {
+  SValue<typename uwr<t1, t2>::type>& min(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
 
     std::vector<SValue<tt>* > v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
@@ -664,7 +1343,7 @@ namespace spurv {
       exit(-1);
     }
 
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(ft, v);
+    return construct_glsl_function<tt>(ft, v);
   }
 
   /*
@@ -699,13 +1378,13 @@ namespace spurv {
   template<typename t1, typename t2>
   requires (IsFloatVector<typename uwr<t1, t2>::type> &&
 	    Has3Columns<typename uwr<t1, t2>::type>)
-  SGLSLHomoFun<typename uwr<t1, t2>::type>& cross(t1&& in1, t2&& in2) {
+  SValue<typename uwr<t1, t2>::type>& cross(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
 
     std::vector<SValue<tt>* > v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
 				   &SValueWrapper::unwrap_to<t2, tt>(in2)};
 
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_CROSS, v);
+    return construct_glsl_function<tt>(GLSL_CROSS, v);
   }
 
   template<typename t1>
@@ -715,23 +1394,23 @@ namespace spurv {
   template<typename t1>
   requires (IsFloatScalar<typename SValueWrapper::unwrapped_type<t1>::type> ||
 	    IsFloatVector<typename SValueWrapper::unwrapped_type<t1>::type>)
-    SGLSLHomoFun<typename SValueWrapper::unwrapped_type<t1>::type>& normalize(t1&& in1) {
+    SValue<typename SValueWrapper::unwrapped_type<t1>::type>& normalize(t1&& in1) {
     using tt = typename SValueWrapper::unwrapped_type<t1>::type;
 
     std::vector<SValue<tt>* > v = {&in1};
 
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_NORMALIZE, v);
+    return construct_glsl_function<tt>(GLSL_NORMALIZE, v);
   }
 
   template<typename t1, typename t2>
   requires (IsFloatScalar<typename uwr<t1, t2>::type> ||
 	    IsFloatVector<typename uwr<t1, t2>::type>)
-    SGLSLHomoFun<typename uwr<t1, t2>::type>& reflect(t1&& in1, t2&& in2) {
+    SValue<typename uwr<t1, t2>::type>& reflect(t1&& in1, t2&& in2) {
     using tt = typename uwr<t1, t2>::type;
 
     std::vector<SValue<tt>* > v = {&SValueWrapper::unwrap_to<t1, tt>(in1),
 				   &SValueWrapper::unwrap_to<t2, tt>(in2) };
-    return *SUtils::allocate<SGLSLHomoFun<tt> >(GLSL_REFLECT, v);
+    return construct_glsl_function<tt>(GLSL_REFLECT, v);
   }
   
   
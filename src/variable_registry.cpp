@@ -1,4 +1,7 @@
 #include "variable_registry.hpp"
+#include "dead_code_elimination.hpp"
+#include "local_promotion.hpp"
+#include "store_forwarding.hpp"
 
 namespace spurv {
 
@@ -15,7 +18,23 @@ namespace spurv {
 
   void SVariableRegistry::write_variable_definitions(std::vector<uint32_t>& bin) {
     for(SVariableEntryBase* vb : SVariableRegistry::variables) {
-      vb->write_definition(bin);
+      // Locals that are neither loaded nor stored to by live code are left out,
+      // as are the ones kept in SSA values and the ones whose loads are all forwarded
+      if(SDeadCodeEliminator::isPointerLive(vb->getPointerID()) &&
+	 !SLocalPromoter::isPromoted(vb->getPointerID()) &&
+	 !SStoreForwarder::isEliminated(vb->getPointerID())) {
+	vb->write_definition(bin);
+      }
+    }
+  }
+
+  void SVariableRegistry::remove_variable(int pointer_id) {
+    for(unsigned int i = 0; i < SVariableRegistry::variables.size(); i++) {
+      if(SVariableRegistry::variables[i]->getPointerID() == pointer_id) {
+	delete SVariableRegistry::variables[i];
+	SVariableRegistry::variables.erase(SVariableRegistry::variables.begin() + i);
+	return;
+      }
     }
   }
 
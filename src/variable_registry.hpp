@@ -15,8 +15,12 @@ namespace spurv {
   class SVariableEntryBase {
 
     virtual void write_definition(std::vector<uint32_t>& bin) = 0;
+    virtual int getPointerID() = 0;
+    virtual int getTypeID() = 0; // Of the value pointed to
 
     friend class SVariableRegistry;
+    friend class SLocalPromoter;
+    friend class SFunctionBase;
   };
 
   
@@ -29,6 +33,8 @@ namespace spurv {
     SLocal<tt>* variable;
 
     virtual void write_definition(std::vector<uint32_t>& bin);
+    virtual int getPointerID();
+    virtual int getTypeID();
 
     SVariableEntry(SLocal<tt>* local);
 
@@ -49,6 +55,9 @@ namespace spurv {
     template<typename tt>
     static void add_variable(SLocal<tt>* var);
 
+    // Used for the iterators of unrolled loops, which are never loaded or stored
+    static void remove_variable(int pointer_id);
+
     static void clear();
 
     template<SShaderType type, typename... Inputs>
@@ -56,6 +65,10 @@ namespace spurv {
 
     template<typename tt>
     friend class SLocal;
+
+    friend class SLoopUnroller;
+    friend class SLocalPromoter;
+    friend class SFunctionBase;
   };
 };
 
@@ -19,6 +19,16 @@ namespace spurv {
     this->variable->ensure_defined(bin);
   }
 
+  template<typename tt>
+  int SVariableEntry<tt>::getPointerID() {
+    return this->variable->getID();
+  }
+
+  template<typename tt>
+  int SVariableEntry<tt>::getTypeID() {
+    return tt::getID();
+  }
+
 
   /*
    * SVariableRegistry static functions
@@ -0,0 +1,151 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+#include <functional>
+
+using namespace spurv;
+
+// The rules of SAlgebraicSimplifier, as listed in algebraic_simplification.hpp. Each rule is
+// recorded with fast math off and on, and the result is compared with the output of the
+// rule. Rules on floats marked fast only apply with fast math, the same rules hold for
+// integers in both modes
+
+enum SGating {
+  GATING_ALWAYS, // Applied with and without fast math
+  GATING_FAST, // Only applied with fast math
+  GATING_NEVER // Looks like a rule, but is not one
+};
+
+struct SInputs {
+  float_v& x;
+  int_v& i;
+  vec3_v& v;
+  mat3_v& m;
+  mat3_v& identity;
+};
+
+struct SRule {
+  const char* rule;
+  SGating gating;
+  std::function<const SValueBase*(SInputs&)> input;
+  std::function<const SValueBase*(SInputs&)> output;
+};
+
+static const std::vector<SRule> rules = {
+  {"x * 1", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x * 1.0f); }, [](SInputs& in) { return &in.x; }},
+  {"1 * x", GATING_ALWAYS,
+   [](SInputs& in) { return &(1.0f * in.x); }, [](SInputs& in) { return &in.x; }},
+  {"x / 1", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x / 1.0f); }, [](SInputs& in) { return &in.x; }},
+  {"v * 1", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.v * vec3_s::cons(1.0f, 1.0f, 1.0f)); }, [](SInputs& in) { return &in.v; }},
+  {"x * -1", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x * -1.0f); }, [](SInputs& in) { return &(-in.x); }},
+  {"-1 * x", GATING_ALWAYS,
+   [](SInputs& in) { return &(-1.0f * in.x); }, [](SInputs& in) { return &(-in.x); }},
+  {"x - 0", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x - 0.0f); }, [](SInputs& in) { return &in.x; }},
+  {"x - (-0)", GATING_NEVER,
+   [](SInputs& in) { return &(in.x - (-0.0f)); }, [](SInputs& in) { return &in.x; }},
+  {"x + 0", GATING_FAST,
+   [](SInputs& in) { return &(in.x + 0.0f); }, [](SInputs& in) { return &in.x; }},
+  {"0 + x", GATING_FAST,
+   [](SInputs& in) { return &(0.0f + in.x); }, [](SInputs& in) { return &in.x; }},
+  {"i + 0", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.i + 0); }, [](SInputs& in) { return &in.i; }},
+  {"0 - x", GATING_FAST,
+   [](SInputs& in) { return &(0.0f - in.x); }, [](SInputs& in) { return &(-in.x); }},
+  {"0 - i", GATING_ALWAYS,
+   [](SInputs& in) { return &(0 - in.i); }, [](SInputs& in) { return &(-in.i); }},
+  {"x * 0", GATING_FAST,
+   [](SInputs& in) { return &(in.x * 0.0f); }, [](SInputs& in) { return &float_s::cons(0.0f); }},
+  {"0 * x", GATING_FAST,
+   [](SInputs& in) { return &(0.0f * in.x); }, [](SInputs& in) { return &float_s::cons(0.0f); }},
+  {"i * 0", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.i * 0); }, [](SInputs& in) { return &int_s::cons(0); }},
+  {"v * 0", GATING_NEVER, // Zeros are only made for scalars
+   [](SInputs& in) { return &(in.v * 0.0f); }, [](SInputs& in) { return &in.v; }},
+  {"x - x", GATING_FAST,
+   [](SInputs& in) { return &(in.x - in.x); }, [](SInputs& in) { return &float_s::cons(0.0f); }},
+  {"i - i", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.i - in.i); }, [](SInputs& in) { return &int_s::cons(0); }},
+  {"-(-x)", GATING_ALWAYS,
+   [](SInputs& in) { return &(-(-in.x)); }, [](SInputs& in) { return &in.x; }},
+  {"I * v", GATING_FAST,
+   [](SInputs& in) { return &(in.identity * in.v); }, [](SInputs& in) { return &in.v; }},
+  {"m * I", GATING_FAST,
+   [](SInputs& in) { return &(in.m * in.identity); }, [](SInputs& in) { return &in.m; }},
+  {"cast<A>(x)", GATING_ALWAYS, // Not allowed by cast itself
+   [](SInputs& in) { return &construct_expression<float_s, EXPR_CAST, float_s, void_s>(in.x, nullptr); },
+   [](SInputs& in) { return &in.x; }},
+  {"cast<A>(cast<B>(x))", GATING_ALWAYS,
+   [](SInputs& in) { return &cast<int_s>(cast<uint_s>(in.i)); }, [](SInputs& in) { return &in.i; }},
+  {"x < x", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x < in.x); }, [](SInputs& in) { return &SBool::cons(false); }},
+  {"x > x", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x > in.x); }, [](SInputs& in) { return &SBool::cons(false); }},
+  {"x != x", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.x != in.x); }, [](SInputs& in) { return &SBool::cons(false); }},
+  {"x == x", GATING_FAST,
+   [](SInputs& in) { return &(in.x == in.x); }, [](SInputs& in) { return &SBool::cons(true); }},
+  {"x <= x", GATING_FAST,
+   [](SInputs& in) { return &(in.x <= in.x); }, [](SInputs& in) { return &SBool::cons(true); }},
+  {"x >= x", GATING_FAST,
+   [](SInputs& in) { return &(in.x >= in.x); }, [](SInputs& in) { return &SBool::cons(true); }},
+  {"i == i", GATING_ALWAYS,
+   [](SInputs& in) { return &(in.i == in.i); }, [](SInputs& in) { return &SBool::cons(true); }},
+};
+
+// The same node, or constants with the same type and value
+static bool is_same(const SValueBase* a, const SValueBase* b) {
+  if(a == b) {
+    return true;
+  }
+
+  SNodeInfo info_a, info_b;
+  a->getNodeInfo(info_a);
+  b->getNodeInfo(info_b);
+  return info_a.kind == NODE_CONSTANT && info_b.kind == NODE_CONSTANT &&
+    info_a.type == info_b.type && info_a.value == info_b.value;
+}
+
+int main() {
+  bool success = true;
+
+  for(bool fast_math : {false, true}) {
+    SAlgebraicSimplifier::setFastMath(fast_math);
+
+    FragmentShader<float_s, vec3_s> shader;
+    float_v x = shader.input<0>();
+    vec3_v v = shader.input<1>();
+    int_v i = cast<int_s>(x);
+    mat3_v m = mat3_s::cons(v, v, v);
+    mat3_v identity = mat3_s::cons(1.0f, 0.0f, 0.0f,
+				   0.0f, 1.0f, 0.0f,
+				   0.0f, 0.0f, 1.0f);
+    SInputs inputs = {x, i, v, m, identity};
+
+    for(const SRule& rule : rules) {
+      bool expected = rule.gating == GATING_ALWAYS || (rule.gating == GATING_FAST && fast_math);
+      bool simplified = is_same(rule.input(inputs), rule.output(inputs));
+
+      if(simplified != expected) {
+	printf("%s was %ssimplified with fast math %s\n", rule.rule, simplified ? "" : "not ",
+	       fast_math ? "on" : "off");
+	success = false;
+      }
+    }
+
+    std::vector<uint32_t> bin;
+    shader.compile(bin, x);
+  }
+
+  SAlgebraicSimplifier::setFastMath(false);
+
+  if(success) {
+    printf("%zu rules checked with fast math off and on\n", rules.size());
+  }
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+
+using namespace spurv;
+
+// Selections written as branches, nested in each other, with values sunk into their arms
+// and into the blocks of an if-statement. The OpPhi of an outer selection must name the
+// block its arm ends in, which is the merge block of the inner selection. A value also
+// used after the if-statement must stay in front of it
+
+// Position of the first GLSL.std.450 instruction with the given number, or -1
+static int find_glsl(const std::vector<uint32_t>& bin, int instruction) {
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((bin[i] & 0xffff) == 12 && (int)bin[i + 4] == instruction) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+// Position of the first instruction with the given opcode, or -1
+static int find_opcode(const std::vector<uint32_t>& bin, int opcode) {
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static bool validate(const char* name, const std::vector<uint32_t>& bin) {
+  std::string error;
+  if(!SValidator::validate(bin, error)) {
+    printf("%s: Not valid: %s\n", name, error.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+int main() {
+  bool success = true;
+
+  {
+    std::vector<uint32_t> bin;
+    FragmentShader<vec2_s> shader;
+    vec2_v uv = shader.input<0>();
+
+    // Each arm only uses its own values, which are sunk into it
+    float_v inner = select(uv[1] > 0.25f, sqrt(uv[0] + uv[1]), exp(uv[0]) * 2.0f,
+			   SELECTION_CONTROL_DONT_FLATTEN);
+    float_v outer = select(uv[0] > 0.5f, inner * uv[1], cos(uv[1]) + 1.0f,
+			   SELECTION_CONTROL_DONT_FLATTEN);
+    float_v both = select(uv[1] > 0.75f, outer, select(uv[0] > 0.1f, sin(uv[1]), outer,
+							 SELECTION_CONTROL_DONT_FLATTEN),
+			  SELECTION_CONTROL_DONT_FLATTEN);
+
+    shader.compile(bin, both);
+
+    success = validate("nested selections", bin) && success;
+    if(SCodeSinker::getNumSunk() == 0) {
+      printf("nested selections: Nothing was sunk\n");
+      success = false;
+    }
+  }
+
+  {
+    std::vector<uint32_t> bin;
+    FragmentShader<vec2_s> shader;
+    vec2_v uv = shader.input<0>();
+
+    SLocal<float_s>& acc = shader.local<float_s>();
+    acc.store(0.0f);
+
+    float_v after = exp(uv[1]); // Used in the then block and after the if-statement
+    float_v then_only = cos(uv[0]) * uv[1];
+    float_v nested_only = sqrt(uv[0] + uv[1]);
+    float_v else_only = log(uv[0] + 2.0f);
+
+    shader.ifThen(uv[0] > 0.5f);
+    {
+      acc.store(acc.load() + then_only + after);
+      shader.ifThen(uv[1] > 0.5f);
+      {
+	acc.store(acc.load() + select(uv[0] > 0.75f, nested_only, uv[1],
+				      SELECTION_CONTROL_DONT_FLATTEN));
+      }
+      shader.endIf();
+    }
+    shader.elseThen();
+    {
+      acc.store(acc.load() + else_only);
+    }
+    shader.endIf();
+
+    acc.store(acc.load() * after);
+    shader.compile(bin, acc.load());
+
+    success = validate("if-statements", bin) && success;
+
+    // Exp = 27, Cos = 14, Sqrt = 31, Log = 28, OpSelectionMerge = 247
+    int first_merge = find_opcode(bin, 247);
+    if(find_glsl(bin, 27) > first_merge) {
+      printf("if-statements: A value used after the if-statement was sunk into it\n");
+      success = false;
+    }
+
+    if(find_glsl(bin, 14) < first_merge || find_glsl(bin, 31) < first_merge ||
+       find_glsl(bin, 28) < first_merge) {
+      printf("if-statements: A value used in one block only was not sunk\n");
+      success = false;
+    }
+  }
+
+  if(success) {
+    printf("Sunk values and nested selections validate\n");
+  }
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+
+using namespace spurv;
+
+// Compares a shader compiled with and without constant folding. Constant vectors scaled by
+// a constant, and lookups into them, are folded to constants, so neither OpVectorTimesScalar
+// nor OpCompositeExtract is left in the folded shader
+
+static int count_instructions(const std::vector<uint32_t>& bin, int opcode) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static void compile_shader(std::vector<uint32_t>& bin) {
+  SShader<SShaderType::SHADER_FRAGMENT, float_s> shader;
+  float_v s = shader.input<0>();
+
+  vec2_v scaled = vec2_s::cons(1.0f, 2.0f) * 0.5f;
+  vec3_v sum = vec3_s::cons(1.0f, 2.0f, 3.0f) + vec3_s::cons(0.5f, 0.5f, 0.5f);
+  float_v component = sum[1];
+
+  shader.compile(bin, vec4_s::cons(scaled[0] * s, scaled[1], component * s, 1.0f));
+}
+
+int main() {
+  std::vector<uint32_t> unfolded;
+  SConstantFolder::setEnabled(false);
+  compile_shader(unfolded);
+
+  std::vector<uint32_t> folded;
+  SConstantFolder::setEnabled(true);
+  compile_shader(folded);
+
+  const int times_scalar = 142; // OpVectorTimesScalar
+  const int extract = 81; // OpCompositeExtract
+  const int fadd = 129; // OpFAdd
+
+  printf("Without folding: %zu words, %d OpVectorTimesScalar, %d OpFAdd, %d OpCompositeExtract\n",
+	 unfolded.size(), count_instructions(unfolded, times_scalar),
+	 count_instructions(unfolded, fadd), count_instructions(unfolded, extract));
+  printf("With folding: %zu words, %d OpVectorTimesScalar, %d OpFAdd, %d OpCompositeExtract\n",
+	 folded.size(), count_instructions(folded, times_scalar),
+	 count_instructions(folded, fadd), count_instructions(folded, extract));
+
+  if(count_instructions(unfolded, times_scalar) != 1 || count_instructions(unfolded, fadd) != 1 ||
+     count_instructions(unfolded, extract) == 0) {
+    printf("The unfolded shader does not compute the constants\n");
+    return 1;
+  }
+
+  if(count_instructions(folded, times_scalar) != 0 || count_instructions(folded, fadd) != 0 ||
+     count_instructions(folded, extract) != 0 || folded.size() >= unfolded.size()) {
+    printf("Constant composites were not folded\n");
+    return 1;
+  }
+
+  return 0;
+}
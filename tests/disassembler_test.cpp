@@ -0,0 +1,192 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+
+using namespace spurv;
+
+// Golden tests of SDisassembler and SAssembler. Each golden/<name>.spvasm is assembled and
+// the binary disassembled, with numeric ids into golden/<name>.dis and with friendly names
+// into golden/<name>.friendly.dis, which must match the committed files. Both are then
+// assembled again, and must give the same binary, or one that only differs in the numbering
+// of ids for the friendly names. Run with --update to rewrite the outputs
+
+static const char* golden_names[] = {"fragment", "debug_info", "compute"};
+
+static bool read_file(const std::string& path, std::string& text) {
+  std::ifstream file(path, std::ios::binary);
+  if(!file) {
+    return false;
+  }
+
+  std::ostringstream oss;
+  oss << file.rdbuf();
+  text = oss.str();
+  return true;
+}
+
+static bool write_file(const std::string& path, const std::string& text) {
+  std::ofstream file(path, std::ios::binary);
+  file << text;
+  return (bool)file;
+}
+
+// Compares with the golden file, or rewrites it
+static bool check_output(const std::string& path, const std::string& text, bool update) {
+  if(update) {
+    if(!write_file(path, text)) {
+      printf("%s: Could not write file\n", path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  std::string golden;
+  if(!read_file(path, golden)) {
+    printf("%s: Could not read file\n", path.c_str());
+    return false;
+  }
+
+  if(text == golden) {
+    return true;
+  }
+
+  // Point out the first line that differs
+  std::istringstream text_lines(text), golden_lines(golden);
+  std::string text_line, golden_line;
+  for(int line = 1; ; line++) {
+    bool has_text = (bool)std::getline(text_lines, text_line);
+    bool has_golden = (bool)std::getline(golden_lines, golden_line);
+    if(!has_text || !has_golden || text_line != golden_line) {
+      printf("%s:%d: Disassembly differs\n  expected: %s\n  got:      %s\n", path.c_str(), line,
+	     has_golden ? golden_line.c_str() : "<end of file>", has_text ? text_line.c_str() : "<end of file>");
+      return false;
+    }
+  }
+}
+
+// The disassembly without the header comments and the alignment of the lines, with the ids
+// numbered in the order they first appear, so that binaries that only differ in the numbering
+// of ids give the same text
+static std::string canonical_disassembly(const std::vector<uint32_t>& binary) {
+  std::string text;
+  SDisassembler::disassemble(binary, text, DISASSEMBLE_NO_HEADER);
+
+  std::map<std::string, int> ids;
+  std::string res;
+  for(size_t i = 0; i < text.size(); i++) {
+    if(text[i] == ' ' && (res.empty() || res.back() == '\n')) {
+      continue;
+    }
+
+    res.push_back(text[i]);
+    if(text[i] != '%') {
+      continue;
+    }
+
+    size_t end = i + 1;
+    while(end < text.size() && isdigit((unsigned char)text[end])) {
+      end++;
+    }
+
+    std::map<std::string, int>::iterator it =
+      ids.insert(std::make_pair(text.substr(i + 1, end - i - 1), (int)ids.size() + 1)).first;
+    res += std::to_string(it->second);
+    i = end - 1;
+  }
+
+  return res;
+}
+
+// Numeric ids are kept by the assembler, so the binary is given back as it was. Friendly names
+// are numbered after the highest numeric id, so that binary is only checked to be the same
+// but for the numbering of ids
+static bool reassemble(const std::string& path, const std::string& text, int flags,
+		       const std::vector<uint32_t>& binary) {
+  std::vector<uint32_t> res;
+  std::string error;
+  if(!SAssembler::assemble(text, res, error)) {
+    printf("%s: Could not assemble the disassembly: %s\n", path.c_str(), error.c_str());
+    return false;
+  }
+
+  if(!(flags & DISASSEMBLE_FRIENDLY_NAMES)) {
+    if(res != binary) {
+      printf("%s: Assembling the disassembly gives another binary\n", path.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  if(!SValidator::validate(res, error)) {
+    printf("%s: Assembling the disassembly gives an invalid binary: %s\n", path.c_str(), error.c_str());
+    return false;
+  }
+
+  if(canonical_disassembly(res) != canonical_disassembly(binary)) {
+    printf("%s: Assembling the disassembly gives another module\n", path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_golden(const std::string& name, bool update) {
+  std::string input_path = "golden/" + name + ".spvasm";
+  std::string input;
+  if(!read_file(input_path, input)) {
+    printf("%s: Could not read file\n", input_path.c_str());
+    return false;
+  }
+
+  std::vector<uint32_t> binary;
+  std::string error;
+  if(!SAssembler::assemble(input, binary, error)) {
+    printf("%s: %s\n", input_path.c_str(), error.c_str());
+    return false;
+  }
+
+  if(!SValidator::validate(binary, error)) {
+    printf("%s: Not valid: %s\n", input_path.c_str(), error.c_str());
+    return false;
+  }
+
+  bool success = true;
+
+  const int flags[] = {DISASSEMBLE_DEFAULT, DISASSEMBLE_FRIENDLY_NAMES};
+  const char* suffixes[] = {".dis", ".friendly.dis"};
+  for(int i = 0; i < 2; i++) {
+    std::string output_path = "golden/" + name + suffixes[i];
+    std::string text;
+    if(!SDisassembler::disassemble(binary, text, flags[i])) {
+      printf("%s: Could not disassemble\n", input_path.c_str());
+      return false;
+    }
+
+    success = check_output(output_path, text, update) && reassemble(output_path, text, flags[i], binary) && success;
+  }
+
+  return success;
+}
+
+int main(int argc, char** argv) {
+  bool update = argc > 1 && !strcmp(argv[1], "--update");
+
+  bool success = true;
+  for(const char* name : golden_names) {
+    success = check_golden(name, update) && success;
+  }
+
+  if(success) {
+    printf("%zu golden files %s\n", sizeof(golden_names) / sizeof(golden_names[0]),
+	   update ? "updated" : "matched");
+  }
+
+  return success ? 0 : 1;
+}
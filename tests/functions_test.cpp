@@ -0,0 +1,167 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace spurv;
+
+// Functions defined with SShader::function. A function called from a loop calls another
+// one, and both are written as functions with the Const or Pure control, depending on
+// whether they read memory. INLINE_AUTO functions are inlined within the maximum inlined
+// size only. Run with capture-value or capture-local, a function using values of the
+// shader is recorded, which exits with a message instead (see CMakeLists.txt)
+
+static int count_opcode(const std::vector<uint32_t>& bin, int opcode) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+// Function controls of the OpFunctions other than the entry point, in order
+static std::vector<uint32_t> function_controls(const std::vector<uint32_t>& bin) {
+  uint32_t entry_point = 0;
+  std::vector<uint32_t> controls;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((bin[i] & 0xffff) == 15) { // OpEntryPoint
+      entry_point = bin[i + 2];
+    } else if((bin[i] & 0xffff) == 54 && bin[i + 2] != entry_point) { // OpFunction
+      controls.push_back(bin[i + 3]);
+    }
+  }
+
+  return controls;
+}
+
+static bool validate(const char* name, const std::vector<uint32_t>& bin) {
+  std::string error;
+  if(!SValidator::validate(bin, error)) {
+    printf("%s: Not valid: %s\n", name, error.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_calls() {
+  const char* name = "calls between functions";
+  std::vector<uint32_t> bin;
+  {
+    FragmentShader<float_s> shader;
+    float_v x = shader.input<0>();
+    auto& factor = shader.uniformBinding<float_s>(0, 0);
+
+    // Computes from its parameter only
+    auto& square = shader.function<float_s(float_s)>([](float_v y) -> float_v {
+	return y * y + 0.5f;
+      }, SInline::INLINE_NEVER);
+
+    // Reads a uniform
+    auto& shade = shader.function<float_s(float_s, int_s)>([&](float_v y, int_v n) -> float_v {
+	return square(y * factor.member<0>().load()) + cast<float_s>(n);
+      }, SInline::INLINE_NEVER);
+
+    SLocal<float_s>& acc = shader.local<float_s>();
+    acc.store(0.0f);
+    int_v i = shader.forLoop(0, 4, SUnroll::UNROLL_NONE);
+    {
+      acc.store(acc.load() + shade(x, i));
+    }
+    shader.endLoop();
+
+    shader.compile(bin, acc.load());
+  }
+
+  if(!validate(name, bin)) {
+    return false;
+  }
+
+  // OpFunction = 54, OpFunctionCall = 57
+  int num_functions = count_opcode(bin, 54);
+  int num_calls = count_opcode(bin, 57);
+  if(num_functions != 3 || num_calls != 2) {
+    printf("%s: %d functions and %d calls, expected 3 and 2\n", name, num_functions, num_calls);
+    return false;
+  }
+
+  // The caller is written first, as it marks its callees as called. Pure = 0x4, Const = 0x8
+  std::vector<uint32_t> controls = function_controls(bin);
+  if(controls != std::vector<uint32_t>{0x4, 0x8}) {
+    printf("%s: Expected a Pure function calling a Const one\n", name);
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_inlining(int max_inlined_size, bool inlined) {
+  const char* name = inlined ? "inlined within the maximum size" : "called beyond the maximum size";
+
+  int old_size = SFunctionInliner::getMaxInlinedSize();
+  SFunctionInliner::setMaxInlinedSize(max_inlined_size);
+
+  std::vector<uint32_t> bin;
+  {
+    FragmentShader<vec2_s> shader;
+    vec2_v uv = shader.input<0>();
+
+    auto& blend = shader.function<float_s(float_s, float_s)>([](float_v a, float_v b) -> float_v {
+	return a * 0.25f + b * 0.75f;
+      });
+
+    shader.compile(bin, blend(uv[0], uv[1]) + blend(uv[1], uv[0]));
+  }
+
+  SFunctionInliner::setMaxInlinedSize(old_size);
+
+  if(!validate(name, bin)) {
+    return false;
+  }
+
+  int num_calls = count_opcode(bin, 57);
+  int num_inlined = SFunctionInliner::getNumInlined();
+  if(num_calls != (inlined ? 0 : 2) || num_inlined != (inlined ? 2 : 0)) {
+    printf("%s: %d calls written and %d inlined\n", name, num_calls, num_inlined);
+    return false;
+  }
+
+  return true;
+}
+
+// Exits with a message, see SFunctionBase::analyze_body
+static void capture(bool local) {
+  std::vector<uint32_t> bin;
+  FragmentShader<float_s> shader;
+  float_v x = shader.input<0>();
+  SLocal<float_s>& acc = shader.local<float_s>();
+  acc.store(x);
+
+  auto& f = shader.function<float_s(float_s)>([&](float_v y) -> float_v {
+      return local ? y + acc.load() : y + x;
+    }, SInline::INLINE_NEVER);
+
+  shader.compile(bin, f(x));
+}
+
+int main(int argc, char** argv) {
+  if(argc > 1) {
+    capture(!strcmp(argv[1], "capture-local"));
+    printf("A function using values of the shader was accepted\n");
+    return 0;
+  }
+
+  bool success = true;
+  success = check_calls() && success;
+  success = check_inlining(SFunctionInliner::default_max_inlined_size, true) && success;
+  success = check_inlining(0, false) && success;
+
+  if(success) {
+    printf("Functions are called and inlined as expected\n");
+  }
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+
+using namespace spurv;
+
+// Shaders whose locals SLocalPromoter keeps in SSA values: a loop with both continue and
+// break edges, locals stored in one arm of an if-statement only (with and without a value
+// from before), and a local reached through access chains, which is left in memory. Each
+// is compiled with promotion on and off, and must validate either way
+
+static int count_opcode(const std::vector<uint32_t>& bin, int opcode) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+// OpVariables in the Function storage class
+static int count_locals(const std::vector<uint32_t>& bin) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((bin[i] & 0xffff) == 59 && bin[i + 3] == 7) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static void loop_shader(std::vector<uint32_t>& bin) {
+  FragmentShader<vec2_s> shader;
+  vec2_v uv = shader.input<0>();
+
+  SLocal<float_s>& acc = shader.local<float_s>();
+  SLocal<float_s>& last = shader.local<float_s>();
+  acc.store(0.0f);
+  last.store(uv[1]);
+
+  int_v i = shader.forLoop(0, 16, SUnroll::UNROLL_NONE);
+  {
+    float_v x = cast<float_s>(i) * uv[0];
+
+    shader.ifThen(x > 4.0f);
+    {
+      last.store(x);
+      shader.breakLoop();
+    }
+    shader.endIf();
+
+    shader.ifThen(x < 1.0f);
+    {
+      acc.store(acc.load() + 0.5f);
+      shader.continueLoop();
+    }
+    shader.endIf();
+
+    acc.store(acc.load() + x);
+  }
+  shader.endLoop();
+
+  shader.compile(bin, acc.load() + last.load());
+}
+
+static void one_arm_shader(std::vector<uint32_t>& bin) {
+  FragmentShader<vec2_s> shader;
+  vec2_v uv = shader.input<0>();
+
+  SLocal<float_s>& kept = shader.local<float_s>();
+  SLocal<float_s>& unset = shader.local<float_s>(); // Loaded before any store on the else edge
+  kept.store(uv[0]);
+
+  shader.ifThen(uv[0] > 0.5f);
+  {
+    kept.store(uv[1] * 2.0f);
+    unset.store(uv[1]);
+  }
+  shader.endIf();
+
+  shader.compile(bin, kept.load() + unset.load());
+}
+
+static void chain_shader(std::vector<uint32_t>& bin) {
+  FragmentShader<vec2_s> shader;
+  vec2_v uv = shader.input<0>();
+
+  SLocal<SArr<2, SStorageClass::STORAGE_FUNCTION, float_s> >& v =
+    shader.local<SArr<2, SStorageClass::STORAGE_FUNCTION, float_s> >();
+  SLocal<float_s>& s = shader.local<float_s>();
+  v[0].store(uv[0]);
+  v[1].store(uv[1]);
+  s.store(uv[0]);
+
+  shader.ifThen(uv[1] > 0.5f);
+  {
+    v[1].store(uv[0] + 1.0f);
+    s.store(uv[1]);
+  }
+  shader.endIf();
+
+  shader.compile(bin, v[0].load() + v[1].load() + s.load());
+}
+
+static bool check(const char* name, void (*record)(std::vector<uint32_t>&), int num_promoted,
+		  int num_locals, bool has_undef) {
+  bool success = true;
+  std::string error;
+
+  for(bool promote : {false, true}) {
+    SLocalPromoter::setEnabled(promote);
+
+    std::vector<uint32_t> bin;
+    record(bin);
+
+    if(!SValidator::validate(bin, error)) {
+      printf("%s: Not valid with promotion %s: %s\n", name, promote ? "on" : "off", error.c_str());
+      success = false;
+      continue;
+    }
+
+    if(!promote) {
+      continue;
+    }
+
+    // OpUndef = 1, OpPhi = 245
+    if(SLocalPromoter::getNumPromoted() != num_promoted || count_locals(bin) != num_locals) {
+      printf("%s: %d locals promoted and %d left, expected %d and %d\n", name,
+	     SLocalPromoter::getNumPromoted(), count_locals(bin), num_promoted, num_locals);
+      success = false;
+    }
+
+    if((count_opcode(bin, 1) > 0) != has_undef) {
+      printf("%s: Expected %s OpUndef\n", name, has_undef ? "an" : "no");
+      success = false;
+    }
+
+    if(count_opcode(bin, 245) == 0) {
+      printf("%s: No values were joined with OpPhi\n", name);
+      success = false;
+    }
+  }
+
+  SLocalPromoter::setEnabled(true);
+
+  if(success) {
+    printf("%s: validates\n", name);
+  }
+
+  return success;
+}
+
+int main() {
+  bool success = true;
+
+  // Both locals and the iterator
+  success = check("loop with break and continue", loop_shader, 3, 0, false) && success;
+  success = check("locals stored in one arm", one_arm_shader, 2, 0, true) && success;
+  // The array is only accessed through chains, the float is promoted
+  success = check("local reached through access chains", chain_shader, 1, 1, false) && success;
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+#include <string>
+#include <map>
+
+using namespace spurv;
+
+// Loops unrolled by SLoopUnroller, checked by the number of loops left and of copies of
+// the body (each computes one sine) in the compiled shader, which must validate:
+// partial unrolling with a remainder, nested full unrolling, loops that break out (never
+// unrolled) and empty ranges. Where a single loop is left, the number of times it runs is
+// checked as well
+
+struct SLoopCase {
+  const char* name;
+  int start, end;
+  SUnroll unroll;
+  int factor;
+  bool nested; // Inside a fully unrolled loop of 2 iterations
+  bool breaks;
+
+  int num_loops; // OpLoopMerges in the shader
+  int num_copies; // Sines in the shader
+  int num_trips; // Of the loop left, if one is left and not nested
+};
+
+static const SLoopCase cases[] = {
+  // 2 trips of 3 copies, stepping to 6, and iteration 6 on its own
+  {"7 iterations, partial by 3", 0, 7, SUnroll::UNROLL_PARTIAL, 3, false, false, 1, 4, 2},
+  {"7 iterations, full", 0, 7, SUnroll::UNROLL_FULL, 0, false, false, 0, 7, 0},
+  {"6 iterations, partial by 3", 0, 6, SUnroll::UNROLL_PARTIAL, 3, false, false, 1, 3, 2},
+  {"nested, full", 0, 3, SUnroll::UNROLL_FULL, 0, true, false, 0, 6, 0},
+  // A trip of 2 copies and iteration 2 on its own, in each of the 2 outer iterations
+  {"nested, partial by 2", 0, 3, SUnroll::UNROLL_PARTIAL, 2, true, false, 2, 6, 0},
+  {"breaking, full", 0, 4, SUnroll::UNROLL_FULL, 0, false, true, 1, 1, 4},
+  {"breaking, auto", 0, 4, SUnroll::UNROLL_AUTO, 0, false, true, 1, 1, 4},
+  {"auto", 2, 6, SUnroll::UNROLL_AUTO, 0, false, false, 0, 4, 0},
+  {"empty, auto", 5, 5, SUnroll::UNROLL_AUTO, 0, false, false, 0, 0, 0},
+  {"empty, full", 5, 5, SUnroll::UNROLL_FULL, 0, false, false, 0, 0, 0},
+  {"empty, partial", 5, 5, SUnroll::UNROLL_PARTIAL, 3, false, false, 0, 0, 0},
+  {"empty, none", 5, 5, SUnroll::UNROLL_NONE, 0, false, false, 1, 1, 0},
+  {"reversed, auto", 5, 2, SUnroll::UNROLL_AUTO, 0, false, false, 0, 0, 0},
+  {"reversed, full", 5, 2, SUnroll::UNROLL_FULL, 0, false, false, 0, 0, 0},
+  {"reversed, partial", 5, 2, SUnroll::UNROLL_PARTIAL, 3, false, false, 0, 0, 0},
+};
+
+static int count_opcode(const std::vector<uint32_t>& bin, int opcode) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+// The number of times the only loop in bin runs, from the constants it starts at, compares
+// its iterator with and steps by (the largest one added to the iterator)
+static int count_trips(const std::vector<uint32_t>& bin) {
+  std::map<uint32_t, int> constants;
+  uint32_t iterator = 0;
+  int start = 0, end = 0, step = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    switch(bin[i] & 0xffff) {
+    case 43: // OpConstant
+      constants[bin[i + 2]] = (int)bin[i + 3];
+      break;
+    case 245: // OpPhi, the first one is the iterator's
+      if(!iterator) {
+	iterator = bin[i + 2];
+	start = constants[bin[i + 3]];
+      }
+      break;
+    case 177: // OpSLessThan
+      if(bin[i + 3] == iterator) {
+	end = constants[bin[i + 4]];
+      }
+      break;
+    case 128: // OpIAdd
+      if(bin[i + 3] == iterator && constants.count(bin[i + 4]) && constants[bin[i + 4]] > step) {
+	step = constants[bin[i + 4]];
+      }
+      break;
+    }
+  }
+
+  return step > 0 ? (end - start + step - 1) / step : -1;
+}
+
+// GLSL.std.450 instructions with the given number
+static int count_glsl(const std::vector<uint32_t>& bin, int instruction) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((bin[i] & 0xffff) == 12 && (int)bin[i + 4] == instruction) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static void record_loop(FragmentShader<float_s>& shader, SLocal<float_s>& acc, float_v x,
+			const SLoopCase& c, float_v offset) {
+  int_v i = shader.forLoop(c.start, c.end, c.unroll, c.factor);
+  {
+    float_v t = cast<float_s>(i) * x + offset;
+    if(c.breaks) {
+      shader.ifThen(t > 2.0f);
+      {
+	shader.breakLoop();
+      }
+      shader.endIf();
+    }
+
+    acc.store(acc.load() + sin(t));
+  }
+  shader.endLoop();
+}
+
+static bool check(const SLoopCase& c) {
+  std::vector<uint32_t> bin;
+  {
+    FragmentShader<float_s> shader;
+    float_v x = shader.input<0>();
+
+    SLocal<float_s>& acc = shader.local<float_s>();
+    acc.store(0.0f);
+
+    if(c.nested) {
+      int_v j = shader.forLoop(0, 2, SUnroll::UNROLL_FULL);
+      {
+	record_loop(shader, acc, x, c, cast<float_s>(j) * 0.5f);
+      }
+      shader.endLoop();
+    } else {
+      record_loop(shader, acc, x, c, float_s::cons(0.25f));
+    }
+
+    shader.compile(bin, acc.load());
+  }
+
+  std::string error;
+  if(!SValidator::validate(bin, error)) {
+    printf("%s: Not valid: %s\n", c.name, error.c_str());
+    return false;
+  }
+
+  // OpLoopMerge = 246, Sin = 13
+  int num_loops = count_opcode(bin, 246);
+  int num_copies = count_glsl(bin, 13);
+  if(num_loops != c.num_loops || num_copies != c.num_copies) {
+    printf("%s: %d loops and %d copies of the body, expected %d and %d\n", c.name,
+	   num_loops, num_copies, c.num_loops, c.num_copies);
+    return false;
+  }
+
+  if(num_loops == 1 && !c.nested && count_trips(bin) != c.num_trips) {
+    printf("%s: The loop runs %d times, expected %d\n", c.name, count_trips(bin), c.num_trips);
+    return false;
+  }
+
+  return true;
+}
+
+int main() {
+  bool success = true;
+  for(const SLoopCase& c : cases) {
+    success = check(c) && success;
+  }
+
+  if(success) {
+    printf("%zu loops unrolled as expected\n", sizeof(cases) / sizeof(cases[0]));
+  }
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+using namespace spurv;
+
+// Measures how fast SModule parses and emits a binary written by SShader::compile, in MB/s
+// of SPIR-V. The number of passes over the binary may be given as the first argument
+
+static double seconds_since(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char** argv) {
+  int num_passes = argc > 1 ? atoi(argv[1]) : 2000;
+
+  std::vector<uint32_t> bin;
+  {
+    FragmentShader<vec2_s> shader;
+    vec2_v coord = shader.input<0>();
+
+    // Unrolled, to get a binary of some size
+    SLocal<float_s>& acc = shader.local<float_s>();
+    acc.store(0.0f);
+    int_v i = shader.forLoop(0, 64, SUnroll::UNROLL_FULL);
+    {
+      float_v t = cast<float_s>(i) * coord[0] + coord[1];
+      acc.store(acc.load() * t + sin(t));
+    }
+    shader.endLoop();
+
+    shader.compile(bin, acc.load());
+  }
+
+  double megabytes = (double)bin.size() * sizeof(uint32_t) * num_passes / 1e6;
+
+  SModule module;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_passes; i++) {
+    module.parse(bin);
+  }
+  double parse_time = seconds_since(begin);
+
+  std::vector<uint32_t> emitted;
+  begin = std::chrono::steady_clock::now();
+  for(int i = 0; i < num_passes; i++) {
+    emitted.clear();
+    module.emit(emitted);
+  }
+  double emit_time = seconds_since(begin);
+
+  if(emitted != bin) {
+    printf("Emitted module differs from the parsed one\n");
+    return 1;
+  }
+
+  printf("%zu words, %d passes\n", bin.size(), num_passes);
+  printf("parse: %.1f MB/s\n", megabytes / parse_time);
+  printf("emit: %.1f MB/s\n", megabytes / emit_time);
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "../include/spurv.hpp"
+
+#include <cstdio>
+
+using namespace spurv;
+
+// Parses binaries written by SShader::compile and one in the style of glslang's output with
+// debug info, and checks that SModule emits them again word for word, also when they are
+// given in the other byte order. The debug info is then stripped from the latter
+
+static const char* debug_info_module =
+  "               OpCapability Shader\n"
+  "               OpExtension \"SPV_KHR_non_semantic_info\"\n"
+  "          %1 = OpExtInstImport \"GLSL.std.450\"\n"
+  "          %2 = OpExtInstImport \"NonSemantic.Shader.DebugInfo.100\"\n"
+  "               OpMemoryModel Logical GLSL450\n"
+  "               OpEntryPoint Fragment %main \"main\" %color\n"
+  "               OpExecutionMode %main OriginUpperLeft\n"
+  "       %file = OpString \"shader.frag\"\n"
+  "               OpSource GLSL 450 %file\n"
+  "               OpName %main \"main\"\n"
+  "               OpName %color \"color\"\n"
+  "               OpDecorate %color Location 0\n"
+  "       %void = OpTypeVoid\n"
+  "         %fn = OpTypeFunction %void\n"
+  "       %uint = OpTypeInt 32 0\n"
+  "      %float = OpTypeFloat 32\n"
+  "    %v4float = OpTypeVector %float 4\n"
+  "    %ptr_out = OpTypePointer Output %v4float\n"
+  "      %color = OpVariable %ptr_out Output\n"
+  "     %uint_2 = OpConstant %uint 2\n"
+  "     %uint_4 = OpConstant %uint 4\n"
+  "    %float_1 = OpConstant %float 1\n"
+  "      %white = OpConstantComposite %v4float %float_1 %float_1 %float_1 %float_1\n"
+  "     %source = OpExtInst %void %2 35 %file\n" // DebugSource
+  "       %unit = OpExtInst %void %2 1 %uint_2 %uint_4 %source %uint_2\n" // DebugCompilationUnit
+  "       %main = OpFunction %void None %fn\n"
+  "      %entry = OpLabel\n"
+  "      %scope = OpExtInst %void %2 23 %unit\n" // DebugScope
+  "               OpLine %file 3 0\n"
+  "               OpStore %color %white\n"
+  "               OpReturn\n"
+  "               OpFunctionEnd\n";
+
+static int count_instructions(const std::vector<uint32_t>& bin, int opcode) {
+  int count = 0;
+  for(unsigned int i = 5; i < bin.size(); i += bin[i] >> 16) {
+    if((int)(bin[i] & 0xffff) == opcode) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static bool round_trip(const char* name, const std::vector<uint32_t>& bin) {
+  SModule module;
+  module.parse(bin);
+
+  std::vector<uint32_t> emitted;
+  module.emit(emitted);
+  if(emitted != bin) {
+    printf("%s: Emitted module differs from the parsed one\n", name);
+    return false;
+  }
+
+  std::vector<uint32_t> swapped(bin.size());
+  for(unsigned int i = 0; i < bin.size(); i++) {
+    uint32_t w = bin[i];
+    swapped[i] = (w >> 24) | ((w >> 8) & 0xff00) | ((w << 8) & 0xff0000) | (w << 24);
+  }
+
+  module.parse(swapped);
+  emitted.clear();
+  module.emit(emitted);
+  if(emitted != bin) {
+    printf("%s: Emitted module differs from the parsed one in the other byte order\n", name);
+    return false;
+  }
+
+  printf("%s: %zu words round-tripped\n", name, bin.size());
+  return true;
+}
+
+int main() {
+  bool success = true;
+
+  {
+    std::vector<uint32_t> bin;
+    VertexShader<vec4_s, vec2_s> shader;
+    vec4_v position = shader.input<0>();
+    vec2_v tex_coord = shader.input<1>();
+
+    shader.setBuiltin<BUILTIN_POSITION>(position);
+    shader.compile(bin, tex_coord);
+
+    success = round_trip("vertex shader", bin) && success;
+  }
+
+  {
+    std::vector<uint32_t> bin;
+    FragmentShader<vec2_s> shader;
+    vec2_v coord = shader.input<0>();
+
+    auto& factor = shader.uniformBinding<float_s>(0, 0);
+    texture2D_v tex = shader.uniformConstant<texture2D_s>(0, 1).load();
+
+    auto& shade = shader.function<float_s(float_s)>([](float_v x) -> float_v {
+	return x * x + 0.5f;
+      }, SInline::INLINE_NEVER);
+
+    SLocal<float_s>& acc = shader.local<float_s>();
+    acc.store(0.0f);
+    int_v i = shader.forLoop(0, 8, SUnroll::UNROLL_NONE);
+    {
+      float_v t = cast<float_s>(i) * factor.member<0>().load();
+      shader.ifThen(t > coord[0]);
+      {
+	shader.breakLoop();
+      }
+      shader.endIf();
+      acc.store(acc.load() + shade(t));
+    }
+    shader.endLoop();
+
+    float_v a = acc.load();
+    shader.compile(bin, select(a > 1.0f, 1.0f, a) * tex[coord]);
+
+    success = round_trip("fragment shader", bin) && success;
+  }
+
+  {
+    std::vector<uint32_t> bin;
+    std::string error;
+    if(!SAssembler::assemble(debug_info_module, bin, error)) {
+      printf("Could not assemble the module with debug info: %s\n", error.c_str());
+      return 1;
+    }
+
+    if(!SValidator::validate(bin, error)) {
+      printf("The module with debug info is not valid: %s\n", error.c_str());
+      return 1;
+    }
+
+    success = round_trip("module with debug info", bin) && success;
+
+    SModule module;
+    module.parse(bin);
+    int num_removed = module.stripDebugInfo();
+
+    std::vector<uint32_t> stripped;
+    module.emit(stripped);
+
+    // OpExtension, OpExtInstImport, OpString, OpSource, 2 OpNames, 3 OpExtInsts and OpLine
+    if(num_removed != 10 || count_instructions(stripped, 12) != 0 || count_instructions(stripped, 8) != 0 ||
+       count_instructions(stripped, 10) != 0 || count_instructions(stripped, 11) != 1 ||
+       count_instructions(stripped, 5) != 0) {
+      printf("Debug info was not stripped (%d instructions removed)\n", num_removed);
+      success = false;
+    } else if(!SValidator::validate(stripped, error)) {
+      printf("The stripped module is not valid: %s\n", error.c_str());
+      success = false;
+    } else {
+      printf("module with debug info: %zu words stripped to %zu\n", bin.size(), stripped.size());
+    }
+  }
+
+  return success ? 0 : 1;
+}